@@ -1,6 +1,7 @@
 #pragma once
 
 #include "config.hpp"
+#include "crc.hpp"
 #include "utils_ldpc.hpp"
 #include <string>
 
@@ -54,6 +55,11 @@ public:
                 information[i] = 1 + (ue_id * 3) + (i % 3);
             }
         }
+        if (lc.cbCrc) {
+            crc_obj.add_cb_crc24(
+                reinterpret_cast<unsigned char*>(&information[0]),
+                cfg->num_bytes_per_cb);
+        }
 
         ldpc_encode_helper(cfg->LDPC_config.Bg, cfg->LDPC_config.Zc,
             cfg->LDPC_config.nRows, &encoded_codeword[0], &parity[0],
@@ -123,6 +129,7 @@ public:
 
 private:
     FastRand fast_rand; // A fast random number generator
+    DoCRC crc_obj; // Computes codeblock CRCs if enabled
     Config* cfg; // The global Agora config
     const Profile profile; // The pattern of the input byte sequence
 };
@@ -0,0 +1,112 @@
+#include <gflags/gflags.h>
+#include <mkl.h>
+#define ARMA_DONT_PRINT_ERRORS
+#include <armadillo>
+#include <iostream>
+#include "timer.h"
+#include "zf_batch.hpp"
+
+double freq_ghz = -1.0;  // RDTSC frequency
+
+// First 20% iterations are for warmup and not accounted for in timing
+static constexpr double warmup_fraction = .2;
+
+DEFINE_uint64(n_iters, 16000, "Number of matrices to invert");
+DEFINE_uint64(n_rows, 64, "Number of matrix rows (base station antennas)");
+DEFINE_uint64(n_cols, 16, "Number of matrix columns (users)");
+
+// Return the zero forcing matrices for all test matrices, computed one at a
+// time with Armadillo like DoZF::compute_precoder(), and matrices per second
+std::pair<std::vector<arma::cx_fmat>, double> arma_zf(
+    const std::vector<arma::cx_fmat>& test_matrices) {
+  std::vector<arma::cx_fmat> ret(FLAGS_n_iters);
+  const size_t n_warmup = FLAGS_n_iters * warmup_fraction;
+  size_t start_tsc = 0;
+
+  for (size_t iter = 0; iter < FLAGS_n_iters; iter++) {
+    if (iter == n_warmup) start_tsc = rdtsc();
+    const arma::cx_fmat& input = test_matrices[iter];
+    ret[iter].set_size(FLAGS_n_cols, FLAGS_n_rows);
+    try {
+      ret[iter] = arma::inv_sympd(input.t() * input) * input.t();
+    } catch (std::runtime_error) {
+      ret[iter] = arma::pinv(input);
+    }
+  }
+
+  double secs = to_sec(rdtsc() - start_tsc, freq_ghz);
+  return std::make_pair(ret, (FLAGS_n_iters - n_warmup) / secs);
+}
+
+// Same as arma_zf(), but in batches of BatchedZF::kBatchSize matrices like
+// DoZF::ZF_time_orthogonal_batched()
+std::pair<std::vector<arma::cx_fmat>, double> batched_zf(
+    const std::vector<arma::cx_fmat>& test_matrices) {
+  std::vector<arma::cx_fmat> ret(FLAGS_n_iters);
+  for (auto& m : ret) m.set_size(FLAGS_n_cols, FLAGS_n_rows);
+  BatchedZF batched(FLAGS_n_rows, FLAGS_n_cols);
+  // Round the warmup up to whole batches
+  const size_t n_warmup =
+      (static_cast<size_t>(FLAGS_n_iters * warmup_fraction) +
+       BatchedZF::kBatchSize - 1) /
+      BatchedZF::kBatchSize * BatchedZF::kBatchSize;
+  size_t start_tsc = 0;
+  size_t n_failed = 0;
+
+  for (size_t iter = 0; iter < FLAGS_n_iters;
+       iter += BatchedZF::kBatchSize) {
+    if (iter == n_warmup) start_tsc = rdtsc();
+    const size_t n_lanes =
+        std::min(BatchedZF::kBatchSize, FLAGS_n_iters - iter);
+    for (size_t lane = 0; lane < n_lanes; lane++) {
+      batched.load(lane,
+                   reinterpret_cast<const float*>(
+                       test_matrices[iter + lane].memptr()));
+    }
+    batched.compute(n_lanes);
+    for (size_t lane = 0; lane < n_lanes; lane++) {
+      if (batched.failed(lane)) {
+        ret[iter + lane] = arma::pinv(test_matrices[iter + lane]);
+        n_failed++;
+      } else {
+        batched.store(lane,
+                      reinterpret_cast<float*>(ret[iter + lane].memptr()));
+      }
+    }
+  }
+
+  double secs = to_sec(rdtsc() - start_tsc, freq_ghz);
+  if (n_failed > 0) fprintf(stderr, "%zu batched inversions failed\n", n_failed);
+  return std::make_pair(ret, (FLAGS_n_iters - n_warmup) / secs);
+}
+
+int main(int argc, char** argv) {
+  mkl_set_num_threads(1);
+  arma::arma_rng::set_seed_random();
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  freq_ghz = measure_rdtsc_freq();
+  nano_sleep(100 * 1000 * 1000, freq_ghz);  // Trigger turbo for 100 ms
+
+  std::vector<arma::cx_fmat> test_matrices;
+  for (size_t i = 0; i < FLAGS_n_iters; i++) {
+    test_matrices.push_back(
+        arma::randn<arma::cx_fmat>(FLAGS_n_rows, FLAGS_n_cols));
+  }
+
+  std::pair<std::vector<arma::cx_fmat>, double> ret_arma =
+      arma_zf(test_matrices);
+  std::pair<std::vector<arma::cx_fmat>, double> ret_batched =
+      batched_zf(test_matrices);
+
+  // Header: "<matrix size> <Matrices/s with Armadillo> <Matrices/s batched>
+  // <Speedup with batching>"
+  printf("%zux%zu %.0f %.0f %.2f\n", FLAGS_n_rows, FLAGS_n_cols,
+         ret_arma.second, ret_batched.second,
+         ret_batched.second / ret_arma.second);
+
+  double norm_sum = 0.0;
+  for (size_t i = 0; i < FLAGS_n_iters; i++) {
+    norm_sum += arma::norm(ret_arma.first[i] - ret_batched.first[i]);
+  }
+  fprintf(stderr, "Computation proof = %.4f\n", norm_sum / FLAGS_n_iters);
+}
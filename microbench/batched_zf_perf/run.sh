@@ -0,0 +1,9 @@
+#!/bin/bash
+echo "Matrix_size Arma_matrices/s Batched_matrices/s Speedup"
+for n_rows in 8 16 32 64; do
+  for n_cols in 4 8 16; do
+    if [ ${n_cols} -le ${n_rows} ]; then
+      numactl --physcpubind=0 --membind=0 ./bench --n_rows ${n_rows} --n_cols ${n_cols} --n_iters 16000 2>/dev/null
+    fi
+  done
+done
@@ -0,0 +1,143 @@
+#include <gflags/gflags.h>
+#include <random>
+#include <vector>
+#include "fft_transpose.hpp"
+#include "timer.h"
+
+double freq_ghz = -1.0;  // RDTSC frequency
+
+DEFINE_uint64(bs_ant_num, 64, "Number of base station antennas");
+DEFINE_uint64(ofdm_ca_num, 2048, "Number of subcarriers per symbol");
+DEFINE_uint64(ofdm_data_num, 1200, "Number of data subcarriers per symbol");
+DEFINE_uint64(n_iters, 1000, "Number of symbols to process");
+
+// Inputs and outputs of one symbol of all antennas
+struct Symbol {
+  size_t data_start;
+  std::vector<complex_float> fft_out;  // One FFT output per antenna
+  std::vector<uint16_t> fp16_in;       // fp16 copy of fft_out
+  complex_float* fft_in;  // Buffer for conversion to float
+  complex_float* pilots_sgn;
+  complex_float* out_buf;  // Partially-transposed output
+};
+
+// Return the cycles per antenna to transpose n_iters symbols of float
+// samples with [fn], like DoFFT::partial_transpose()
+double time_float(FFTTransposeFn fn, Symbol& s, bool pilot) {
+  const size_t num_blocks = FLAGS_ofdm_data_num / kTransposeBlockSize;
+  const size_t start_tsc = rdtsc();
+  for (size_t iter = 0; iter < FLAGS_n_iters; iter++) {
+    for (size_t ant = 0; ant < FLAGS_bs_ant_num; ant++) {
+      fn(&s.fft_out[ant * FLAGS_ofdm_ca_num + s.data_start], s.out_buf, ant,
+         FLAGS_bs_ant_num, num_blocks, pilot ? s.pilots_sgn : nullptr);
+    }
+  }
+  return (rdtsc() - start_tsc) * 1.0 / (FLAGS_n_iters * FLAGS_bs_ant_num);
+}
+
+// Return the cycles per antenna to transpose n_iters symbols of fp16
+// samples. If [fn] is nullptr, each antenna's symbol is converted to float
+// first and then transposed with fft_transpose_avx2().
+double time_fp16(FP16TransposeFn fn, Symbol& s, bool pilot) {
+  const size_t num_blocks = FLAGS_ofdm_data_num / kTransposeBlockSize;
+  const size_t start_tsc = rdtsc();
+  for (size_t iter = 0; iter < FLAGS_n_iters; iter++) {
+    for (size_t ant = 0; ant < FLAGS_bs_ant_num; ant++) {
+      const uint16_t* in = &s.fp16_in[2 * ant * FLAGS_ofdm_ca_num];
+      if (fn != nullptr) {
+        fn(in + 2 * s.data_start, s.out_buf, ant, FLAGS_bs_ant_num,
+           num_blocks, pilot ? s.pilots_sgn : nullptr);
+        continue;
+      }
+      float* fft_in = reinterpret_cast<float*>(s.fft_in);
+      for (size_t i = 0; i < 2 * FLAGS_ofdm_ca_num; i += 8) {
+        _mm256_store_ps(fft_in + i,
+                        _mm256_cvtph_ps(_mm_load_si128(
+                            reinterpret_cast<const __m128i*>(in + i))));
+      }
+      fft_transpose_avx2(&s.fft_in[s.data_start], s.out_buf, ant,
+                         FLAGS_bs_ant_num, num_blocks,
+                         pilot ? s.pilots_sgn : nullptr);
+    }
+  }
+  return (rdtsc() - start_tsc) * 1.0 / (FLAGS_n_iters * FLAGS_bs_ant_num);
+}
+
+// Return the largest absolute difference between two buffers of n elements
+float max_diff(const complex_float* a, const complex_float* b, size_t n) {
+  float ret = 0;
+  for (size_t i = 0; i < n; i++) {
+    ret = std::max(ret, std::abs(a[i].re - b[i].re));
+    ret = std::max(ret, std::abs(a[i].im - b[i].im));
+  }
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  freq_ghz = measure_rdtsc_freq();
+  const size_t ants = FLAGS_bs_ant_num;
+  if (FLAGS_ofdm_data_num % kTransposeBlockSize != 0 ||
+      FLAGS_ofdm_data_num > FLAGS_ofdm_ca_num) {
+    fprintf(stderr, "Invalid number of data subcarriers\n");
+    return -1;
+  }
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx512f")) {
+    fprintf(stderr, "AVX-512 not supported\n");
+    return -1;
+  }
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+  Symbol s;
+  s.data_start = (FLAGS_ofdm_ca_num - FLAGS_ofdm_data_num) / 2;
+  s.fft_out.resize(ants * FLAGS_ofdm_ca_num);
+  s.fp16_in.resize(2 * ants * FLAGS_ofdm_ca_num);
+  s.fft_in = static_cast<complex_float*>(
+      aligned_alloc(64, FLAGS_ofdm_ca_num * sizeof(complex_float)));
+  for (size_t i = 0; i < s.fft_out.size(); i++) {
+    s.fft_out[i] = {dist(gen), dist(gen)};
+    s.fp16_in[2 * i] = _cvtss_sh(s.fft_out[i].re, 0);
+    s.fp16_in[2 * i + 1] = _cvtss_sh(s.fft_out[i].im, 0);
+  }
+  s.pilots_sgn = static_cast<complex_float*>(
+      aligned_alloc(64, FLAGS_ofdm_data_num * sizeof(complex_float)));
+  for (size_t i = 0; i < FLAGS_ofdm_data_num; i++) {
+    s.pilots_sgn[i] = {dist(gen), dist(gen)};
+  }
+  const size_t out_size = FLAGS_ofdm_data_num * ants;
+  s.out_buf = static_cast<complex_float*>(
+      aligned_alloc(64, out_size * sizeof(complex_float)));
+  std::vector<complex_float> avx2_out(out_size);
+
+  // Header: "<Antennas> <Input> <Symbol> <AVX2 cycles/antenna> <AVX-512
+  // cycles/antenna> <Speedup>"
+  for (bool pilot : {false, true}) {
+    const char* symbol = pilot ? "pilot" : "data";
+
+    const double avx2_cycles = time_float(fft_transpose_avx2, s, pilot);
+    memcpy(avx2_out.data(), s.out_buf, out_size * sizeof(complex_float));
+    const double avx512_cycles = time_float(fft_transpose_avx512, s, pilot);
+    if (max_diff(avx2_out.data(), s.out_buf, out_size) > 1e-5) {
+      fprintf(stderr, "AVX-512 float kernel produces wrong results\n");
+      return -1;
+    }
+    printf("%zu float %s %.1f %.1f %.2f\n", ants, symbol, avx2_cycles,
+           avx512_cycles, avx2_cycles / avx512_cycles);
+
+    const double avx2_fp16_cycles = time_fp16(nullptr, s, pilot);
+    memcpy(avx2_out.data(), s.out_buf, out_size * sizeof(complex_float));
+    const double avx512_fp16_cycles =
+        time_fp16(fp16_transpose_avx512, s, pilot);
+    if (max_diff(avx2_out.data(), s.out_buf, out_size) > 1e-5) {
+      fprintf(stderr, "AVX-512 fp16 kernel produces wrong results\n");
+      return -1;
+    }
+    printf("%zu fp16 %s %.1f %.1f %.2f\n", ants, symbol, avx2_fp16_cycles,
+           avx512_fp16_cycles, avx2_fp16_cycles / avx512_fp16_cycles);
+  }
+  free(s.fft_in);
+  free(s.pilots_sgn);
+  free(s.out_buf);
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+# Compare the AVX2 and AVX-512 post-FFT transpose kernels for several antenna
+# counts
+echo "Antennas Input Symbol AVX2_cycles/ant AVX512_cycles/ant Speedup"
+for ants in 8 16 32 64; do
+  ./bench --bs_ant_num ${ants}
+done
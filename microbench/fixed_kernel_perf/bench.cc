@@ -0,0 +1,140 @@
+#include <gflags/gflags.h>
+#include <armadillo>
+#include <random>
+#include <vector>
+#include "equalize.hpp"
+#include "precode.hpp"
+#include "timer.h"
+
+double freq_ghz = -1.0;  // RDTSC frequency
+
+DEFINE_uint64(bs_ant_num, 64, "Number of base station antennas");
+DEFINE_uint64(ue_num, 16, "Number of UEs");
+DEFINE_uint64(num_scs, 1200, "Number of data subcarriers per symbol");
+DEFINE_uint64(n_iters, 1000, "Number of symbols to process");
+
+// Return the cycles per subcarrier to equalize n_iters symbols with [fn], like
+// DoDemul::equalize_demod_fused() with one zeroforcing matrix per subcarrier
+double time_equalize(EqualizeTileFn fn,
+                     const std::vector<complex_float>& data,
+                     std::vector<std::vector<complex_float>>& ul_zf,
+                     std::vector<complex_float>& out) {
+  complex_float* ul_zf_ptrs[kEqualizeTileSCs];
+  alignas(64) complex_float tile[kMaxUEs * kEqualizeTileSCs];
+  const size_t start_tsc = rdtsc();
+  for (size_t iter = 0; iter < FLAGS_n_iters; iter++) {
+    for (size_t i = 0; i < FLAGS_num_scs; i += kEqualizeTileSCs) {
+      const size_t num_sc = std::min(kEqualizeTileSCs, FLAGS_num_scs - i);
+      for (size_t j = 0; j < num_sc; j++) ul_zf_ptrs[j] = ul_zf[i + j].data();
+      fn(data.data(), ul_zf_ptrs, nullptr, FLAGS_bs_ant_num, FLAGS_ue_num, i,
+         num_sc, tile);
+      for (size_t j = 0; j < num_sc; j++) {
+        for (size_t u = 0; u < FLAGS_ue_num; u++) {
+          out[(i + j) * FLAGS_ue_num + u] = tile[u * kEqualizeTileSCs + j];
+        }
+      }
+    }
+  }
+  return (rdtsc() - start_tsc) * 1.0 / (FLAGS_n_iters * FLAGS_num_scs);
+}
+
+// Return the cycles per subcarrier to precode n_iters symbols, with [fn] or
+// with Armadillo like DoPrecode::precoding_per_sc() if [fn] is nullptr
+double time_precode(PrecodeScFn fn,
+                    std::vector<std::vector<complex_float>>& dl_zf,
+                    std::vector<complex_float>& data,
+                    std::vector<complex_float>& out) {
+  const size_t start_tsc = rdtsc();
+  for (size_t iter = 0; iter < FLAGS_n_iters; iter++) {
+    for (size_t i = 0; i < FLAGS_num_scs; i++) {
+      complex_float* data_ptr = &data[i * FLAGS_ue_num];
+      complex_float* out_ptr = &out[i * FLAGS_bs_ant_num];
+      if (fn != nullptr) {
+        fn(dl_zf[i].data(), data_ptr, out_ptr);
+      } else {
+        arma::cx_fmat mat_precoder(
+            reinterpret_cast<arma::cx_float*>(dl_zf[i].data()),
+            FLAGS_bs_ant_num, FLAGS_ue_num, false);
+        arma::cx_fmat mat_data(reinterpret_cast<arma::cx_float*>(data_ptr),
+                               FLAGS_ue_num, 1, false);
+        arma::cx_fmat mat_precoded(reinterpret_cast<arma::cx_float*>(out_ptr),
+                                   FLAGS_bs_ant_num, 1, false);
+        mat_precoded = mat_precoder * mat_data;
+      }
+    }
+  }
+  return (rdtsc() - start_tsc) * 1.0 / (FLAGS_n_iters * FLAGS_num_scs);
+}
+
+// Return the largest absolute difference between two vectors
+float max_diff(const std::vector<complex_float>& a,
+               const std::vector<complex_float>& b) {
+  float ret = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    ret = std::max(ret, std::abs(a[i].re - b[i].re));
+    ret = std::max(ret, std::abs(a[i].im - b[i].im));
+  }
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  freq_ghz = measure_rdtsc_freq();
+  const size_t ants = FLAGS_bs_ant_num, ues = FLAGS_ue_num;
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+  auto rand_vec = [&](size_t n) {
+    std::vector<complex_float> v(n);
+    for (auto& x : v) x = {dist(gen), dist(gen)};
+    return v;
+  };
+
+  // Partially-transposed received data of one symbol, and one zeroforcing
+  // matrix and precoder per subcarrier
+  const size_t num_blocks =
+      (FLAGS_num_scs + kTransposeBlockSize - 1) / kTransposeBlockSize;
+  std::vector<complex_float> data =
+      rand_vec(num_blocks * kTransposeBlockSize * ants);
+  std::vector<std::vector<complex_float>> zf(FLAGS_num_scs);
+  for (auto& m : zf) m = rand_vec(ants * ues);
+  std::vector<complex_float> dl_data = rand_vec(FLAGS_num_scs * ues);
+
+  __builtin_cpu_init();
+  const bool use_avx512 = __builtin_cpu_supports("avx512f");
+  EqualizeTileFn generic_eq = select_equalize_tile_fn(ants, ues, false);
+  EqualizeTileFn fixed_eq =
+      select_fixed_equalize_tile_fn(ants, ues, use_avx512);
+  PrecodeScFn fixed_precode = select_precode_sc_fn(ants, ues);
+  if (fixed_eq == nullptr || fixed_precode == nullptr) {
+    fprintf(stderr, "No specialized kernels for %zu antennas and %zu UEs\n",
+            ants, ues);
+    return -1;
+  }
+
+  std::vector<complex_float> eq_generic(FLAGS_num_scs * ues);
+  std::vector<complex_float> eq_fixed(FLAGS_num_scs * ues);
+  const double eq_generic_cycles =
+      time_equalize(generic_eq, data, zf, eq_generic);
+  const double eq_fixed_cycles = time_equalize(fixed_eq, data, zf, eq_fixed);
+
+  std::vector<complex_float> pc_generic(FLAGS_num_scs * ants);
+  std::vector<complex_float> pc_fixed(FLAGS_num_scs * ants);
+  const double pc_generic_cycles =
+      time_precode(nullptr, zf, dl_data, pc_generic);
+  const double pc_fixed_cycles =
+      time_precode(fixed_precode, zf, dl_data, pc_fixed);
+
+  if (max_diff(eq_generic, eq_fixed) > 1e-3 ||
+      max_diff(pc_generic, pc_fixed) > 1e-3) {
+    fprintf(stderr, "Specialized kernels produce wrong results\n");
+    return -1;
+  }
+
+  // Header: "<Antennas> <UEs> <Kernel> <Generic cycles/subcarrier> <Fixed
+  // cycles/subcarrier> <Speedup>"
+  printf("%zu %zu equalize %.1f %.1f %.2f\n", ants, ues, eq_generic_cycles,
+         eq_fixed_cycles, eq_generic_cycles / eq_fixed_cycles);
+  printf("%zu %zu precode %.1f %.1f %.2f\n", ants, ues, pc_generic_cycles,
+         pc_fixed_cycles, pc_generic_cycles / pc_fixed_cycles);
+}
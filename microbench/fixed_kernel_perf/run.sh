@@ -0,0 +1,8 @@
+#!/bin/bash
+# Compare generic and specialized equalization and precoding kernels for all
+# antenna and UE counts that have specialized kernels
+echo "Antennas UEs Kernel Generic_cycles/sc Fixed_cycles/sc Speedup"
+for dims in "8 4" "16 8" "32 8" "64 16" "64 32"; do
+  set -- ${dims}
+  ./bench --bs_ant_num $1 --ue_num $2
+done
@@ -0,0 +1,208 @@
+#include <gflags/gflags.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <complex>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "timer.h"
+
+typedef std::complex<float> cx_float;
+
+double freq_ghz = -1.0;  // RDTSC frequency
+
+DEFINE_string(kernel, "demul", "Kernel to run: demul or zf");
+DEFINE_string(placement, "local",
+              "Placement of each node's frame slots: local, remote, or "
+              "interleave");
+DEFINE_uint64(threads_per_node, 4, "Worker threads per NUMA node");
+DEFINE_uint64(num_ants, 64, "Number of base station antennas");
+DEFINE_uint64(num_ues, 16, "Number of UEs");
+DEFINE_uint64(num_scs, 1200, "Number of data subcarriers per frame slot");
+DEFINE_uint64(duration_sec, 5, "Duration of the measurement in seconds");
+
+// Parse a sysfs CPU or node list such as "0-3,8-11"
+std::vector<size_t> parse_sysfs_list(const std::string& path) {
+  std::vector<size_t> ret;
+  std::ifstream file(path);
+  std::string list, range;
+  if (!std::getline(file, list)) return ret;
+  std::stringstream ss(list);
+  while (std::getline(ss, range, ',')) {
+    const size_t dash = range.find('-');
+    const size_t lo = std::stoul(range.substr(0, dash));
+    const size_t hi =
+        dash == std::string::npos ? lo : std::stoul(range.substr(dash + 1));
+    for (size_t i = lo; i <= hi; i++) ret.push_back(i);
+  }
+  return ret;
+}
+
+// Bind [len] bytes at page-aligned [addr] to the nodes in [nodemask]
+void bind_pages(void* addr, size_t len, int mode, unsigned long nodemask) {
+  if (syscall(SYS_mbind, addr, len, mode, &nodemask, 65, 0) != 0) {
+    perror("mbind() failed");
+    exit(-1);
+  }
+}
+
+void pin_to_cpu(size_t cpu) {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+    fprintf(stderr, "Failed to pin to CPU %zu\n", cpu);
+    exit(-1);
+  }
+}
+
+// Equalize one subcarrier like DoDemul: out = zf (UE x ant) * data (ant)
+void demul_subcarrier(const cx_float* zf, const cx_float* data,
+                      cx_float* out) {
+  for (size_t u = 0; u < FLAGS_num_ues; u++) {
+    cx_float sum = 0;
+    const cx_float* row = &zf[u * FLAGS_num_ants];
+    for (size_t a = 0; a < FLAGS_num_ants; a++) sum += row[a] * data[a];
+    out[u] = sum;
+  }
+}
+
+// Compute the Gram matrix of one subcarrier like DoZF: out = H^H * H, where
+// H is the ant x UE CSI matrix
+void zf_subcarrier(const cx_float* csi, cx_float* out) {
+  for (size_t i = 0; i < FLAGS_num_ues; i++) {
+    for (size_t j = 0; j < FLAGS_num_ues; j++) {
+      cx_float sum = 0;
+      for (size_t a = 0; a < FLAGS_num_ants; a++) {
+        const cx_float* row = &csi[a * FLAGS_num_ues];
+        sum += std::conj(row[i]) * row[j];
+      }
+      out[i * FLAGS_num_ues + j] = sum;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  freq_ghz = measure_rdtsc_freq();
+  const bool is_demul = FLAGS_kernel == "demul";
+  if (!is_demul && FLAGS_kernel != "zf") {
+    fprintf(stderr, "Invalid kernel %s\n", FLAGS_kernel.c_str());
+    return -1;
+  }
+
+  std::vector<size_t> nodes =
+      parse_sysfs_list("/sys/devices/system/node/online");
+  if (nodes.empty()) nodes.push_back(0);
+  const size_t num_nodes = nodes.size();
+  const size_t ants = FLAGS_num_ants, ues = FLAGS_num_ues;
+
+  // Per subcarrier, the demul kernel reads a zeroforcing matrix and antenna
+  // samples, and the zf kernel reads a CSI matrix
+  const size_t in_per_sc = is_demul ? ues * ants + ants : ants * ues;
+  const size_t out_per_sc = is_demul ? ues : ues * ues;
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t slot_bytes =
+      (FLAGS_num_scs * (in_per_sc + out_per_sc) * sizeof(cx_float) +
+       page_size - 1) /
+      page_size * page_size;
+  const size_t node_bytes = slot_bytes * FLAGS_threads_per_node;
+
+  // One contiguous buffer like Agora's, with the frame slots of node i's
+  // threads in the i-th region
+  auto* buf = static_cast<uint8_t*>(mmap(nullptr, node_bytes * num_nodes,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (buf == MAP_FAILED) {
+    perror("mmap() failed");
+    return -1;
+  }
+  unsigned long all_nodes_mask = 0;
+  for (size_t node : nodes) all_nodes_mask |= 1ul << node;
+  for (size_t i = 0; i < num_nodes; i++) {
+    if (FLAGS_placement == "interleave") {
+      bind_pages(buf + i * node_bytes, node_bytes, MPOL_INTERLEAVE,
+                 all_nodes_mask);
+    } else {
+      const size_t target = FLAGS_placement == "remote"
+                                ? nodes[(i + 1) % num_nodes]
+                                : nodes[i];
+      bind_pages(buf + i * node_bytes, node_bytes, MPOL_BIND, 1ul << target);
+    }
+  }
+  // Fault in all pages with their policy, and fill the inputs
+  for (size_t i = 0; i < node_bytes * num_nodes / sizeof(float); i++) {
+    reinterpret_cast<float*>(buf)[i] = (i % 17) / 17.0f;
+  }
+
+  std::atomic<size_t> num_ready(0);
+  std::atomic<bool> start(false), stop(false);
+  std::vector<size_t> num_scs_done(num_nodes * FLAGS_threads_per_node, 0);
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i < num_nodes; i++) {
+    const std::vector<size_t> cpus = parse_sysfs_list(
+        "/sys/devices/system/node/node" + std::to_string(nodes[i]) +
+        "/cpulist");
+    if (cpus.size() < FLAGS_threads_per_node) {
+      fprintf(stderr, "Node %zu has only %zu CPUs\n", nodes[i], cpus.size());
+      return -1;
+    }
+    for (size_t t = 0; t < FLAGS_threads_per_node; t++) {
+      const size_t thread_idx = i * FLAGS_threads_per_node + t;
+      const size_t cpu = cpus[t];
+      threads.emplace_back([&, thread_idx, cpu] {
+        pin_to_cpu(cpu);
+        auto* in = reinterpret_cast<cx_float*>(buf + thread_idx * slot_bytes);
+        cx_float* out = in + FLAGS_num_scs * in_per_sc;
+        num_ready++;
+        while (!start) {
+        }
+
+        size_t done = 0;
+        while (!stop) {
+          for (size_t sc = 0; sc < FLAGS_num_scs; sc++) {
+            if (is_demul) {
+              demul_subcarrier(&in[sc * ues * ants],
+                               &in[FLAGS_num_scs * ues * ants + sc * ants],
+                               &out[sc * ues]);
+            } else {
+              zf_subcarrier(&in[sc * ants * ues], &out[sc * ues * ues]);
+            }
+          }
+          done += FLAGS_num_scs;
+        }
+        num_scs_done[thread_idx] = done;
+      });
+    }
+  }
+
+  while (num_ready != threads.size()) {
+  }
+  const size_t start_tsc = rdtsc();
+  start = true;
+  sleep(FLAGS_duration_sec);
+  stop = true;
+  for (auto& thread : threads) thread.join();
+  const double secs = to_sec(rdtsc() - start_tsc, freq_ghz);
+
+  // Header: "<Kernel> <Placement> <Node> <Threads> <Subcarriers/s> <GB/s>",
+  // where GB/s counts the input bytes read
+  for (size_t i = 0; i < num_nodes; i++) {
+    size_t scs = 0;
+    for (size_t t = 0; t < FLAGS_threads_per_node; t++) {
+      scs += num_scs_done[i * FLAGS_threads_per_node + t];
+    }
+    printf("%s %s %zu %zu %.0f %.2f\n", FLAGS_kernel.c_str(),
+           FLAGS_placement.c_str(), nodes[i], FLAGS_threads_per_node,
+           scs / secs, scs * in_per_sc * sizeof(cx_float) / (secs * 1e9));
+  }
+  munmap(buf, node_bytes * num_nodes);
+}
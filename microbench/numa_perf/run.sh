@@ -0,0 +1,10 @@
+#!/bin/bash
+# Measure demodulation-like and ZF-like throughput per NUMA node with buffers
+# on the local node, on a remote node, and interleaved across nodes
+echo "Kernel Placement Node Threads Subcarriers/s GB/s"
+for kernel in demul zf; do
+  for placement in local remote interleave; do
+    ./bench --kernel ${kernel} --placement ${placement} --threads_per_node 4 \
+      --duration_sec 5
+  done
+done
@@ -0,0 +1,109 @@
+#include <gflags/gflags.h>
+#include <random>
+#include <vector>
+#include "precode.hpp"
+#include "timer.h"
+
+double freq_ghz = -1.0;  // RDTSC frequency
+
+DEFINE_uint64(ue_num, 8, "Number of UEs");
+DEFINE_uint64(ofdm_data_num, 1200, "Number of data subcarriers per symbol");
+DEFINE_uint64(demul_block_size, 48, "Number of subcarriers per precode task");
+DEFINE_uint64(pilot_spacing, 16, "Spacing of pilot subcarriers");
+DEFINE_uint64(mod_order_bits, 4, "Bits per modulated sample");
+DEFINE_uint64(n_iters, 1000, "Number of symbols to modulate");
+
+// Return the pilot flags of the block of subcarriers that starts at
+// [base_sc_id], like DoPrecode
+void mark_pilot_scs(bool pilot_symbol, size_t base_sc_id,
+                    std::vector<size_t>& flags) {
+  for (size_t i = 0; i < flags.size(); i++) {
+    flags[i] =
+        pilot_symbol || (base_sc_id + i) % FLAGS_pilot_spacing == 0 ? 1 : 0;
+  }
+}
+
+// Return the cycles per subcarrier to modulate n_iters symbols. If [simd] is
+// false, each UE and subcarrier is modulated separately.
+double time_modulation(bool simd, bool pilot_symbol,
+                       const std::vector<int8_t>& raw, size_t raw_stride,
+                       const std::vector<const complex_float*>& pilots,
+                       const std::vector<complex_float>& mod_table,
+                       std::vector<complex_float>& out) {
+  const size_t ues = FLAGS_ue_num;
+  std::vector<size_t> flags(FLAGS_demul_block_size);
+  size_t cycles = 0;
+  for (size_t iter = 0; iter < FLAGS_n_iters; iter++) {
+    for (size_t base_sc_id = 0; base_sc_id < FLAGS_ofdm_data_num;
+         base_sc_id += FLAGS_demul_block_size) {
+      const size_t num_scs = std::min(FLAGS_demul_block_size,
+                                      FLAGS_ofdm_data_num - base_sc_id);
+      mark_pilot_scs(pilot_symbol, base_sc_id, flags);
+      complex_float* out_block = &out[base_sc_id * ues];
+
+      const size_t start_tsc = rdtsc();
+      if (simd) {
+        modulate_block_avx2(raw.data(), raw_stride, pilots.data(), base_sc_id,
+                            flags.data(), mod_table.data(), ues, num_scs,
+                            out_block);
+      } else {
+        for (size_t i = 0; i < num_scs; i++) {
+          for (size_t u = 0; u < ues; u++) {
+            const size_t sc_id = base_sc_id + i;
+            if (flags[i] == 1) {
+              out_block[i * ues + u] = pilots[u][sc_id];
+            } else {
+              out_block[i * ues + u] =
+                  mod_table[static_cast<uint8_t>(raw[u * raw_stride + sc_id])];
+            }
+          }
+        }
+      }
+      cycles += rdtsc() - start_tsc;
+    }
+  }
+  return cycles * 1.0 / (FLAGS_n_iters * FLAGS_ofdm_data_num);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  freq_ghz = measure_rdtsc_freq();
+  const size_t ues = FLAGS_ue_num;
+  const size_t table_size = 1ul << FLAGS_mod_order_bits;
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+  std::vector<complex_float> mod_table(table_size);
+  for (auto& v : mod_table) v = {dist(gen), dist(gen)};
+
+  // Modulation table indices and pilots of each UE, with rows padded like
+  // Agora's buffers
+  const size_t raw_stride = (FLAGS_ofdm_data_num + 63) / 64 * 64;
+  std::vector<int8_t> raw(ues * raw_stride);
+  for (auto& v : raw) v = gen() % table_size;
+  std::vector<std::vector<complex_float>> pilot_rows(ues);
+  std::vector<const complex_float*> pilots(ues);
+  for (size_t u = 0; u < ues; u++) {
+    pilot_rows[u].resize(FLAGS_ofdm_data_num);
+    for (auto& v : pilot_rows[u]) v = {dist(gen), dist(gen)};
+    pilots[u] = pilot_rows[u].data();
+  }
+
+  std::vector<complex_float> scalar_out(FLAGS_ofdm_data_num * ues);
+  std::vector<complex_float> simd_out(FLAGS_ofdm_data_num * ues);
+
+  // Header: "<UEs> <Symbol> <Scalar cycles/sc> <SIMD cycles/sc> <Speedup>"
+  for (bool pilot_symbol : {false, true}) {
+    const double scalar_cycles = time_modulation(
+        false, pilot_symbol, raw, raw_stride, pilots, mod_table, scalar_out);
+    const double simd_cycles = time_modulation(
+        true, pilot_symbol, raw, raw_stride, pilots, mod_table, simd_out);
+    if (memcmp(scalar_out.data(), simd_out.data(),
+               scalar_out.size() * sizeof(complex_float)) != 0) {
+      fprintf(stderr, "SIMD modulation produces wrong results\n");
+      return -1;
+    }
+    printf("%zu %s %.1f %.1f %.2f\n", ues, pilot_symbol ? "pilot" : "data",
+           scalar_cycles, simd_cycles, scalar_cycles / simd_cycles);
+  }
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+# Compare scalar and vectorized downlink modulation for several UE counts
+echo "UEs Symbol Scalar_cycles/sc SIMD_cycles/sc Speedup"
+for ues in 1 4 8 16 32; do
+  ./bench --ue_num ${ues}
+done
@@ -0,0 +1,116 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "timer.h"
+
+double freq_ghz = -1.0;  // RDTSC frequency
+
+// Largest UDP payload that Agora packets can have
+static constexpr size_t kMaxPacketSize = 9000;
+
+DEFINE_uint64(base_port, 8000, "UDP port of the first radio (bs_server_port)");
+DEFINE_uint64(num_ports, 8, "Number of radios, with consecutive UDP ports");
+DEFINE_uint64(batch_size, 1,
+              "Packets per system call. One uses recv(), larger values use "
+              "recvmmsg()");
+DEFINE_uint64(duration_sec, 5, "Duration of the measurement in seconds");
+
+// Return a non-blocking UDP socket bound to [port], like setup_socket_ipv4()
+int setup_socket(uint16_t port) {
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    perror("socket() failed");
+    exit(-1);
+  }
+  int sock_buf_size = 1024 * 1024 * 64 * 8 - 1;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &sock_buf_size,
+             sizeof(sock_buf_size));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+      0) {
+    perror("bind() failed");
+    exit(-1);
+  }
+  fcntl(sock, F_SETFL, O_NONBLOCK);
+  return sock;
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  freq_ghz = measure_rdtsc_freq();
+
+  std::vector<int> sockets(FLAGS_num_ports);
+  for (size_t i = 0; i < FLAGS_num_ports; i++) {
+    sockets[i] = setup_socket(FLAGS_base_port + i);
+  }
+
+  // Consecutive packet slots like a socket thread's RX buffer in Agora
+  const size_t num_slots = 4096;
+  std::vector<char> rx_buffer(num_slots * kMaxPacketSize);
+  std::vector<struct mmsghdr> msgs(FLAGS_batch_size);
+  std::vector<struct iovec> iovecs(FLAGS_batch_size);
+  memset(&msgs[0], 0, FLAGS_batch_size * sizeof(struct mmsghdr));
+  for (size_t i = 0; i < FLAGS_batch_size; i++) {
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    iovecs[i].iov_len = kMaxPacketSize;
+  }
+
+  size_t num_pkts = 0, num_bytes = 0, num_syscalls = 0;
+  size_t rx_offset = 0, port_idx = 0;
+  const size_t start_tsc = rdtsc();
+  const size_t duration_cycles =
+      static_cast<size_t>(FLAGS_duration_sec * freq_ghz * 1e9);
+
+  while (rdtsc() - start_tsc < duration_cycles) {
+    const int sock = sockets[port_idx];
+    port_idx = (port_idx + 1) % FLAGS_num_ports;
+    num_syscalls++;
+
+    if (FLAGS_batch_size == 1) {
+      ssize_t ret =
+          recv(sock, &rx_buffer[rx_offset * kMaxPacketSize], kMaxPacketSize, 0);
+      if (ret <= 0) continue;
+      num_pkts++;
+      num_bytes += ret;
+      rx_offset = (rx_offset + 1) % num_slots;
+    } else {
+      // Receive into consecutive slots, without wrapping around
+      const size_t n = std::min(FLAGS_batch_size, num_slots - rx_offset);
+      for (size_t i = 0; i < n; i++) {
+        iovecs[i].iov_base = &rx_buffer[(rx_offset + i) * kMaxPacketSize];
+      }
+      int ret = recvmmsg(sock, &msgs[0], n, MSG_DONTWAIT, nullptr);
+      if (ret <= 0) continue;
+      for (int i = 0; i < ret; i++) num_bytes += msgs[i].msg_len;
+      num_pkts += ret;
+      rx_offset = (rx_offset + ret) % num_slots;
+    }
+  }
+
+  const double secs = to_sec(rdtsc() - start_tsc, freq_ghz);
+  if (num_pkts == 0) {
+    fprintf(stderr, "No packets received. Is the sender running?\n");
+    return -1;
+  }
+
+  // Header: "<Batch size> <Packets/s> <Gbps> <System calls per packet>"
+  printf("%zu %.0f %.2f %.2f\n", FLAGS_batch_size, num_pkts / secs,
+         num_bytes * 8 / (secs * 1e9), num_syscalls * 1.0 / num_pkts);
+
+  for (int sock : sockets) close(sock);
+}
@@ -0,0 +1,16 @@
+#!/bin/bash
+# Run the simulator sender in the background and measure the packet rate
+# received with different socket batch sizes
+conf_file=../../data/tddconfig-sim-ul.json
+../../build/sender --num_threads=2 --core_offset=2 --frame_duration=1000 \
+  --enable_slow_start=0 --conf_file=${conf_file} > /dev/null 2>&1 &
+sender_pid=$!
+sleep 2
+
+echo "Batch_size Packets/s Gbps Syscalls/packet"
+for batch_size in 1 4 8 16 32 64; do
+  numactl --physcpubind=0 --membind=0 ./bench --batch_size ${batch_size} \
+    --num_ports 8 --duration_sec 5 2>/dev/null
+done
+
+kill ${sender_pid}
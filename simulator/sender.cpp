@@ -242,9 +242,7 @@ void* Sender::worker_thread(int tid)
         (size_t)tid, ant_num_this_thread, cfg->BS_ANT_NUM, num_worker_threads_);
 
     // We currently don't support zero-padding OFDM prefix and postfix
-    rt_assert(cfg->packet_length
-        == Packet::kOffsetOfData
-            + 2 * sizeof(unsigned short) * (cfg->CP_LEN + cfg->OFDM_CA_NUM));
+    rt_assert(cfg->sampsPerSymbol == cfg->CP_LEN + cfg->OFDM_CA_NUM);
     size_t ant_num_per_cell = cfg->BS_ANT_NUM / cfg->nCells;
     while (true) {
         gen_tag_t tag = 0;
@@ -268,9 +266,17 @@ void* Sender::worker_thread(int tid)
         pkt->symbol_id = cfg->getSymbolId(tag.symbol_id);
         pkt->cell_id = tag.ant_id / ant_num_per_cell;
         pkt->ant_id = tag.ant_id - ant_num_per_cell * (pkt->cell_id);
-        memcpy(pkt->data,
-            iq_data_short_[(pkt->symbol_id * cfg->BS_ANT_NUM) + tag.ant_id],
-            (cfg->CP_LEN + cfg->OFDM_CA_NUM) * sizeof(unsigned short) * 2);
+        pkt->comp_hdr = cfg->fronthaul_comp_hdr();
+        const unsigned short* iq_data
+            = iq_data_short_[(pkt->symbol_id * cfg->BS_ANT_NUM) + tag.ant_id];
+        if (cfg->bfp_iq_width != 0) {
+            bfp_compress(reinterpret_cast<const short*>(iq_data),
+                cfg->sampsPerSymbol, cfg->bfp_iq_width,
+                reinterpret_cast<uint8_t*>(pkt->data));
+        } else {
+            memcpy(pkt->data, iq_data,
+                (cfg->CP_LEN + cfg->OFDM_CA_NUM) * sizeof(unsigned short) * 2);
+        }
         if (cfg->fft_in_rru) {
             run_fft(pkt, fft_inout, mkl_handle);
         }
@@ -4,13 +4,15 @@ using namespace std;
 Agora::Agora(Config* cfg)
     : freq_ghz(measure_rdtsc_freq())
     , base_worker_core_offset(cfg->core_offset + 1 + cfg->socket_thread_num)
-    , csi_buffers_(kFrameWnd, cfg->UE_NUM, cfg->BS_ANT_NUM * cfg->OFDM_DATA_NUM)
+    , csi_buffers_(kFrameWnd, cfg->UE_NUM, cfg->BS_ANT_NUM * cfg->OFDM_DATA_NUM,
+          cfg->buffer_page_backing)
     , ul_zf_matrices_(
           kFrameWnd, cfg->OFDM_DATA_NUM, cfg->BS_ANT_NUM * cfg->UE_NUM)
     , demod_buffers_(kFrameWnd, cfg->symbol_num_perframe, cfg->UE_NUM,
-          kMaxModType * cfg->OFDM_DATA_NUM)
+          kMaxModType * cfg->OFDM_DATA_NUM, cfg->buffer_page_backing)
     , decoded_buffer_(kFrameWnd, cfg->symbol_num_perframe, cfg->UE_NUM,
-          cfg->LDPC_config.nblocksInSymbol * roundup<64>(cfg->num_bytes_per_cb))
+          cfg->LDPC_config.nblocksInSymbol * roundup<64>(cfg->num_bytes_per_cb),
+          cfg->buffer_page_backing)
     , dl_zf_matrices_(
           kFrameWnd, cfg->OFDM_DATA_NUM, cfg->UE_NUM * cfg->BS_ANT_NUM)
 {
@@ -19,6 +21,7 @@ Agora::Agora(Config* cfg)
         directory.c_str(), freq_ghz);
 
     this->config_ = cfg;
+    mod_order_bits_ = cfg->mod_order_bits;
 
     pin_to_core_with_offset(
         ThreadType::kMaster, cfg->core_offset, 0, false /* quiet */);
@@ -29,10 +32,20 @@ Agora::Agora(Config* cfg)
         printf("Agora: Initializing downlink buffers\n");
         initialize_downlink_buffers();
     }
+    place_buffers();
+    print_memory_footprint();
 
     stats = new Stats(cfg, kMaxStatBreakdown, freq_ghz);
     phy_stats = new PhyStats(cfg);
 
+    if (cfg->task_trace_events > 0) {
+        task_tracer_.reset(new TaskTracer(
+            cfg->worker_thread_num, cfg->task_trace_events, freq_ghz));
+        TaskTracer::install_signal_handler();
+    }
+    if (cfg->metrics_port > 0)
+        metrics_server_.reset(new MetricsServer(cfg->metrics_port));
+
     /* Initialize TXRX threads */
     packet_tx_rx_.reset(
         new PacketTXRX(cfg, cfg->core_offset + 1, &message_queue_,
@@ -49,6 +62,11 @@ Agora::Agora(Config* cfg)
         mac_std_thread_ = std::thread(&MacThread::run_event_loop, mac_thread_);
     }
 
+    if (config_->zf_tracking_mode) {
+        zf_tracker_.reset(
+            new ZFTracker(cfg->OFDM_DATA_NUM, cfg->BS_ANT_NUM, cfg->UE_NUM));
+    }
+
     /* Create worker threads */
     if (config_->bigstation_mode) {
         create_threads(pthread_fun_wrapper<Agora, &Agora::worker_fft>, 0,
@@ -57,17 +75,32 @@ Agora::Agora(Config* cfg)
             cfg->fft_thread_num, cfg->fft_thread_num + cfg->zf_thread_num);
         create_threads(pthread_fun_wrapper<Agora, &Agora::worker_demul>,
             cfg->fft_thread_num + cfg->zf_thread_num, cfg->worker_thread_num);
+    } else if (config_->work_stealing_mode) {
+        work_stealing_sched_.reset(new WorkStealingScheduler(cfg));
+        create_threads(
+            pthread_fun_wrapper<Agora, &Agora::worker_work_stealing>, 0,
+            cfg->worker_thread_num);
     } else {
         create_threads(pthread_fun_wrapper<Agora, &Agora::worker>, 0,
             cfg->worker_thread_num);
     }
 
-    printf("Master thread core %zu, TX/RX thread cores %zu--%zu, worker thread "
-           "cores %zu--%zu\n",
-        cfg->core_offset, cfg->core_offset + 1,
-        cfg->core_offset + 1 + cfg->socket_thread_num - 1,
-        base_worker_core_offset,
-        base_worker_core_offset + cfg->worker_thread_num - 1);
+    if (cfg->worker_cores.empty()) {
+        printf("Master thread core %zu, TX/RX thread cores %zu--%zu, worker "
+               "thread cores %zu--%zu\n",
+            cfg->core_offset, cfg->core_offset + 1,
+            cfg->core_offset + 1 + cfg->socket_thread_num - 1,
+            base_worker_core_offset,
+            base_worker_core_offset + cfg->worker_thread_num - 1);
+    } else {
+        printf("Master thread core %zu, TX/RX thread cores %zu--%zu, worker "
+               "threads on NUMA nodes [ ",
+            cfg->core_offset, cfg->core_offset + 1,
+            cfg->core_offset + 1 + cfg->socket_thread_num - 1);
+        for (size_t node : cfg->worker_numa_nodes)
+            printf("%zu ", node);
+        printf("]\n");
+    }
 }
 
 Agora::~Agora()
@@ -88,6 +121,7 @@ void Agora::stop()
     config_->running = false;
     usleep(1000);
     packet_tx_rx_.reset();
+    metrics_server_.reset();
 }
 
 void Agora::send_snr_report(
@@ -105,6 +139,15 @@ void Agora::send_snr_report(
     }
 }
 
+void Agora::enqueue_task(size_t frame_id, const Event_data& event,
+    moodycamel::ProducerToken* ptok)
+{
+    if (config_->overload_shedding)
+        overload_ctrl_.task_queued(frame_id);
+    try_enqueue_fallback(get_conq(event.event_type),
+        ptok != nullptr ? ptok : get_ptok(event.event_type), event);
+}
+
 void Agora::schedule_antennas(
     EventType event_type, size_t frame_id, size_t symbol_id)
 {
@@ -130,7 +173,45 @@ void Agora::schedule_antennas(
             event.tags[j] = base_tag._tag;
             base_tag.ant_id++;
         }
-        try_enqueue_fallback(get_conq(event_type), get_ptok(event_type), event);
+        enqueue_task(frame_id, event);
+    }
+}
+
+void Agora::schedule_precode(size_t frame_id, size_t symbol_id)
+{
+    if (!config_->fused_precode_ifft) {
+        schedule_subcarriers(EventType::kPrecode, frame_id, symbol_id);
+        return;
+    }
+
+    auto base_tag = gen_tag_t::frm_sym_ant(frame_id, symbol_id, 0);
+    for (size_t i = 0; i < config_->fused_precode_events_per_symbol; i++) {
+        enqueue_task(frame_id, Event_data(EventType::kPrecode, base_tag._tag));
+        base_tag.ant_id += config_->fused_precode_ant_block_size;
+    }
+}
+
+void Agora::handle_ifft_done(size_t tag)
+{
+    /* IFFT is done, schedule data transmission */
+    size_t ant_id = gen_tag_t(tag).ant_id;
+    size_t frame_id = gen_tag_t(tag).frame_id;
+    size_t symbol_id = gen_tag_t(tag).symbol_id;
+    size_t symbol_idx_dl = config_->get_dl_symbol_idx(frame_id, symbol_id);
+    enqueue_task(frame_id, Event_data(EventType::kPacketTX, tag),
+        tx_ptoks_ptr[ant_id % config_->socket_thread_num]);
+    print_per_task_done(PrintType::kIFFT, frame_id, symbol_idx_dl, ant_id);
+
+    if (ifft_stats_.last_task(frame_id, symbol_idx_dl)) {
+        print_per_symbol_done(PrintType::kIFFT, frame_id, symbol_idx_dl);
+        if (ifft_stats_.last_symbol(frame_id)) {
+            stats->master_set_tsc(TsType::kIFFTDone, frame_id);
+            print_per_frame_done(PrintType::kIFFT, frame_id);
+            frame_dag_.set_frame_done(frame_id);
+            size_t retired_frame_id;
+            while (frame_dag_.try_retire_oldest(retired_frame_id))
+                stats->update_stats_in_functions_downlink(retired_frame_id);
+        }
     }
 }
 
@@ -156,8 +237,7 @@ void Agora::schedule_subcarriers(
     }
 
     for (size_t i = 0; i < num_events; i++) {
-        try_enqueue_fallback(get_conq(event_type), get_ptok(event_type),
-            Event_data(event_type, base_tag._tag));
+        enqueue_task(frame_id, Event_data(event_type, base_tag._tag));
         base_tag.sc_id += block_size;
     }
 }
@@ -167,13 +247,25 @@ void Agora::schedule_codeblocks(
 {
     auto base_tag = gen_tag_t::frm_sym_cb(frame_id, symbol_idx, 0);
 
+    const ModConfig& mod_cfg = config_->mod_cfg(frame_id);
+    if (event_type == EventType::kDecode) {
+        // A decode event covers decode_batch_size consecutive code blocks
+        // starting from its tag's code block, so it is not limited by the
+        // number of tags in an event
+        for (size_t i = 0; i < mod_cfg.decode_events_per_symbol; i++) {
+            enqueue_task(frame_id, Event_data(event_type, base_tag._tag));
+            base_tag.cb_id += mod_cfg.decode_batch_size;
+        }
+        return;
+    }
+
     // for (size_t i = 0;
     //      i < config_->UE_NUM * config_->LDPC_config.nblocksInSymbol; i++) {
     //     try_enqueue_fallback(get_conq(event_type), get_ptok(event_type),
     //         Event_data(event_type, base_tag._tag));
     //     base_tag.cb_id++;
     // }
-    size_t num_tasks = config_->UE_NUM * config_->LDPC_config.nblocksInSymbol;
+    size_t num_tasks = config_->UE_NUM * mod_cfg.nblocksInSymbol;
     size_t num_blocks = num_tasks / config_->encode_block_size;
     size_t num_remainder = num_tasks % config_->encode_block_size;
     if (num_remainder > 0)
@@ -188,7 +280,7 @@ void Agora::schedule_codeblocks(
             event.tags[j] = base_tag._tag;
             base_tag.cb_id++;
         }
-        try_enqueue_fallback(get_conq(event_type), get_ptok(event_type), event);
+        enqueue_task(frame_id, event);
     }
 }
 
@@ -205,17 +297,236 @@ void Agora::schedule_users(
     }
 }
 
-void Agora::move_events_between_queues(
-    EventType event_type1, EventType event_type2)
+void Agora::schedule_fft(size_t frame_id)
 {
-    auto q1 = get_conq(event_type1);
-    auto q2 = get_conq(event_type2);
-    Event_data events_list[16];
-    // printf("%zu elements in decode queue\n", q1->size_approx());
-    while (q1->size_approx() > 0) {
-        size_t num_events = q1->try_dequeue_bulk(events_list, 16);
-        q2->try_enqueue_bulk(events_list, num_events);
+    const size_t frame_slot = frame_id % kFrameWnd;
+    std::queue<fft_req_tag_t>& fftq = fft_queue_arr[frame_slot];
+    const size_t num_fft_blocks = fftq.size() / config_->fft_block_size;
+    for (size_t i = 0; i < num_fft_blocks; i++) {
+        Event_data do_fft_task;
+        do_fft_task.num_tags = config_->fft_block_size;
+        do_fft_task.event_type = EventType::kFFT;
+
+        for (size_t j = 0; j < config_->fft_block_size; j++) {
+            do_fft_task.tags[j] = fftq.front()._tag;
+            fftq.pop();
+
+            if (fft_created_count[frame_slot]++ == 0) {
+                stats->master_set_tsc(TsType::kProcessingStarted, frame_id);
+            } else if (fft_created_count[frame_slot]
+                == rx_counters_.num_pkts_per_frame) {
+                fft_created_count[frame_slot] = 0;
+            }
+        }
+        enqueue_task(frame_id, do_fft_task);
+    }
+}
+
+bool Agora::accept_rx_packet(const Packet* pkt)
+{
+    const size_t frame_id = pkt->frame_id;
+    if (config_->overload_shedding) {
+        if (frame_id < frame_dag_.oldest_frame()
+            or overload_ctrl_.is_shed(frame_id)) {
+            stats->overload_stat.num_shed_pkts++;
+            return false;
+        }
+
+        // When a new frame starts while Agora lags behind, shed the oldest
+        // frames. This also makes room for the new frame in the window.
+        if (overload_ctrl_.update_newest_frame(frame_id)) {
+            while (overload_ctrl_.frame_lag_exceeded(frame_dag_.oldest_frame()))
+                shed_oldest_frame();
+            if (frame_dag_.oldest_frame() < frame_id
+                and overload_ctrl_.queue_depth_exceeded(
+                    get_worker_queue_depth())) {
+                shed_oldest_frame();
+            }
+        }
+    }
+
+    if (frame_id >= frame_dag_.oldest_frame() + kFrameWnd) {
+        if (config_->rx_deadline_us == 0) {
+            printf("Error: Received packet for future frame %zu beyond frame "
+                   "window (= %zu + %zu). This can happen if Agora is running "
+                   "slowly, e.g., in debug mode\n",
+                frame_id, frame_dag_.oldest_frame(), kFrameWnd);
+            config_->running = false;
+        } else {
+            stats->rx_drop_stat.num_beyond_window++;
+        }
+        return false;
+    }
+
+    // Tasks that were queued before the previous frame in this frame's slot
+    // was shed may still write to the slot's buffers
+    if (config_->overload_shedding and overload_ctrl_.slot_busy(frame_id)) {
+        stats->overload_stat.num_shed_pkts++;
+        return false;
+    }
+
+    if (config_->rx_deadline_us == 0)
+        return true;
+
+    if (frame_id < frame_dag_.oldest_frame()) {
+        stats->rx_drop_stat.num_late++;
+        return false;
+    }
+    if (!rx_counters_.mark_packet(frame_id, pkt->symbol_id, pkt->ant_id)) {
+        // The packet was received before, or replaced with zeros at the
+        // frame's RX deadline
+        if (frame_id < rx_deadline_frame_)
+            stats->rx_drop_stat.num_late++;
+        else
+            stats->rx_drop_stat.num_duplicate++;
+        return false;
+    }
+
+    // The RX deadlines of this frame and of earlier frames that have not
+    // received any packet yet start now
+    if (rx_next_frame_ <= frame_id) {
+        const size_t deadline_tsc = rdtsc() + rx_deadline_cycles_;
+        for (; rx_next_frame_ <= frame_id; rx_next_frame_++)
+            rx_deadline_tsc_[rx_next_frame_ % kFrameWnd] = deadline_tsc;
     }
+    return true;
+}
+
+void Agora::shed_oldest_frame()
+{
+    const size_t frame_id = frame_dag_.oldest_frame();
+    const size_t frame_slot = frame_id % kFrameWnd;
+    overload_ctrl_.mark_shed(frame_id);
+
+    // Release the socket buffer slots of packets waiting for FFT
+    std::queue<fft_req_tag_t>& fftq = fft_queue_arr[frame_slot];
+    stats->overload_stat.num_shed_pkts += fftq.size();
+    while (!fftq.empty()) {
+        release_rx_packet(fftq.front()._tag);
+        fftq.pop();
+    }
+    fft_created_count[frame_slot] = 0;
+
+    // Tasks of this frame that are already queued still run, but the master
+    // ignores their completions. The next frame in this slot waits for them
+    // to complete before accepting packets.
+    rx_counters_.reset_frame(frame_id);
+    fft_stats_.reset_frame(frame_id);
+    zf_stats_.reset_frame(frame_id);
+    demul_stats_.reset_frame(frame_id);
+    decode_stats_.reset_frame(frame_id);
+    tomac_stats_.reset_frame(frame_id);
+    encode_stats_.reset_frame(frame_id);
+    precode_stats_.reset_frame(frame_id);
+    ifft_stats_.reset_frame(frame_id);
+    tx_stats_.reset_frame(frame_id);
+    frame_dag_.reset_frame(frame_id);
+
+    stats->overload_stat.num_shed_frames++;
+    MLPD_WARN("Main: Overloaded, shedding frame %zu (newest frame %zu)\n",
+        frame_id, overload_ctrl_.newest_frame());
+
+    frame_dag_.set_frame_done(frame_id);
+    size_t retired_frame_id;
+    while (frame_dag_.try_retire_oldest(retired_frame_id)) {
+        if (retired_frame_id == frame_id)
+            stats->mark_frame_shed(frame_id);
+        else if (config_->downlink_mode)
+            stats->update_stats_in_functions_downlink(retired_frame_id);
+        else
+            stats->update_stats_in_functions_uplink(retired_frame_id);
+        if (retired_frame_id == config_->frames_to_test - 1)
+            config_->running = false;
+    }
+}
+
+size_t Agora::get_worker_queue_depth()
+{
+    size_t queue_depth = 0;
+    for (size_t i = 0; i < kNumEventTypes; i++)
+        queue_depth += sched_info_arr[i].concurrent_q.size_approx();
+    return queue_depth;
+}
+
+void Agora::release_rx_packet(size_t tag)
+{
+#ifdef USE_DPDK
+    if (config_->dpdk_zero_copy) {
+        rte_pktmbuf_free(reinterpret_cast<rte_mbuf*>(rx_tag_t(tag).offset));
+        return;
+    }
+#endif
+    socket_buffer_status_[rx_tag_t(tag).tid][rx_tag_t(tag).offset] = 0;
+}
+
+void Agora::handle_rx_deadlines()
+{
+    if (rx_deadline_frame_ == rx_next_frame_)
+        return;
+
+    // Frames expire in order, as their deadlines are set in frame order
+    const size_t cur_tsc = rdtsc();
+    while (rx_deadline_frame_ < rx_next_frame_) {
+        const size_t frame_id = rx_deadline_frame_;
+        if (!rx_counters_.received_all(frame_id)) {
+            if (cur_tsc < rx_deadline_tsc_[frame_id % kFrameWnd])
+                return;
+            zero_fill_missing_packets(frame_id);
+        }
+        rx_deadline_frame_++;
+    }
+}
+
+void Agora::zero_fill_missing_packets(size_t frame_id)
+{
+    const size_t frame_slot = frame_id % kFrameWnd;
+
+    // Schedule the received packets that are waiting for a full FFT block
+    std::queue<fft_req_tag_t>& fftq = fft_queue_arr[frame_slot];
+    if (!fftq.empty()) {
+        Event_data do_fft_task;
+        do_fft_task.num_tags = fftq.size();
+        do_fft_task.event_type = EventType::kFFT;
+        for (size_t j = 0; j < do_fft_task.num_tags; j++) {
+            do_fft_task.tags[j] = fftq.front()._tag;
+            fftq.pop();
+        }
+        enqueue_task(frame_id, do_fft_task);
+    }
+    fft_created_count[frame_slot] = 0;
+
+    // The zero-filled antennas are masked out of this frame's CSI, so its
+    // zeroforcing and demodulation use only the received antennas
+    size_t num_missing = 0;
+    for (size_t symbol_id = 0; symbol_id < config_->symbol_num_perframe;
+         symbol_id++) {
+        const SymbolType sym_type
+            = config_->get_symbol_type(frame_id, symbol_id);
+        complex_float* out_buf;
+        if (sym_type == SymbolType::kPilot) {
+            out_buf = csi_buffers_[frame_slot][config_->get_pilot_symbol_idx(
+                frame_id, symbol_id)];
+        } else if (sym_type == SymbolType::kUL) {
+            out_buf = config_->get_data_buf(data_buffer_, frame_id, symbol_id);
+        } else {
+            // Calibration symbols are not zero-filled. Config rejects RX
+            // deadline mode with reciprocity calibration.
+            continue;
+        }
+
+        for (size_t ant_id = 0; ant_id < config_->BS_ANT_NUM; ant_id++) {
+            if (!rx_counters_.mark_packet(frame_id, symbol_id, ant_id))
+                continue;
+            DoFFT::zero_partial_transpose(config_, out_buf, ant_id);
+            update_rx_counters(frame_id, symbol_id);
+            handle_event_fft(gen_tag_t::frm_sym(frame_id, symbol_id)._tag);
+            num_missing++;
+        }
+    }
+    stats->rx_drop_stat.num_zero_filled += num_missing;
+    MLPD_WARN("Main: Frame %zu missed its RX deadline. Zero-filled %zu "
+              "packets\n",
+        frame_id, num_missing);
 }
 
 void Agora::start()
@@ -230,9 +541,9 @@ void Agora::start()
         return;
     }
 
-    // Agora processes a frame after processing for previous frames is
-    // complete. cur_frame_id is the frame that is currently being processed.
-    size_t cur_frame_id = 0;
+    // Frames are processed concurrently, as allowed by the dependencies in
+    // frame_dag_. Frames are retired in order.
+    size_t retired_frame_id;
 
     /* Counters for printing summary */
     size_t demul_count = 0;
@@ -258,13 +569,8 @@ void Agora::start()
             num_events += mac_response_queue_.try_dequeue_bulk(
                 events_list + num_events, kDequeueBulkSizeTXRX);
         } else {
-            if (!cfg->downlink_mode)
-                num_events += complete_decode_task_queue_.try_dequeue_bulk(
-                    events_list + num_events, max_events_needed);
-            if (num_events == 0) {
-                num_events += complete_task_queue_.try_dequeue_bulk(
-                    events_list + num_events, max_events_needed);
-            }
+            num_events += complete_task_queue_.try_dequeue_bulk(
+                events_list + num_events, max_events_needed);
         }
         is_turn_to_dequeue_from_io = !is_turn_to_dequeue_from_io;
 
@@ -272,35 +578,54 @@ void Agora::start()
         for (size_t ev_i = 0; ev_i < num_events; ev_i++) {
             Event_data& event = events_list[ev_i];
 
-            // FFT processing is scheduled after falling through the switch
+            // Count every completed task, then ignore the completions of
+            // tasks queued before their frame was shed
+            if (cfg->overload_shedding and is_queued_task(event.event_type)) {
+                const size_t frame_id = gen_tag_t(event.tags[0]).frame_id;
+                overload_ctrl_.task_completed(frame_id);
+                if (overload_ctrl_.is_shed(frame_id))
+                    continue;
+            }
+
             switch (event.event_type) {
             case EventType::kPacketRX: {
-                size_t socket_thread_id = rx_tag_t(event.tags[0]).tid;
-                size_t sock_buf_offset = rx_tag_t(event.tags[0]).offset;
-                auto* pkt = (Packet*)(socket_buffer_[socket_thread_id]
-                    + (sock_buf_offset * cfg->packet_length));
-
-                if (pkt->frame_id >= cur_frame_id + kFrameWnd) {
-                    printf("Error: Received packet for future frame %u beyond "
-                           "frame window (= %zu + %zu). This can happen if "
-                           "Agora is running slowly, e.g., in debug mode\n",
-                        pkt->frame_id, cur_frame_id, kFrameWnd);
-                    cfg->running = false;
-                    break;
-                }
+                // With batched socket I/O, one event carries several packets
+                for (size_t i = 0; i < event.num_tags; i++) {
+                    size_t socket_thread_id = rx_tag_t(event.tags[i]).tid;
+                    size_t sock_buf_offset = rx_tag_t(event.tags[i]).offset;
+                    Packet* pkt;
+#ifdef USE_DPDK
+                    if (cfg->dpdk_zero_copy) {
+                        pkt = reinterpret_cast<Packet*>(
+                            DpdkTransport::udp_payload(
+                                reinterpret_cast<rte_mbuf*>(sock_buf_offset)));
+                    } else
+#endif
+                    {
+                        pkt = cfg->get_rx_packet(
+                            socket_buffer_[socket_thread_id], sock_buf_offset);
+                    }
 
-                update_rx_counters(pkt->frame_id, pkt->symbol_id);
-                if (config_->bigstation_mode) {
-                    /* In BigStation, schedule FFT whenever a packet is RX */
-                    if (cur_frame_id != pkt->frame_id) {
-                        cur_frame_id = pkt->frame_id;
-                        stats->master_set_tsc(
-                            TsType::kProcessingStarted, pkt->frame_id);
+                    if (!accept_rx_packet(pkt)) {
+                        if (!cfg->running)
+                            break;
+                        release_rx_packet(event.tags[i]);
+                        continue;
                     }
-                }
 
-                fft_queue_arr[pkt->frame_id % kFrameWnd].push(
-                    fft_req_tag_t(event.tags[0]));
+                    update_rx_counters(pkt->frame_id, pkt->symbol_id);
+                    newest_rx_frame_
+                        = std::max(newest_rx_frame_, size_t(pkt->frame_id));
+
+                    // FFT tasks of a frame are scheduled as soon as enough of
+                    // its packets arrive, independent of other frames
+                    fft_queue_arr[pkt->frame_id % kFrameWnd].push(
+                        fft_req_tag_t(event.tags[i]));
+                    if (fft_queue_arr[pkt->frame_id % kFrameWnd].size()
+                        >= config_->fft_block_size) {
+                        schedule_fft(pkt->frame_id);
+                    }
+                }
             } break;
 
             case EventType::kFFT: {
@@ -318,19 +643,19 @@ void Agora::start()
                     zf_stats_.coded_frame = frame_id;
                     print_per_frame_done(PrintType::kZF, frame_id);
 
-                    /* If all the data in a frame has arrived when ZF is done */
+                    /* Schedule the data symbols whose FFT or encoding is
+                     * already done */
                     for (size_t i = 0; i < cfg->ul_data_symbol_num_perframe;
                          i++) {
-                        if (fft_stats_.cur_frame_for_symbol[i] == frame_id) {
+                        if (frame_dag_.resolve_ul(frame_id, i)) {
                             schedule_subcarriers(
                                 EventType::kDemul, frame_id, i);
                         }
                     }
                     for (size_t i = 0; i < cfg->dl_data_symbol_num_perframe;
                          i++) {
-                        if (encode_stats_.cur_frame_for_symbol[i] == frame_id) {
-                            schedule_subcarriers(EventType::kPrecode, frame_id,
-                                cfg->DLSymbols[0][i]);
+                        if (frame_dag_.resolve_dl(frame_id, i)) {
+                            schedule_precode(frame_id, cfg->DLSymbols[0][i]);
                         }
                     }
                 }
@@ -343,27 +668,17 @@ void Agora::start()
 
                 print_per_task_done(
                     PrintType::kDemul, frame_id, symbol_idx_ul, base_sc_id);
-                /* If this symbol is ready */
-                if (demul_stats_.last_task(frame_id, symbol_idx_ul)) {
-                    if (demul_stats_.get_symbol_count(frame_id)
-                        < demul_stats_.max_symbol_count - 1)
+                /* If this symbol is ready. In work-stealing mode, workers
+                 * report only completed symbols and schedule decoding. */
+                if (cfg->work_stealing_mode
+                    || demul_stats_.last_task(frame_id, symbol_idx_ul)) {
+                    if (!cfg->work_stealing_mode)
                         schedule_codeblocks(
                             EventType::kDecode, frame_id, symbol_idx_ul);
                     print_per_symbol_done(
                         PrintType::kDemul, frame_id, symbol_idx_ul);
                     if (demul_stats_.last_symbol(frame_id)) {
                         max_equaled_frame = frame_id;
-                        if (!cfg->bigstation_mode) {
-                            assert(cur_frame_id == frame_id);
-                            cur_frame_id++;
-                            move_events_between_queues(
-                                EventType::kDecode, EventType::kDecodeLast);
-                            schedule_codeblocks(EventType::kDecodeLast,
-                                frame_id, symbol_idx_ul);
-                        } else {
-                            schedule_codeblocks(
-                                EventType::kDecode, frame_id, symbol_idx_ul);
-                        }
                         stats->master_set_tsc(TsType::kDemulDone, frame_id);
                         print_per_frame_done(PrintType::kDemul, frame_id);
                     }
@@ -390,7 +705,8 @@ void Agora::start()
                 size_t frame_id = gen_tag_t(event.tags[0]).frame_id;
                 size_t symbol_idx_ul = gen_tag_t(event.tags[0]).symbol_id;
 
-                if (decode_stats_.last_task(frame_id, symbol_idx_ul)) {
+                if (cfg->work_stealing_mode
+                    || decode_stats_.last_task(frame_id, symbol_idx_ul)) {
                     if (kEnableMac) {
                         schedule_users(
                             EventType::kPacketToMac, frame_id, symbol_idx_ul);
@@ -401,11 +717,14 @@ void Agora::start()
                         stats->master_set_tsc(TsType::kDecodeDone, frame_id);
                         print_per_frame_done(PrintType::kDecode, frame_id);
                         if (!kEnableMac) {
-                            // assert(cur_frame_id == frame_id);
-                            // cur_frame_id++;
-                            stats->update_stats_in_functions_uplink(frame_id);
-                            if (stats->last_frame_id == cfg->frames_to_test - 1)
-                                goto finish;
+                            frame_dag_.set_frame_done(frame_id);
+                            while (frame_dag_.try_retire_oldest(
+                                retired_frame_id)) {
+                                stats->update_stats_in_functions_uplink(
+                                    retired_frame_id);
+                                if (retired_frame_id == cfg->frames_to_test - 1)
+                                    goto finish;
+                            }
                         }
                     }
                 }
@@ -426,13 +745,15 @@ void Agora::start()
                     print_per_symbol_done(
                         PrintType::kPacketToMac, frame_id, symbol_idx_ul);
                     if (tomac_stats_.last_symbol(frame_id)) {
-                        assert(cur_frame_id == frame_id);
-                        cur_frame_id++;
                         // stats->master_set_tsc(TsType::kMacTXDone, frame_id);
                         print_per_frame_done(PrintType::kPacketToMac, frame_id);
-                        stats->update_stats_in_functions_uplink(frame_id);
-                        if (stats->last_frame_id == cfg->frames_to_test - 1)
-                            goto finish;
+                        frame_dag_.set_frame_done(frame_id);
+                        while (frame_dag_.try_retire_oldest(retired_frame_id)) {
+                            stats->update_stats_in_functions_uplink(
+                                retired_frame_id);
+                            if (retired_frame_id == cfg->frames_to_test - 1)
+                                goto finish;
+                        }
                     }
                 }
 
@@ -445,12 +766,9 @@ void Agora::start()
                     size_t symbol_idx_dl
                         = cfg->get_dl_symbol_idx(frame_id, symbol_id);
                     if (encode_stats_.last_task(frame_id, symbol_idx_dl)) {
-                        encode_stats_.cur_frame_for_symbol[symbol_idx_dl]
-                            = frame_id;
                         /* If precoder exist, schedule precoding */
-                        if (zf_stats_.coded_frame == frame_id) {
-                            schedule_subcarriers(
-                                EventType::kPrecode, frame_id, symbol_id);
+                        if (frame_dag_.resolve_dl(frame_id, symbol_idx_dl)) {
+                            schedule_precode(frame_id, symbol_id);
                         }
                         print_per_symbol_done(
                             PrintType::kEncode, frame_id, symbol_idx_dl);
@@ -473,7 +791,10 @@ void Agora::start()
                 print_per_task_done(
                     PrintType::kPrecode, frame_id, symbol_idx_dl, sc_id);
                 if (precode_stats_.last_task(frame_id, symbol_idx_dl)) {
-                    schedule_antennas(EventType::kIFFT, frame_id, symbol_id);
+                    if (!cfg->fused_precode_ifft) {
+                        schedule_antennas(
+                            EventType::kIFFT, frame_id, symbol_id);
+                    }
                     print_per_symbol_done(
                         PrintType::kPrecode, frame_id, symbol_idx_dl);
                     if (precode_stats_.last_symbol(frame_id)) {
@@ -481,34 +802,20 @@ void Agora::start()
                         print_per_frame_done(PrintType::kPrecode, frame_id);
                     }
                 }
+
+                if (cfg->fused_precode_ifft) {
+                    /* The task also did IFFT for its block of antennas */
+                    auto tag = gen_tag_t(event.tags[0]);
+                    const size_t ant_end = std::min(cfg->BS_ANT_NUM,
+                        tag.ant_id + cfg->fused_precode_ant_block_size);
+                    for (; tag.ant_id < ant_end; tag.ant_id++)
+                        handle_ifft_done(tag._tag);
+                }
             } break;
 
             case EventType::kIFFT: {
-                for (size_t i = 0; i < event.num_tags; i++) {
-                    /* IFFT is done, schedule data transmission */
-                    size_t ant_id = gen_tag_t(event.tags[i]).ant_id;
-                    size_t frame_id = gen_tag_t(event.tags[i]).frame_id;
-                    size_t symbol_id = gen_tag_t(event.tags[i]).symbol_id;
-                    size_t symbol_idx_dl
-                        = cfg->get_dl_symbol_idx(frame_id, symbol_id);
-                    try_enqueue_fallback(get_conq(EventType::kPacketTX),
-                        tx_ptoks_ptr[ant_id % cfg->socket_thread_num],
-                        Event_data(EventType::kPacketTX, event.tags[0]));
-                    print_per_task_done(
-                        PrintType::kIFFT, frame_id, symbol_idx_dl, ant_id);
-
-                    if (ifft_stats_.last_task(frame_id, symbol_idx_dl)) {
-                        print_per_symbol_done(
-                            PrintType::kIFFT, frame_id, symbol_idx_dl);
-                        if (ifft_stats_.last_symbol(frame_id)) {
-                            stats->master_set_tsc(TsType::kIFFTDone, frame_id);
-                            print_per_frame_done(PrintType::kIFFT, frame_id);
-                            assert(frame_id == cur_frame_id);
-                            cur_frame_id++;
-                            stats->update_stats_in_functions_downlink(frame_id);
-                        }
-                    }
-                }
+                for (size_t i = 0; i < event.num_tags; i++)
+                    handle_ifft_done(event.tags[i]);
             } break;
 
             case EventType::kPacketTX: {
@@ -558,44 +865,23 @@ void Agora::start()
                 printf("Wrong event type in message queue!");
                 exit(0);
             } /* End of switch */
-
-            // We schedule FFT processing if the event handling above results in
-            // either (a) sufficient packets received for the current frame,
-            // or (b) the current frame being updated.
-            std::queue<fft_req_tag_t>& cur_fftq
-                = fft_queue_arr[cur_frame_id % kFrameWnd];
-            if (cur_fftq.size() >= config_->fft_block_size) {
-                size_t num_fft_blocks
-                    = cur_fftq.size() / config_->fft_block_size;
-                for (size_t i = 0; i < num_fft_blocks; i++) {
-                    Event_data do_fft_task;
-                    do_fft_task.num_tags = config_->fft_block_size;
-                    do_fft_task.event_type = EventType::kFFT;
-
-                    for (size_t j = 0; j < config_->fft_block_size; j++) {
-                        do_fft_task.tags[j] = cur_fftq.front()._tag;
-                        cur_fftq.pop();
-
-                        if (!config_->bigstation_mode) {
-                            if (fft_created_count++ == 0) {
-                                stats->master_set_tsc(
-                                    TsType::kProcessingStarted, cur_frame_id);
-                            } else if (fft_created_count
-                                == rx_counters_.num_pkts_per_frame) {
-                                fft_created_count = 0;
-                            }
-                        }
-                    }
-                    try_enqueue_fallback(get_conq(EventType::kFFT),
-                        get_ptok(EventType::kFFT), do_fft_task);
-                }
-            }
         } /* End of for */
+
+        if (cfg->rx_deadline_us > 0)
+            handle_rx_deadlines();
+
+        if (task_tracer_ != nullptr && TaskTracer::dump_requested())
+            save_task_trace();
+
+        if (metrics_server_ != nullptr && rdtsc() >= next_metrics_tsc_)
+            publish_metrics();
     } /* End of while */
 
 finish:
 
     printf("Agora: printing stats and saving to file\n");
+    stats->overload_stat.num_rx_overflow_pkts
+        = packet_tx_rx_->get_num_rx_overflow_pkts();
     stats->print_summary();
     stats->save_to_file();
     if (flags.enable_save_decode_data_to_file) {
@@ -603,6 +889,15 @@ finish:
     }
     if (flags.enable_save_tx_data_to_file)
         save_tx_data_to_file(stats->last_frame_id);
+    if (task_tracer_ != nullptr)
+        save_task_trace();
+
+    if (config_->work_stealing_mode) {
+        size_t num_steals = 0;
+        for (size_t i = 0; i < config_->worker_thread_num; i++)
+            num_steals += work_stealing_sched_->get_num_steals(i);
+        printf("Agora: %zu decode tasks stolen by workers\n", num_steals);
+    }
 
     // Calculate and print per-user BER
     if (!kEnableMac && kPrintPhyStats) {
@@ -642,10 +937,9 @@ void Agora::handle_event_fft(size_t tag)
         if (fft_stats_.last_task(frame_id, symbol_id)) {
             size_t symbol_idx_ul
                 = config_->get_ul_symbol_idx(frame_id, symbol_id);
-            fft_stats_.cur_frame_for_symbol[symbol_idx_ul] = frame_id;
             print_per_symbol_done(PrintType::kFFTData, frame_id, symbol_id);
             /* If precoder exist, schedule demodulation */
-            if (zf_stats_.coded_frame == frame_id) {
+            if (frame_dag_.resolve_ul(frame_id, symbol_idx_ul)) {
                 schedule_subcarriers(
                     EventType::kDemul, frame_id, symbol_idx_ul);
             }
@@ -666,8 +960,7 @@ void Agora::handle_event_fft(size_t tag)
 
 void* Agora::worker(int tid)
 {
-    pin_to_core_with_offset(
-        ThreadType::kWorker, base_worker_core_offset, tid, false /* quiet */);
+    pin_worker(tid, false /* quiet */);
 
     /* Initialize operators */
     auto computeFFT = new DoFFT(config_, tid, freq_ghz,
@@ -681,7 +974,8 @@ void* Agora::worker(int tid)
 
     auto computeZF = new DoZF(config_, tid, freq_ghz, *get_conq(EventType::kZF),
         complete_task_queue_, worker_ptoks_ptr[tid], csi_buffers_,
-        calib_buffer_, ul_zf_matrices_, dl_zf_matrices_, stats);
+        calib_buffer_, ul_zf_matrices_, dl_zf_matrices_, stats,
+        zf_tracker_.get());
 
     auto computeDemul = new DoDemul(config_, tid, freq_ghz,
         *get_conq(EventType::kDemul), complete_task_queue_,
@@ -691,29 +985,27 @@ void* Agora::worker(int tid)
     auto computePrecode
         = new DoPrecode(config_, tid, freq_ghz, *get_conq(EventType::kPrecode),
             complete_task_queue_, worker_ptoks_ptr[tid], dl_zf_matrices_,
-            dl_ifft_buffer_, dl_encoded_buffer_, stats);
+            dl_ifft_buffer_, dl_socket_buffer_, dl_encoded_buffer_,
+            dl_modulated_buffer_, stats);
 
     auto computeEncoding = new DoEncode(config_, tid, freq_ghz,
         *get_conq(EventType::kEncode), complete_task_queue_,
-        worker_ptoks_ptr[tid], config_->dl_bits, dl_encoded_buffer_, stats);
+        worker_ptoks_ptr[tid], config_->dl_bits, dl_encoded_buffer_,
+        dl_modulated_buffer_, stats);
 
     auto computeDecoding
         = new DoDecode(config_, tid, freq_ghz, *get_conq(EventType::kDecode),
             complete_task_queue_, worker_ptoks_ptr[tid], demod_buffers_,
             decoded_buffer_, phy_stats, stats);
 
-    auto computeDecodingLast = new DoDecode(config_, tid, freq_ghz,
-        *get_conq(EventType::kDecodeLast), complete_decode_task_queue_,
-        decode_ptoks_ptr[tid], demod_buffers_, decoded_buffer_, phy_stats,
-        stats);
-
     std::vector<Doer*> computers_vec;
     if (config_->dl_data_symbol_num_perframe > 0)
         computers_vec = { computeZF, computeFFT, computeEncoding, computeIFFT,
             computePrecode };
     else
-        computers_vec = { computeDecodingLast, computeZF, computeFFT,
-            computeDecoding, computeDemul };
+        computers_vec
+            = { computeZF, computeFFT, computeDecoding, computeDemul };
+    trace_worker_doers(tid, computers_vec);
 
     while (true) {
         for (size_t i = 0; i < computers_vec.size(); i++) {
@@ -723,9 +1015,82 @@ void* Agora::worker(int tid)
     }
 }
 
+void* Agora::worker_work_stealing(int tid)
+{
+    pin_worker(tid, false /* quiet */);
+
+    /* Initialize operators */
+    auto computeFFT = new DoFFT(config_, tid, freq_ghz,
+        *get_conq(EventType::kFFT), complete_task_queue_, worker_ptoks_ptr[tid],
+        socket_buffer_, socket_buffer_status_, data_buffer_, csi_buffers_,
+        calib_buffer_, phy_stats, stats);
+
+    auto computeZF = new DoZF(config_, tid, freq_ghz, *get_conq(EventType::kZF),
+        complete_task_queue_, worker_ptoks_ptr[tid], csi_buffers_,
+        calib_buffer_, ul_zf_matrices_, dl_zf_matrices_, stats,
+        zf_tracker_.get());
+
+    auto computeDemul = new DoDemul(config_, tid, freq_ghz,
+        *get_conq(EventType::kDemul), complete_task_queue_,
+        worker_ptoks_ptr[tid], data_buffer_, ul_zf_matrices_,
+        ue_spec_pilot_buffer_, equal_buffer_, demod_buffers_, phy_stats, stats);
+
+    // Decode tasks are fetched from the work-stealing scheduler, not from a
+    // shared queue
+    auto computeDecoding
+        = new DoDecode(config_, tid, freq_ghz, *get_conq(EventType::kDecode),
+            complete_task_queue_, worker_ptoks_ptr[tid], demod_buffers_,
+            decoded_buffer_, phy_stats, stats);
+    trace_worker_doers(
+        tid, { computeFFT, computeZF, computeDemul, computeDecoding });
+
+    Event_data event;
+    while (true) {
+        // Decoding has the highest priority so that frames are retired
+        // quickly
+        if (work_stealing_sched_->try_get_task(tid, event)) {
+            for (size_t i = 0; i < event.num_tags; i++)
+                computeDecoding->launch_traced(event.tags[i]);
+
+            const size_t frame_id = gen_tag_t(event.tags[0]).frame_id;
+            const size_t symbol_idx_ul = gen_tag_t(event.tags[0]).symbol_id;
+            if (work_stealing_sched_->decode_tasks_done(
+                    frame_id, symbol_idx_ul, event.num_tags)) {
+                try_enqueue_fallback(&complete_task_queue_,
+                    worker_ptoks_ptr[tid],
+                    Event_data(EventType::kDecode,
+                        gen_tag_t::frm_sym(frame_id, symbol_idx_ul)._tag));
+            }
+            continue;
+        }
+
+        if (computeZF->try_launch() || computeFFT->try_launch())
+            continue;
+
+        if (get_conq(EventType::kDemul)->try_dequeue(event)) {
+            for (size_t i = 0; i < event.num_tags; i++) {
+                computeDemul->launch_traced(event.tags[i]);
+
+                const size_t frame_id = gen_tag_t(event.tags[i]).frame_id;
+                const size_t symbol_idx_ul
+                    = gen_tag_t(event.tags[i]).symbol_id;
+                if (work_stealing_sched_->demul_task_done(
+                        frame_id, symbol_idx_ul)) {
+                    work_stealing_sched_->schedule_codeblocks(
+                        tid, frame_id, symbol_idx_ul);
+                    try_enqueue_fallback(&complete_task_queue_,
+                        worker_ptoks_ptr[tid],
+                        Event_data(EventType::kDemul,
+                            gen_tag_t::frm_sym(frame_id, symbol_idx_ul)._tag));
+                }
+            }
+        }
+    }
+}
+
 void* Agora::worker_fft(int tid)
 {
-    pin_to_core_with_offset(ThreadType::kWorker, base_worker_core_offset, tid);
+    pin_worker(tid);
 
     /* Initialize IFFT operator */
     auto computeFFT = new DoFFT(config_, tid, freq_ghz,
@@ -735,6 +1100,7 @@ void* Agora::worker_fft(int tid)
     auto computeIFFT = new DoIFFT(config_, tid, freq_ghz,
         *get_conq(EventType::kIFFT), complete_task_queue_,
         worker_ptoks_ptr[tid], dl_ifft_buffer_, dl_socket_buffer_, stats);
+    trace_worker_doers(tid, { computeFFT, computeIFFT });
 
     while (true) {
         if (computeFFT->try_launch()) {
@@ -746,12 +1112,14 @@ void* Agora::worker_fft(int tid)
 
 void* Agora::worker_zf(int tid)
 {
-    pin_to_core_with_offset(ThreadType::kWorker, base_worker_core_offset, tid);
+    pin_worker(tid);
 
     /* Initialize ZF operator */
     auto computeZF = new DoZF(config_, tid, freq_ghz, *get_conq(EventType::kZF),
         complete_task_queue_, worker_ptoks_ptr[tid], csi_buffers_,
-        calib_buffer_, ul_zf_matrices_, dl_zf_matrices_, stats);
+        calib_buffer_, ul_zf_matrices_, dl_zf_matrices_, stats,
+        zf_tracker_.get());
+    trace_worker_doers(tid, { computeZF });
 
     while (true) {
         computeZF->try_launch();
@@ -760,7 +1128,7 @@ void* Agora::worker_zf(int tid)
 
 void* Agora::worker_demul(int tid)
 {
-    pin_to_core_with_offset(ThreadType::kWorker, base_worker_core_offset, tid);
+    pin_worker(tid);
 
     auto computeDemul = new DoDemul(config_, tid, freq_ghz,
         *get_conq(EventType::kDemul), complete_task_queue_,
@@ -771,7 +1139,9 @@ void* Agora::worker_demul(int tid)
     auto computePrecode
         = new DoPrecode(config_, tid, freq_ghz, *get_conq(EventType::kPrecode),
             complete_task_queue_, worker_ptoks_ptr[tid], dl_zf_matrices_,
-            dl_ifft_buffer_, dl_encoded_buffer_, stats);
+            dl_ifft_buffer_, dl_socket_buffer_, dl_encoded_buffer_,
+            dl_modulated_buffer_, stats);
+    trace_worker_doers(tid, { computeDemul, computePrecode });
 
     while (true) {
         if (config_->dl_data_symbol_num_perframe > 0) {
@@ -799,7 +1169,42 @@ void Agora::create_threads(void* (*worker)(void*), int tid_start, int tid_end)
 
 void Agora::update_ran_config(RanConfig rc)
 {
-    config_->update_mod_cfgs(rc.mod_order_bits);
+    if (!config_->link_adaptation)
+        return;
+    rt_assert(config_->mod_order_supported(rc.mod_order_bits),
+        "RAN config update with an unsupported modulation order");
+
+    // The MAC repeats its modulation order in every update, so only changes
+    // are queued
+    const size_t last_mod_order_bits = ran_config_updates_.empty()
+        ? mod_order_bits_
+        : ran_config_updates_.back().mod_order_bits;
+    if (rc.mod_order_bits == last_mod_order_bits)
+        return;
+    if (rc.frame_id <= newest_rx_frame_) {
+        MLPD_WARN("Main: RAN config update for frame %zu arrived after the "
+                  "frame started (newest frame %zu)\n",
+            rc.frame_id, newest_rx_frame_);
+    }
+    ran_config_updates_.push(rc);
+}
+
+void Agora::apply_ran_config(size_t frame_id)
+{
+    while (!ran_config_updates_.empty()
+        and ran_config_updates_.front().frame_id <= frame_id) {
+        mod_order_bits_ = ran_config_updates_.front().mod_order_bits;
+        ran_config_updates_.pop();
+    }
+
+    // Workers read the frame's modulation order through the frame ID in
+    // their task tags, so frames that are in flight are not affected
+    config_->set_frame_mod_order_bits(frame_id, mod_order_bits_);
+    const ModConfig& mod_cfg = config_->mod_cfg(frame_id);
+    decode_stats_.set_max_task_count(
+        frame_id, mod_cfg.decode_events_per_symbol);
+    encode_stats_.set_max_task_count(
+        frame_id, mod_cfg.nblocksInSymbol * config_->UE_NUM);
 }
 
 void Agora::update_rx_counters(size_t frame_id, size_t symbol_id)
@@ -823,6 +1228,8 @@ void Agora::update_rx_counters(size_t frame_id, size_t symbol_id)
     }
     // Receive first packet in a frame
     if (rx_counters_.num_pkts[frame_slot] == 0) {
+        apply_ran_config(frame_id);
+
         // schedule this frame's encoding
         for (size_t i = 0; i < config_->dl_data_symbol_num_perframe; i++)
             schedule_codeblocks(
@@ -1059,7 +1466,6 @@ void Agora::initialize_queues()
     int data_symbol_num_perframe = config_->data_symbol_num_perframe;
     message_queue_ = mt_queue_t(512 * data_symbol_num_perframe);
     complete_task_queue_ = mt_queue_t(512 * data_symbol_num_perframe * 4);
-    complete_decode_task_queue_ = mt_queue_t(2048);
 
     // Create concurrent queues for each Doer
     for (sched_info_t& s : sched_info_arr) {
@@ -1076,8 +1482,6 @@ void Agora::initialize_queues()
     for (size_t i = 0; i < config_->worker_thread_num; i++) {
         worker_ptoks_ptr[i]
             = new moodycamel::ProducerToken(complete_task_queue_);
-        decode_ptoks_ptr[i]
-            = new moodycamel::ProducerToken(complete_decode_task_queue_);
     }
 }
 
@@ -1091,15 +1495,17 @@ void Agora::initialize_uplink_buffers()
 
     socket_buffer_status_size_
         = cfg->BS_ANT_NUM * kFrameWnd * cfg->symbol_num_perframe;
-    socket_buffer_size_ = cfg->packet_length * socket_buffer_status_size_;
+    socket_buffer_size_ = cfg->rx_slot_size * socket_buffer_status_size_;
 
-    socket_buffer_.malloc(
-        cfg->socket_thread_num /* RX */, socket_buffer_size_, 64);
+    // With AF_XDP, each socket thread's RX buffer is registered as a UMEM,
+    // which must be page-aligned
+    socket_buffer_.malloc(cfg->socket_thread_num /* RX */, socket_buffer_size_,
+        kUseXDP ? 4096 : 64, cfg->buffer_page_backing);
     socket_buffer_status_.calloc(
         cfg->socket_thread_num /* RX */, socket_buffer_status_size_, 64);
 
-    data_buffer_.malloc(
-        task_buffer_symbol_num_ul, cfg->OFDM_DATA_NUM * cfg->BS_ANT_NUM, 64);
+    data_buffer_.malloc(task_buffer_symbol_num_ul,
+        cfg->OFDM_DATA_NUM * cfg->BS_ANT_NUM, 64, cfg->buffer_page_backing);
 
     equal_buffer_.malloc(
         task_buffer_symbol_num_ul, cfg->OFDM_DATA_NUM * cfg->UE_NUM, 64);
@@ -1111,22 +1517,24 @@ void Agora::initialize_uplink_buffers()
     rx_counters_.num_pilot_pkts_per_frame
         = cfg->BS_ANT_NUM * cfg->pilot_symbol_num_perframe;
     rx_counters_.num_reciprocity_pkts_per_frame = cfg->BS_ANT_NUM;
+    rx_deadline_cycles_ = us_to_cycles(cfg->rx_deadline_us, freq_ghz);
 
-    fft_created_count = 0;
+    fft_created_count.fill(0);
+    overload_ctrl_.init(cfg->overload_frame_lag, cfg->overload_queue_depth);
+    frame_dag_.init(
+        cfg->ul_data_symbol_num_perframe, cfg->dl_data_symbol_num_perframe);
     fft_stats_.init(cfg->BS_ANT_NUM, cfg->pilot_symbol_num_perframe,
         cfg->symbol_num_perframe);
     fft_stats_.max_symbol_data_count = cfg->ul_data_symbol_num_perframe;
     fft_stats_.symbol_rc_count.fill(0);
     fft_stats_.max_symbol_rc_count = cfg->BS_ANT_NUM;
-    fft_stats_.cur_frame_for_symbol
-        = std::vector<size_t>(cfg->ul_data_symbol_num_perframe, SIZE_MAX);
 
     zf_stats_.init(config_->zf_events_per_symbol);
 
     demul_stats_.init(config_->demul_events_per_symbol,
         cfg->ul_data_symbol_num_perframe, cfg->data_symbol_num_perframe);
 
-    decode_stats_.init(config_->LDPC_config.nblocksInSymbol * cfg->UE_NUM,
+    decode_stats_.init(config_->decode_events_per_symbol,
         cfg->ul_data_symbol_num_perframe, cfg->data_symbol_num_perframe);
 
     tomac_stats_.init(cfg->UE_NUM, cfg->ul_data_symbol_num_perframe,
@@ -1158,14 +1566,18 @@ void Agora::initialize_downlink_buffers()
     calib_buffer_.calloc(kFrameWnd, cfg->OFDM_DATA_NUM * cfg->BS_ANT_NUM, 64);
     dl_encoded_buffer_.calloc(task_buffer_symbol_num,
         roundup<64>(cfg->OFDM_DATA_NUM) * cfg->UE_NUM, 64);
+    if (cfg->fused_precode_ifft) {
+        dl_modulated_buffer_.calloc(
+            task_buffer_symbol_num, cfg->OFDM_DATA_NUM * cfg->UE_NUM, 64);
+    }
 
     frommac_stats_.init(config_->UE_NUM, cfg->dl_data_symbol_num_perframe,
         cfg->data_symbol_num_perframe);
     encode_stats_.init(config_->LDPC_config.nblocksInSymbol * cfg->UE_NUM,
         cfg->dl_data_symbol_num_perframe, cfg->data_symbol_num_perframe);
-    encode_stats_.cur_frame_for_symbol
-        = std::vector<size_t>(cfg->dl_data_symbol_num_perframe, SIZE_MAX);
-    precode_stats_.init(config_->demul_events_per_symbol,
+    precode_stats_.init(cfg->fused_precode_ifft
+            ? cfg->fused_precode_events_per_symbol
+            : cfg->demul_events_per_symbol,
         cfg->dl_data_symbol_num_perframe, cfg->data_symbol_num_perframe);
     ifft_stats_.init(cfg->BS_ANT_NUM, cfg->dl_data_symbol_num_perframe,
         cfg->data_symbol_num_perframe);
@@ -1173,6 +1585,176 @@ void Agora::initialize_downlink_buffers()
         cfg->data_symbol_num_perframe);
 }
 
+void Agora::place_buffers()
+{
+    const NumaPolicy policy
+        = NumaUtils::policy_from_string(config_->numa_buffer_policy);
+    if (policy == NumaPolicy::kDefault)
+        return;
+
+    // Without worker nodes, spread the buffers across all nodes
+    std::vector<size_t> nodes = config_->worker_numa_nodes;
+    if (nodes.empty()) {
+        for (size_t i = 0; i < NumaUtils::num_nodes(); i++)
+            nodes.push_back(i);
+    }
+    printf("Agora: Placing buffers with NUMA policy %s\n",
+        config_->numa_buffer_policy.c_str());
+
+    // All buffers below are indexed by frame slot first, so each of their
+    // kFrameWnd frame slots is contiguous
+    auto place = [&](void* buf, size_t size, PageBacking backing) {
+        NumaUtils::place(buf, size, policy, nodes, kFrameWnd,
+            page_backing_size(backing));
+    };
+    place(data_buffer_[0], data_buffer_.size_bytes(),
+        data_buffer_.page_backing());
+    place(equal_buffer_[0], equal_buffer_.size_bytes(),
+        equal_buffer_.page_backing());
+    place(csi_buffers_.backing_buffer(), csi_buffers_.backing_buffer_size(),
+        csi_buffers_.page_backing());
+    place(ul_zf_matrices_.backing_buffer(),
+        ul_zf_matrices_.backing_buffer_size(), ul_zf_matrices_.page_backing());
+    place(demod_buffers_.backing_buffer(),
+        demod_buffers_.backing_buffer_size(), demod_buffers_.page_backing());
+    place(decoded_buffer_.backing_buffer(),
+        decoded_buffer_.backing_buffer_size(), decoded_buffer_.page_backing());
+    place(dl_zf_matrices_.backing_buffer(),
+        dl_zf_matrices_.backing_buffer_size(), dl_zf_matrices_.page_backing());
+    if (config_->dl_data_symbol_num_perframe > 0) {
+        place(dl_ifft_buffer_[0], dl_ifft_buffer_.size_bytes(),
+            dl_ifft_buffer_.page_backing());
+        place(dl_encoded_buffer_[0], dl_encoded_buffer_.size_bytes(),
+            dl_encoded_buffer_.page_backing());
+        if (dl_modulated_buffer_.is_allocated()) {
+            place(dl_modulated_buffer_[0], dl_modulated_buffer_.size_bytes(),
+                dl_modulated_buffer_.page_backing());
+        }
+    }
+}
+
+void Agora::print_memory_footprint()
+{
+    size_t total_bytes = 0;
+    printf("Agora: Memory footprint of shared buffers:\n");
+    auto print = [&](const char* name, size_t size, PageBacking backing) {
+        if (size == 0)
+            return;
+        printf("  %-24s %10.2f MB  %s\n", name, size / (1024.0 * 1024),
+            page_backing_str(backing));
+        total_bytes += size;
+    };
+    print("socket_buffer", socket_buffer_.size_bytes(),
+        socket_buffer_.page_backing());
+    print("data_buffer", data_buffer_.size_bytes(),
+        data_buffer_.page_backing());
+    print("equal_buffer", equal_buffer_.size_bytes(),
+        equal_buffer_.page_backing());
+    print("csi_buffers", csi_buffers_.backing_buffer_size(),
+        csi_buffers_.page_backing());
+    print("ul_zf_matrices", ul_zf_matrices_.backing_buffer_size(),
+        ul_zf_matrices_.page_backing());
+    print("demod_buffers", demod_buffers_.backing_buffer_size(),
+        demod_buffers_.page_backing());
+    print("decoded_buffer", decoded_buffer_.backing_buffer_size(),
+        decoded_buffer_.page_backing());
+    print("dl_zf_matrices", dl_zf_matrices_.backing_buffer_size(),
+        dl_zf_matrices_.page_backing());
+    print("dl_ifft_buffer", dl_ifft_buffer_.size_bytes(),
+        dl_ifft_buffer_.page_backing());
+    print("dl_encoded_buffer", dl_encoded_buffer_.size_bytes(),
+        dl_encoded_buffer_.page_backing());
+    print("dl_modulated_buffer", dl_modulated_buffer_.size_bytes(),
+        dl_modulated_buffer_.page_backing());
+    print("dl_bits_buffer", dl_bits_buffer_.size_bytes(),
+        dl_bits_buffer_.page_backing());
+    print("calib_buffer", calib_buffer_.size_bytes(),
+        calib_buffer_.page_backing());
+    printf("  %-24s %10.2f MB\n", "Total", total_bytes / (1024.0 * 1024));
+}
+
+void Agora::pin_worker(int tid, bool verbose)
+{
+    if (config_->worker_cores.empty()) {
+        pin_to_core_with_offset(
+            ThreadType::kWorker, base_worker_core_offset, tid, verbose);
+    } else {
+        pin_to_core_in_list(
+            ThreadType::kWorker, config_->worker_cores, tid, verbose);
+    }
+}
+
+void Agora::trace_worker_doers(int tid, const std::vector<Doer*>& doers)
+{
+    if (task_tracer_ == nullptr)
+        return;
+    for (Doer* doer : doers)
+        doer->set_trace_ring(task_tracer_->ring(tid));
+}
+
+void Agora::save_task_trace()
+{
+    std::string cur_directory = TOSTRING(PROJECT_DIRECTORY);
+    task_tracer_->save(cur_directory + "/data/task_trace.json");
+}
+
+void Agora::publish_metrics()
+{
+    MetricsSnapshot snapshot;
+    snapshot.num_frames_done = stats->num_frames_done;
+    snapshot.frame_lag = newest_rx_frame_ >= frame_dag_.oldest_frame()
+        ? newest_rx_frame_ - frame_dag_.oldest_frame()
+        : 0;
+
+    for (size_t i = 0; i < kNumDoerTypes; i++) {
+        const DurationStat ds
+            = stats->get_total_duration_stat(static_cast<DoerType>(i));
+        snapshot.task_count[i] = ds.task_count;
+        snapshot.task_seconds[i] = cycles_to_sec(ds.task_duration[0], freq_ghz);
+    }
+    for (size_t i = 0; i < kNumEventTypes; i++)
+        snapshot.queue_depth[i] = sched_info_arr[i].concurrent_q.size_approx();
+    snapshot.complete_queue_depth = complete_task_queue_.size_approx();
+
+    // Frames are retired in order, so the latest ones precede the last
+    // retired frame. Shed frames have no latency and are skipped.
+    const size_t max_latencies
+        = std::min(stats->num_frames_done, kMetricsLatencyWindow);
+    snapshot.num_latencies = 0;
+    for (size_t i = 0; snapshot.num_latencies < max_latencies
+         and i <= stats->last_frame_id and i < kNumStatsFrames;
+         i++) {
+        const double latency_us
+            = stats->get_frame_latency_us(stats->last_frame_id - i);
+        if (!std::isnan(latency_us))
+            snapshot.frame_latency_us[snapshot.num_latencies++] = latency_us;
+    }
+
+    snapshot.num_ues = std::min(config_->UE_NUM, kMaxUEs);
+    for (size_t i = 0; i < snapshot.num_ues; i++) {
+        if (stats->num_frames_done > 0) {
+            snapshot.pilot_snr_db[i]
+                = phy_stats->get_pilot_snr(stats->last_frame_id, i);
+            snapshot.evm_percent[i]
+                = phy_stats->get_evm(stats->last_frame_id, i);
+        } else {
+            snapshot.pilot_snr_db[i] = 0;
+            snapshot.evm_percent[i] = 0;
+        }
+        phy_stats->get_block_stats(
+            i, snapshot.decoded_blocks[i], snapshot.block_errors[i]);
+    }
+
+    snapshot.rx_drop_stat = stats->rx_drop_stat;
+    snapshot.overload_stat = stats->overload_stat;
+    snapshot.overload_stat.num_rx_overflow_pkts
+        = packet_tx_rx_->get_num_rx_overflow_pkts();
+
+    metrics_server_->publish(snapshot);
+    next_metrics_tsc_
+        = rdtsc() + ms_to_cycles(MetricsServer::kPublishIntervalMs, freq_ghz);
+}
+
 void Agora::free_uplink_buffers()
 {
     socket_buffer_.free();
@@ -1193,6 +1775,7 @@ void Agora::free_downlink_buffers()
     dl_ifft_buffer_.free();
     calib_buffer_.free();
     dl_encoded_buffer_.free();
+    dl_modulated_buffer_.free();
 
     encode_stats_.fini();
     precode_stats_.fini();
@@ -1238,8 +1821,8 @@ void Agora::save_tx_data_to_file(UNUSED int frame_id)
             size_t packet_length = config_->packet_length;
             struct Packet* pkt
                 = (struct Packet*)(&dl_socket_buffer_[offset * packet_length]);
-            short* socket_ptr = pkt->data;
-            fwrite(socket_ptr, cfg->sampsPerSymbol * 2, sizeof(short), fp);
+            // Compressed packets are saved as they are sent
+            fwrite(pkt->data, packet_length - Packet::kOffsetOfData, 1, fp);
         }
     }
     fclose(fp);
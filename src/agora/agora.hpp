@@ -6,6 +6,7 @@
 #include "concurrentqueue.h"
 #include "config.hpp"
 #include "docoding.hpp"
+#include "frame_dag.hpp"
 #include "dodemul.hpp"
 #include "dofft.hpp"
 #include "doprecode.hpp"
@@ -13,12 +14,17 @@
 #include "gettime.h"
 #include "mac_thread.hpp"
 #include "memory_manage.h"
+#include "metrics_server.hpp"
+#include "overload_controller.hpp"
 #include "phy_stats.hpp"
 #include "signalHandler.hpp"
 #include "stats.hpp"
+#include "task_tracer.hpp"
 #include "txrx.hpp"
 #include "utils.h"
+#include "work_stealing.hpp"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <memory>
 #include <pthread.h>
@@ -51,6 +57,10 @@ public:
     void* worker_demul(int tid);
     void* worker(int tid);
 
+    /// Worker for the decentralized (work-stealing) scheduling mode. Workers
+    /// schedule decode tasks themselves after demodulating a symbol.
+    void* worker_work_stealing(int tid);
+
     /* Launch threads to run worker with thread IDs tid_start to tid_end - 1 */
     void create_threads(void* (*worker)(void*), int tid_start, int tid_end);
 
@@ -62,14 +72,28 @@ public:
     void print_per_task_done(PrintType print_type, size_t frame_id,
         size_t symbol_id, size_t ant_or_sc_id);
 
-    /// Update Agora's RAN config parameters
+    /// Queue a RAN config update from the MAC, which applies to frames
+    /// starting from rc.frame_id
     void update_ran_config(RanConfig rc);
 
+    /// Set the modulation order of a frame that is starting from the RAN
+    /// config updates that apply to it
+    void apply_ran_config(size_t frame_id);
+
     void schedule_subcarriers(
         EventType task_type, size_t frame_id, size_t symbol_id);
     void schedule_antennas(
         EventType task_type, size_t frame_id, size_t symbol_id);
 
+    /// Schedule downlink precoding for symbol [symbol_id] of frame
+    /// [frame_id]: over blocks of subcarriers, or over blocks of antennas if
+    /// precoding and IFFT are fused
+    void schedule_precode(size_t frame_id, size_t symbol_id);
+
+    /// Handle the completion of IFFT for the antenna of [tag] and schedule
+    /// its transmission
+    void handle_ifft_done(size_t tag);
+
     /**
      * @brief Schedule LDPC decoding or encoding over code blocks
      * @param task_type Either LDPC decoding or LDPC encoding
@@ -86,12 +110,60 @@ public:
     void send_snr_report(
         EventType event_type, size_t frame_id, size_t symbol_id);
 
-    void move_events_between_queues(
-        EventType event_type1, EventType event_type2);
+    /// Schedule FFT tasks for the received packets of frame [frame_id], in
+    /// blocks of fft_block_size packets
+    void schedule_fft(size_t frame_id);
+
+    /// Check the packet [pkt] received by the master against the frame
+    /// window and the packets already received. Return false if it must be
+    /// dropped.
+    bool accept_rx_packet(const Packet* pkt);
+
+    /// Free the socket buffer slot of a received packet that is dropped
+    void release_rx_packet(size_t tag);
+
+    /// Queue [event] for a worker or socket thread on its event type's queue.
+    /// [ptok] defaults to the event type's producer token. In overload
+    /// shedding mode, the task is counted as in flight for frame [frame_id].
+    void enqueue_task(size_t frame_id, const Event_data& event,
+        moodycamel::ProducerToken* ptok = nullptr);
+
+    /// Drop the oldest in-flight frame: release its queued packets, reset its
+    /// counters, and retire it
+    void shed_oldest_frame();
+
+    /// Return the number of tasks queued for workers and socket threads
+    size_t get_worker_queue_depth();
+
+    /// Replace the missing packets of frames whose RX deadline has passed
+    /// with zeros, in frame order
+    void handle_rx_deadlines();
+
+    /// Zero-fill the FFT outputs of all missing pilot and uplink packets of
+    /// frame [frame_id], and complete their FFT tasks
+    void zero_fill_missing_packets(size_t frame_id);
 
     void initialize_queues();
     void initialize_uplink_buffers();
     void initialize_downlink_buffers();
+
+    /// Apply the configured NUMA policy to the buffers shared by workers
+    void place_buffers();
+
+    /// Print the size and page backing of each shared buffer
+    void print_memory_footprint();
+
+    /// Pin worker thread [tid] to its core
+    void pin_worker(int tid, bool verbose = true);
+
+    /// Record the tasks of worker [tid]'s Doers if task tracing is enabled
+    void trace_worker_doers(int tid, const std::vector<Doer*>& doers);
+
+    /// Save the task trace to data/task_trace.json
+    void save_task_trace();
+
+    /// Publish a snapshot of the runtime metrics to the metrics server
+    void publish_metrics();
     void free_uplink_buffers();
     void free_downlink_buffers();
 
@@ -121,6 +193,25 @@ private:
         return sched_info_arr[static_cast<size_t>(event_type)].ptok;
     }
 
+    /// Return true iff events of this type report the completion of a task
+    /// queued with enqueue_task()
+    static bool is_queued_task(EventType event_type)
+    {
+        switch (event_type) {
+        case EventType::kFFT:
+        case EventType::kZF:
+        case EventType::kDemul:
+        case EventType::kDecode:
+        case EventType::kEncode:
+        case EventType::kPrecode:
+        case EventType::kIFFT:
+        case EventType::kPacketTX:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     /// Return a string containing the sizes of the FFT queues
     std::string get_fft_queue_sizes_string() const
     {
@@ -135,11 +226,14 @@ private:
 
     const double freq_ghz; // RDTSC frequency in GHz
 
-    // Worker thread i runs on core base_worker_core_offset + i
+    // Worker thread i runs on core base_worker_core_offset + i, unless
+    // worker NUMA nodes are configured
     const size_t base_worker_core_offset;
 
     Config* config_;
-    size_t fft_created_count;
+    // fft_created_count[i % kFrameWnd] is the number of FFT tasks created for
+    // frame i
+    std::array<size_t, kFrameWnd> fft_created_count;
     int max_equaled_frame = 0;
     std::unique_ptr<PacketTXRX> packet_tx_rx_;
 
@@ -148,6 +242,20 @@ private:
 
     Stats* stats;
     PhyStats* phy_stats;
+
+    // Per-worker decode task queues and completion counters, used only in
+    // work-stealing mode
+    std::unique_ptr<WorkStealingScheduler> work_stealing_sched_;
+
+    // Reference CSI and zeroforcing matrices, used only in ZF tracking mode
+    std::unique_ptr<ZFTracker> zf_tracker_;
+
+    // Per-worker task timelines, used only if task tracing is enabled
+    std::unique_ptr<TaskTracer> task_tracer_;
+
+    // Serves runtime metrics, used only if a metrics port is configured
+    std::unique_ptr<MetricsServer> metrics_server_;
+    size_t next_metrics_tsc_ = 0; // TSC of the next metrics snapshot
     pthread_t* task_threads;
 
     /*****************************************************
@@ -202,6 +310,29 @@ private:
     Table<complex_float> ue_spec_pilot_buffer_;
 
     RxCounters rx_counters_;
+
+    // In RX deadline mode, rx_deadline_tsc_[i % kFrameWnd] is the TSC by
+    // which all packets of frame i must have arrived. It is set when the
+    // first packet of frame i or of a later frame arrives, so frames that
+    // lose all of their packets also expire.
+    std::array<size_t, kFrameWnd> rx_deadline_tsc_;
+    size_t rx_deadline_cycles_;
+
+    // Oldest frame whose reception is not complete or expired
+    size_t rx_deadline_frame_ = 0;
+
+    // Frames before rx_next_frame_ have an RX deadline set
+    size_t rx_next_frame_ = 0;
+
+    // The newest frame with an accepted packet
+    size_t newest_rx_frame_ = 0;
+
+    // With link adaptation, RAN config updates from the MAC that apply to
+    // frames that have not started yet, in frame order
+    std::queue<RanConfig> ran_config_updates_;
+
+    // The modulation order bits of the most recently started frame
+    size_t mod_order_bits_;
     FFT_stats fft_stats_;
     ZF_stats zf_stats_;
     RC_stats rc_stats_;
@@ -214,6 +345,12 @@ private:
     Data_stats tomac_stats_;
     Data_stats frommac_stats_;
 
+    // Dependencies between the stages of frames in the frame window
+    FrameDag frame_dag_;
+
+    // Decides when to shed frames in overload shedding mode
+    OverloadController overload_ctrl_;
+
     // Per-frame queues of delayed FFT tasks. The queue contains offsets into
     // TX/RX buffers.
     std::array<std::queue<fft_req_tag_t>, kFrameWnd> fft_queue_arr;
@@ -236,6 +373,13 @@ private:
     // 2nd dimension: number of OFDM data subcarriers * number of UEs
     Table<int8_t> dl_encoded_buffer_;
 
+    // Modulated downlink data of each symbol, written by encode tasks and
+    // read by all fused precode tasks of the symbol. Allocated only if
+    // fused_precode_ifft is set.
+    // 1st dimension: kFrameWnd * number of data symbols per frame
+    // 2nd dimension: number of OFDM data subcarriers * number of UEs
+    Table<complex_float> dl_modulated_buffer_;
+
     // 1st dimension: kFrameWnd * number of DL data symbols per frame
     // 2nd dimension: number of OFDM data subcarriers * number of UEs
     Table<uint8_t> dl_bits_buffer_;
@@ -276,13 +420,9 @@ private:
     // Master thread's message queue for event completion from Doers;
     moodycamel::ConcurrentQueue<Event_data> complete_task_queue_;
 
-    // Master thread's message queue for event completion from DoDecode;
-    moodycamel::ConcurrentQueue<Event_data> complete_decode_task_queue_;
-
     moodycamel::ProducerToken* rx_ptoks_ptr[kMaxThreads];
     moodycamel::ProducerToken* tx_ptoks_ptr[kMaxThreads];
     moodycamel::ProducerToken* worker_ptoks_ptr[kMaxThreads];
-    moodycamel::ProducerToken* decode_ptoks_ptr[kMaxThreads];
 };
 
 #endif
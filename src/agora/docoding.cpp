@@ -13,11 +13,12 @@ DoEncode::DoEncode(Config* in_config, int in_tid, double freq_ghz,
     moodycamel::ConcurrentQueue<Event_data>& complete_task_queue,
     moodycamel::ProducerToken* worker_producer_token,
     Table<int8_t>& in_raw_data_buffer, Table<int8_t>& in_encoded_buffer,
-    Stats* in_stats_manager)
+    Table<complex_float>& in_modulated_buffer, Stats* in_stats_manager)
     : Doer(in_config, in_tid, freq_ghz, in_task_queue, complete_task_queue,
           worker_producer_token)
     , raw_data_buffer_(in_raw_data_buffer)
     , encoded_buffer_(in_encoded_buffer)
+    , modulated_buffer_(in_modulated_buffer)
 {
     duration_stat
         = in_stats_manager->get_duration_stat(DoerType::kEncode, in_tid);
@@ -41,8 +42,9 @@ Event_data DoEncode::launch(size_t tag)
     size_t frame_id = gen_tag_t(tag).frame_id;
     size_t symbol_id = gen_tag_t(tag).symbol_id;
     size_t cb_id = gen_tag_t(tag).cb_id;
-    size_t cur_cb_id = cb_id % cfg->LDPC_config.nblocksInSymbol;
-    size_t ue_id = cb_id / cfg->LDPC_config.nblocksInSymbol;
+    const ModConfig& mod_cfg = cfg->mod_cfg(frame_id);
+    size_t cur_cb_id = cb_id % mod_cfg.nblocksInSymbol;
+    size_t ue_id = cb_id / mod_cfg.nblocksInSymbol;
     if (kDebugPrintInTask) {
         printf(
             "In doEncode thread %d: frame: %zu, symbol: %zu, code block %zu, "
@@ -62,7 +64,9 @@ Event_data DoEncode::launch(size_t tag)
         encoded_buffer_, frame_id, symbol_idx_dl, ue_id, cur_cb_id);
     adapt_bits_for_mod(reinterpret_cast<uint8_t*>(encoded_buffer_temp),
         reinterpret_cast<uint8_t*>(final_output_ptr),
-        bits_to_bytes(LDPC_config.cbCodewLen), cfg->mod_order_bits);
+        bits_to_bytes(LDPC_config.cbCodewLen), mod_cfg.mod_order_bits);
+    if (cfg->fused_precode_ifft)
+        modulate_codeblock(frame_id, symbol_idx_dl, ue_id, cur_cb_id);
 
     // printf("Encoded data\n");
     // int num_mod = LDPC_config.cbCodewLen / cfg->mod_order_bits;
@@ -82,6 +86,37 @@ Event_data DoEncode::launch(size_t tag)
     return Event_data(EventType::kEncode, tag);
 }
 
+void DoEncode::modulate_codeblock(
+    size_t frame_id, size_t symbol_idx_dl, size_t ue_id, size_t cb_id)
+{
+    const ModConfig& mod_cfg = cfg->mod_cfg(frame_id);
+    const size_t num_scs_per_cb
+        = cfg->LDPC_config.cbCodewLen / mod_cfg.mod_order_bits;
+    const size_t base_sc_id = num_scs_per_cb * cb_id;
+    const size_t end_sc_id = cb_id == mod_cfg.nblocksInSymbol - 1
+        ? cfg->OFDM_DATA_NUM
+        : base_sc_id + num_scs_per_cb;
+
+    const size_t total_data_symbol_idx
+        = cfg->get_total_data_symbol_idx_dl(frame_id, symbol_idx_dl);
+    const int8_t* encoded_ptr = &encoded_buffer_[total_data_symbol_idx]
+                                                [roundup<64>(cfg->OFDM_DATA_NUM)
+                                                    * ue_id];
+    const complex_float* mod_table = mod_cfg.mod_table[0];
+    const complex_float* pilots = cfg->ue_specific_pilot[ue_id];
+    complex_float* out_ptr = modulated_buffer_[total_data_symbol_idx];
+
+    // In downlink pilot symbols, all subcarriers are used as pilots. In
+    // downlink data symbols, every OFDM_PILOT_SPACING-th subcarrier is.
+    const bool is_pilot_symbol = symbol_idx_dl < cfg->DL_PILOT_SYMS;
+    for (size_t sc_id = base_sc_id; sc_id < end_sc_id; sc_id++) {
+        out_ptr[sc_id * cfg->UE_NUM + ue_id]
+            = is_pilot_symbol || sc_id % cfg->OFDM_PILOT_SPACING == 0
+            ? pilots[sc_id]
+            : mod_table[static_cast<uint8_t>(encoded_ptr[sc_id])];
+    }
+}
+
 DoDecode::DoDecode(Config* in_config, int in_tid, double freq_ghz,
     moodycamel::ConcurrentQueue<Event_data>& in_task_queue,
     moodycamel::ConcurrentQueue<Event_data>& complete_task_queue,
@@ -94,29 +129,66 @@ DoDecode::DoDecode(Config* in_config, int in_tid, double freq_ghz,
     , demod_buffers_(demod_buffers)
     , decoded_buffers_(decoded_buffers)
     , phy_stats(in_phy_stats)
+    , stats_manager_(in_stats_manager)
 {
     duration_stat
         = in_stats_manager->get_duration_stat(DoerType::kDecode, in_tid);
+    decode_iter_stat = in_stats_manager->get_decode_iter_stat(in_tid);
     resp_var_nodes = (int16_t*)memalign(64, 1024 * 1024 * sizeof(int16_t));
 }
 
+int16_t DoDecode::iteration_budget(int16_t iter_max, int16_t iter_min,
+    size_t remaining_cycles, size_t deadline_cycles)
+{
+    if (remaining_cycles == 0)
+        return iter_min;
+
+    // Use the full budget while at least half of the time before the
+    // deadline remains, then scale it down linearly
+    if (remaining_cycles * 2 >= deadline_cycles)
+        return iter_max;
+    return iter_min
+        + (iter_max - iter_min) * remaining_cycles * 2 / deadline_cycles;
+}
+
+int16_t DoDecode::get_iteration_budget(size_t frame_id)
+{
+    const LDPCconfig& LDPC_config = cfg->LDPC_config;
+    if (!LDPC_config.adaptiveIter)
+        return LDPC_config.decoderIter;
+
+    const size_t deadline_cycles = cfg->frame_deadline_us * 1000 * freq_ghz;
+    const size_t deadline_tsc
+        = stats_manager_->master_get_tsc(TsType::kPilotRX, frame_id)
+        + deadline_cycles;
+    const size_t cur_tsc = rdtsc();
+    return iteration_budget(LDPC_config.decoderIter,
+        LDPC_config.decoderIterMin,
+        cur_tsc >= deadline_tsc ? 0 : deadline_tsc - cur_tsc, deadline_cycles);
+}
+
 DoDecode::~DoDecode() { free(resp_var_nodes); }
 
 Event_data DoDecode::launch(size_t tag)
 {
-    LDPCconfig LDPC_config = cfg->LDPC_config;
+    const LDPCconfig& LDPC_config = cfg->LDPC_config;
     const size_t frame_id = gen_tag_t(tag).frame_id;
     const size_t symbol_idx_ul = gen_tag_t(tag).symbol_id;
-    const size_t cb_id = gen_tag_t(tag).cb_id;
+    const size_t base_cb_id = gen_tag_t(tag).cb_id;
     const size_t symbol_offset
         = cfg->get_total_data_symbol_idx_ul(frame_id, symbol_idx_ul);
-    const size_t cur_cb_id = cb_id % cfg->LDPC_config.nblocksInSymbol;
-    const size_t ue_id = cb_id / cfg->LDPC_config.nblocksInSymbol;
     const size_t frame_slot = frame_id % kFrameWnd;
+    const ModConfig& mod_cfg = cfg->mod_cfg(frame_id);
+
+    // This task decodes code blocks [base_cb_id, base_cb_id + num_cbs) of the
+    // symbol, where code block cb_id belongs to UE cb_id / nblocksInSymbol
+    const size_t num_cbs = std::min(mod_cfg.decode_batch_size,
+        cfg->UE_NUM * mod_cfg.nblocksInSymbol - base_cb_id);
     if (kDebugPrintInTask) {
-        printf("In doDecode thread %d: frame: %zu, symbol: %zu, code block: "
-               "%zu, ue: %zu\n",
-            tid, frame_id, symbol_idx_ul, cur_cb_id, ue_id);
+        printf("In doDecode thread %d: frame: %zu, symbol: %zu, code blocks: "
+               "%zu to %zu\n",
+            tid, frame_id, symbol_idx_ul, base_cb_id,
+            base_cb_id + num_cbs - 1);
     }
 
     size_t start_tsc = worker_rdtsc();
@@ -126,13 +198,14 @@ Event_data DoDecode::launch(size_t tag)
     struct bblib_ldpc_decoder_5gnr_response ldpc_decoder_5gnr_response {
     };
 
-    // Decoder setup
+    // Decoder setup, shared by all code blocks of this task
     int16_t numFillerBits = 0;
     int16_t numChannelLlrs = LDPC_config.cbCodewLen;
 
     ldpc_decoder_5gnr_request.numChannelLlrs = numChannelLlrs;
     ldpc_decoder_5gnr_request.numFillerBits = numFillerBits;
-    ldpc_decoder_5gnr_request.maxIterations = LDPC_config.decoderIter;
+    const int16_t max_iterations = get_iteration_budget(frame_id);
+    ldpc_decoder_5gnr_request.maxIterations = max_iterations;
     ldpc_decoder_5gnr_request.enableEarlyTermination
         = LDPC_config.earlyTermination;
     ldpc_decoder_5gnr_request.Zc = LDPC_config.Zc;
@@ -143,64 +216,89 @@ Event_data DoDecode::launch(size_t tag)
     ldpc_decoder_5gnr_response.numMsgBits = numMsgBits;
     ldpc_decoder_5gnr_response.varNodes = resp_var_nodes;
 
-    int8_t* llr_buffer_ptr = demod_buffers_[frame_slot][symbol_idx_ul][ue_id]
-        + (cfg->mod_order_bits * (LDPC_config.cbCodewLen * cur_cb_id));
+    size_t start_tsc1 = worker_rdtsc();
+    duration_stat->task_duration[1] += start_tsc1 - start_tsc;
 
-    uint8_t* decoded_buffer_ptr
-        = decoded_buffers_[frame_slot][symbol_idx_ul][ue_id]
-        + (cur_cb_id * roundup<64>(cfg->num_bytes_per_cb));
+    for (size_t cb_id = base_cb_id; cb_id < base_cb_id + num_cbs; cb_id++) {
+        const size_t cur_cb_id = cb_id % mod_cfg.nblocksInSymbol;
+        const size_t ue_id = cb_id / mod_cfg.nblocksInSymbol;
 
-    ldpc_decoder_5gnr_request.varNodes = llr_buffer_ptr;
-    ldpc_decoder_5gnr_response.compactedMessageBytes = decoded_buffer_ptr;
+        int8_t* llr_buffer_ptr
+            = demod_buffers_[frame_slot][symbol_idx_ul][ue_id]
+            + (mod_cfg.mod_order_bits * (LDPC_config.cbCodewLen * cur_cb_id));
 
-    size_t start_tsc1 = worker_rdtsc();
-    duration_stat->task_duration[1] += start_tsc1 - start_tsc;
+        uint8_t* decoded_buffer_ptr
+            = decoded_buffers_[frame_slot][symbol_idx_ul][ue_id]
+            + (cur_cb_id * roundup<64>(cfg->num_bytes_per_cb));
+
+        ldpc_decoder_5gnr_request.varNodes = llr_buffer_ptr;
+        ldpc_decoder_5gnr_response.compactedMessageBytes = decoded_buffer_ptr;
 
-    bblib_ldpc_decoder_5gnr(
-        &ldpc_decoder_5gnr_request, &ldpc_decoder_5gnr_response);
+        size_t decode_start_tsc = worker_rdtsc();
+        bblib_ldpc_decoder_5gnr(
+            &ldpc_decoder_5gnr_request, &ldpc_decoder_5gnr_response);
+        duration_stat->task_duration[2] += worker_rdtsc() - decode_start_tsc;
 
-    size_t start_tsc2 = worker_rdtsc();
-    duration_stat->task_duration[2] += start_tsc2 - start_tsc1;
+        decode_iter_stat->iter_hist[std::min(
+            static_cast<size_t>(
+                ldpc_decoder_5gnr_response.iterationAtTermination),
+            kDecodeIterHistSize - 1)]++;
+        if (max_iterations < LDPC_config.decoderIter)
+            decode_iter_stat->num_budget_limited++;
 
-    if (kPrintLLRData) {
-        printf("LLR data, symbol_offset: %zu\n", symbol_offset);
-        for (size_t i = 0; i < LDPC_config.cbCodewLen; i++) {
-            printf("%d ", *(llr_buffer_ptr + i));
+        // The decoder terminates early once all parity checks pass. The
+        // codeblock CRC confirms that the decoded block is correct.
+        if (LDPC_config.cbCrc) {
+            if (crc_obj.check_cb_crc24(
+                    decoded_buffer_ptr, cfg->num_bytes_per_cb))
+                decode_iter_stat->num_crc_passed++;
+            else
+                decode_iter_stat->num_crc_failed++;
         }
-        printf("\n");
-    }
 
-    if (kPrintDecodedData) {
-        printf("Decoded data\n");
-        for (size_t i = 0; i < (LDPC_config.cbLen >> 3); i++) {
-            printf("%u ", *(decoded_buffer_ptr + i));
+        if (kPrintLLRData) {
+            printf("LLR data, symbol_offset: %zu\n", symbol_offset);
+            for (size_t i = 0; i < LDPC_config.cbCodewLen; i++) {
+                printf("%d ", *(llr_buffer_ptr + i));
+            }
+            printf("\n");
+        }
+
+        if (kPrintDecodedData) {
+            printf("Decoded data\n");
+            for (size_t i = 0; i < (LDPC_config.cbLen >> 3); i++) {
+                printf("%u ", *(decoded_buffer_ptr + i));
+            }
+            printf("\n");
         }
-        printf("\n");
-    }
 
-    if (!kEnableMac && kPrintPhyStats && symbol_idx_ul == cfg->UL_PILOT_SYMS) {
-        phy_stats->update_decoded_bits(
-            ue_id, symbol_offset, cfg->num_bytes_per_cb * 8);
-        phy_stats->increment_decoded_blocks(ue_id, symbol_offset);
-        size_t block_error(0);
-        for (size_t i = 0; i < cfg->num_bytes_per_cb; i++) {
-            uint8_t rx_byte = decoded_buffer_ptr[i];
-            uint8_t tx_byte = (uint8_t)cfg->get_info_bits(
-                cfg->ul_bits, symbol_idx_ul, ue_id, cur_cb_id)[i];
-            phy_stats->update_bit_errors(
-                ue_id, symbol_offset, tx_byte, rx_byte);
-            if (rx_byte != tx_byte)
-                block_error++;
+        if (!kEnableMac && kPrintPhyStats
+            && symbol_idx_ul == cfg->UL_PILOT_SYMS) {
+            phy_stats->update_decoded_bits(
+                ue_id, symbol_offset, cfg->num_bytes_per_cb * 8);
+            phy_stats->increment_decoded_blocks(ue_id, symbol_offset);
+            size_t block_error(0);
+            for (size_t i = 0; i < cfg->num_bytes_per_cb; i++) {
+                uint8_t rx_byte = decoded_buffer_ptr[i];
+                uint8_t tx_byte = (uint8_t)cfg->get_info_bits(
+                    cfg->ul_bits, symbol_idx_ul, ue_id, cur_cb_id)[i];
+                phy_stats->update_bit_errors(
+                    ue_id, symbol_offset, tx_byte, rx_byte);
+                if (rx_byte != tx_byte)
+                    block_error++;
+            }
+            phy_stats->update_block_errors(ue_id, symbol_offset, block_error);
         }
-        phy_stats->update_block_errors(ue_id, symbol_offset, block_error);
     }
 
+    // Durations and task counts are per code block, so that they do not
+    // depend on the decode batch size
     double duration = worker_rdtsc() - start_tsc;
     duration_stat->task_duration[0] += duration;
-    duration_stat->task_count++;
-    if (cycles_to_us(duration, freq_ghz) > 500) {
+    duration_stat->task_count += num_cbs;
+    if (cycles_to_us(duration / num_cbs, freq_ghz) > 500) {
         printf("Thread %d Decode takes %.2f\n", tid,
-            cycles_to_us(duration, freq_ghz));
+            cycles_to_us(duration / num_cbs, freq_ghz));
     }
 
     return Event_data(EventType::kDecode, tag);
@@ -5,6 +5,7 @@
 #include "buffer.hpp"
 #include "concurrentqueue.h"
 #include "config.hpp"
+#include "crc.hpp"
 #include "doer.hpp"
 #include "gettime.h"
 #include "memory_manage.h"
@@ -28,18 +29,29 @@ public:
         moodycamel::ConcurrentQueue<Event_data>& complete_task_queue,
         moodycamel::ProducerToken* worker_producer_token,
         Table<int8_t>& in_raw_data_buffer, Table<int8_t>& in_encoded_buffer,
-        Stats* in_stats_manager);
+        Table<complex_float>& in_modulated_buffer, Stats* in_stats_manager);
     ~DoEncode();
 
     Event_data launch(size_t tag);
 
 private:
+    /// Modulate the subcarriers of code block [cb_id] of UE [ue_id] into
+    /// modulated_buffer_, with the UE's pilots on pilot subcarriers. The last
+    /// code block also covers the subcarriers after the code blocks.
+    void modulate_codeblock(
+        size_t frame_id, size_t symbol_idx_dl, size_t ue_id, size_t cb_id);
+
     Table<int8_t>& raw_data_buffer_;
     int8_t* parity_buffer; // Intermediate buffer to hold LDPC encoding parity
 
     // Intermediate buffer to hold LDPC encoding output
     int8_t* encoded_buffer_temp;
     Table<int8_t>& encoded_buffer_;
+
+    // Modulated downlink symbols read by fused precode tasks, written only
+    // if fused_precode_ifft is set. Same layout as dl_modulated_buffer_ in
+    // Agora.
+    Table<complex_float>& modulated_buffer_;
     DurationStat* duration_stat;
 };
 
@@ -56,12 +68,28 @@ public:
 
     Event_data launch(size_t tag);
 
+    /// Return the maximum number of decoder iterations for a codeblock with
+    /// [remaining_cycles] of [deadline_cycles] left before its frame's
+    /// deadline: [iter_max] while at least half of the time remains, then
+    /// shrinking linearly to [iter_min] at the deadline
+    static int16_t iteration_budget(int16_t iter_max, int16_t iter_min,
+        size_t remaining_cycles, size_t deadline_cycles);
+
 private:
+    /// Return the maximum number of decoder iterations for a codeblock of
+    /// this frame. With adaptive iterations, the budget shrinks from
+    /// decoderIter to decoderIterMin over the second half of the time
+    /// before the frame's deadline.
+    int16_t get_iteration_budget(size_t frame_id);
+
     int16_t* resp_var_nodes;
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers_;
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, uint8_t>& decoded_buffers_;
     PhyStats* phy_stats;
+    Stats* stats_manager_;
     DurationStat* duration_stat;
+    DecodeIterStat* decode_iter_stat;
+    DoCRC crc_obj;
 };
 
 #endif
@@ -3,6 +3,10 @@
 #include <malloc.h>
 
 static constexpr bool kUseSIMDGather = true;
+// Equalize and demodulate data symbols in one pass over small tiles of
+// subcarriers, instead of gathering, equalizing, transposing, and demodulating
+// a whole block of subcarriers in separate passes
+static constexpr bool kUseFusedEqualizeDemod = true;
 
 DoDemul::DoDemul(Config* config, int tid, double freq_ghz,
     moodycamel::ConcurrentQueue<Event_data>& task_queue,
@@ -32,6 +36,13 @@ DoDemul::DoDemul(Config* config, int tid, double freq_ghz,
     equaled_buffer_temp_transposed = reinterpret_cast<complex_float*>(
         memalign(64, cfg->demul_block_size * kMaxUEs * sizeof(complex_float)));
 
+    equalize_tile_fn = select_equalize_tile_fn(
+        cfg->BS_ANT_NUM, cfg->UE_NUM, kUseFixedSizeKernels);
+    equal_tile = reinterpret_cast<complex_float*>(
+        memalign(64, kEqualizeTileSCs * kMaxUEs * sizeof(complex_float)));
+    phase_correct_buffer = reinterpret_cast<complex_float*>(
+        memalign(64, kMaxUEs * sizeof(complex_float)));
+
     // phase offset calibration data
     cx_float* ue_pilot_ptr = (cx_float*)cfg->ue_specific_pilot[0];
     cx_fmat mat_pilot_data(
@@ -59,6 +70,8 @@ DoDemul::~DoDemul()
     free(data_gather_buffer);
     free(equaled_buffer_temp);
     free(equaled_buffer_temp_transposed);
+    free(equal_tile);
+    free(phase_correct_buffer);
 }
 
 Event_data DoDemul::launch(size_t tag)
@@ -71,6 +84,7 @@ Event_data DoDemul::launch(size_t tag)
     const complex_float* data_buf = data_buffer_[total_data_symbol_idx_ul];
 
     const size_t frame_slot = frame_id % kFrameWnd;
+    const size_t mod_order_bits = cfg->mod_cfg(frame_id).mod_order_bits;
     size_t start_tsc = worker_rdtsc();
 
     if (kDebugPrintInTask) {
@@ -81,6 +95,20 @@ Event_data DoDemul::launch(size_t tag)
     size_t max_sc_ite
         = std::min(cfg->demul_block_size, cfg->OFDM_DATA_NUM - base_sc_id);
     assert(max_sc_ite % kSCsPerCacheline == 0);
+
+    // Symbols used for phase tracking and EVM measurement need the
+    // per-subcarrier path below
+    if (kUseFusedEqualizeDemod and !kExportConstellation
+        and (cfg->UL_PILOT_SYMS == 0 or symbol_idx_ul > cfg->UL_PILOT_SYMS)
+        and (mod_order_bits == CommsLib::QPSK
+                or mod_order_bits == CommsLib::QAM16
+                or mod_order_bits == CommsLib::QAM64
+                or mod_order_bits == CommsLib::QAM256)) {
+        equalize_demod_fused(
+            frame_id, symbol_idx_ul, base_sc_id, max_sc_ite, data_buf);
+        duration_stat->task_duration[0] += worker_rdtsc() - start_tsc;
+        return Event_data(EventType::kDemul, tag);
+    }
     // Iterate through cache lines
     for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
         size_t start_tsc0 = worker_rdtsc();
@@ -237,18 +265,24 @@ Event_data DoDemul::launch(size_t tag)
         }
         equal_T_ptr = (float*)(equaled_buffer_temp_transposed);
         int8_t* demod_ptr = demod_buffers_[frame_slot][symbol_idx_ul][i]
-            + (cfg->mod_order_bits * base_sc_id);
+            + (mod_order_bits * base_sc_id);
 
-        switch (cfg->mod_order_bits) {
+        switch (mod_order_bits) {
+        case (CommsLib::QPSK):
+            demod_qpsk_soft_avx2(equal_T_ptr, demod_ptr, max_sc_ite);
+            break;
         case (CommsLib::QAM16):
             demod_16qam_soft_avx2(equal_T_ptr, demod_ptr, max_sc_ite);
             break;
         case (CommsLib::QAM64):
             demod_64qam_soft_avx2(equal_T_ptr, demod_ptr, max_sc_ite);
             break;
+        case (CommsLib::QAM256):
+            demod_256qam_soft_avx2(equal_T_ptr, demod_ptr, max_sc_ite);
+            break;
         default:
-            printf("Demodulation: modulation type %s not supported!\n",
-                cfg->modulation.c_str());
+            printf("Demodulation: modulation type %zu bits not supported!\n",
+                mod_order_bits);
         }
         // printf("In doDemul thread %d: frame: %d, symbol: %d, sc_id: %d \n",
         //     tid, frame_id, symbol_idx_ul, base_sc_id);
@@ -263,3 +297,69 @@ Event_data DoDemul::launch(size_t tag)
     duration_stat->task_duration[0] += worker_rdtsc() - start_tsc;
     return Event_data(EventType::kDemul, tag);
 }
+
+void DoDemul::equalize_demod_fused(size_t frame_id, size_t symbol_idx_ul,
+    size_t base_sc_id, size_t max_sc_ite, const complex_float* data_buf)
+{
+    const size_t frame_slot = frame_id % kFrameWnd;
+    const size_t ue_num = cfg->UE_NUM;
+    const size_t mod_order_bits = cfg->mod_cfg(frame_id).mod_order_bits;
+
+    // The phase correction is the same for all subcarriers of a symbol
+    const complex_float* phase_correct = nullptr;
+    if (cfg->UL_PILOT_SYMS > 0) {
+        const complex_float* pilot_corr = ue_spec_pilot_buffer_[frame_slot];
+        for (size_t u = 0; u < ue_num; u++) {
+            float theta_0 = atan2f(pilot_corr[u].im, pilot_corr[u].re);
+            float theta_prev = theta_0;
+            float theta_inc = 0;
+            for (size_t s = 1; s < cfg->UL_PILOT_SYMS; s++) {
+                const complex_float& c = pilot_corr[s * ue_num + u];
+                const float theta = atan2f(c.im, c.re);
+                theta_inc += theta - theta_prev;
+                theta_prev = theta;
+            }
+            theta_inc /= (float)std::max(1, (int)cfg->UL_PILOT_SYMS - 1);
+            const float cur_theta = theta_0 + (symbol_idx_ul * theta_inc);
+            phase_correct_buffer[u] = { cosf(-cur_theta), sinf(-cur_theta) };
+        }
+        phase_correct = phase_correct_buffer;
+    }
+
+    complex_float* ul_zf_ptrs[kEqualizeTileSCs];
+    for (size_t i = 0; i < max_sc_ite; i += kEqualizeTileSCs) {
+        size_t start_tsc1 = worker_rdtsc();
+        const size_t num_sc = std::min(kEqualizeTileSCs, max_sc_ite - i);
+        for (size_t j = 0; j < num_sc; j++) {
+            ul_zf_ptrs[j] = ul_zf_matrices_[frame_slot][cfg->get_zf_sc_id(
+                base_sc_id + i + j)];
+        }
+        equalize_tile_fn(data_buf, ul_zf_ptrs, phase_correct, cfg->BS_ANT_NUM,
+            ue_num, base_sc_id + i, num_sc, equal_tile);
+
+        size_t start_tsc2 = worker_rdtsc();
+        duration_stat->task_duration[2] += start_tsc2 - start_tsc1;
+        duration_stat->task_count += num_sc;
+
+        for (size_t u = 0; u < ue_num; u++) {
+            float* equal_ptr = (float*)(equal_tile + u * kEqualizeTileSCs);
+            int8_t* demod_ptr = demod_buffers_[frame_slot][symbol_idx_ul][u]
+                + (mod_order_bits * (base_sc_id + i));
+            switch (mod_order_bits) {
+            case (CommsLib::QPSK):
+                demod_qpsk_soft_avx2(equal_ptr, demod_ptr, num_sc);
+                break;
+            case (CommsLib::QAM16):
+                demod_16qam_soft_avx2(equal_ptr, demod_ptr, num_sc);
+                break;
+            case (CommsLib::QAM64):
+                demod_64qam_soft_avx2(equal_ptr, demod_ptr, num_sc);
+                break;
+            case (CommsLib::QAM256):
+                demod_256qam_soft_avx2(equal_ptr, demod_ptr, num_sc);
+                break;
+            }
+        }
+        duration_stat->task_duration[3] += worker_rdtsc() - start_tsc2;
+    }
+}
@@ -6,6 +6,7 @@
 #include "concurrentqueue.h"
 #include "config.hpp"
 #include "doer.hpp"
+#include "equalize.hpp"
 #include "gettime.h"
 #include "modulation.hpp"
 #include "phy_stats.hpp"
@@ -60,6 +61,12 @@ public:
     Event_data launch(size_t tag);
 
 private:
+    /// Equalize and demodulate subcarriers [base_sc_id, base_sc_id +
+    /// max_sc_ite) of a data symbol in tiles of kEqualizeTileSCs subcarriers,
+    /// writing soft bits directly to demod_buffers_
+    void equalize_demod_fused(size_t frame_id, size_t symbol_idx_ul,
+        size_t base_sc_id, size_t max_sc_ite, const complex_float* data_buf);
+
     Table<complex_float>& data_buffer_;
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_zf_matrices_;
     Table<complex_float>& ue_spec_pilot_buffer_;
@@ -78,6 +85,16 @@ private:
     cx_fmat ue_pilot_data;
     int ue_num_simd256;
 
+    // Equalization kernel for the fused path, selected at runtime based on
+    // the CPU's instruction set support and the antenna and UE counts
+    EqualizeTileFn equalize_tile_fn;
+
+    // Equalized data for one tile of subcarriers, UE-major
+    complex_float* equal_tile;
+
+    // Per-UE phase correction factors for the current symbol
+    complex_float* phase_correct_buffer;
+
 #if USE_MKL_JIT
     void* jitter;
     cgemm_jit_kernel_t mkl_jit_cgemm;
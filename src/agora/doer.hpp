@@ -7,6 +7,7 @@ class Config;
 #include "concurrentqueue.h"
 #include "logger.h"
 #include "stats.hpp"
+#include "task_tracer.hpp"
 
 class Doer {
 public:
@@ -20,7 +21,7 @@ public:
             resp_event.num_tags = req_event.num_tags;
 
             for (size_t i = 0; i < req_event.num_tags; i++) {
-                Event_data resp_i = launch(req_event.tags[i]);
+                Event_data resp_i = launch_traced(req_event.tags[i]);
                 rt_assert(resp_i.num_tags == 1, "Invalid num_tags in resp");
                 resp_event.tags[i] = resp_i.tags[0];
                 resp_event.event_type = resp_i.event_type;
@@ -42,6 +43,22 @@ public:
         return Event_data();
     }
 
+    /// Call launch(tag), and record the task in the trace ring if one is set
+    inline Event_data launch_traced(size_t tag)
+    {
+        if (trace_ring_ == nullptr)
+            return launch(tag);
+
+        const size_t start_tsc = rdtsc();
+        Event_data resp = launch(tag);
+        trace_ring_->record(resp.event_type, resp.tags[0], start_tsc, rdtsc());
+        return resp;
+    }
+
+    /// Record this Doer's tasks in [trace_ring], or stop recording if
+    /// [trace_ring] is nullptr
+    void set_trace_ring(TraceRing* trace_ring) { trace_ring_ = trace_ring; }
+
     /// The main event handling function that performs Doer-specific work.
     /// Doers that handle multiple event types use this signature.
     virtual Event_data launch(size_t tag, EventType event_type)
@@ -74,5 +91,6 @@ protected:
     moodycamel::ConcurrentQueue<Event_data>& task_queue_;
     moodycamel::ConcurrentQueue<Event_data>& complete_task_queue;
     moodycamel::ProducerToken* worker_producer_token;
+    TraceRing* trace_ring_ = nullptr; // Not owned
 };
 #endif /* DOER */
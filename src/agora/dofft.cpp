@@ -1,6 +1,8 @@
 #include "dofft.hpp"
+#include "bfp.h"
 #include "concurrent_queue_wrapper.hpp"
 #include "datatype_conversion.h"
+#include "fft_transpose.hpp"
 #include <malloc.h>
 
 using namespace arma;
@@ -29,109 +31,226 @@ DoFFT::DoFFT(Config* config, int tid, double freq_ghz,
     , calib_buffer_(calib_buffer)
     , phy_stats(in_phy_stats)
 {
+    fft_transpose_fn = select_fft_transpose_fn();
+    fp16_transpose_fn = select_fp16_transpose_fn();
     duration_stat_fft = stats_manager->get_duration_stat(DoerType::kFFT, tid);
     duration_stat_csi = stats_manager->get_duration_stat(DoerType::kCSI, tid);
-    DftiCreateDescriptor(
-        &mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, cfg->OFDM_CA_NUM);
-    DftiCommitDescriptor(mkl_handle);
+    for (size_t i = 0; i < cfg->fft_block_size; i++) {
+        DftiCreateDescriptor(
+            &mkl_handles[i], DFTI_SINGLE, DFTI_COMPLEX, 1, cfg->OFDM_CA_NUM);
+        DftiSetValue(mkl_handles[i], DFTI_NUMBER_OF_TRANSFORMS, i + 1);
+        DftiSetValue(mkl_handles[i], DFTI_INPUT_DISTANCE, cfg->OFDM_CA_NUM);
+        DftiSetValue(mkl_handles[i], DFTI_OUTPUT_DISTANCE, cfg->OFDM_CA_NUM);
+        DftiCommitDescriptor(mkl_handles[i]);
+    }
 
     // Aligned for SIMD
-    fft_inout = reinterpret_cast<complex_float*>(
-        memalign(64, cfg->OFDM_CA_NUM * sizeof(complex_float)));
+    fft_inout = reinterpret_cast<complex_float*>(memalign(64,
+        cfg->fft_block_size * cfg->OFDM_CA_NUM * sizeof(complex_float)));
 }
 
 DoFFT::~DoFFT()
 {
-    DftiFreeDescriptor(&mkl_handle);
+    for (size_t i = 0; i < cfg->fft_block_size; i++)
+        DftiFreeDescriptor(&mkl_handles[i]);
     free(fft_inout);
 }
 
-Event_data DoFFT::launch(size_t tag)
+bool DoFFT::try_launch()
+{
+    Event_data req_event;
+    if (!task_queue_.try_dequeue(req_event))
+        return false;
+
+    const size_t start_tsc = rdtsc();
+    Event_data resp_event = launch_batch(req_event.tags, req_event.num_tags);
+    if (trace_ring_ != nullptr) {
+        trace_ring_->record(
+            EventType::kFFT, resp_event.tags[0], start_tsc, rdtsc());
+    }
+    try_enqueue_fallback(
+        &complete_task_queue, worker_producer_token, resp_event);
+    return true;
+}
+
+Event_data DoFFT::launch(size_t tag) { return launch_batch(&tag, 1); }
+
+Packet* DoFFT::get_packet(size_t tag)
+{
+#ifdef USE_DPDK
+    // In zero-copy mode, read the packet directly from its mbuf
+    if (cfg->dpdk_zero_copy) {
+        return reinterpret_cast<Packet*>(DpdkTransport::udp_payload(
+            reinterpret_cast<rte_mbuf*>(fft_req_tag_t(tag).offset)));
+    }
+#endif
+    return cfg->get_rx_packet(
+        socket_buffer_[fft_req_tag_t(tag).tid], fft_req_tag_t(tag).offset);
+}
+
+void DoFFT::release_packet(size_t tag)
+{
+#ifdef USE_DPDK
+    if (cfg->dpdk_zero_copy) {
+        rte_pktmbuf_free(
+            reinterpret_cast<rte_mbuf*>(fft_req_tag_t(tag).offset));
+        return;
+    }
+#endif
+    socket_buffer_status_[fft_req_tag_t(tag).tid][fft_req_tag_t(tag).offset]
+        = 0;
+}
+
+Event_data DoFFT::launch_batch(const size_t* tags, size_t num_tags)
 {
-    size_t socket_thread_id = fft_req_tag_t(tag).tid;
-    size_t buf_offset = fft_req_tag_t(tag).offset;
+    rt_assert(num_tags >= 1 && num_tags <= cfg->fft_block_size,
+        "Invalid number of packets in FFT batch");
     size_t start_tsc = worker_rdtsc();
-    auto* pkt = (Packet*)(socket_buffer_[socket_thread_id]
-        + buf_offset * cfg->packet_length);
-    size_t frame_id = pkt->frame_id;
-    size_t frame_slot = frame_id % kFrameWnd;
-    size_t symbol_id = pkt->symbol_id;
-    size_t ant_id = pkt->ant_id;
-
-    if (cfg->fft_in_rru) {
-        simd_convert_float16_to_float32(reinterpret_cast<float*>(fft_inout),
-            reinterpret_cast<float*>(
-                &pkt->data[2 * cfg->ofdm_rx_zero_prefix_bs_]),
-            cfg->OFDM_CA_NUM * 2);
-    } else {
-        simd_convert_short_to_float(
-            &pkt->data[2 * cfg->ofdm_rx_zero_prefix_bs_],
-            reinterpret_cast<float*>(fft_inout), cfg->OFDM_CA_NUM * 2);
-
-        if (kDebugPrintInTask) {
-            printf("In doFFT thread %d: frame: %zu, symbol: %zu, ant: %zu\n",
-                tid, frame_id, symbol_id, ant_id);
-            if (kPrintFFTInput) {
-                printf("FFT input\n");
-                for (size_t i = 0; i < cfg->OFDM_CA_NUM; i++) {
-                    printf("%.4f+%.4fi ", fft_inout[i].re, fft_inout[i].im);
+    Packet* pkts[Event_data::kMaxTags];
+    DurationStat* duration_stats[Event_data::kMaxTags];
+    bool fp16_fused[Event_data::kMaxTags];
+    DurationStat dummy_duration_stat; // TODO: timing for calibration symbols
+
+    for (size_t i = 0; i < num_tags; i++) {
+        Packet* pkt = get_packet(tags[i]);
+        complex_float* fft_in = &fft_inout[i * cfg->OFDM_CA_NUM];
+        pkts[i] = pkt;
+
+        SymbolType sym_type
+            = cfg->get_symbol_type(pkt->frame_id, pkt->symbol_id);
+        if (sym_type == SymbolType::kUL) {
+            duration_stats[i] = duration_stat_fft;
+        } else if (sym_type == SymbolType::kPilot) {
+            duration_stats[i] = duration_stat_csi;
+        } else {
+            duration_stats[i] = &dummy_duration_stat; // For calibration
+        }
+
+        if (cfg->fft_in_rru) {
+            // Pilot and uplink symbols are converted while transposing,
+            // unless pilot SNR needs the whole converted symbol
+            fp16_fused[i] = sym_type == SymbolType::kUL
+                or (sym_type == SymbolType::kPilot and !kCollectPhyStats);
+            if (!fp16_fused[i]) {
+                simd_convert_float16_to_float32(
+                    reinterpret_cast<float*>(fft_in),
+                    reinterpret_cast<float*>(
+                        &pkt->data[2 * cfg->ofdm_rx_zero_prefix_bs_]),
+                    cfg->OFDM_CA_NUM * 2);
+            }
+        } else if (cfg->bfp_iq_width != 0) {
+            fp16_fused[i] = false;
+            rt_assert(pkt->comp_hdr == bfp_comp_hdr(cfg->bfp_iq_width),
+                "Packet compression does not match bfp_iq_width");
+            bfp_decompress(reinterpret_cast<const uint8_t*>(pkt->data),
+                cfg->bfp_iq_width, cfg->sampsPerSymbol,
+                cfg->ofdm_rx_zero_prefix_bs_, cfg->OFDM_CA_NUM,
+                reinterpret_cast<float*>(fft_in));
+        } else {
+            fp16_fused[i] = false;
+            simd_convert_short_to_float(
+                &pkt->data[2 * cfg->ofdm_rx_zero_prefix_bs_],
+                reinterpret_cast<float*>(fft_in), cfg->OFDM_CA_NUM * 2);
+
+            if (kDebugPrintInTask) {
+                printf("In doFFT thread %d: frame: %u, symbol: %u, ant: %u\n",
+                    tid, pkt->frame_id, pkt->symbol_id, pkt->ant_id);
+                if (kPrintFFTInput) {
+                    printf("FFT input\n");
+                    for (size_t j = 0; j < cfg->OFDM_CA_NUM; j++) {
+                        printf("%.4f+%.4fi ", fft_in[j].re, fft_in[j].im);
+                    }
+                    printf("\n");
                 }
-                printf("\n");
             }
         }
     }
 
-    DurationStat dummy_duration_stat; // TODO: timing for calibration symbols
-    DurationStat* duration_stat = nullptr;
-    SymbolType sym_type = cfg->get_symbol_type(frame_id, symbol_id);
-    if (sym_type == SymbolType::kUL) {
-        duration_stat = duration_stat_fft;
-    } else if (sym_type == SymbolType::kPilot) {
-        duration_stat = duration_stat_csi;
-    } else {
-        duration_stat = &dummy_duration_stat; // For calibration symbols
-    }
-
+    // Stage durations of the batch are split evenly among its packets
     size_t start_tsc1 = worker_rdtsc();
-    duration_stat->task_duration[1] += start_tsc1 - start_tsc;
+    for (size_t i = 0; i < num_tags; i++) {
+        duration_stats[i]->task_duration[1]
+            += (start_tsc1 - start_tsc) / num_tags;
+    }
 
     if (!cfg->fft_in_rru) {
-        DftiComputeForward(mkl_handle,
-            reinterpret_cast<float*>(fft_inout)); // Compute FFT in-place
+        // Compute all FFTs in-place
+        DftiComputeForward(
+            mkl_handles[num_tags - 1], reinterpret_cast<float*>(fft_inout));
     }
 
     size_t start_tsc2 = worker_rdtsc();
-    duration_stat->task_duration[2] += start_tsc2 - start_tsc1;
+    for (size_t i = 0; i < num_tags; i++) {
+        duration_stats[i]->task_duration[2]
+            += (start_tsc2 - start_tsc1) / num_tags;
+    }
 
-    if (sym_type == SymbolType::kPilot) {
-        if (kCollectPhyStats) {
-            phy_stats->update_pilot_snr(frame_id,
-                cfg->get_pilot_symbol_idx(frame_id, symbol_id), fft_inout);
+    Event_data resp_event(EventType::kFFT);
+    resp_event.num_tags = num_tags;
+    for (size_t i = 0; i < num_tags; i++) {
+        const Packet* pkt = pkts[i];
+        const size_t frame_id = pkt->frame_id;
+        const size_t frame_slot = frame_id % kFrameWnd;
+        const size_t symbol_id = pkt->symbol_id;
+        const size_t ant_id = pkt->ant_id;
+        complex_float* fft_out = &fft_inout[i * cfg->OFDM_CA_NUM];
+        SymbolType sym_type = cfg->get_symbol_type(frame_id, symbol_id);
+
+        if (sym_type == SymbolType::kPilot) {
+            if (kCollectPhyStats) {
+                phy_stats->update_pilot_snr(frame_id,
+                    cfg->get_pilot_symbol_idx(frame_id, symbol_id), fft_out);
+            }
+            const size_t ue_id = cfg->get_pilot_symbol_idx(frame_id, symbol_id);
+            if (fp16_fused[i]) {
+                fp16_partial_transpose(pkt, csi_buffers_[frame_slot][ue_id],
+                    ant_id, SymbolType::kPilot);
+            } else {
+                partial_transpose(fft_out, csi_buffers_[frame_slot][ue_id],
+                    ant_id, SymbolType::kPilot);
+            }
+        } else if (sym_type == SymbolType::kUL) {
+            complex_float* data_buf
+                = cfg->get_data_buf(data_buffer_, frame_id, symbol_id);
+            if (fp16_fused[i]) {
+                fp16_partial_transpose(pkt, data_buf, ant_id, SymbolType::kUL);
+            } else {
+                partial_transpose(fft_out, data_buf, ant_id, SymbolType::kUL);
+            }
+        } else if ((sym_type == SymbolType::kCalDL and ant_id == cfg->ref_ant)
+            or (sym_type == SymbolType::kCalUL and ant_id != cfg->ref_ant)) {
+            partial_transpose(fft_out, calib_buffer_[frame_slot], ant_id,
+                SymbolType::kCalUL);
+        } else {
+            rt_assert(false, "Unknown or unsupported symbol type");
         }
-        const size_t ue_id = cfg->get_pilot_symbol_idx(frame_id, symbol_id);
-        partial_transpose(
-            csi_buffers_[frame_slot][ue_id], ant_id, SymbolType::kPilot);
-    } else if (sym_type == SymbolType::kUL) {
-        partial_transpose(cfg->get_data_buf(data_buffer_, frame_id, symbol_id),
-            ant_id, SymbolType::kUL);
-    } else if ((sym_type == SymbolType::kCalDL and ant_id == cfg->ref_ant)
-        or (sym_type == SymbolType::kCalUL and ant_id != cfg->ref_ant)) {
-        partial_transpose(
-            calib_buffer_[frame_slot], ant_id, SymbolType::kCalUL);
-    } else {
-        rt_assert(false, "Unknown or unsupported symbol type");
+        resp_event.tags[i] = gen_tag_t::frm_sym(frame_id, symbol_id)._tag;
+        release_packet(tags[i]);
     }
 
-    duration_stat->task_duration[3] += worker_rdtsc() - start_tsc2;
-    socket_buffer_status_[socket_thread_id][buf_offset] = 0; // Reset sock buf
-    duration_stat->task_count++;
-    duration_stat->task_duration[0] += worker_rdtsc() - start_tsc;
-    return Event_data(EventType::kFFT,
-        gen_tag_t::frm_sym(pkt->frame_id, pkt->symbol_id)._tag);
+    size_t end_tsc = worker_rdtsc();
+    for (size_t i = 0; i < num_tags; i++) {
+        duration_stats[i]->task_duration[3]
+            += (end_tsc - start_tsc2) / num_tags;
+        duration_stats[i]->task_count++;
+        duration_stats[i]->task_duration[0] += (end_tsc - start_tsc) / num_tags;
+    }
+    return resp_event;
 }
 
-void DoFFT::partial_transpose(
-    complex_float* out_buf, size_t ant_id, SymbolType symbol_type) const
+void DoFFT::zero_partial_transpose(
+    const Config* cfg, complex_float* out_buf, size_t ant_id)
+{
+    const size_t num_blocks = cfg->OFDM_DATA_NUM / kTransposeBlockSize;
+    for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
+        memset(&out_buf[block_idx * (kTransposeBlockSize * cfg->BS_ANT_NUM)
+                   + (ant_id * kTransposeBlockSize)],
+            0, kTransposeBlockSize * sizeof(complex_float));
+    }
+}
+
+void DoFFT::partial_transpose(complex_float* fft_out, complex_float* out_buf,
+    size_t ant_id, SymbolType symbol_type) const
 {
     // We have OFDM_DATA_NUM % kTransposeBlockSize == 0
     const size_t num_blocks = cfg->OFDM_DATA_NUM / kTransposeBlockSize;
@@ -141,85 +260,24 @@ void DoFFT::partial_transpose(
         or symbol_type == SymbolType::kCalUL) {
         for (size_t i = 0; i < cfg->OFDM_DATA_NUM; i += cfg->BS_ANT_NUM)
             for (size_t j = 0; j < cfg->BS_ANT_NUM - 1; j++)
-                fft_inout[std::min(i + j, cfg->OFDM_DATA_NUM - 1)
+                fft_out[std::min(i + j, cfg->OFDM_DATA_NUM - 1)
                     + cfg->OFDM_DATA_START]
-                    = fft_inout[i + cfg->OFDM_DATA_START];
+                    = fft_out[i + cfg->OFDM_DATA_START];
     }
 
-    for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
-        const size_t block_base_offset
-            = block_idx * (kTransposeBlockSize * cfg->BS_ANT_NUM);
-        // We have kTransposeBlockSize % kSCsPerCacheline == 0
-        for (size_t sc_j = 0; sc_j < kTransposeBlockSize;
-             sc_j += kSCsPerCacheline) {
-            const size_t sc_idx = (block_idx * kTransposeBlockSize) + sc_j;
-            const complex_float* src
-                = &fft_inout[sc_idx + cfg->OFDM_DATA_START];
-
-            complex_float* dst = &out_buf[block_base_offset
-                + (ant_id * kTransposeBlockSize) + sc_j];
-
-            // With either of AVX-512 or AVX2, load one cacheline =
-            // 16 float values = 8 subcarriers = kSCsPerCacheline
-
-#if 0
-            // AVX-512. Disabled for now because we don't have a working
-            // complex multiply for __m512 type.
-            __m512 fft_result
-                = _mm512_load_ps(reinterpret_cast<const float*>(src));
-            if (symbol_type == SymbolType::kPilot) {
-                __m512 pilot_tx = _mm512_set_ps(cfg->pilots_sgn_[sc_idx + 7].im,
-                    cfg->pilots_sgn_[sc_idx + 7].re,
-                    cfg->pilots_sgn_[sc_idx + 6].im,
-                    cfg->pilots_sgn_[sc_idx + 6].re,
-                    cfg->pilots_sgn_[sc_idx + 5].im,
-                    cfg->pilots_sgn_[sc_idx + 5].re,
-                    cfg->pilots_sgn_[sc_idx + 4].im,
-                    cfg->pilots_sgn_[sc_idx + 4].re,
-                    cfg->pilots_sgn_[sc_idx + 3].im,
-                    cfg->pilots_sgn_[sc_idx + 3].re,
-                    cfg->pilots_sgn_[sc_idx + 2].im,
-                    cfg->pilots_sgn_[sc_idx + 2].re,
-                    cfg->pilots_sgn_[sc_idx + 1].im,
-                    cfg->pilots_sgn_[sc_idx + 1].re,
-                    cfg->pilots_sgn_[sc_idx].im, cfg->pilots_sgn_[sc_idx].re);
-                fft_result = _mm512_mul_ps(fft_result, pilot_tx);
-            }
-            _mm512_stream_ps(reinterpret_cast<float*>(dst), fft_result);
-#else
-            __m256 fft_result0
-                = _mm256_load_ps(reinterpret_cast<const float*>(src));
-            __m256 fft_result1
-                = _mm256_load_ps(reinterpret_cast<const float*>(src + 4));
-            if (symbol_type == SymbolType::kPilot) {
-                __m256 pilot_tx0 = _mm256_set_ps(
-                    cfg->pilots_sgn_[sc_idx + 3].im,
-                    cfg->pilots_sgn_[sc_idx + 3].re,
-                    cfg->pilots_sgn_[sc_idx + 2].im,
-                    cfg->pilots_sgn_[sc_idx + 2].re,
-                    cfg->pilots_sgn_[sc_idx + 1].im,
-                    cfg->pilots_sgn_[sc_idx + 1].re,
-                    cfg->pilots_sgn_[sc_idx].im, cfg->pilots_sgn_[sc_idx].re);
-                fft_result0 = CommsLib::__m256_complex_cf32_mult(
-                    fft_result0, pilot_tx0, true);
-
-                __m256 pilot_tx1
-                    = _mm256_set_ps(cfg->pilots_sgn_[sc_idx + 7].im,
-                        cfg->pilots_sgn_[sc_idx + 7].re,
-                        cfg->pilots_sgn_[sc_idx + 6].im,
-                        cfg->pilots_sgn_[sc_idx + 6].re,
-                        cfg->pilots_sgn_[sc_idx + 5].im,
-                        cfg->pilots_sgn_[sc_idx + 5].re,
-                        cfg->pilots_sgn_[sc_idx + 4].im,
-                        cfg->pilots_sgn_[sc_idx + 4].re);
-                fft_result1 = CommsLib::__m256_complex_cf32_mult(
-                    fft_result1, pilot_tx1, true);
-            }
-            _mm256_store_ps(reinterpret_cast<float*>(dst), fft_result0);
-            _mm256_store_ps(reinterpret_cast<float*>(dst + 4), fft_result1);
-#endif
-        }
-    }
+    fft_transpose_fn(&fft_out[cfg->OFDM_DATA_START], out_buf, ant_id,
+        cfg->BS_ANT_NUM, num_blocks,
+        symbol_type == SymbolType::kPilot ? cfg->pilots_sgn_ : nullptr);
+}
+
+void DoFFT::fp16_partial_transpose(const Packet* pkt, complex_float* out_buf,
+    size_t ant_id, SymbolType symbol_type) const
+{
+    const uint16_t* in = reinterpret_cast<const uint16_t*>(&pkt->data[2
+        * (cfg->ofdm_rx_zero_prefix_bs_ + cfg->OFDM_DATA_START)]);
+    fp16_transpose_fn(in, out_buf, ant_id, cfg->BS_ANT_NUM,
+        cfg->OFDM_DATA_NUM / kTransposeBlockSize,
+        symbol_type == SymbolType::kPilot ? cfg->pilots_sgn_ : nullptr);
 }
 
 DoIFFT::DoIFFT(Config* in_config, int in_tid, double freq_ghz,
@@ -244,9 +302,44 @@ DoIFFT::DoIFFT(Config* in_config, int in_tid, double freq_ghz,
     // Aligned for SIMD
     ifft_out = reinterpret_cast<float*>(
         memalign(64, 2 * cfg->OFDM_CA_NUM * sizeof(float)));
+
+    bfp_in = nullptr;
+    if (cfg->bfp_iq_width != 0) {
+        // The zero prefix and postfix stay zero
+        bfp_in = reinterpret_cast<float*>(
+            memalign(64, 2 * cfg->sampsPerSymbol * sizeof(float)));
+        memset(bfp_in, 0, 2 * cfg->sampsPerSymbol * sizeof(float));
+    }
 }
 
-DoIFFT::~DoIFFT() { DftiFreeDescriptor(&mkl_handle); }
+DoIFFT::~DoIFFT()
+{
+    DftiFreeDescriptor(&mkl_handle);
+    free(bfp_in);
+}
+
+void DoIFFT::write_tx_packet(
+    const Config* cfg, const float* ifft_out, float* bfp_in, Packet* pkt)
+{
+    if (cfg->bfp_iq_width != 0) {
+        // Add the cyclic prefix, and compress the symbol from bfp_in into
+        // the packet
+        float* sym_ptr = &bfp_in[2 * cfg->ofdm_tx_zero_prefix_];
+        memcpy(sym_ptr, ifft_out + 2 * (cfg->OFDM_CA_NUM - cfg->CP_LEN),
+            2 * cfg->CP_LEN * sizeof(float));
+        memcpy(sym_ptr + 2 * cfg->CP_LEN, ifft_out,
+            2 * cfg->OFDM_CA_NUM * sizeof(float));
+        bfp_compress_float(bfp_in, cfg->sampsPerSymbol,
+            32768.f / cfg->OFDM_CA_NUM, cfg->bfp_iq_width,
+            reinterpret_cast<uint8_t*>(pkt->data));
+    } else {
+        // IFFT scaled results by OFDM_CA_NUM, we scale down IFFT results
+        // during data type coversion
+        simd_convert_float_to_short(ifft_out,
+            &pkt->data[2 * cfg->ofdm_tx_zero_prefix_], cfg->OFDM_CA_NUM,
+            cfg->CP_LEN, cfg->OFDM_CA_NUM);
+    }
+}
 
 Event_data DoIFFT::launch(size_t tag)
 {
@@ -308,15 +401,11 @@ Event_data DoIFFT::launch(size_t tag)
     struct Packet* pkt
         = (struct Packet*)&dl_socket_buffer_[offset * cfg->packet_length];
     short* socket_ptr = &pkt->data[2 * cfg->ofdm_tx_zero_prefix_];
-
-    // IFFT scaled results by OFDM_CA_NUM, we scale down IFFT results
-    // during data type coversion
-    simd_convert_float_to_short(ifft_out_ptr, socket_ptr, cfg->OFDM_CA_NUM,
-        cfg->CP_LEN, cfg->OFDM_CA_NUM);
+    write_tx_packet(cfg, ifft_out_ptr, bfp_in, pkt);
 
     duration_stat->task_duration[3] += worker_rdtsc() - start_tsc2;
 
-    if (kPrintSocketOutput) {
+    if (kPrintSocketOutput and cfg->bfp_iq_width == 0) {
         printf("IFFT data in socket\n");
         for (size_t i = 0; i < cfg->OFDM_CA_NUM; i++) {
             printf("%hi+%hij ", socket_ptr[i * 2], socket_ptr[i * 2 + 1]);
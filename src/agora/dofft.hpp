@@ -6,6 +6,7 @@
 #include "concurrentqueue.h"
 #include "config.hpp"
 #include "doer.hpp"
+#include "fft_transpose.hpp"
 #include "gettime.h"
 #include "mkl_dfti.h"
 #include "phy_stats.hpp"
@@ -16,6 +17,10 @@
 #include <string.h>
 #include <vector>
 
+#ifdef USE_DPDK
+#include "dpdk_transport.hpp"
+#endif
+
 class DoFFT : public Doer {
 public:
     DoFFT(Config* config, int tid, double freq_ghz,
@@ -64,8 +69,19 @@ public:
     Event_data launch(size_t tag);
 
     /**
-     * Fill-in the partial transpose of the computed FFT for this antenna into
-     * out_buf.
+     * Do FFT tasks for the [num_tags] packets in [tags], which may belong to
+     * different symbols. All packets are converted first, then transformed
+     * with one batched MKL DFTI call, and then transposed. The response has
+     * one tag per packet.
+     */
+    Event_data launch_batch(const size_t* tags, size_t num_tags);
+
+    /// Dequeue one FFT event and process all of its packets as a batch
+    bool try_launch();
+
+    /**
+     * Fill-in the partial transpose of the computed FFT [fft_out] for this
+     * antenna into out_buf.
      *
      * The fully-transposed matrix after FFT is a subcarriers x antennas matrix
      * that should look like so (using the notation subcarrier/antenna, and
@@ -92,18 +108,44 @@ public:
      * Each partially-transposed block is identical to the corresponding block
      * of the fully-transposed matrix, but laid out in memory in column-major
      * order.
+     *
+     * For pilot symbols, each subcarrier is multiplied with the conjugate of
+     * its pilot sign while transposing.
      */
-    void partial_transpose(
-        complex_float* out_buf, size_t ant_id, SymbolType symbol_type) const;
+    void partial_transpose(complex_float* fft_out, complex_float* out_buf,
+        size_t ant_id, SymbolType symbol_type) const;
+
+    /// Like partial_transpose(), but read the frequency-domain fp16 samples
+    /// of a pilot or uplink symbol directly from packet [pkt]. Used when FFT
+    /// is done in the RRU.
+    void fp16_partial_transpose(const Packet* pkt, complex_float* out_buf,
+        size_t ant_id, SymbolType symbol_type) const;
+
+    /// Zero the entries of antenna [ant_id] in the partially-transposed
+    /// buffer [out_buf], in place of a packet that never arrived
+    static void zero_partial_transpose(
+        const Config* cfg, complex_float* out_buf, size_t ant_id);
 
 private:
+    /// Return the packet of FFT request tag [tag]
+    Packet* get_packet(size_t tag);
+
+    /// Free the socket buffer slot or mbuf of FFT request tag [tag]
+    void release_packet(size_t tag);
+
     Table<char>& socket_buffer_;
     Table<int>& socket_buffer_status_;
     Table<complex_float>& data_buffer_;
     PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers_;
     Table<complex_float>& calib_buffer_;
-    DFTI_DESCRIPTOR_HANDLE mkl_handle;
-    complex_float* fft_inout; // Buffer for both FFT input and output
+
+    // mkl_handles[i] computes (i + 1) FFTs stored back-to-back, in place
+    DFTI_DESCRIPTOR_HANDLE mkl_handles[Event_data::kMaxTags];
+
+    // Buffer for both FFT input and output of fft_block_size packets
+    complex_float* fft_inout;
+    FFTTransposeFn fft_transpose_fn;
+    FP16TransposeFn fp16_transpose_fn;
     DurationStat* duration_stat_fft;
     DurationStat* duration_stat_csi;
     PhyStats* phy_stats;
@@ -144,12 +186,25 @@ public:
      */
     Event_data launch(size_t tag);
 
+    /**
+     * Convert one antenna's IFFT output [ifft_out] to the time-domain samples
+     * of the TX packet [pkt], adding the cyclic prefix. [bfp_in] is a scratch
+     * buffer of sampsPerSymbol zeroed complex floats if fronthaul packets are
+     * BFP-compressed, and is not used otherwise.
+     */
+    static void write_tx_packet(
+        const Config* cfg, const float* ifft_out, float* bfp_in, Packet* pkt);
+
 private:
     Table<complex_float>& dl_ifft_buffer_;
     char* dl_socket_buffer_;
     DurationStat* duration_stat;
     DFTI_DESCRIPTOR_HANDLE mkl_handle;
     float* ifft_out; // Buffer IFFT output
+
+    // Samples of a symbol, with cyclic prefix, before BFP compression. This
+    // is nullptr if fronthaul packets are uncompressed.
+    float* bfp_in;
 };
 
 #endif
@@ -9,23 +9,46 @@ DoPrecode::DoPrecode(Config* in_config, int in_tid, double freq_ghz,
     moodycamel::ConcurrentQueue<Event_data>& complete_task_queue,
     moodycamel::ProducerToken* worker_producer_token,
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices,
-    Table<complex_float>& in_dl_ifft_buffer,
+    Table<complex_float>& in_dl_ifft_buffer, char* in_dl_socket_buffer,
     Table<int8_t>& dl_encoded_or_raw_data /* Encoded if LDPC is enabled */,
-    Stats* in_stats_manager)
+    Table<complex_float>& dl_modulated_buffer, Stats* in_stats_manager)
     : Doer(in_config, in_tid, freq_ghz, in_task_queue, complete_task_queue,
           worker_producer_token)
     , dl_zf_matrices_(dl_zf_matrices)
     , dl_ifft_buffer_(in_dl_ifft_buffer)
     , dl_raw_data(dl_encoded_or_raw_data)
+    , dl_modulated_buffer_(dl_modulated_buffer)
+    , dl_socket_buffer_(in_dl_socket_buffer)
+    , fused_ifft_in(nullptr)
+    , fused_ifft_out(nullptr)
+    , bfp_in(nullptr)
 {
     duration_stat
         = in_stats_manager->get_duration_stat(DoerType::kPrecode, in_tid);
 
-    alloc_buffer_1d(
-        &modulated_buffer_temp, kSCsPerCacheline * cfg->UE_NUM, 64, 0);
+    alloc_buffer_1d(&modulated_buffer_temp,
+        std::max(kSCsPerCacheline, cfg->demul_block_size) * cfg->UE_NUM, 64,
+        0);
     alloc_buffer_1d(
         &precoded_buffer_temp, cfg->demul_block_size * cfg->BS_ANT_NUM, 64, 0);
     alloc_buffer_1d(&pilot_sc_flags, cfg->demul_block_size, 64, 1);
+    for (size_t user_id = 0; user_id < cfg->UE_NUM; user_id++)
+        ue_pilots.push_back(cfg->ue_specific_pilot[user_id]);
+    precode_sc_fn = kUseFixedSizeKernels
+        ? select_precode_sc_fn(cfg->BS_ANT_NUM, cfg->UE_NUM)
+        : nullptr;
+
+    if (cfg->fused_precode_ifft) {
+        alloc_buffer_1d(&fused_ifft_in,
+            cfg->fused_precode_ant_block_size * cfg->OFDM_CA_NUM, 64, 1);
+        alloc_buffer_1d(&fused_ifft_out, 2 * cfg->OFDM_CA_NUM, 64, 0);
+        if (cfg->bfp_iq_width != 0)
+            alloc_buffer_1d(&bfp_in, 2 * cfg->sampsPerSymbol, 64, 1);
+        DftiCreateDescriptor(
+            &fused_mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, cfg->OFDM_CA_NUM);
+        DftiSetValue(fused_mkl_handle, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
+        DftiCommitDescriptor(fused_mkl_handle);
+    }
 
 #if USE_MKL_JIT
     MKL_Complex8 alpha = { 1, 0 };
@@ -50,25 +73,21 @@ DoPrecode::~DoPrecode()
 {
     free_buffer_1d(&modulated_buffer_temp);
     free_buffer_1d(&precoded_buffer_temp);
+    free_buffer_1d(&fused_ifft_in);
+    free_buffer_1d(&fused_ifft_out);
+    free_buffer_1d(&bfp_in);
+    if (cfg->fused_precode_ifft)
+        DftiFreeDescriptor(&fused_mkl_handle);
 }
 
-Event_data DoPrecode::launch(size_t tag)
+void DoPrecode::mark_pilot_scs(size_t symbol_idx_dl, size_t base_sc_id)
 {
-    size_t start_tsc = worker_rdtsc();
-    const size_t frame_id = gen_tag_t(tag).frame_id;
-    const size_t base_sc_id = gen_tag_t(tag).sc_id;
-    const size_t symbol_id = gen_tag_t(tag).symbol_id;
-    const size_t symbol_idx_dl = cfg->get_dl_symbol_idx(frame_id, symbol_id);
-    const size_t total_data_symbol_idx
-        = cfg->get_total_data_symbol_idx_dl(frame_id, symbol_idx_dl);
-    const size_t frame_slot = frame_id % kFrameWnd;
-
-    // Mark pilot subcarriers in this block
     // In downlink pilot symbols, all subcarriers are used as pilots
     // In downlink data symbols, pilot subcarriers are every
     // OFDM_PILOT_SPACING subcarriers
     if (symbol_idx_dl < cfg->DL_PILOT_SYMS) {
-        memset(pilot_sc_flags, 1, cfg->demul_block_size * sizeof(size_t));
+        for (size_t i = 0; i < cfg->demul_block_size; i++)
+            pilot_sc_flags[i] = 1;
     } else {
         // Find subcarriers used as pilot in this block
         memset(pilot_sc_flags, 0, cfg->demul_block_size * sizeof(size_t));
@@ -79,6 +98,24 @@ Event_data DoPrecode::launch(size_t tag)
              i += cfg->OFDM_PILOT_SPACING)
             pilot_sc_flags[i] = 1;
     }
+}
+
+Event_data DoPrecode::launch(size_t tag)
+{
+    if (cfg->fused_precode_ifft)
+        return launch_fused(tag);
+
+    size_t start_tsc = worker_rdtsc();
+    const size_t frame_id = gen_tag_t(tag).frame_id;
+    const size_t base_sc_id = gen_tag_t(tag).sc_id;
+    const size_t symbol_id = gen_tag_t(tag).symbol_id;
+    const size_t symbol_idx_dl = cfg->get_dl_symbol_idx(frame_id, symbol_id);
+    const size_t total_data_symbol_idx
+        = cfg->get_total_data_symbol_idx_dl(frame_id, symbol_idx_dl);
+    const size_t frame_slot = frame_id % kFrameWnd;
+    const complex_float* mod_table = cfg->mod_cfg(frame_id).mod_table[0];
+
+    mark_pilot_scs(symbol_idx_dl, base_sc_id);
 
     if (kDebugPrintInTask) {
         printf(
@@ -95,7 +132,8 @@ Event_data DoPrecode::launch(size_t tag)
             for (size_t user_id = 0; user_id < cfg->UE_NUM; user_id++) {
                 for (size_t j = 0; j < kSCsPerCacheline; j++) {
                     load_input_data(symbol_idx_dl, total_data_symbol_idx,
-                        user_id, base_sc_id + i + j, j, pilot_sc_flags[i + j]);
+                        user_id, base_sc_id + i + j, j, pilot_sc_flags[i + j],
+                        mod_table);
                 }
             }
 
@@ -108,19 +146,16 @@ Event_data DoPrecode::launch(size_t tag)
             duration_stat->task_duration[2] += worker_rdtsc() - start_tsc2;
         }
     } else {
-        for (size_t i = 0; i < max_sc_ite; i++) {
-            size_t start_tsc1 = worker_rdtsc();
-            int cur_sc_id = base_sc_id + i;
-            for (size_t user_id = 0; user_id < cfg->UE_NUM; user_id++)
-                load_input_data(symbol_idx_dl, total_data_symbol_idx, user_id,
-                    cur_sc_id, 0, pilot_sc_flags[i]);
-            size_t start_tsc2 = worker_rdtsc();
-            duration_stat->task_duration[1] += start_tsc2 - start_tsc1;
+        size_t start_tsc1 = worker_rdtsc();
+        modulate_block(
+            total_data_symbol_idx, base_sc_id, max_sc_ite, mod_table);
+        size_t start_tsc2 = worker_rdtsc();
+        duration_stat->task_duration[1] += start_tsc2 - start_tsc1;
 
-            precoding_per_sc(frame_slot, cur_sc_id, i);
-            duration_stat->task_count++;
-            duration_stat->task_duration[2] += worker_rdtsc() - start_tsc2;
-        }
+        for (size_t i = 0; i < max_sc_ite; i++)
+            precoding_per_sc(frame_slot, base_sc_id + i, i);
+        duration_stat->task_count += max_sc_ite;
+        duration_stat->task_duration[2] += worker_rdtsc() - start_tsc2;
     }
 
     size_t start_tsc3 = worker_rdtsc();
@@ -152,9 +187,67 @@ Event_data DoPrecode::launch(size_t tag)
     return Event_data(EventType::kPrecode, tag);
 }
 
+Event_data DoPrecode::launch_fused(size_t tag)
+{
+    size_t start_tsc = worker_rdtsc();
+    const size_t frame_id = gen_tag_t(tag).frame_id;
+    const size_t base_ant_id = gen_tag_t(tag).ant_id;
+    const size_t symbol_id = gen_tag_t(tag).symbol_id;
+    const size_t symbol_idx_dl = cfg->get_dl_symbol_idx(frame_id, symbol_id);
+    const size_t total_data_symbol_idx
+        = cfg->get_total_data_symbol_idx_dl(frame_id, symbol_idx_dl);
+    const size_t frame_slot = frame_id % kFrameWnd;
+    const size_t num_ants = std::min(
+        cfg->fused_precode_ant_block_size, cfg->BS_ANT_NUM - base_ant_id);
+    const complex_float* modulated_ptr
+        = dl_modulated_buffer_[total_data_symbol_idx];
+
+    if (kDebugPrintInTask) {
+        printf("In doPrecode thread %d: fused frame %zu, symbol %zu, "
+               "antenna %zu\n",
+            tid, frame_id, symbol_id, base_ant_id);
+    }
+
+    // Precode all data subcarriers for this block's antennas. Each
+    // antenna's precoded samples go to its own row of fused_ifft_in, so no
+    // transpose is needed before IFFT.
+    for (size_t sc_id = 0; sc_id < cfg->OFDM_DATA_NUM; sc_id++) {
+        precode_sc_ants_avx2(
+            dl_zf_matrices_[frame_slot][cfg->get_zf_sc_id(sc_id)],
+            modulated_ptr + sc_id * cfg->UE_NUM, cfg->BS_ANT_NUM, cfg->UE_NUM,
+            base_ant_id, num_ants, precoded_buffer_temp);
+        complex_float* ifft_in_sc
+            = fused_ifft_in + cfg->OFDM_DATA_START + sc_id;
+        for (size_t i = 0; i < num_ants; i++)
+            ifft_in_sc[i * cfg->OFDM_CA_NUM] = precoded_buffer_temp[i];
+    }
+    size_t start_tsc1 = worker_rdtsc();
+    duration_stat->task_duration[1] += start_tsc1 - start_tsc;
+
+    for (size_t i = 0; i < num_ants; i++) {
+        DftiComputeBackward(fused_mkl_handle,
+            reinterpret_cast<float*>(&fused_ifft_in[i * cfg->OFDM_CA_NUM]),
+            fused_ifft_out);
+        size_t start_tsc2 = worker_rdtsc();
+        duration_stat->task_duration[2] += start_tsc2 - start_tsc1;
+
+        const size_t offset
+            = total_data_symbol_idx * cfg->BS_ANT_NUM + base_ant_id + i;
+        auto* pkt = reinterpret_cast<Packet*>(
+            &dl_socket_buffer_[offset * cfg->packet_length]);
+        DoIFFT::write_tx_packet(cfg, fused_ifft_out, bfp_in, pkt);
+        start_tsc1 = worker_rdtsc();
+        duration_stat->task_duration[3] += start_tsc1 - start_tsc2;
+    }
+
+    duration_stat->task_count++;
+    duration_stat->task_duration[0] += worker_rdtsc() - start_tsc;
+    return Event_data(EventType::kPrecode, tag);
+}
+
 void DoPrecode::load_input_data(size_t symbol_idx_dl,
     size_t total_data_symbol_idx, size_t user_id, size_t sc_id,
-    size_t sc_id_in_block, size_t is_pilot_sc)
+    size_t sc_id_in_block, size_t is_pilot_sc, const complex_float* mod_table)
 {
     complex_float* data_ptr
         = modulated_buffer_temp + sc_id_in_block * cfg->UE_NUM;
@@ -163,22 +256,36 @@ void DoPrecode::load_input_data(size_t symbol_idx_dl,
     } else {
         int8_t* raw_data_ptr = &dl_raw_data[total_data_symbol_idx][sc_id
             + roundup<64>(cfg->OFDM_DATA_NUM) * user_id];
-        data_ptr[user_id]
-            = mod_single_uint8((uint8_t)(*raw_data_ptr), cfg->mod_table);
+        data_ptr[user_id] = mod_table[(uint8_t)(*raw_data_ptr)];
     }
 }
 
+void DoPrecode::modulate_block(size_t total_data_symbol_idx,
+    size_t base_sc_id, size_t num_scs, const complex_float* mod_table)
+{
+    modulate_block_avx2(dl_raw_data[total_data_symbol_idx],
+        roundup<64>(cfg->OFDM_DATA_NUM), ue_pilots.data(), base_sc_id,
+        pilot_sc_flags, mod_table, cfg->UE_NUM, num_scs,
+        modulated_buffer_temp);
+}
+
 void DoPrecode::precoding_per_sc(
     size_t frame_slot, size_t sc_id, size_t sc_id_in_block)
 {
     auto* precoder_ptr = reinterpret_cast<cx_float*>(
         dl_zf_matrices_[frame_slot][cfg->get_zf_sc_id(sc_id)]);
     auto* data_ptr = reinterpret_cast<cx_float*>(modulated_buffer_temp
-        + (kUseSpatialLocality
-                  ? (sc_id_in_block % kSCsPerCacheline * cfg->UE_NUM)
-                  : 0));
+        + (kUseSpatialLocality ? (sc_id_in_block % kSCsPerCacheline)
+                               : sc_id_in_block)
+            * cfg->UE_NUM);
     auto* precoded_ptr = reinterpret_cast<cx_float*>(
         precoded_buffer_temp + sc_id_in_block * cfg->BS_ANT_NUM);
+    if (precode_sc_fn != nullptr) {
+        precode_sc_fn(reinterpret_cast<complex_float*>(precoder_ptr),
+            reinterpret_cast<complex_float*>(data_ptr),
+            reinterpret_cast<complex_float*>(precoded_ptr));
+        return;
+    }
 #if USE_MKL_JIT
     my_cgemm(jitter, (MKL_Complex8*)precoder_ptr, (MKL_Complex8*)data_ptr,
         (MKL_Complex8*)precoded_ptr);
@@ -6,9 +6,11 @@
 #include "concurrentqueue.h"
 #include "config.hpp"
 #include "doer.hpp"
+#include "dofft.hpp"
 #include "gettime.h"
 #include "memory_manage.h"
 #include "modulation.hpp"
+#include "precode.hpp"
 #include "stats.hpp"
 #include <armadillo>
 #include <iostream>
@@ -23,8 +25,9 @@ public:
         moodycamel::ConcurrentQueue<Event_data>& complete_task_queue,
         moodycamel::ProducerToken* worker_producer_token,
         PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices_,
-        Table<complex_float>& in_dl_ifft_buffer,
-        Table<int8_t>& dl_encoded_buffer, Stats* in_stats_manager);
+        Table<complex_float>& in_dl_ifft_buffer, char* in_dl_socket_buffer,
+        Table<int8_t>& dl_encoded_buffer,
+        Table<complex_float>& dl_modulated_buffer, Stats* in_stats_manager);
     ~DoPrecode();
 
     /**
@@ -55,22 +58,60 @@ public:
      */
     Event_data launch(size_t tag);
 
-    // Load input data for a single UE and a single subcarrier
+    /**
+     * Fused downlink task for one symbol and a block of
+     * fused_precode_ant_block_size antennas starting at the tag's ant_id.
+     * Precode all data subcarriers for the block's antennas, then IFFT each
+     * antenna and write its TX packet to dl_socket_buffer_, while the
+     * precoded samples are still in cache. The symbol's modulated data is
+     * read from dl_modulated_buffer_, where encode tasks wrote it once for
+     * all antenna blocks.
+     */
+    Event_data launch_fused(size_t tag);
+
+    // Load input data for a single UE and a single subcarrier, modulated
+    // with [mod_table]
     void load_input_data(size_t symbol_idx_dl, size_t total_data_symbol_idx,
         size_t user_id, size_t sc_id, size_t sc_id_in_block,
-        size_t is_pilot_sc);
+        size_t is_pilot_sc, const complex_float* mod_table);
     void precoding_per_sc(
         size_t frame_slot, size_t sc_id, size_t sc_id_in_block);
 
+    /// Modulate subcarriers [base_sc_id, base_sc_id + num_scs) of all UEs
+    /// with [mod_table] into modulated_buffer_temp, in the layout that
+    /// precoding_per_sc() reads. pilot_sc_flags must be set for the block.
+    void modulate_block(size_t total_data_symbol_idx, size_t base_sc_id,
+        size_t num_scs, const complex_float* mod_table);
+
 private:
+    /// Set pilot_sc_flags for the block of demul_block_size subcarriers
+    /// starting at [base_sc_id]
+    void mark_pilot_scs(size_t symbol_idx_dl, size_t base_sc_id);
+
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices_;
     Table<complex_float>& dl_ifft_buffer_;
     Table<int8_t>& dl_raw_data;
+    Table<complex_float>& dl_modulated_buffer_;
     Table<float> qam_table;
     DurationStat* duration_stat;
     complex_float* modulated_buffer_temp;
     complex_float* precoded_buffer_temp;
     size_t* pilot_sc_flags;
+    std::vector<const complex_float*> ue_pilots; // Pilots of each UE
+
+    // Buffers of the fused precode and IFFT stage, allocated only if
+    // fused_precode_ifft is set. fused_ifft_in holds the IFFT input of each
+    // antenna of a block, with zeroed guard subcarriers. bfp_in is like
+    // DoIFFT's.
+    char* dl_socket_buffer_;
+    complex_float* fused_ifft_in;
+    float* fused_ifft_out;
+    float* bfp_in;
+    DFTI_DESCRIPTOR_HANDLE fused_mkl_handle;
+
+    // Precoding kernel specialized for the antenna and UE counts, or nullptr
+    // to use the generic path
+    PrecodeScFn precode_sc_fn;
 #if USE_MKL_JIT
     void* jitter;
     cgemm_jit_kernel_t my_cgemm;
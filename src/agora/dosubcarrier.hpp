@@ -118,7 +118,7 @@ public:
 
         do_precode_ = new DoPrecode(this->cfg, tid, freq_ghz, dummy_conq_,
             dummy_conq_, nullptr /* ptok */, dl_zf_matrices_, dl_ifft_buffer_,
-            dl_encoded_buffer_, stats);
+            nullptr /* dl_socket_buffer */, dl_encoded_buffer_, stats);
 
         // Init internal states
         demul_cur_sym_ = cfg->pilot_symbol_num_perframe;
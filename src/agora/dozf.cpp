@@ -1,12 +1,17 @@
 #include "dozf.hpp"
 #include "concurrent_queue_wrapper.hpp"
 #include "doer.hpp"
+#include <limits>
 #include <malloc.h>
 
 static constexpr bool kUseSIMDGather = true;
 // Calculate the zeroforcing receiver using the formula W_zf = inv(H' * H) * H'.
 // This is faster but less accurate than using an SVD-based pseudoinverse.
 static constexpr size_t kUseInverseForZF = true;
+// Compute zeroforcing matrices for up to BatchedZF::kBatchSize subcarriers of
+// a ZF task together. This has no effect if zf_block_size is 1, if
+// kUseInverseForZF is false, or in ZF tracking mode.
+static constexpr bool kUseBatchedZF = true;
 
 DoZF::DoZF(Config* config, int tid, double freq_ghz,
     moodycamel::ConcurrentQueue<Event_data>& task_queue,
@@ -16,34 +21,50 @@ DoZF::DoZF(Config* config, int tid, double freq_ghz,
     Table<complex_float>& calib_buffer,
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_zf_matrices,
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices,
-    Stats* stats_manager)
+    Stats* stats_manager, ZFTracker* zf_tracker)
     : Doer(config, tid, freq_ghz, task_queue, complete_task_queue,
           worker_producer_token)
     , csi_buffers_(csi_buffers)
     , calib_buffer_(calib_buffer)
     , ul_zf_matrices_(ul_zf_matrices)
     , dl_zf_matrices_(dl_zf_matrices)
+    , zf_tracker_(zf_tracker)
 {
     duration_stat = stats_manager->get_duration_stat(DoerType::kZF, tid);
+    zf_tracking_stat_ = stats_manager->get_zf_tracking_stat(tid);
     pred_csi_buffer = reinterpret_cast<complex_float*>(
         memalign(64, kMaxAntennas * kMaxUEs * sizeof(complex_float)));
-    csi_gather_buffer = reinterpret_cast<complex_float*>(
-        memalign(64, kMaxAntennas * kMaxUEs * sizeof(complex_float)));
+    zf_gram_buffer = reinterpret_cast<complex_float*>(
+        memalign(64, kMaxUEs * kMaxUEs * sizeof(complex_float)));
+
+    batched_zf_ = nullptr;
+    size_t num_gather_lanes = 1;
+    if (kUseBatchedZF and kUseInverseForZF and !cfg->freq_orthogonal_pilot
+        and cfg->zf_block_size > 1 and zf_tracker_ == nullptr) {
+        batched_zf_ = new BatchedZF(cfg->BS_ANT_NUM, cfg->UE_NUM);
+        num_gather_lanes = BatchedZF::kBatchSize;
+    }
+    csi_gather_buffer = reinterpret_cast<complex_float*>(memalign(64,
+        num_gather_lanes * kMaxAntennas * kMaxUEs * sizeof(complex_float)));
     calib_gather_buffer = reinterpret_cast<complex_float*>(
-        memalign(64, kMaxAntennas * sizeof(complex_float)));
+        memalign(64, num_gather_lanes * kMaxAntennas * sizeof(complex_float)));
 }
 
 DoZF::~DoZF()
 {
     free(pred_csi_buffer);
+    free(zf_gram_buffer);
     free(csi_gather_buffer);
     free(calib_gather_buffer);
+    delete batched_zf_;
 }
 
 Event_data DoZF::launch(size_t tag)
 {
     if (cfg->freq_orthogonal_pilot)
         ZF_freq_orthogonal(tag);
+    else if (batched_zf_ != nullptr)
+        ZF_time_orthogonal_batched(tag);
     else
         ZF_time_orthogonal(tag);
 
@@ -54,40 +75,153 @@ void DoZF::compute_precoder(const arma::cx_fmat& mat_csi,
     complex_float* calib_ptr, complex_float* _mat_ul_zf,
     complex_float* _mat_dl_zf)
 {
-    arma::cx_fmat mat_ul_zf(reinterpret_cast<arma::cx_float*>(_mat_ul_zf),
-        cfg->UE_NUM, cfg->BS_ANT_NUM, false);
+    const size_t bs_ant_num = cfg->BS_ANT_NUM;
+    const size_t ue_num = cfg->UE_NUM;
+    bool inverse_ok = false;
+
     if (kUseInverseForZF) {
-        try {
-            mat_ul_zf = arma::inv_sympd(mat_csi.t() * mat_csi) * mat_csi.t();
-        } catch (std::runtime_error) {
+        // Compute mat_ul_zf = inv(H' * H) * H' in the preallocated Gram matrix
+        // buffer and output buffer, without Armadillo temporaries:
+        //   1. G = H' * H (lower triangle only)
+        //   2. Cholesky factorization G = L * L'
+        //   3. mat_ul_zf = H', then solve G * mat_ul_zf = H' in place
+        auto* mkl_gram = reinterpret_cast<MKL_Complex8*>(zf_gram_buffer);
+        cblas_cherk(CblasColMajor, CblasLower, CblasConjTrans, ue_num,
+            bs_ant_num, 1.0, mat_csi.memptr(), bs_ant_num, 0.0, mkl_gram,
+            ue_num);
+        if (LAPACKE_cpotrf_work(LAPACK_COL_MAJOR, 'L', ue_num, mkl_gram, ue_num)
+            == 0) {
+            const auto* csi = reinterpret_cast<const complex_float*>(
+                mat_csi.memptr());
+            for (size_t i = 0; i < bs_ant_num; i++) {
+                for (size_t j = 0; j < ue_num; j++) {
+                    const complex_float& h = csi[j * bs_ant_num + i];
+                    _mat_ul_zf[i * ue_num + j] = { h.re, -h.im };
+                }
+            }
+            inverse_ok = LAPACKE_cpotrs_work(LAPACK_COL_MAJOR, 'L', ue_num,
+                             bs_ant_num, mkl_gram, ue_num,
+                             reinterpret_cast<MKL_Complex8*>(_mat_ul_zf),
+                             ue_num)
+                == 0;
+        }
+        if (!inverse_ok) {
             MLPD_WARN(
                 "Failed to invert channel matrix, falling back to pinv()\n");
-            arma::pinv(mat_ul_zf, mat_csi, 1e-2, "dc");
         }
-    } else {
+    }
+
+    if (!inverse_ok) {
+        // Slow path, which allocates memory
+        arma::cx_fmat mat_ul_zf(reinterpret_cast<arma::cx_float*>(_mat_ul_zf),
+            ue_num, bs_ant_num, false);
         arma::pinv(mat_ul_zf, mat_csi, 1e-2, "dc");
     }
 
-    if (cfg->dl_data_symbol_num_perframe > 0) {
-        arma::cx_fmat mat_dl_zf(reinterpret_cast<arma::cx_float*>(_mat_dl_zf),
-            cfg->BS_ANT_NUM, cfg->UE_NUM, false);
-        if (cfg->recipCalEn) {
-            arma::cx_fvec vec_calib(
-                reinterpret_cast<arma::cx_float*>(calib_ptr), cfg->BS_ANT_NUM,
-                false);
-
-            vec_calib = vec_calib / vec_calib(cfg->ref_ant);
-            arma::cx_fmat mat_calib(cfg->BS_ANT_NUM, cfg->BS_ANT_NUM);
-            mat_calib = arma::diagmat(vec_calib);
-            mat_dl_zf = arma::inv(mat_calib) * mat_ul_zf.st();
-        } else
-            mat_dl_zf = mat_ul_zf.st();
-
-        // We should be scaling the beamforming matrix, so the IFFT
-        // output can be scaled with OFDM_CA_NUM across all antennas.
-        // See Argos paper (Mobicom 2012) Sec. 3.4 for details.
-        mat_dl_zf /= abs(mat_dl_zf).max();
+    if (cfg->dl_data_symbol_num_perframe > 0)
+        compute_dl_precoder(calib_ptr, _mat_ul_zf, _mat_dl_zf);
+}
+
+void DoZF::compute_dl_precoder(complex_float* calib_ptr,
+    complex_float* _mat_ul_zf, complex_float* _mat_dl_zf)
+{
+    const size_t bs_ant_num = cfg->BS_ANT_NUM;
+    const size_t ue_num = cfg->UE_NUM;
+    auto* ul_zf = reinterpret_cast<std::complex<float>*>(_mat_ul_zf);
+    auto* dl_zf = reinterpret_cast<std::complex<float>*>(_mat_dl_zf);
+    auto* calib = reinterpret_cast<std::complex<float>*>(calib_ptr);
+
+    // mat_dl_zf = inv(diagmat(calib / calib(ref_ant))) * mat_ul_zf.st(), where
+    // the inverse of the diagonal calibration matrix is an elementwise scale
+    // of each antenna's row
+    float max_abs_sq = 0;
+    for (size_t i = 0; i < bs_ant_num; i++) {
+        const std::complex<float> scale
+            = cfg->recipCalEn ? calib[cfg->ref_ant] / calib[i] : 1.0f;
+        for (size_t j = 0; j < ue_num; j++) {
+            const std::complex<float> v = ul_zf[i * ue_num + j] * scale;
+            dl_zf[j * bs_ant_num + i] = v;
+            max_abs_sq = std::max(max_abs_sq, std::norm(v));
+        }
+    }
+
+    // We should be scaling the beamforming matrix, so the IFFT
+    // output can be scaled with OFDM_CA_NUM across all antennas.
+    // See Argos paper (Mobicom 2012) Sec. 3.4 for details.
+    const float inv_max_abs = 1.0f / std::sqrt(max_abs_sq);
+    for (size_t i = 0; i < bs_ant_num * ue_num; i++)
+        dl_zf[i] *= inv_max_abs;
+}
+
+void DoZF::compute_precoder_tracked(const arma::cx_fmat& mat_csi,
+    complex_float* calib_ptr, size_t sc_id, complex_float* _mat_ul_zf,
+    complex_float* _mat_dl_zf)
+{
+    if (zf_tracker_ == nullptr or !zf_tracker_->try_lock(sc_id)) {
+        // Tracking is disabled, or another worker is using this subcarrier's
+        // reference (e.g., for an overlapping frame)
+        compute_precoder(mat_csi, calib_ptr, _mat_ul_zf, _mat_dl_zf);
+        if (zf_tracker_ != nullptr)
+            zf_tracking_stat_->num_full++;
+        return;
+    }
+
+    const size_t bs_ant_num = cfg->BS_ANT_NUM;
+    const size_t ue_num = cfg->UE_NUM;
+    const size_t csi_size = bs_ant_num * ue_num;
+    auto* csi = reinterpret_cast<const std::complex<float>*>(mat_csi.memptr());
+    auto* ref_csi
+        = reinterpret_cast<std::complex<float>*>(zf_tracker_->ref_csi(sc_id));
+    complex_float* ref_ul_zf = zf_tracker_->ref_ul_zf(sc_id);
+
+    // Relative change of the CSI from the reference CSI
+    double delta = std::numeric_limits<double>::infinity();
+    if (zf_tracker_->has_reference(sc_id)) {
+        float diff_norm = 0;
+        float ref_norm = 0;
+        for (size_t i = 0; i < csi_size; i++) {
+            diff_norm += std::norm(csi[i] - ref_csi[i]);
+            ref_norm += std::norm(ref_csi[i]);
+        }
+        delta = diff_norm / ref_norm;
+    }
+
+    if (delta <= cfg->zf_reuse_threshold) {
+        // Keep the old reference CSI, so that slow drift eventually triggers
+        // a refinement or a full inverse
+        memcpy(_mat_ul_zf, ref_ul_zf, csi_size * sizeof(complex_float));
+        zf_tracking_stat_->num_reused++;
+    } else if (delta <= cfg->zf_refine_threshold) {
+        // One Newton-Schulz iteration W' = 2W - (W * H) * W for the
+        // pseudo-inverse of H, starting from the reference W
+        static const MKL_Complex8 kOne = { 1.0, 0.0 };
+        static const MKL_Complex8 kZero = { 0.0, 0.0 };
+        static const MKL_Complex8 kMinusOne = { -1.0, 0.0 };
+        static const MKL_Complex8 kTwo = { 2.0, 0.0 };
+        memcpy(_mat_ul_zf, ref_ul_zf, csi_size * sizeof(complex_float));
+        cblas_cgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ue_num, ue_num,
+            bs_ant_num, &kOne, ref_ul_zf, ue_num, mat_csi.memptr(), bs_ant_num,
+            &kZero, zf_gram_buffer, ue_num);
+        cblas_cgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ue_num,
+            bs_ant_num, ue_num, &kMinusOne, zf_gram_buffer, ue_num, ref_ul_zf,
+            ue_num, &kTwo, _mat_ul_zf, ue_num);
+
+        memcpy(ref_csi, csi, csi_size * sizeof(complex_float));
+        memcpy(ref_ul_zf, _mat_ul_zf, csi_size * sizeof(complex_float));
+        zf_tracking_stat_->num_refined++;
+    } else {
+        compute_precoder(mat_csi, calib_ptr, _mat_ul_zf, _mat_dl_zf);
+        memcpy(ref_csi, csi, csi_size * sizeof(complex_float));
+        memcpy(ref_ul_zf, _mat_ul_zf, csi_size * sizeof(complex_float));
+        zf_tracker_->set_reference(sc_id);
+        zf_tracker_->unlock(sc_id);
+        zf_tracking_stat_->num_full++;
+        return;
     }
+    zf_tracker_->unlock(sc_id);
+
+    if (cfg->dl_data_symbol_num_perframe > 0)
+        compute_dl_precoder(calib_ptr, _mat_ul_zf, _mat_dl_zf);
 }
 
 // Gather data of one symbol from partially-transposed buffer
@@ -170,7 +304,7 @@ void DoZF::ZF_time_orthogonal(size_t tag)
         arma::cx_fmat mat_csi((arma::cx_float*)csi_gather_buffer,
             cfg->BS_ANT_NUM, cfg->UE_NUM, false);
 
-        compute_precoder(mat_csi, calib_gather_buffer,
+        compute_precoder_tracked(mat_csi, calib_gather_buffer, cur_sc_id,
             ul_zf_matrices_[frame_slot][cur_sc_id],
             dl_zf_matrices_[frame_slot][cur_sc_id]);
 
@@ -188,6 +322,82 @@ void DoZF::ZF_time_orthogonal(size_t tag)
     }
 }
 
+void DoZF::ZF_time_orthogonal_batched(size_t tag)
+{
+    const size_t frame_id = gen_tag_t(tag).frame_id;
+    const size_t base_sc_id = gen_tag_t(tag).sc_id;
+    const size_t frame_slot = frame_id % kFrameWnd;
+    if (kDebugPrintInTask) {
+        printf("In doZF thread %d: frame: %zu, base subcarrier: %zu\n", tid,
+            frame_id, base_sc_id);
+    }
+    const size_t num_subcarriers
+        = std::min(cfg->zf_block_size, cfg->OFDM_DATA_NUM - base_sc_id);
+    const size_t csi_size = cfg->BS_ANT_NUM * cfg->UE_NUM;
+
+    for (size_t i = 0; i < num_subcarriers; i += BatchedZF::kBatchSize) {
+        size_t start_tsc1 = worker_rdtsc();
+        const size_t num_lanes
+            = std::min(BatchedZF::kBatchSize, num_subcarriers - i);
+
+        // Gather the CSI matrix of each subcarrier in the batch from
+        // partially-transposed CSIs, and load it into its batch lane
+        for (size_t lane = 0; lane < num_lanes; lane++) {
+            const size_t cur_sc_id = base_sc_id + i + lane;
+            complex_float* csi_ptr = csi_gather_buffer + lane * csi_size;
+            for (size_t ue_idx = 0; ue_idx < cfg->UE_NUM; ue_idx++) {
+                float* dst_csi_ptr
+                    = (float*)(csi_ptr + cfg->BS_ANT_NUM * ue_idx);
+                partial_transpose_gather(cur_sc_id,
+                    (float*)csi_buffers_[frame_slot][ue_idx], dst_csi_ptr,
+                    cfg->BS_ANT_NUM);
+            }
+            if (cfg->recipCalEn) {
+                float* dst_calib_ptr
+                    = (float*)(calib_gather_buffer + lane * cfg->BS_ANT_NUM);
+                partial_transpose_gather(cur_sc_id,
+                    (float*)calib_buffer_[frame_slot], dst_calib_ptr,
+                    cfg->BS_ANT_NUM);
+            }
+            batched_zf_->load(lane, (float*)csi_ptr);
+        }
+
+        double start_tsc2 = worker_rdtsc();
+        duration_stat->task_duration[1] += start_tsc2 - start_tsc1;
+
+        batched_zf_->compute(num_lanes);
+
+        for (size_t lane = 0; lane < num_lanes; lane++) {
+            const size_t cur_sc_id = base_sc_id + i + lane;
+            complex_float* calib_ptr
+                = calib_gather_buffer + lane * cfg->BS_ANT_NUM;
+            if (batched_zf_->failed(lane)) {
+                // The channel matrix is (close to) rank-deficient, so take
+                // the slow path
+                arma::cx_fmat mat_csi(
+                    (arma::cx_float*)(csi_gather_buffer + lane * csi_size),
+                    cfg->BS_ANT_NUM, cfg->UE_NUM, false);
+                compute_precoder(mat_csi, calib_ptr,
+                    ul_zf_matrices_[frame_slot][cur_sc_id],
+                    dl_zf_matrices_[frame_slot][cur_sc_id]);
+                continue;
+            }
+            batched_zf_->store(
+                lane, (float*)ul_zf_matrices_[frame_slot][cur_sc_id]);
+            if (cfg->dl_data_symbol_num_perframe > 0) {
+                compute_dl_precoder(calib_ptr,
+                    ul_zf_matrices_[frame_slot][cur_sc_id],
+                    dl_zf_matrices_[frame_slot][cur_sc_id]);
+            }
+        }
+
+        double start_tsc3 = worker_rdtsc();
+        duration_stat->task_duration[2] += start_tsc3 - start_tsc2;
+        duration_stat->task_count += num_lanes;
+        duration_stat->task_duration[0] += start_tsc3 - start_tsc1;
+    }
+}
+
 void DoZF::ZF_freq_orthogonal(size_t tag)
 {
     const size_t frame_id = gen_tag_t(tag).frame_id;
@@ -220,9 +430,10 @@ void DoZF::ZF_freq_orthogonal(size_t tag)
     arma::cx_fmat mat_csi(reinterpret_cast<arma::cx_float*>(csi_gather_buffer),
         cfg->BS_ANT_NUM, cfg->UE_NUM, false);
 
-    compute_precoder(mat_csi, calib_gather_buffer,
-        ul_zf_matrices_[frame_slot][cfg->get_zf_sc_id(base_sc_id)],
-        dl_zf_matrices_[frame_slot][cfg->get_zf_sc_id(base_sc_id)]);
+    const size_t zf_sc_id = cfg->get_zf_sc_id(base_sc_id);
+    compute_precoder_tracked(mat_csi, calib_gather_buffer, zf_sc_id,
+        ul_zf_matrices_[frame_slot][zf_sc_id],
+        dl_zf_matrices_[frame_slot][zf_sc_id]);
 
     double start_tsc2 = worker_rdtsc();
     duration_stat->task_duration[2] += start_tsc2 - start_tsc1;
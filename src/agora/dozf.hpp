@@ -9,6 +9,8 @@
 #include "gettime.h"
 #include "stats.hpp"
 #include "utils.h"
+#include "zf_batch.hpp"
+#include "zf_tracker.hpp"
 #include <armadillo>
 #include <iostream>
 #include <stdio.h>
@@ -24,7 +26,7 @@ public:
         Table<complex_float>& calib_buffer,
         PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_zf_matrices_,
         PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices_,
-        Stats* stats_manager);
+        Stats* stats_manager, ZFTracker* zf_tracker = nullptr);
     ~DoZF();
 
     /**
@@ -48,12 +50,30 @@ public:
 private:
     void ZF_time_orthogonal(size_t tag);
 
+    /// Compute zeroforcing matrices for a block of subcarriers in batches of
+    /// BatchedZF::kBatchSize, instead of one subcarrier at a time
+    void ZF_time_orthogonal_batched(size_t tag);
+
     /// Compute the uplink zeroforcing detector matrix and/or the downlink
-    /// zeroforcing precoder using this CSI matrix and calibration buffer
+    /// zeroforcing precoder using this CSI matrix and calibration buffer.
+    /// Unless the channel matrix is rank-deficient, this does not allocate
+    /// memory.
     void compute_precoder(const arma::cx_fmat& mat_csi,
         complex_float* calib_buf, complex_float* mat_ul_zf,
         complex_float* mat_dl_zf);
 
+    /// Compute the downlink zeroforcing precoder from the uplink zeroforcing
+    /// detector matrix and the calibration buffer
+    void compute_dl_precoder(complex_float* calib_buf,
+        complex_float* mat_ul_zf, complex_float* mat_dl_zf);
+
+    /// Same as compute_precoder(), but in ZF tracking mode, reuse or refine
+    /// the reference zeroforcing matrix of subcarrier [sc_id] if the CSI has
+    /// not changed much since the reference was computed
+    void compute_precoder_tracked(const arma::cx_fmat& mat_csi,
+        complex_float* calib_buf, size_t sc_id, complex_float* mat_ul_zf,
+        complex_float* mat_dl_zf);
+
     void ZF_freq_orthogonal(size_t tag);
 
     /**
@@ -87,9 +107,20 @@ private:
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices_;
     DurationStat* duration_stat;
 
+    // Intermediate buffer for the Gram matrix H' * H and its Cholesky factor
+    complex_float* zf_gram_buffer;
+
     complex_float* csi_gather_buffer; // Intermediate buffer to gather CSI
     // Intermediate buffer to gather reciprical calibration data vector
     complex_float* calib_gather_buffer;
+
+    // Reference state shared by all workers in ZF tracking mode, or nullptr
+    ZFTracker* zf_tracker_;
+    ZFTrackingStat* zf_tracking_stat_;
+
+    // Batched zeroforcing engine, used only if batching is enabled. The
+    // gather buffers above then hold one matrix (or vector) per batch lane.
+    BatchedZF* batched_zf_;
 };
 
 #endif
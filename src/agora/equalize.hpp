@@ -0,0 +1,318 @@
+/**
+ * @file equalize.hpp
+ * @brief SIMD kernels for uplink equalization in DoDemul
+ *
+ * The kernels equalize a tile of up to kEqualizeTileSCs subcarriers of one
+ * symbol for all UEs, reading received data directly from the
+ * partially-transposed data buffer produced by DoFFT. The equalized data is
+ * written UE-major into a small tile that fits in L1 cache, so each UE's
+ * subcarriers can be demodulated immediately afterwards.
+ *
+ * Equalization is vectorized across UEs: a column of the zeroforcing matrix
+ * (one antenna, all UEs) is contiguous in memory, and is multiplied with the
+ * broadcast received sample of that antenna.
+ */
+#ifndef EQUALIZE
+#define EQUALIZE
+
+#include "Symbols.hpp"
+#include "buffer.hpp"
+#include <algorithm>
+#include <immintrin.h>
+
+// Number of subcarriers equalized in one tile. Sixteen subcarriers match the
+// granularity of the AVX2 soft demodulation kernels.
+static constexpr size_t kEqualizeTileSCs = 16;
+
+/**
+ * Equalize subcarriers [base_sc_id, base_sc_id + num_sc) of one symbol.
+ *
+ * @param data_buf Partially-transposed received data of the symbol
+ * @param ul_zf_ptrs ul_zf_ptrs[j] is the column-major ue_num x bs_ant_num
+ * zeroforcing matrix of subcarrier (base_sc_id + j)
+ * @param phase_correct If not nullptr, a per-UE complex factor applied to the
+ * equalized data
+ * @param tile Output, tile[u * kEqualizeTileSCs + j] is the equalized data of
+ * UE u on subcarrier (base_sc_id + j)
+ */
+typedef void (*EqualizeTileFn)(const complex_float* data_buf,
+    complex_float* const* ul_zf_ptrs, const complex_float* phase_correct,
+    size_t bs_ant_num, size_t ue_num, size_t base_sc_id, size_t num_sc,
+    complex_float* tile);
+
+// Return the offset of antenna 0's sample of subcarrier sc_id in a
+// partially-transposed data buffer
+static inline size_t equalize_data_offset(size_t sc_id, size_t bs_ant_num)
+{
+    return (sc_id / kTransposeBlockSize) * (kTransposeBlockSize * bs_ant_num)
+        + (sc_id % kTransposeBlockSize);
+}
+
+static inline void equalize_tile_avx2(const complex_float* data_buf,
+    complex_float* const* ul_zf_ptrs, const complex_float* phase_correct,
+    size_t bs_ant_num, size_t ue_num, size_t base_sc_id, size_t num_sc,
+    complex_float* tile)
+{
+    static constexpr size_t kUEsPerVector = 4;
+    const __m256i lane_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (size_t j = 0; j < num_sc; j++) {
+        const float* x = reinterpret_cast<const float*>(data_buf
+            + equalize_data_offset(base_sc_id + j, bs_ant_num));
+        const float* zf = reinterpret_cast<const float*>(ul_zf_ptrs[j]);
+
+        for (size_t u = 0; u < ue_num; u += kUEsPerVector) {
+            const size_t n_ue = std::min(kUEsPerVector, ue_num - u);
+            const __m256i mask = _mm256_cmpgt_epi32(
+                _mm256_set1_epi32(static_cast<int>(2 * n_ue)), lane_idx);
+
+            // acc_a = (w_re * x_re, w_im * x_re), acc_b = (w_im * x_im,
+            // w_re * x_im), summed over antennas
+            __m256 acc_a = _mm256_setzero_ps();
+            __m256 acc_b = _mm256_setzero_ps();
+            for (size_t a = 0; a < bs_ant_num; a++) {
+                const __m256 w
+                    = _mm256_maskload_ps(zf + 2 * (a * ue_num + u), mask);
+                const float* x_a = x + 2 * a * kTransposeBlockSize;
+                acc_a = _mm256_fmadd_ps(w, _mm256_broadcast_ss(x_a), acc_a);
+                acc_b = _mm256_fmadd_ps(_mm256_permute_ps(w, 0xb1),
+                    _mm256_broadcast_ss(x_a + 1), acc_b);
+            }
+            __m256 y = _mm256_addsub_ps(acc_a, acc_b);
+
+            if (phase_correct != nullptr) {
+                const __m256 p = _mm256_maskload_ps(
+                    reinterpret_cast<const float*>(phase_correct + u), mask);
+                y = _mm256_addsub_ps(_mm256_mul_ps(y, _mm256_moveldup_ps(p)),
+                    _mm256_mul_ps(
+                        _mm256_permute_ps(y, 0xb1), _mm256_movehdup_ps(p)));
+            }
+
+            alignas(32) complex_float y_ue[kUEsPerVector];
+            _mm256_store_ps(reinterpret_cast<float*>(y_ue), y);
+            for (size_t k = 0; k < n_ue; k++)
+                tile[(u + k) * kEqualizeTileSCs + j] = y_ue[k];
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static inline void equalize_tile_avx512(
+    const complex_float* data_buf, complex_float* const* ul_zf_ptrs,
+    const complex_float* phase_correct, size_t bs_ant_num, size_t ue_num,
+    size_t base_sc_id, size_t num_sc, complex_float* tile)
+{
+    static constexpr size_t kUEsPerVector = 8;
+    const __m512 ones = _mm512_set1_ps(1.0);
+    const __m512i ue_row_offsets = _mm512_setr_epi64(0, kEqualizeTileSCs,
+        2 * kEqualizeTileSCs, 3 * kEqualizeTileSCs, 4 * kEqualizeTileSCs,
+        5 * kEqualizeTileSCs, 6 * kEqualizeTileSCs, 7 * kEqualizeTileSCs);
+
+    for (size_t j = 0; j < num_sc; j++) {
+        const float* x = reinterpret_cast<const float*>(data_buf
+            + equalize_data_offset(base_sc_id + j, bs_ant_num));
+        const float* zf = reinterpret_cast<const float*>(ul_zf_ptrs[j]);
+
+        for (size_t u = 0; u < ue_num; u += kUEsPerVector) {
+            const size_t n_ue = std::min(kUEsPerVector, ue_num - u);
+            const __mmask16 mask = (1u << (2 * n_ue)) - 1;
+
+            __m512 acc_a = _mm512_setzero_ps();
+            __m512 acc_b = _mm512_setzero_ps();
+            for (size_t a = 0; a < bs_ant_num; a++) {
+                const __m512 w
+                    = _mm512_maskz_loadu_ps(mask, zf + 2 * (a * ue_num + u));
+                const float* x_a = x + 2 * a * kTransposeBlockSize;
+                acc_a = _mm512_fmadd_ps(w, _mm512_set1_ps(x_a[0]), acc_a);
+                acc_b = _mm512_fmadd_ps(_mm512_permute_ps(w, 0xb1),
+                    _mm512_set1_ps(x_a[1]), acc_b);
+            }
+            // Even (real) lanes: acc_a - acc_b, odd (imaginary) lanes:
+            // acc_a + acc_b
+            __m512 y = _mm512_fmaddsub_ps(acc_a, ones, acc_b);
+
+            if (phase_correct != nullptr) {
+                const __m512 p = _mm512_maskz_loadu_ps(mask,
+                    reinterpret_cast<const float*>(phase_correct + u));
+                y = _mm512_fmaddsub_ps(y, _mm512_moveldup_ps(p),
+                    _mm512_mul_ps(
+                        _mm512_permute_ps(y, 0xb1), _mm512_movehdup_ps(p)));
+            }
+
+            // Scatter each UE's complex sample into its row of the tile
+            const __m512i index = _mm512_add_epi64(ue_row_offsets,
+                _mm512_set1_epi64(u * kEqualizeTileSCs + j));
+            _mm512_mask_i64scatter_pd(tile,
+                static_cast<__mmask8>((1u << n_ue) - 1), index,
+                _mm512_castps_pd(y), sizeof(complex_float));
+        }
+    }
+}
+
+/**
+ * Equalization kernels specialized for [kAnts] antennas and [kUEs] UEs. With
+ * compile-time dimensions, the antenna loop is unrolled, no masks are needed,
+ * and the accumulators of up to four vectors of UEs stay in registers during
+ * one pass over the antennas. The bs_ant_num and ue_num arguments are
+ * ignored.
+ */
+template <size_t kAnts, size_t kUEs>
+static inline void equalize_tile_fixed_avx2(const complex_float* data_buf,
+    complex_float* const* ul_zf_ptrs, const complex_float* phase_correct,
+    size_t, size_t, size_t base_sc_id, size_t num_sc, complex_float* tile)
+{
+    static constexpr size_t kUEsPerVector = 4;
+    static_assert(kUEs % kUEsPerVector == 0, "Unsupported UE count");
+    static constexpr size_t kNumVectors = kUEs / kUEsPerVector;
+    static constexpr size_t kVectorsPerPass = kNumVectors < 4 ? kNumVectors : 4;
+
+    for (size_t j = 0; j < num_sc; j++) {
+        const float* x = reinterpret_cast<const float*>(
+            data_buf + equalize_data_offset(base_sc_id + j, kAnts));
+        const float* zf = reinterpret_cast<const float*>(ul_zf_ptrs[j]);
+
+        for (size_t v0 = 0; v0 < kNumVectors; v0 += kVectorsPerPass) {
+            __m256 acc_a[kVectorsPerPass], acc_b[kVectorsPerPass];
+            for (size_t v = 0; v < kVectorsPerPass; v++) {
+                acc_a[v] = _mm256_setzero_ps();
+                acc_b[v] = _mm256_setzero_ps();
+            }
+            for (size_t a = 0; a < kAnts; a++) {
+                const float* x_a = x + 2 * a * kTransposeBlockSize;
+                const __m256 x_re = _mm256_broadcast_ss(x_a);
+                const __m256 x_im = _mm256_broadcast_ss(x_a + 1);
+                const float* zf_a = zf + 2 * (a * kUEs + v0 * kUEsPerVector);
+                for (size_t v = 0; v < kVectorsPerPass; v++) {
+                    const __m256 w
+                        = _mm256_loadu_ps(zf_a + 2 * v * kUEsPerVector);
+                    acc_a[v] = _mm256_fmadd_ps(w, x_re, acc_a[v]);
+                    acc_b[v] = _mm256_fmadd_ps(
+                        _mm256_permute_ps(w, 0xb1), x_im, acc_b[v]);
+                }
+            }
+
+            for (size_t v = 0; v < kVectorsPerPass; v++) {
+                const size_t u = (v0 + v) * kUEsPerVector;
+                __m256 y = _mm256_addsub_ps(acc_a[v], acc_b[v]);
+                if (phase_correct != nullptr) {
+                    const __m256 p = _mm256_loadu_ps(
+                        reinterpret_cast<const float*>(phase_correct + u));
+                    y = _mm256_addsub_ps(
+                        _mm256_mul_ps(y, _mm256_moveldup_ps(p)),
+                        _mm256_mul_ps(_mm256_permute_ps(y, 0xb1),
+                            _mm256_movehdup_ps(p)));
+                }
+                alignas(32) complex_float y_ue[kUEsPerVector];
+                _mm256_store_ps(reinterpret_cast<float*>(y_ue), y);
+                for (size_t k = 0; k < kUEsPerVector; k++)
+                    tile[(u + k) * kEqualizeTileSCs + j] = y_ue[k];
+            }
+        }
+    }
+}
+
+template <size_t kAnts, size_t kUEs>
+__attribute__((target("avx512f"))) static inline void
+equalize_tile_fixed_avx512(const complex_float* data_buf,
+    complex_float* const* ul_zf_ptrs, const complex_float* phase_correct,
+    size_t, size_t, size_t base_sc_id, size_t num_sc, complex_float* tile)
+{
+    static constexpr size_t kUEsPerVector = 8;
+    static_assert(kUEs % kUEsPerVector == 0, "Unsupported UE count");
+    static constexpr size_t kNumVectors = kUEs / kUEsPerVector;
+    static constexpr size_t kVectorsPerPass = kNumVectors < 4 ? kNumVectors : 4;
+    const __m512 ones = _mm512_set1_ps(1.0);
+    const __m512i ue_row_offsets = _mm512_setr_epi64(0, kEqualizeTileSCs,
+        2 * kEqualizeTileSCs, 3 * kEqualizeTileSCs, 4 * kEqualizeTileSCs,
+        5 * kEqualizeTileSCs, 6 * kEqualizeTileSCs, 7 * kEqualizeTileSCs);
+
+    for (size_t j = 0; j < num_sc; j++) {
+        const float* x = reinterpret_cast<const float*>(
+            data_buf + equalize_data_offset(base_sc_id + j, kAnts));
+        const float* zf = reinterpret_cast<const float*>(ul_zf_ptrs[j]);
+
+        for (size_t v0 = 0; v0 < kNumVectors; v0 += kVectorsPerPass) {
+            __m512 acc_a[kVectorsPerPass], acc_b[kVectorsPerPass];
+            for (size_t v = 0; v < kVectorsPerPass; v++) {
+                acc_a[v] = _mm512_setzero_ps();
+                acc_b[v] = _mm512_setzero_ps();
+            }
+            for (size_t a = 0; a < kAnts; a++) {
+                const float* x_a = x + 2 * a * kTransposeBlockSize;
+                const __m512 x_re = _mm512_set1_ps(x_a[0]);
+                const __m512 x_im = _mm512_set1_ps(x_a[1]);
+                const float* zf_a = zf + 2 * (a * kUEs + v0 * kUEsPerVector);
+                for (size_t v = 0; v < kVectorsPerPass; v++) {
+                    const __m512 w
+                        = _mm512_loadu_ps(zf_a + 2 * v * kUEsPerVector);
+                    acc_a[v] = _mm512_fmadd_ps(w, x_re, acc_a[v]);
+                    acc_b[v] = _mm512_fmadd_ps(
+                        _mm512_permute_ps(w, 0xb1), x_im, acc_b[v]);
+                }
+            }
+
+            for (size_t v = 0; v < kVectorsPerPass; v++) {
+                const size_t u = (v0 + v) * kUEsPerVector;
+                __m512 y = _mm512_fmaddsub_ps(acc_a[v], ones, acc_b[v]);
+                if (phase_correct != nullptr) {
+                    const __m512 p = _mm512_loadu_ps(
+                        reinterpret_cast<const float*>(phase_correct + u));
+                    y = _mm512_fmaddsub_ps(y, _mm512_moveldup_ps(p),
+                        _mm512_mul_ps(_mm512_permute_ps(y, 0xb1),
+                            _mm512_movehdup_ps(p)));
+                }
+                const __m512i index = _mm512_add_epi64(ue_row_offsets,
+                    _mm512_set1_epi64(u * kEqualizeTileSCs + j));
+                _mm512_i64scatter_pd(tile, index, _mm512_castps_pd(y),
+                    sizeof(complex_float));
+            }
+        }
+    }
+}
+
+/// Return the specialized equalization kernel for [bs_ant_num] antennas and
+/// [ue_num] UEs, or nullptr if there is none. Specializations exist for
+/// 8x4, 16x8, 32x8, 64x16, and 64x32 (antennas x UEs).
+static inline EqualizeTileFn select_fixed_equalize_tile_fn(
+    size_t bs_ant_num, size_t ue_num, bool use_avx512)
+{
+    if (bs_ant_num == 8 && ue_num == 4)
+        return equalize_tile_fixed_avx2<8, 4>;
+    if (bs_ant_num == 16 && ue_num == 8) {
+        return use_avx512 ? equalize_tile_fixed_avx512<16, 8>
+                          : equalize_tile_fixed_avx2<16, 8>;
+    }
+    if (bs_ant_num == 32 && ue_num == 8) {
+        return use_avx512 ? equalize_tile_fixed_avx512<32, 8>
+                          : equalize_tile_fixed_avx2<32, 8>;
+    }
+    if (bs_ant_num == 64 && ue_num == 16) {
+        return use_avx512 ? equalize_tile_fixed_avx512<64, 16>
+                          : equalize_tile_fixed_avx2<64, 16>;
+    }
+    if (bs_ant_num == 64 && ue_num == 32) {
+        return use_avx512 ? equalize_tile_fixed_avx512<64, 32>
+                          : equalize_tile_fixed_avx2<64, 32>;
+    }
+    return nullptr;
+}
+
+/// Return the fastest equalization kernel supported by this CPU for
+/// [bs_ant_num] antennas and [ue_num] UEs. A specialized kernel is preferred
+/// if [use_fixed_size] is true and one exists for these dimensions.
+static inline EqualizeTileFn select_equalize_tile_fn(
+    size_t bs_ant_num, size_t ue_num, bool use_fixed_size = true)
+{
+    __builtin_cpu_init();
+    const bool use_avx512 = __builtin_cpu_supports("avx512f");
+    if (use_fixed_size) {
+        EqualizeTileFn fn
+            = select_fixed_equalize_tile_fn(bs_ant_num, ue_num, use_avx512);
+        if (fn != nullptr)
+            return fn;
+    }
+    if (use_avx512)
+        return equalize_tile_avx512;
+    return equalize_tile_avx2;
+}
+
+#endif /* EQUALIZE */
@@ -0,0 +1,168 @@
+/**
+ * @file fft_transpose.hpp
+ * @brief SIMD kernels for the post-FFT stage of DoFFT
+ *
+ * The kernels copy the data subcarriers of one antenna's frequency-domain
+ * symbol into a partially-transposed buffer (see DoFFT::partial_transpose()).
+ * For pilot symbols, each subcarrier is also multiplied with the conjugate of
+ * its pilot sign in the same pass, which gives the CSI estimate. Pilot signs
+ * are loaded directly from Config::pilots_sgn_, one vector per cacheline of
+ * subcarriers.
+ *
+ * The fp16 kernels are used when FFT is done in the RRU. They read the
+ * frequency-domain samples straight from the packet, so conversion to float,
+ * pilot sign multiplication, and the transpose stores are one pass.
+ */
+#ifndef FFT_TRANSPOSE
+#define FFT_TRANSPOSE
+
+#include "Symbols.hpp"
+#include "buffer.hpp"
+#include <immintrin.h>
+
+/**
+ * Partially transpose [num_blocks] * kTransposeBlockSize subcarriers of one
+ * antenna.
+ *
+ * @param in First data subcarrier of the antenna's FFT output
+ * @param out_buf Partially-transposed buffer of the symbol
+ * @param pilots_sgn Pilot signs of the data subcarriers for pilot symbols,
+ * nullptr for data symbols
+ */
+typedef void (*FFTTransposeFn)(const complex_float* in,
+    complex_float* out_buf, size_t ant_id, size_t bs_ant_num,
+    size_t num_blocks, const complex_float* pilots_sgn);
+
+/// Like FFTTransposeFn, but the input is the antenna's first data subcarrier
+/// in a packet of fp16 frequency-domain samples
+typedef void (*FP16TransposeFn)(const uint16_t* in, complex_float* out_buf,
+    size_t ant_id, size_t bs_ant_num, size_t num_blocks,
+    const complex_float* pilots_sgn);
+
+// Return a * conj(b) for each of the four complex floats in a and b
+static inline __m256 mul_conj_avx2(__m256 a, __m256 b)
+{
+    // Even (real) lanes: a_re * b_re + a_im * b_im, odd (imaginary) lanes:
+    // a_im * b_re - a_re * b_im
+    const __m256 t
+        = _mm256_mul_ps(_mm256_permute_ps(a, 0xb1), _mm256_movehdup_ps(b));
+    return _mm256_fmsubadd_ps(a, _mm256_moveldup_ps(b), t);
+}
+
+// Return a * conj(b) for each of the eight complex floats in a and b
+__attribute__((target("avx512f"))) static inline __m512 mul_conj_avx512(
+    __m512 a, __m512 b)
+{
+    const __m512 t
+        = _mm512_mul_ps(_mm512_permute_ps(a, 0xb1), _mm512_movehdup_ps(b));
+    return _mm512_fmsubadd_ps(a, _mm512_moveldup_ps(b), t);
+}
+
+static inline void fft_transpose_avx2(const complex_float* in,
+    complex_float* out_buf, size_t ant_id, size_t bs_ant_num,
+    size_t num_blocks, const complex_float* pilots_sgn)
+{
+    for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
+        const size_t sc_idx = block_idx * kTransposeBlockSize;
+        float* dst = reinterpret_cast<float*>(out_buf
+            + block_idx * (kTransposeBlockSize * bs_ant_num)
+            + ant_id * kTransposeBlockSize);
+        for (size_t j = 0; j < kTransposeBlockSize; j += 4) {
+            __m256 x = _mm256_loadu_ps(
+                reinterpret_cast<const float*>(in + sc_idx + j));
+            if (pilots_sgn != nullptr) {
+                x = mul_conj_avx2(x,
+                    _mm256_load_ps(reinterpret_cast<const float*>(
+                        pilots_sgn + sc_idx + j)));
+            }
+            _mm256_store_ps(dst + 2 * j, x);
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static inline void fft_transpose_avx512(
+    const complex_float* in, complex_float* out_buf, size_t ant_id,
+    size_t bs_ant_num, size_t num_blocks, const complex_float* pilots_sgn)
+{
+    for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
+        const size_t sc_idx = block_idx * kTransposeBlockSize;
+        float* dst = reinterpret_cast<float*>(out_buf
+            + block_idx * (kTransposeBlockSize * bs_ant_num)
+            + ant_id * kTransposeBlockSize);
+        for (size_t j = 0; j < kTransposeBlockSize; j += kSCsPerCacheline) {
+            // The first data subcarrier need not start a cacheline
+            __m512 x = _mm512_loadu_ps(
+                reinterpret_cast<const float*>(in + sc_idx + j));
+            if (pilots_sgn != nullptr) {
+                x = mul_conj_avx512(x,
+                    _mm512_load_ps(reinterpret_cast<const float*>(
+                        pilots_sgn + sc_idx + j)));
+            }
+            _mm512_store_ps(dst + 2 * j, x);
+        }
+    }
+}
+
+static inline void fp16_transpose_avx2(const uint16_t* in,
+    complex_float* out_buf, size_t ant_id, size_t bs_ant_num,
+    size_t num_blocks, const complex_float* pilots_sgn)
+{
+    for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
+        const size_t sc_idx = block_idx * kTransposeBlockSize;
+        float* dst = reinterpret_cast<float*>(out_buf
+            + block_idx * (kTransposeBlockSize * bs_ant_num)
+            + ant_id * kTransposeBlockSize);
+        for (size_t j = 0; j < kTransposeBlockSize; j += 4) {
+            __m256 x = _mm256_cvtph_ps(_mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(in + 2 * (sc_idx + j))));
+            if (pilots_sgn != nullptr) {
+                x = mul_conj_avx2(x,
+                    _mm256_load_ps(reinterpret_cast<const float*>(
+                        pilots_sgn + sc_idx + j)));
+            }
+            _mm256_store_ps(dst + 2 * j, x);
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static inline void fp16_transpose_avx512(
+    const uint16_t* in, complex_float* out_buf, size_t ant_id,
+    size_t bs_ant_num, size_t num_blocks, const complex_float* pilots_sgn)
+{
+    for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
+        const size_t sc_idx = block_idx * kTransposeBlockSize;
+        float* dst = reinterpret_cast<float*>(out_buf
+            + block_idx * (kTransposeBlockSize * bs_ant_num)
+            + ant_id * kTransposeBlockSize);
+        for (size_t j = 0; j < kTransposeBlockSize; j += kSCsPerCacheline) {
+            __m512 x = _mm512_cvtph_ps(_mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(in + 2 * (sc_idx + j))));
+            if (pilots_sgn != nullptr) {
+                x = mul_conj_avx512(x,
+                    _mm512_load_ps(reinterpret_cast<const float*>(
+                        pilots_sgn + sc_idx + j)));
+            }
+            _mm512_store_ps(dst + 2 * j, x);
+        }
+    }
+}
+
+/// Return the fastest post-FFT transpose kernel supported by this CPU
+static inline FFTTransposeFn select_fft_transpose_fn()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return fft_transpose_avx512;
+    return fft_transpose_avx2;
+}
+
+/// Return the fastest fp16 transpose kernel supported by this CPU
+static inline FP16TransposeFn select_fp16_transpose_fn()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return fp16_transpose_avx512;
+    return fp16_transpose_avx2;
+}
+
+#endif /* FFT_TRANSPOSE */
@@ -0,0 +1,116 @@
+/**
+ * @file frame_dag.hpp
+ * @brief Per-frame task dependency tracking for the Agora master thread
+ *
+ * Each frame's work forms a DAG: FFT of pilots -> ZF, and (ZF, FFT of a data
+ * symbol) -> demodulation of that symbol -> decoding of that symbol on the
+ * uplink, or (ZF, encoding of a data symbol) -> precoding -> IFFT on the
+ * downlink. FrameDag tracks the unresolved dependencies of every data symbol
+ * of every frame in the frame window, so stages of different frames can run
+ * concurrently. It also retires completed frames in order.
+ *
+ * FrameDag is not thread-safe; only the master thread may use it.
+ */
+#ifndef FRAME_DAG
+#define FRAME_DAG
+
+#include "Symbols.hpp"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+class FrameDag {
+public:
+    // A data symbol depends on its frame's precoder (ZF) and on its own FFT
+    // (uplink) or LDPC encoding (downlink)
+    static constexpr size_t kNumSymbolDeps = 2;
+
+    void init(size_t num_ul_symbols, size_t num_dl_symbols)
+    {
+        for (size_t i = 0; i < kFrameWnd; i++) {
+            ul_pending_deps_[i].assign(num_ul_symbols, kNumSymbolDeps);
+            dl_pending_deps_[i].assign(num_dl_symbols, kNumSymbolDeps);
+        }
+        frame_done_.fill(false);
+        oldest_frame_ = 0;
+    }
+
+    /// Resolve one dependency of uplink data symbol [symbol_idx_ul] in frame
+    /// [frame_id]. Return true iff the symbol is now ready for demodulation.
+    bool resolve_ul(size_t frame_id, size_t symbol_idx_ul)
+    {
+        return resolve(ul_pending_deps_[frame_id % kFrameWnd][symbol_idx_ul]);
+    }
+
+    /// Resolve one dependency of downlink data symbol [symbol_idx_dl] in frame
+    /// [frame_id]. Return true iff the symbol is now ready for precoding.
+    bool resolve_dl(size_t frame_id, size_t symbol_idx_dl)
+    {
+        return resolve(dl_pending_deps_[frame_id % kFrameWnd][symbol_idx_dl]);
+    }
+
+    /// Re-arm the dependency counters of frame [frame_id], which is dropped
+    /// before all of its symbols are ready
+    void reset_frame(size_t frame_id)
+    {
+        const size_t frame_slot = frame_id % kFrameWnd;
+        std::fill(ul_pending_deps_[frame_slot].begin(),
+            ul_pending_deps_[frame_slot].end(), kNumSymbolDeps);
+        std::fill(dl_pending_deps_[frame_slot].begin(),
+            dl_pending_deps_[frame_slot].end(), kNumSymbolDeps);
+    }
+
+    /// Mark all processing of frame [frame_id] as complete. The frame is
+    /// retired once all older frames are complete.
+    void set_frame_done(size_t frame_id)
+    {
+        rt_assert(
+            frame_id >= oldest_frame_ && frame_id < oldest_frame_ + kFrameWnd,
+            "FrameDag: Completed frame is outside the frame window");
+        frame_done_[frame_id % kFrameWnd] = true;
+    }
+
+    /// If the oldest in-flight frame is complete, retire it, store its ID in
+    /// [frame_id], and return true. Otherwise, return false.
+    bool try_retire_oldest(size_t& frame_id)
+    {
+        const size_t frame_slot = oldest_frame_ % kFrameWnd;
+        if (!frame_done_[frame_slot])
+            return false;
+        frame_done_[frame_slot] = false;
+        frame_id = oldest_frame_++;
+        return true;
+    }
+
+    /// Return the oldest frame that has not been retired. Frames at or beyond
+    /// oldest_frame() + kFrameWnd cannot be admitted.
+    size_t oldest_frame() const { return oldest_frame_; }
+
+private:
+    static bool resolve(size_t& pending_deps)
+    {
+        if (--pending_deps == 0) {
+            // Re-arm the counter for the frame that will reuse this slot
+            pending_deps = kNumSymbolDeps;
+            return true;
+        }
+        return false;
+    }
+
+    // ul_pending_deps_[i % kFrameWnd][j] is the number of unresolved
+    // dependencies of uplink data symbol j in frame i
+    std::array<std::vector<size_t>, kFrameWnd> ul_pending_deps_;
+
+    // dl_pending_deps_[i % kFrameWnd][j] is the number of unresolved
+    // dependencies of downlink data symbol j in frame i
+    std::array<std::vector<size_t>, kFrameWnd> dl_pending_deps_;
+
+    // frame_done_[i % kFrameWnd] is true iff frame i is complete but not yet
+    // retired
+    std::array<bool, kFrameWnd> frame_done_;
+
+    size_t oldest_frame_; // The oldest frame that has not been retired
+};
+
+#endif /* FRAME_DAG */
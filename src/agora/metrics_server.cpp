@@ -0,0 +1,215 @@
+#include "metrics_server.hpp"
+#include "utils.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static const char* kStageNames[kNumDoerTypes]
+    = { "fft", "csi", "zf", "demul", "decode", "encode", "ifft", "precode",
+          "rc" };
+
+// Worker task queues exported as queue depths
+static const std::pair<EventType, const char*> kWorkerQueues[]
+    = { { EventType::kFFT, "fft" }, { EventType::kZF, "zf" },
+          { EventType::kDemul, "demul" }, { EventType::kDecode, "decode" },
+          { EventType::kEncode, "encode" }, { EventType::kPrecode, "precode" },
+          { EventType::kIFFT, "ifft" } };
+
+MetricsServer::MetricsServer(size_t port)
+    : port_(port)
+    , running_(true)
+    , seq_(0)
+    , snapshot_()
+{
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    rt_assert(listen_fd_ >= 0, "MetricsServer: Failed to create socket");
+    int optval = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    rt_assert(bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+                  sizeof(addr))
+            == 0,
+        "MetricsServer: Failed to bind to metrics port");
+    rt_assert(listen(listen_fd_, 4) == 0, "MetricsServer: Failed to listen");
+
+    thread_ = std::thread(&MetricsServer::run, this);
+    printf("MetricsServer: Serving metrics at http://127.0.0.1:%zu/metrics\n",
+        port_);
+}
+
+MetricsServer::~MetricsServer()
+{
+    running_ = false;
+    thread_.join();
+    close(listen_fd_);
+}
+
+void MetricsServer::publish(const MetricsSnapshot& snapshot)
+{
+    const size_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&snapshot_, &snapshot, sizeof(MetricsSnapshot));
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+void MetricsServer::read_snapshot(MetricsSnapshot& snapshot)
+{
+    while (true) {
+        const size_t seq = seq_.load(std::memory_order_acquire);
+        if (seq % 2 == 1)
+            continue;
+        memcpy(&snapshot, &snapshot_, sizeof(MetricsSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == seq)
+            return;
+    }
+}
+
+void MetricsServer::run()
+{
+    MetricsSnapshot snapshot;
+    char request[1024];
+    struct pollfd pfd = { listen_fd_, POLLIN, 0 };
+
+    while (running_) {
+        if (poll(&pfd, 1, 100 /* ms */) <= 0)
+            continue;
+        const int conn_fd = accept(listen_fd_, nullptr, nullptr);
+        if (conn_fd < 0)
+            continue;
+
+        // Every request gets the metrics, whatever its path
+        if (recv(conn_fd, request, sizeof(request), 0) > 0) {
+            read_snapshot(snapshot);
+            const std::string body = format(snapshot);
+            std::ostringstream ss;
+            ss << "HTTP/1.0 200 OK\r\n"
+               << "Content-Type: text/plain; version=0.0.4\r\n"
+               << "Content-Length: " << body.size() << "\r\n\r\n"
+               << body;
+            const std::string response = ss.str();
+            if (send(conn_fd, response.data(), response.size(), MSG_NOSIGNAL)
+                < 0) {
+                perror("MetricsServer: send() failed");
+            }
+        }
+        close(conn_fd);
+    }
+}
+
+// Write the HELP and TYPE lines of metric [name]
+static void write_header(std::ostringstream& ss, const char* name,
+    const char* type, const char* help)
+{
+    ss << "# HELP " << name << " " << help << "\n";
+    ss << "# TYPE " << name << " " << type << "\n";
+}
+
+std::string MetricsServer::format(const MetricsSnapshot& s)
+{
+    std::ostringstream ss;
+
+    write_header(ss, "agora_frames_done_total", "counter",
+        "Frames retired since Agora started");
+    ss << "agora_frames_done_total " << s.num_frames_done << "\n";
+    write_header(ss, "agora_frame_lag", "gauge",
+        "Newest received frame minus oldest in-flight frame");
+    ss << "agora_frame_lag " << s.frame_lag << "\n";
+
+    write_header(ss, "agora_tasks_total", "counter",
+        "Tasks completed by all workers");
+    for (size_t i = 0; i < kNumDoerTypes; i++) {
+        ss << "agora_tasks_total{stage=\"" << kStageNames[i] << "\"} "
+           << s.task_count[i] << "\n";
+    }
+    write_header(ss, "agora_task_seconds_total", "counter",
+        "Time spent in tasks by all workers");
+    for (size_t i = 0; i < kNumDoerTypes; i++) {
+        ss << "agora_task_seconds_total{stage=\"" << kStageNames[i] << "\"} "
+           << s.task_seconds[i] << "\n";
+    }
+
+    write_header(ss, "agora_queue_depth", "gauge", "Approximate queued events");
+    for (const auto& queue : kWorkerQueues) {
+        ss << "agora_queue_depth{queue=\"" << queue.second << "\"} "
+           << s.queue_depth[static_cast<size_t>(queue.first)] << "\n";
+    }
+    ss << "agora_queue_depth{queue=\"complete\"} " << s.complete_queue_depth
+       << "\n";
+
+    write_header(ss, "agora_frame_latency_us", "summary",
+        "Latency from first pilot packet to frame retirement of recent "
+        "frames");
+    std::vector<double> latencies(
+        s.frame_latency_us, s.frame_latency_us + s.num_latencies);
+    std::sort(latencies.begin(), latencies.end());
+    double latency_sum = 0;
+    for (double latency : latencies)
+        latency_sum += latency;
+    for (double quantile : { 0.5, 0.9, 0.99, 1.0 }) {
+        const double value = latencies.empty()
+            ? 0
+            : latencies[std::min(latencies.size() - 1,
+                  static_cast<size_t>(quantile * latencies.size()))];
+        ss << "agora_frame_latency_us{quantile=\"" << quantile << "\"} "
+           << value << "\n";
+    }
+    ss << "agora_frame_latency_us_sum " << latency_sum << "\n";
+    ss << "agora_frame_latency_us_count " << latencies.size() << "\n";
+
+    write_header(ss, "agora_ue_pilot_snr_db", "gauge",
+        "Pilot SNR of the last retired frame");
+    for (size_t i = 0; i < s.num_ues; i++) {
+        ss << "agora_ue_pilot_snr_db{ue=\"" << i << "\"} " << s.pilot_snr_db[i]
+           << "\n";
+    }
+    write_header(ss, "agora_ue_evm_percent", "gauge",
+        "Constellation EVM of the last retired frame");
+    for (size_t i = 0; i < s.num_ues; i++) {
+        ss << "agora_ue_evm_percent{ue=\"" << i << "\"} " << s.evm_percent[i]
+           << "\n";
+    }
+    write_header(ss, "agora_ue_decoded_blocks_total", "counter",
+        "Decoded code blocks");
+    for (size_t i = 0; i < s.num_ues; i++) {
+        ss << "agora_ue_decoded_blocks_total{ue=\"" << i << "\"} "
+           << s.decoded_blocks[i] << "\n";
+    }
+    write_header(ss, "agora_ue_block_errors_total", "counter",
+        "Decoded code blocks with errors");
+    for (size_t i = 0; i < s.num_ues; i++) {
+        ss << "agora_ue_block_errors_total{ue=\"" << i << "\"} "
+           << s.block_errors[i] << "\n";
+    }
+
+    write_header(ss, "agora_rx_dropped_packets_total", "counter",
+        "Uplink packets dropped or replaced with zeros");
+    const std::pair<const char*, size_t> drops[]
+        = { { "zero_filled", s.rx_drop_stat.num_zero_filled },
+              { "late", s.rx_drop_stat.num_late },
+              { "duplicate", s.rx_drop_stat.num_duplicate },
+              { "beyond_window", s.rx_drop_stat.num_beyond_window },
+              { "shed", s.overload_stat.num_shed_pkts },
+              { "rx_overflow", s.overload_stat.num_rx_overflow_pkts } };
+    for (const auto& drop : drops) {
+        ss << "agora_rx_dropped_packets_total{reason=\"" << drop.first
+           << "\"} " << drop.second << "\n";
+    }
+    write_header(ss, "agora_shed_frames_total", "counter",
+        "Frames shed in overload shedding mode");
+    ss << "agora_shed_frames_total " << s.overload_stat.num_shed_frames << "\n";
+
+    return ss.str();
+}
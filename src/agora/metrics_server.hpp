@@ -0,0 +1,87 @@
+/**
+ * @file metrics_server.hpp
+ * @brief A local HTTP endpoint that serves Agora's runtime metrics in the
+ * Prometheus text exposition format
+ *
+ * The master thread periodically fills a MetricsSnapshot from Stats,
+ * PhyStats, and its own queues, and publishes it with publish(). The
+ * snapshot is guarded by a sequence lock, so neither the master thread nor
+ * the workers ever wait for the metrics thread. The metrics thread copies the
+ * latest snapshot when a scraper connects, and formats it there.
+ */
+#ifndef METRICS_SERVER
+#define METRICS_SERVER
+
+#include "Symbols.hpp"
+#include "stats.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Number of most recently completed frames over which frame latency
+// percentiles are computed
+static constexpr size_t kMetricsLatencyWindow = 256;
+
+struct MetricsSnapshot {
+    size_t num_frames_done; // Frames retired since Agora started
+    size_t frame_lag; // Newest received frame minus oldest in-flight frame
+
+    // Tasks completed and their total duration, summed over workers
+    size_t task_count[kNumDoerTypes];
+    double task_seconds[kNumDoerTypes];
+
+    // Approximate number of queued events of each type for workers, and of
+    // completions for the master thread
+    size_t queue_depth[kNumEventTypes];
+    size_t complete_queue_depth;
+
+    // Latency from the first pilot packet until retirement of the last
+    // num_latencies frames
+    size_t num_latencies;
+    double frame_latency_us[kMetricsLatencyWindow];
+
+    // Per-UE PHY statistics. SNR and EVM are of the last retired frame, and
+    // block counts are totals since Agora started.
+    size_t num_ues;
+    float pilot_snr_db[kMaxUEs];
+    float evm_percent[kMaxUEs];
+    size_t decoded_blocks[kMaxUEs];
+    size_t block_errors[kMaxUEs];
+
+    RxDropStat rx_drop_stat;
+    OverloadStat overload_stat;
+};
+
+class MetricsServer {
+public:
+    // The master thread publishes a snapshot at this interval
+    static constexpr size_t kPublishIntervalMs = 100;
+
+    /// Start the metrics thread, serving on [port] of the loopback interface
+    MetricsServer(size_t port);
+    ~MetricsServer();
+
+    /// Make [snapshot] the one served to scrapers. Only one thread may
+    /// publish.
+    void publish(const MetricsSnapshot& snapshot);
+
+    /// Return the metrics in [snapshot] in Prometheus text format
+    static std::string format(const MetricsSnapshot& snapshot);
+
+private:
+    /// Copy the latest published snapshot to [snapshot]
+    void read_snapshot(MetricsSnapshot& snapshot);
+
+    /// Accept scraper connections until the server is destroyed
+    void run();
+
+    const size_t port_;
+    int listen_fd_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    std::atomic<size_t> seq_; // Odd while a snapshot is being published
+    MetricsSnapshot snapshot_;
+};
+
+#endif /* METRICS_SERVER */
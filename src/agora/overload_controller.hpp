@@ -0,0 +1,132 @@
+/**
+ * @file overload_controller.hpp
+ * @brief Frame shedding decisions for the Agora master thread
+ *
+ * When Agora falls behind, e.g., after a transient CPU hiccup, packets of new
+ * frames arrive while old frames are still in flight. Instead of stopping,
+ * the master sheds the oldest in-flight frames: their queued packets are
+ * released, their counters are reset, and they are retired without being
+ * processed further, so Agora catches up with the newest frames.
+ *
+ * OverloadController detects backlog from the lag between the newest and the
+ * oldest in-flight frame and from the worker queue depth. It also remembers
+ * which frames were shed, so that the master can ignore late packets and
+ * completions of tasks that were already queued for those frames.
+ *
+ * Tasks queued for a shed frame still run and write to the buffers of the
+ * frame's slot. OverloadController counts the queued tasks of each slot, so
+ * that the master does not let a newer frame reuse the slot before the tasks
+ * of the previous frame in it have completed.
+ *
+ * OverloadController is not thread-safe; only the master thread may use it.
+ */
+#ifndef OVERLOAD_CONTROLLER
+#define OVERLOAD_CONTROLLER
+
+#include "Symbols.hpp"
+#include "utils.h"
+#include <array>
+
+class OverloadController {
+public:
+    void init(size_t max_frame_lag, size_t max_queue_depth)
+    {
+        rt_assert(max_frame_lag >= 1 && max_frame_lag <= kFrameWnd,
+            "OverloadController: Invalid frame lag");
+        max_frame_lag_ = max_frame_lag;
+        max_queue_depth_ = max_queue_depth;
+        shed_frame_.fill(SIZE_MAX);
+        task_frame_.fill(SIZE_MAX);
+        tasks_in_flight_.fill(0);
+        newest_frame_ = 0;
+    }
+
+    /// Record that a packet of frame [frame_id] was received. Return true iff
+    /// it is the first packet of a frame newer than all previous frames.
+    /// Frame 0 is never reported, as there is nothing to shed before it.
+    bool update_newest_frame(size_t frame_id)
+    {
+        if (frame_id <= newest_frame_)
+            return false;
+        newest_frame_ = frame_id;
+        return true;
+    }
+
+    /// Return true iff the newest frame lags too far behind the oldest
+    /// in-flight frame [oldest_frame]
+    bool frame_lag_exceeded(size_t oldest_frame) const
+    {
+        return newest_frame_ >= oldest_frame + max_frame_lag_;
+    }
+
+    /// Return true iff [queue_depth] queued worker tasks is too many
+    bool queue_depth_exceeded(size_t queue_depth) const
+    {
+        return max_queue_depth_ > 0 && queue_depth > max_queue_depth_;
+    }
+
+    /// Remember that frame [frame_id] was shed. If tasks of an earlier shed
+    /// frame in the same slot are still in flight, frame [frame_id] has no
+    /// tasks, and the earlier frame stays marked so that the master keeps
+    /// ignoring their completions.
+    void mark_shed(size_t frame_id)
+    {
+        if (!slot_busy(frame_id))
+            shed_frame_[frame_id % kFrameWnd] = frame_id;
+    }
+
+    /// Return true iff frame [frame_id] was shed. This is accurate until a
+    /// frame that reuses the same slot is shed.
+    bool is_shed(size_t frame_id) const
+    {
+        return shed_frame_[frame_id % kFrameWnd] == frame_id;
+    }
+
+    /// Record that a task of frame [frame_id] was queued for a worker or a
+    /// socket thread
+    void task_queued(size_t frame_id)
+    {
+        const size_t frame_slot = frame_id % kFrameWnd;
+        task_frame_[frame_slot] = frame_id;
+        tasks_in_flight_[frame_slot]++;
+    }
+
+    /// Record that a task of frame [frame_id] completed, including tasks of
+    /// shed frames whose completions the master ignores
+    void task_completed(size_t frame_id)
+    {
+        const size_t frame_slot = frame_id % kFrameWnd;
+        rt_assert(tasks_in_flight_[frame_slot] > 0,
+            "OverloadController: Task completed but none is in flight");
+        tasks_in_flight_[frame_slot]--;
+    }
+
+    /// Return true iff tasks of an earlier frame in the slot of frame
+    /// [frame_id] are still in flight, so frame [frame_id] must not use the
+    /// slot's buffers yet
+    bool slot_busy(size_t frame_id) const
+    {
+        const size_t frame_slot = frame_id % kFrameWnd;
+        return tasks_in_flight_[frame_slot] > 0
+            && task_frame_[frame_slot] != frame_id;
+    }
+
+    size_t newest_frame() const { return newest_frame_; }
+
+private:
+    size_t max_frame_lag_;
+    size_t max_queue_depth_;
+
+    // shed_frame_[i % kFrameWnd] is i if frame i was shed
+    std::array<size_t, kFrameWnd> shed_frame_;
+
+    // task_frame_[i % kFrameWnd] is the frame of the last task queued in
+    // slot i, and tasks_in_flight_[i % kFrameWnd] is the number of queued
+    // tasks in slot i that have not completed yet
+    std::array<size_t, kFrameWnd> task_frame_;
+    std::array<size_t, kFrameWnd> tasks_in_flight_;
+
+    size_t newest_frame_; // The newest frame with a received packet
+};
+
+#endif /* OVERLOAD_CONTROLLER */
@@ -67,6 +67,30 @@ float PhyStats::get_evm_snr(size_t frame_id, size_t ue_id)
     return -10 * std::log10(evm);
 }
 
+float PhyStats::get_evm(size_t frame_id, size_t ue_id)
+{
+    float evm = evm_buffer_[frame_id % kFrameWnd][ue_id];
+    return 100 * sqrt(evm) / config_->OFDM_DATA_NUM;
+}
+
+float PhyStats::get_pilot_snr(size_t frame_id, size_t ue_id)
+{
+    return pilot_snr_[frame_id % kFrameWnd][ue_id];
+}
+
+void PhyStats::get_block_stats(
+    size_t ue_id, size_t& num_blocks, size_t& num_errors)
+{
+    const size_t task_buffer_symbol_num_ul
+        = config_->ul_data_symbol_num_perframe * kFrameWnd;
+    num_blocks = 0;
+    num_errors = 0;
+    for (size_t i = 0; i < task_buffer_symbol_num_ul; i++) {
+        num_blocks += decoded_blocks_count_[ue_id][i];
+        num_errors += block_error_count_[ue_id][i];
+    }
+}
+
 void PhyStats::print_snr_stats(size_t frame_id)
 {
     std::stringstream ss;
@@ -22,6 +22,16 @@ public:
     void print_evm_stats(size_t);
     void update_pilot_snr(size_t, size_t, complex_float*);
     float get_evm_snr(size_t frame_id, size_t ue_id);
+
+    /// Return the constellation EVM of a UE in a frame, in percent
+    float get_evm(size_t frame_id, size_t ue_id);
+
+    /// Return the pilot SNR of a UE in a frame, in dB
+    float get_pilot_snr(size_t frame_id, size_t ue_id);
+
+    /// Get the number of code blocks decoded for a UE, and the number with
+    /// errors
+    void get_block_stats(size_t ue_id, size_t& num_blocks, size_t& num_errors);
     void print_snr_stats(size_t);
 
 private:
@@ -0,0 +1,226 @@
+/**
+ * @file precode.hpp
+ * @brief SIMD kernels for downlink modulation and precoding in DoPrecode
+ *
+ * The kernels multiply one subcarrier's column-major bs_ant_num x ue_num
+ * precoder with the subcarrier's modulated data for all UEs. Precoding is
+ * vectorized across antennas: a column of the precoder (one UE, all
+ * antennas) is contiguous in memory, and is multiplied with the broadcast
+ * data sample of that UE.
+ *
+ * Only kernels specialized for common array sizes are provided here. Other
+ * sizes use the generic Armadillo or MKL JIT path in DoPrecode.
+ *
+ * modulate_block_avx2() produces the kernels' data input for a block of
+ * subcarriers at once.
+ */
+#ifndef PRECODE
+#define PRECODE
+
+#include "buffer.hpp"
+#include <algorithm>
+#include <immintrin.h>
+#include <string.h>
+
+/**
+ * Precode one subcarrier.
+ *
+ * @param precoder Column-major bs_ant_num x ue_num precoder
+ * @param data Modulated data of each UE
+ * @param precoded Output, the precoded sample of each antenna
+ */
+typedef void (*PrecodeScFn)(const complex_float* precoder,
+    const complex_float* data, complex_float* precoded);
+
+/// Precoding kernel specialized for [kAnts] antennas and [kUEs] UEs. The
+/// accumulators of up to four vectors of antennas stay in registers during
+/// one pass over the UEs.
+template <size_t kAnts, size_t kUEs>
+static inline void precode_sc_fixed_avx2(const complex_float* precoder,
+    const complex_float* data, complex_float* precoded)
+{
+    static constexpr size_t kAntsPerVector = 4;
+    static_assert(kAnts % kAntsPerVector == 0, "Unsupported antenna count");
+    static constexpr size_t kNumVectors = kAnts / kAntsPerVector;
+    static constexpr size_t kVectorsPerPass = kNumVectors < 4 ? kNumVectors : 4;
+    const float* w = reinterpret_cast<const float*>(precoder);
+    const float* x = reinterpret_cast<const float*>(data);
+
+    for (size_t v0 = 0; v0 < kNumVectors; v0 += kVectorsPerPass) {
+        // acc_a = (w_re * x_re, w_im * x_re), acc_b = (w_im * x_im,
+        // w_re * x_im), summed over UEs
+        __m256 acc_a[kVectorsPerPass], acc_b[kVectorsPerPass];
+        for (size_t v = 0; v < kVectorsPerPass; v++) {
+            acc_a[v] = _mm256_setzero_ps();
+            acc_b[v] = _mm256_setzero_ps();
+        }
+        for (size_t u = 0; u < kUEs; u++) {
+            const __m256 x_re = _mm256_broadcast_ss(x + 2 * u);
+            const __m256 x_im = _mm256_broadcast_ss(x + 2 * u + 1);
+            const float* w_u = w + 2 * (u * kAnts + v0 * kAntsPerVector);
+            for (size_t v = 0; v < kVectorsPerPass; v++) {
+                const __m256 w_v
+                    = _mm256_loadu_ps(w_u + 2 * v * kAntsPerVector);
+                acc_a[v] = _mm256_fmadd_ps(w_v, x_re, acc_a[v]);
+                acc_b[v] = _mm256_fmadd_ps(
+                    _mm256_permute_ps(w_v, 0xb1), x_im, acc_b[v]);
+            }
+        }
+        float* y = reinterpret_cast<float*>(precoded + v0 * kAntsPerVector);
+        for (size_t v = 0; v < kVectorsPerPass; v++) {
+            _mm256_storeu_ps(y + 2 * v * kAntsPerVector,
+                _mm256_addsub_ps(acc_a[v], acc_b[v]));
+        }
+    }
+}
+
+/**
+ * Precode one subcarrier for antennas [ant_start, ant_start + num_ants) only,
+ * for any antenna and UE counts. This is used by the fused precoding and IFFT
+ * stage, where each task owns a block of antennas.
+ *
+ * @param precoder Column-major bs_ant_num x ue_num precoder
+ * @param data Modulated data of each UE
+ * @param precoded Output, the precoded sample of each of the num_ants
+ * antennas
+ */
+static inline void precode_sc_ants_avx2(const complex_float* precoder,
+    const complex_float* data, size_t bs_ant_num, size_t ue_num,
+    size_t ant_start, size_t num_ants, complex_float* precoded)
+{
+    static constexpr size_t kAntsPerVector = 4;
+    const float* x = reinterpret_cast<const float*>(data);
+    const __m256i lane_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (size_t a = 0; a < num_ants; a += kAntsPerVector) {
+        // The last vector may hold fewer than kAntsPerVector antennas
+        const size_t n = std::min(kAntsPerVector, num_ants - a);
+        const __m256i mask
+            = _mm256_cmpgt_epi32(_mm256_set1_epi32(2 * n), lane_idx);
+        __m256 acc_a = _mm256_setzero_ps();
+        __m256 acc_b = _mm256_setzero_ps();
+        for (size_t u = 0; u < ue_num; u++) {
+            const __m256 w = _mm256_maskload_ps(reinterpret_cast<const float*>(
+                                                    precoder + u * bs_ant_num
+                                                    + ant_start + a),
+                mask);
+            acc_a = _mm256_fmadd_ps(w, _mm256_broadcast_ss(x + 2 * u), acc_a);
+            acc_b = _mm256_fmadd_ps(_mm256_permute_ps(w, 0xb1),
+                _mm256_broadcast_ss(x + 2 * u + 1), acc_b);
+        }
+        _mm256_maskstore_ps(reinterpret_cast<float*>(precoded + a), mask,
+            _mm256_addsub_ps(acc_a, acc_b));
+    }
+}
+
+// Return subcarriers [sc_id, sc_id + 4) of one UE, modulated from the table
+// indices [raw] where [data_mask] is set, and the UE's [pilots] elsewhere
+static inline __m256d modulate_sc4_avx2(const int8_t* raw,
+    const complex_float* pilots, size_t sc_id, const complex_float* mod_table,
+    __m256d data_mask)
+{
+    const __m256d pilot
+        = _mm256_loadu_pd(reinterpret_cast<const double*>(pilots + sc_id));
+    // Skip the gather in pilot symbols, where all subcarriers are pilots
+    if (_mm256_movemask_pd(data_mask) == 0)
+        return pilot;
+    int32_t idx;
+    memcpy(&idx, raw + sc_id, sizeof(idx));
+    return _mm256_mask_i64gather_pd(pilot,
+        reinterpret_cast<const double*>(mod_table),
+        _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(idx)), data_mask, 8);
+}
+
+/**
+ * Modulate [num_scs] subcarriers starting at [base_sc_id] for each of
+ * [ue_num] UEs, and write them in the layout of PrecodeScFn's data input:
+ * the samples of all UEs for one subcarrier are contiguous, at
+ * out[sc * ue_num + ue] for the sc-th subcarrier of the block.
+ *
+ * Four subcarriers of a UE are modulated with one table gather. Pilot
+ * subcarriers are masked out of the gather, which keeps the UE-specific
+ * pilots loaded as its source. Groups of four UEs are then transposed to the
+ * output layout in registers.
+ *
+ * @param raw Modulation table indices of the symbol, with UE u's subcarrier
+ * sc at raw[u * raw_stride + sc]
+ * @param pilots UE-specific pilots of each UE, indexed by subcarrier
+ * @param pilot_sc_flags 1 for pilot subcarriers of the block, 0 otherwise
+ * @param mod_table Modulated sample of each table index
+ */
+static inline void modulate_block_avx2(const int8_t* raw, size_t raw_stride,
+    const complex_float* const* pilots, size_t base_sc_id,
+    const size_t* pilot_sc_flags, const complex_float* mod_table,
+    size_t ue_num, size_t num_scs, complex_float* out)
+{
+    static constexpr size_t kSCsPerVector = 4;
+    auto* y = reinterpret_cast<double*>(out);
+
+    size_t sc = 0;
+    for (; sc + kSCsPerVector <= num_scs; sc += kSCsPerVector) {
+        const size_t sc_id = base_sc_id + sc;
+        const __m256d data_mask = _mm256_castsi256_pd(_mm256_cmpeq_epi64(
+            _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(pilot_sc_flags + sc)),
+            _mm256_setzero_si256()));
+        double* y_sc = y + sc * ue_num;
+
+        size_t u = 0;
+        for (; u + 4 <= ue_num; u += 4) {
+            // v[k] holds the four subcarriers of UE u + k
+            __m256d v[4];
+            for (size_t k = 0; k < 4; k++) {
+                v[k] = modulate_sc4_avx2(raw + (u + k) * raw_stride,
+                    pilots[u + k], sc_id, mod_table, data_mask);
+            }
+            const __m256d t0 = _mm256_unpacklo_pd(v[0], v[1]);
+            const __m256d t1 = _mm256_unpackhi_pd(v[0], v[1]);
+            const __m256d t2 = _mm256_unpacklo_pd(v[2], v[3]);
+            const __m256d t3 = _mm256_unpackhi_pd(v[2], v[3]);
+            _mm256_storeu_pd(y_sc + u, _mm256_permute2f128_pd(t0, t2, 0x20));
+            _mm256_storeu_pd(
+                y_sc + ue_num + u, _mm256_permute2f128_pd(t1, t3, 0x20));
+            _mm256_storeu_pd(
+                y_sc + 2 * ue_num + u, _mm256_permute2f128_pd(t0, t2, 0x31));
+            _mm256_storeu_pd(
+                y_sc + 3 * ue_num + u, _mm256_permute2f128_pd(t1, t3, 0x31));
+        }
+        for (; u < ue_num; u++) {
+            alignas(32) double v[kSCsPerVector];
+            _mm256_store_pd(v,
+                modulate_sc4_avx2(raw + u * raw_stride, pilots[u], sc_id,
+                    mod_table, data_mask));
+            for (size_t j = 0; j < kSCsPerVector; j++)
+                y_sc[j * ue_num + u] = v[j];
+        }
+    }
+
+    for (; sc < num_scs; sc++) {
+        const size_t sc_id = base_sc_id + sc;
+        for (size_t u = 0; u < ue_num; u++) {
+            out[sc * ue_num + u] = pilot_sc_flags[sc] == 1
+                ? pilots[u][sc_id]
+                : mod_table[static_cast<uint8_t>(raw[u * raw_stride + sc_id])];
+        }
+    }
+}
+
+/// Return the specialized precoding kernel for [bs_ant_num] antennas and
+/// [ue_num] UEs, or nullptr if there is none. Specializations exist for
+/// 8x4, 16x8, 32x8, 64x16, and 64x32 (antennas x UEs).
+static inline PrecodeScFn select_precode_sc_fn(size_t bs_ant_num, size_t ue_num)
+{
+    if (bs_ant_num == 8 && ue_num == 4)
+        return precode_sc_fixed_avx2<8, 4>;
+    if (bs_ant_num == 16 && ue_num == 8)
+        return precode_sc_fixed_avx2<16, 8>;
+    if (bs_ant_num == 32 && ue_num == 8)
+        return precode_sc_fixed_avx2<32, 8>;
+    if (bs_ant_num == 64 && ue_num == 16)
+        return precode_sc_fixed_avx2<64, 16>;
+    if (bs_ant_num == 64 && ue_num == 32)
+        return precode_sc_fixed_avx2<64, 32>;
+    return nullptr;
+}
+
+#endif /* PRECODE */
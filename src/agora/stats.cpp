@@ -1,4 +1,6 @@
 #include "stats.hpp"
+#include <cmath>
+#include <sstream>
 #include <typeinfo>
 
 Stats::Stats(Config* cfg, size_t break_down_num, double freq_ghz)
@@ -12,6 +14,7 @@ Stats::Stats(Config* cfg, size_t break_down_num, double freq_ghz)
     , freq_ghz(freq_ghz)
     , creation_tsc(rdtsc())
 {
+    num_frames_done = 0;
     rt_assert(
         break_down_num <= kMaxStatBreakdown, "Statistics breakdown too high");
     frame_start.calloc(config_->socket_thread_num, kNumStatsFrames, 64);
@@ -67,6 +70,9 @@ void Stats::update_stats_in_functions_uplink(size_t frame_id)
 {
     last_frame_id = frame_id;
     size_t frame_slot = frame_id % kNumStatsFrames;
+    frame_latency_us[frame_slot]
+        = master_get_us_since(TsType::kPilotRX, frame_id);
+    num_frames_done++;
     if (!kIsWorkerTimingEnabled)
         return;
 
@@ -117,10 +123,18 @@ void Stats::update_stats_in_functions_uplink(size_t frame_id)
     }
 }
 
+void Stats::mark_frame_shed(size_t frame_id)
+{
+    frame_latency_us[frame_id % kNumStatsFrames] = NAN;
+}
+
 void Stats::update_stats_in_functions_downlink(size_t frame_id)
 {
     last_frame_id = (size_t)frame_id;
     size_t frame_slot = frame_id % kNumStatsFrames;
+    frame_latency_us[frame_slot]
+        = master_get_us_since(TsType::kPilotRX, frame_id);
+    num_frames_done++;
     if (!kIsWorkerTimingEnabled)
         return;
 
@@ -530,9 +544,83 @@ size_t Stats::get_total_task_count(DoerType doer_type, size_t thread_num)
     return total_count;
 }
 
+DurationStat Stats::get_total_duration_stat(DoerType doer_type)
+{
+    DurationStat total;
+    for (size_t i = 0; i < task_thread_num; i++) {
+        DurationStat* ds = get_duration_stat(doer_type, i);
+        total.task_count += ds->task_count;
+        for (size_t j = 0; j < kMaxStatBreakdown; j++)
+            total.task_duration[j] += ds->task_duration[j];
+    }
+    return total;
+}
+
+void Stats::print_decode_iter_summary()
+{
+    DecodeIterStat total;
+    size_t num_blocks = 0;
+    size_t num_iters = 0;
+    for (size_t i = 0; i < task_thread_num; i++) {
+        const DecodeIterStat* s = get_decode_iter_stat(i);
+        for (size_t j = 0; j < kDecodeIterHistSize; j++) {
+            total.iter_hist[j] += s->iter_hist[j];
+            num_blocks += s->iter_hist[j];
+            num_iters += j * s->iter_hist[j];
+        }
+        total.num_crc_passed += s->num_crc_passed;
+        total.num_crc_failed += s->num_crc_failed;
+        total.num_budget_limited += s->num_budget_limited;
+    }
+    if (num_blocks == 0)
+        return;
+
+    std::stringstream ss;
+    ss << "Stats: LDPC decoder iterations (avg "
+       << 1.0 * num_iters / num_blocks << "), codeblocks per iteration count:";
+    for (size_t j = 0; j < kDecodeIterHistSize; j++) {
+        if (total.iter_hist[j] > 0)
+            ss << " " << j << ": " << total.iter_hist[j];
+    }
+    printf("%s\n", ss.str().c_str());
+    if (config_->LDPC_config.cbCrc) {
+        printf("Stats: Codeblock CRC passed %zu, failed %zu\n",
+            total.num_crc_passed, total.num_crc_failed);
+    }
+    if (config_->LDPC_config.adaptiveIter) {
+        printf("Stats: %zu codeblocks decoded with a reduced iteration "
+               "budget\n",
+            total.num_budget_limited);
+    }
+}
+
 void Stats::print_summary()
 {
     printf("Stats: total processed frames %zu\n", last_frame_id + 1);
+    if (config_->zf_tracking_mode) {
+        ZFTrackingStat total;
+        for (size_t i = 0; i < task_thread_num; i++) {
+            total.num_reused += get_zf_tracking_stat(i)->num_reused;
+            total.num_refined += get_zf_tracking_stat(i)->num_refined;
+            total.num_full += get_zf_tracking_stat(i)->num_full;
+        }
+        printf("Stats: ZF tracking reused %zu, refined %zu, and fully "
+               "computed %zu zeroforcing subcarriers\n",
+            total.num_reused, total.num_refined, total.num_full);
+    }
+    print_decode_iter_summary();
+    if (config_->rx_deadline_us > 0) {
+        printf("Stats: RX deadline zero-filled %zu packets, dropped %zu "
+               "late, %zu duplicate, and %zu beyond-window packets\n",
+            rx_drop_stat.num_zero_filled, rx_drop_stat.num_late,
+            rx_drop_stat.num_duplicate, rx_drop_stat.num_beyond_window);
+    }
+    if (config_->overload_shedding) {
+        printf("Stats: Overload shedding dropped %zu frames, %zu packets of "
+               "shed frames, and %zu packets at full socket buffers\n",
+            overload_stat.num_shed_frames, overload_stat.num_shed_pkts,
+            overload_stat.num_rx_overflow_pkts);
+    }
     if (!kIsWorkerTimingEnabled) {
         printf("Stats: Worker timing is disabled. Not printing summary\n");
         return;
@@ -19,6 +19,50 @@ struct DurationStat {
     void reset() { memset(this, 0, sizeof(DurationStat)); }
 };
 
+// Number of zeroforcing subcarriers for which a worker thread reused, refined,
+// or fully recomputed the zeroforcing matrices in ZF tracking mode
+struct ZFTrackingStat {
+    size_t num_reused;
+    size_t num_refined;
+    size_t num_full;
+    ZFTrackingStat() { reset(); }
+    void reset() { memset(this, 0, sizeof(ZFTrackingStat)); }
+};
+
+// Number of buckets in the LDPC decoder iteration histogram. Codeblocks that
+// take more iterations are counted in the last bucket.
+static constexpr size_t kDecodeIterHistSize = 32;
+
+// Number of codeblocks that a worker thread decoded with each number of LDPC
+// decoder iterations, and the results of their CRC checks
+struct DecodeIterStat {
+    size_t iter_hist[kDecodeIterHistSize];
+    size_t num_crc_passed;
+    size_t num_crc_failed;
+    size_t num_budget_limited; // Decoded with a reduced iteration budget
+    DecodeIterStat() { reset(); }
+    void reset() { memset(this, 0, sizeof(DecodeIterStat)); }
+};
+
+// Uplink packets that the master thread replaced with zeros or dropped
+struct RxDropStat {
+    size_t num_zero_filled; // Still missing at the frame's RX deadline
+    size_t num_late; // Arrived after the frame's RX deadline
+    size_t num_duplicate;
+    size_t num_beyond_window; // Arrived for a frame beyond the frame window
+    RxDropStat() { reset(); }
+    void reset() { memset(this, 0, sizeof(RxDropStat)); }
+};
+
+// Frames and packets dropped in overload shedding mode
+struct OverloadStat {
+    size_t num_shed_frames;
+    size_t num_shed_pkts; // Received for frames that were shed
+    size_t num_rx_overflow_pkts; // Discarded by socket threads
+    OverloadStat() { reset(); }
+    void reset() { memset(this, 0, sizeof(OverloadStat)); }
+};
+
 // Temporary summary statistics assembled from per-thread runtime stats
 struct FrameSummary {
     double us_this_thread[kMaxStatBreakdown];
@@ -65,6 +109,10 @@ public:
     /// stats for all downlink Doer types. Else return immediately.
     void update_stats_in_functions_downlink(size_t frame_id);
 
+    /// Record that frame [frame_id] was retired without being processed
+    /// because it was shed. It is not counted as done and has no latency.
+    void mark_frame_shed(size_t frame_id);
+
     /// Save master timestamps to a file. If worker stats collection is enabled,
     /// also save detailed worker timing info to a file.
     void save_to_file();
@@ -74,6 +122,16 @@ public:
 
     size_t last_frame_id;
 
+    /// Number of frames retired since Agora started
+    size_t num_frames_done;
+
+    /// From the master, get the microseconds from the first pilot packet of
+    /// a retired frame until its retirement. This is NaN for shed frames.
+    double get_frame_latency_us(size_t frame_id)
+    {
+        return frame_latency_us[frame_id % kNumStatsFrames];
+    }
+
     /// From the master, set the RDTSC timestamp for a frame ID and timestamp
     /// type
     void master_set_tsc(TsType timestamp_type, size_t frame_id)
@@ -173,6 +231,28 @@ public:
                     .duration_stat[static_cast<size_t>(doer_type)];
     }
 
+    /// Get the task count and duration of DoerType doer_type summed over all
+    /// worker threads
+    DurationStat get_total_duration_stat(DoerType doer_type);
+
+    /// Get the ZFTrackingStat object used by thread thread_id
+    ZFTrackingStat* get_zf_tracking_stat(size_t thread_id)
+    {
+        return &worker_durations[thread_id].zf_tracking_stat;
+    }
+
+    /// Get the DecodeIterStat object used by thread thread_id
+    DecodeIterStat* get_decode_iter_stat(size_t thread_id)
+    {
+        return &worker_durations[thread_id].decode_iter_stat;
+    }
+
+    /// Uplink packet drops. Updated only by the master thread.
+    RxDropStat rx_drop_stat;
+
+    /// Overload shedding counters. Updated only by the master thread.
+    OverloadStat overload_stat;
+
     /// Dimensions = number of packet RX threads x kNumStatsFrames.
     /// frame_start[i][j] is the RDTSC timestamp taken by thread i when it
     /// starts receiving frame j.
@@ -192,6 +272,10 @@ private:
 
     size_t get_total_task_count(DoerType doer_type, size_t thread_num);
 
+    // Print the LDPC decoder iteration histogram and CRC results summed over
+    // all worker threads
+    void print_decode_iter_summary();
+
     /* stats for the worker threads */
     void update_stats_in_dofft_bigstation(size_t frame_id, size_t thread_num,
         size_t thread_num_offset, FrameSummary* frame_summary_fft,
@@ -250,9 +334,14 @@ private:
     /// ("old") copies of all DurationStat objects.
     struct {
         DurationStat duration_stat[kNumDoerTypes];
+        ZFTrackingStat zf_tracking_stat;
+        DecodeIterStat decode_iter_stat;
         uint8_t false_sharing_padding[64];
     } worker_durations[kMaxThreads], worker_durations_old[kMaxThreads];
 
+    // Set by the master when a frame is retired
+    double frame_latency_us[kNumStatsFrames];
+
     double fft_us[kNumStatsFrames];
     double csi_us[kNumStatsFrames];
     double zf_us[kNumStatsFrames];
@@ -0,0 +1,106 @@
+#include "task_tracer.hpp"
+#include "buffer.hpp"
+#include "gettime.h"
+#include "utils.h"
+#include <signal.h>
+
+std::atomic<bool> TaskTracer::dump_requested_(false);
+
+static const char* event_type_name(EventType event_type)
+{
+    switch (event_type) {
+    case EventType::kFFT:
+        return "FFT";
+    case EventType::kZF:
+        return "ZF";
+    case EventType::kDemul:
+        return "Demul";
+    case EventType::kIFFT:
+        return "IFFT";
+    case EventType::kPrecode:
+        return "Precode";
+    case EventType::kDecode:
+        return "Decode";
+    case EventType::kEncode:
+        return "Encode";
+    default:
+        return "Other";
+    }
+}
+
+TaskTracer::TaskTracer(
+    size_t num_workers, size_t records_per_worker, double freq_ghz)
+    : rings_(num_workers)
+    , freq_ghz_(freq_ghz)
+    , base_tsc_(rdtsc())
+{
+    size_t num_records = 1;
+    while (num_records < records_per_worker)
+        num_records *= 2;
+
+    for (auto& ring : rings_) {
+        alloc_buffer_1d(&ring.records_, num_records, 64, 1);
+        ring.mask_ = num_records - 1;
+        ring.head_ = 0;
+    }
+    printf("TaskTracer: Recording up to %zu tasks per worker (%.1f MB)\n",
+        num_records,
+        num_workers * num_records * sizeof(TraceRecord) / (1024.0 * 1024));
+}
+
+TaskTracer::~TaskTracer()
+{
+    for (auto& ring : rings_)
+        free_buffer_1d(&ring.records_);
+}
+
+void TaskTracer::save(const std::string& filename)
+{
+    FILE* fp = fopen(filename.c_str(), "w");
+    if (fp == nullptr) {
+        fprintf(stderr, "TaskTracer: Failed to open %s\n", filename.c_str());
+        return;
+    }
+
+    size_t num_saved = 0;
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (size_t tid = 0; tid < rings_.size(); tid++) {
+        fprintf(fp,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,"
+            "\"args\":{\"name\":\"Worker %zu\"}}",
+            tid == 0 ? "" : ",\n", tid, tid);
+
+        const TraceRing& ring = rings_[tid];
+        const size_t head = ring.head_.load(std::memory_order_acquire);
+        const size_t num_records = std::min(head, ring.mask_ + 1);
+        for (size_t i = head - num_records; i < head; i++) {
+            const TraceRecord& rec = ring.records_[i & ring.mask_];
+            const gen_tag_t tag(rec.tag);
+            fprintf(fp,
+                ",\n{\"name\":\"%s\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":0,"
+                "\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u,"
+                "\"symbol\":%u,\"id\":%u}}",
+                event_type_name(rec.event_type), tid,
+                cycles_to_us(rec.start_tsc - base_tsc_, freq_ghz_),
+                cycles_to_us(rec.end_tsc - rec.start_tsc, freq_ghz_),
+                tag.frame_id, tag.symbol_id, tag.sc_id);
+        }
+        num_saved += num_records;
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    printf("TaskTracer: Saved %zu tasks to %s\n", num_saved, filename.c_str());
+}
+
+void TaskTracer::dump_signal_handler(int) { dump_requested_ = true; }
+
+void TaskTracer::install_signal_handler()
+{
+    if (signal(SIGUSR1, TaskTracer::dump_signal_handler) == SIG_ERR)
+        fprintf(stderr, "TaskTracer: Failed to install SIGUSR1 handler\n");
+}
+
+bool TaskTracer::dump_requested()
+{
+    return dump_requested_.exchange(false, std::memory_order_relaxed);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file task_tracer.hpp
+ * @brief Per-worker task timelines, exported as Chrome trace JSON
+ *
+ * Each worker thread owns a TraceRing, a fixed-size ring buffer of task
+ * records with the start and end TSC, event type, and tag of each task. Only
+ * the owning worker writes to its ring, so recording a task needs no locks or
+ * atomic read-modify-write instructions. When a ring is full, its oldest
+ * records are overwritten.
+ *
+ * TaskTracer::save() writes all rings to a Chrome trace event file that can
+ * be opened in chrome://tracing or https://ui.perfetto.dev. It may run while
+ * workers are still recording; records that are overwritten during the dump
+ * can be inconsistent.
+ */
+#ifndef TASK_TRACER
+#define TASK_TRACER
+
+#include "Symbols.hpp"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct TraceRecord {
+    uint64_t start_tsc;
+    uint64_t end_tsc;
+    uint64_t tag; // The gen_tag_t of the task's response
+    EventType event_type;
+};
+
+class alignas(64) TraceRing {
+public:
+    /// Record a task of [event_type] with response tag [tag]
+    inline void record(
+        EventType event_type, size_t tag, size_t start_tsc, size_t end_tsc)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        TraceRecord& rec = records_[head & mask_];
+        rec.start_tsc = start_tsc;
+        rec.end_tsc = end_tsc;
+        rec.tag = tag;
+        rec.event_type = event_type;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    friend class TaskTracer;
+
+    TraceRecord* records_ = nullptr;
+    size_t mask_ = 0; // Number of records minus one
+    std::atomic<size_t> head_; // Number of tasks recorded so far
+};
+
+class TaskTracer {
+public:
+    /// Create rings of at least [records_per_worker] records for
+    /// [num_workers] workers
+    TaskTracer(size_t num_workers, size_t records_per_worker, double freq_ghz);
+    ~TaskTracer();
+
+    TraceRing* ring(size_t worker_id) { return &rings_[worker_id]; }
+
+    /// Write the recorded tasks of all workers to [filename]
+    void save(const std::string& filename);
+
+    /// Make SIGUSR1 request a dump of the trace while Agora runs
+    static void install_signal_handler();
+
+    /// Return true iff a dump was requested with SIGUSR1 since the last call
+    static bool dump_requested();
+
+private:
+    static void dump_signal_handler(int);
+    static std::atomic<bool> dump_requested_;
+
+    std::vector<TraceRing> rings_;
+    const double freq_ghz_;
+    const size_t base_tsc_; // Timestamps are relative to this TSC
+};
+
+#endif /* TASK_TRACER */
@@ -16,6 +16,32 @@ PacketTXRX::PacketTXRX(Config* cfg, size_t core_offset)
     if (!kUseArgos && !kUseUHD) {
         socket_.resize(cfg->nRadios);
         bs_rru_sockaddr_.resize(cfg->nRadios);
+
+        const size_t batch_size = cfg->socket_batch_size;
+        rt_assert(batch_size >= 1 && batch_size <= kMaxSocketBatchSize,
+            "Socket batch size must be in [1, kMaxSocketBatchSize]");
+        rx_msgs_.resize(socket_thread_num);
+        rx_iovecs_.resize(socket_thread_num);
+        tx_msgs_.resize(socket_thread_num);
+        tx_iovecs_.resize(socket_thread_num);
+        for (size_t i = 0; i < socket_thread_num; i++) {
+            rx_msgs_[i].resize(batch_size);
+            rx_iovecs_[i].resize(batch_size);
+            tx_msgs_[i].resize(batch_size);
+            tx_iovecs_[i].resize(batch_size);
+            for (size_t j = 0; j < batch_size; j++) {
+                memset(&rx_msgs_[i][j], 0, sizeof(struct mmsghdr));
+                rx_msgs_[i][j].msg_hdr.msg_iov = &rx_iovecs_[i][j];
+                rx_msgs_[i][j].msg_hdr.msg_iovlen = 1;
+                rx_iovecs_[i][j].iov_len = cfg->packet_length;
+
+                memset(&tx_msgs_[i][j], 0, sizeof(struct mmsghdr));
+                tx_msgs_[i][j].msg_hdr.msg_iov = &tx_iovecs_[i][j];
+                tx_msgs_[i][j].msg_hdr.msg_iovlen = 1;
+                tx_msgs_[i][j].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                tx_iovecs_[i][j].iov_len = cfg->packet_length;
+            }
+        }
     } else {
         radioconfig_ = new RadioConfig(cfg);
     }
@@ -150,6 +176,31 @@ void* PacketTXRX::loop_tx_rx(int tid)
             else if (tx_frame_id > 500)
                 slow_start_factor = 1;
         }
+        if (cfg->socket_batch_size > 1) {
+            if (dequeue_send_batch(tid) > 0)
+                continue;
+            size_t num_pkts = recv_enqueue_batch(tid, radio_id, rx_offset);
+            if (num_pkts == 0)
+                continue;
+
+            if (kIsWorkerTimingEnabled) {
+                for (size_t i = 0; i < num_pkts; i++) {
+                    auto* pkt = reinterpret_cast<Packet*>(&(*buffer_)[tid][(
+                        rx_offset + i) * cfg->packet_length]);
+                    int frame_id = pkt->frame_id;
+                    if (frame_id > prev_frame_id) {
+                        rx_frame_start[frame_id % kNumStatsFrames] = rdtsc();
+                        prev_frame_id = frame_id;
+                    }
+                }
+            }
+            rx_offset = (rx_offset + num_pkts) % packet_num_in_buffer_;
+
+            if (++radio_id == radio_hi)
+                radio_id = radio_lo;
+            continue;
+        }
+
         if (-1 != dequeue_send(tid))
             continue;
         // receive data
@@ -179,8 +230,13 @@ struct Packet* PacketTXRX::recv_enqueue(int tid, int radio_id, int rx_offset)
     int* rx_buffer_status = (*buffer_status_)[tid];
     int packet_length = cfg->packet_length;
 
-    // if rx_buffer is full, exit
+    // if rx_buffer is full, exit, or drop packets until the master frees
+    // the buffer by shedding frames
     if (rx_buffer_status[rx_offset] == 1) {
+        if (cfg->overload_shedding) {
+            discard_packet(tid, radio_id);
+            return (NULL);
+        }
         printf("TXRX thread %d rx_buffer full, offset: %d\n", tid, rx_offset);
         cfg->running = false;
         return (NULL);
@@ -222,6 +278,147 @@ struct Packet* PacketTXRX::recv_enqueue(int tid, int radio_id, int rx_offset)
     return pkt;
 }
 
+void PacketTXRX::discard_packet(int tid, int radio_id)
+{
+    // A zero-length receive consumes one datagram
+    if (recv(socket_[radio_id], nullptr, 0, MSG_TRUNC) >= 0)
+        num_rx_overflow_pkts_[tid].fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t PacketTXRX::recv_enqueue_batch(int tid, int radio_id, size_t rx_offset)
+{
+    char* rx_buffer = (*buffer_)[tid];
+    int* rx_buffer_status = (*buffer_status_)[tid];
+    std::vector<struct mmsghdr>& msgs = rx_msgs_[tid];
+    std::vector<struct iovec>& iovecs = rx_iovecs_[tid];
+
+    // Receive into consecutive RX buffer slots, without wrapping around
+    const size_t num_slots = std::min(
+        cfg->socket_batch_size, packet_num_in_buffer_ - rx_offset);
+    size_t num_free_slots = 0;
+    for (; num_free_slots < num_slots; num_free_slots++) {
+        // if rx_buffer is full, exit, or receive into the free slots only
+        if (rx_buffer_status[rx_offset + num_free_slots] == 1) {
+            if (cfg->overload_shedding)
+                break;
+            printf("TXRX thread %d rx_buffer full, offset: %zu\n", tid,
+                rx_offset + num_free_slots);
+            cfg->running = false;
+            return 0;
+        }
+        iovecs[num_free_slots].iov_base
+            = &rx_buffer[(rx_offset + num_free_slots) * cfg->packet_length];
+    }
+    if (num_free_slots == 0) {
+        discard_packet(tid, radio_id);
+        return 0;
+    }
+
+    int num_pkts = recvmmsg(
+        socket_[radio_id], &msgs[0], num_free_slots, MSG_DONTWAIT, nullptr);
+    if (num_pkts == -1) {
+        if (errno != EAGAIN && cfg->running) {
+            perror("recvmmsg failed");
+            exit(0);
+        }
+        return 0;
+    }
+
+    // Push the packets to the master thread with one bulk enqueue, packing
+    // up to kMaxTags packets into each kPacketRX event
+    Event_data events[kMaxSocketBatchSize];
+    size_t num_events = 0;
+    for (size_t i = 0; i < static_cast<size_t>(num_pkts); i++) {
+        auto* pkt = reinterpret_cast<Packet*>(iovecs[i].iov_base);
+        if (kDebugPrintInTask) {
+            printf("In TXRX thread %d: Received frame %d, symbol %d, ant %d\n",
+                tid, pkt->frame_id, pkt->symbol_id, pkt->ant_id);
+        }
+        pkt->ant_id += pkt->cell_id * ant_per_cell;
+        rx_buffer_status[rx_offset + i] = 1;
+
+        if (i % Event_data::kMaxTags == 0) {
+            events[num_events] = Event_data(EventType::kPacketRX);
+            num_events++;
+        }
+        Event_data& event = events[num_events - 1];
+        event.tags[event.num_tags++] = rx_tag_t(tid, rx_offset + i)._tag;
+    }
+
+    if (!message_queue_->enqueue_bulk(*rx_ptoks_[tid], events, num_events)) {
+        printf("socket message enqueue failed\n");
+        exit(0);
+    }
+    return num_pkts;
+}
+
+size_t PacketTXRX::dequeue_send_batch(int tid)
+{
+    Event_data events[kMaxSocketBatchSize];
+    size_t num_events = task_queue_->try_dequeue_bulk_from_producer(
+        *tx_ptoks_[tid], events, cfg->socket_batch_size);
+    if (num_events == 0)
+        return 0;
+
+    // Each packet is sent from its antenna's socket, like in dequeue_send(),
+    // so order the packets by antenna to send each antenna's packets with one
+    // sendmmsg() call. The batch is small, so use insertion sort.
+    size_t ant_ids[kMaxSocketBatchSize];
+    size_t order[kMaxSocketBatchSize];
+    for (size_t i = 0; i < num_events; i++) {
+        assert(events[i].event_type == EventType::kPacketTX);
+        ant_ids[i] = gen_tag_t(events[i].tags[0]).ant_id;
+        size_t j = i;
+        for (; j > 0 && ant_ids[order[j - 1]] > ant_ids[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    std::vector<struct mmsghdr>& msgs = tx_msgs_[tid];
+    std::vector<struct iovec>& iovecs = tx_iovecs_[tid];
+    for (size_t i = 0; i < num_events; i++) {
+        const Event_data& event = events[order[i]];
+        size_t ant_id = gen_tag_t(event.tags[0]).ant_id;
+        size_t frame_id = gen_tag_t(event.tags[0]).frame_id;
+        size_t symbol_id = gen_tag_t(event.tags[0]).symbol_id;
+
+        size_t data_symbol_idx_dl
+            = cfg->get_dl_symbol_idx(frame_id, symbol_id);
+        size_t offset = (cfg->get_total_data_symbol_idx_dl(
+                             frame_id, data_symbol_idx_dl)
+                            * cfg->BS_ANT_NUM)
+            + ant_id;
+
+        char* cur_buffer_ptr = tx_buffer_ + offset * cfg->packet_length;
+        new (cur_buffer_ptr) Packet(frame_id, symbol_id, 0 /* cell_id */,
+            ant_id, cfg->fronthaul_comp_hdr());
+        iovecs[i].iov_base = cur_buffer_ptr;
+        msgs[i].msg_hdr.msg_name = &bs_rru_sockaddr_[ant_id];
+    }
+
+    size_t run_start = 0;
+    while (run_start < num_events) {
+        const size_t ant_id = ant_ids[order[run_start]];
+        size_t run_end = run_start + 1;
+        while (run_end < num_events && ant_ids[order[run_end]] == ant_id)
+            run_end++;
+
+        size_t num_sent = run_start;
+        while (num_sent < run_end) {
+            int ret = sendmmsg(
+                socket_[ant_id], &msgs[num_sent], run_end - num_sent, 0);
+            rt_assert(ret > 0 || errno == EAGAIN, "sendmmsg() failed");
+            if (ret > 0)
+                num_sent += ret;
+        }
+        run_start = run_end;
+    }
+
+    rt_assert(message_queue_->enqueue_bulk(*rx_ptoks_[tid], events, num_events),
+        "Socket message enqueue failed\n");
+    return num_events;
+}
+
 int PacketTXRX::dequeue_send(int tid)
 {
     auto& c = cfg;
@@ -251,7 +448,8 @@ int PacketTXRX::dequeue_send(int tid)
 
     char* cur_buffer_ptr = tx_buffer_ + offset * c->packet_length;
     auto* pkt = (Packet*)cur_buffer_ptr;
-    new (pkt) Packet(frame_id, symbol_id, 0 /* cell_id */, ant_id);
+    new (pkt) Packet(frame_id, symbol_id, 0 /* cell_id */, ant_id,
+        c->fronthaul_comp_hdr());
 
     // Send data (one OFDM symbol)
     ssize_t ret = sendto(socket_[ant_id], cur_buffer_ptr, c->packet_length, 0,
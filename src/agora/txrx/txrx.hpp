@@ -10,6 +10,8 @@
 #include "radio_lib.hpp"
 #include <algorithm>
 #include <arpa/inet.h>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <ctime>
@@ -25,18 +27,24 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <vector>
 
 #ifdef USE_DPDK
 #include "dpdk_transport.hpp"
 #endif
 
+#ifdef USE_XDP
+#include "xdp_slot_pool.hpp"
+#include <xdp/xsk.h>
+#endif
+
 /**
  * @brief Implementations of this class provide packet I/O for Agora.
  *
- * In the vanilla mode, this class provides socket or DPDK-based packet I/O to
- * Agora (running on the base station server or client) for communicating
- * with simulated peers.
+ * In the vanilla mode, this class provides socket, AF_XDP, or DPDK-based
+ * packet I/O to Agora (running on the base station server or client) for
+ * communicating with simulated peers.
  *
  * In the "Argos" mode, this class provides SoapySDR-based communication for
  * Agora (running on the base station server or client) for communicating
@@ -45,6 +53,9 @@
  */
 class PacketTXRX {
 public:
+    // Maximum number of packets received or sent in one recvmmsg/sendmmsg
+    static constexpr size_t kMaxSocketBatchSize = 64;
+
     PacketTXRX(Config* cfg, size_t in_core_offset = 1);
 
     PacketTXRX(Config* cfg, size_t core_offset,
@@ -60,6 +71,12 @@ public:
     uint16_t dpdk_recv(int tid, size_t& prev_frame_id, size_t& rx_offset);
 #endif
 
+#ifdef USE_XDP
+    // At thread [tid], receive packets from the AF_XDP socket and enqueue them
+    // to the master thread. Return the number of packets received.
+    size_t xdp_recv(int tid, size_t& prev_frame_id);
+#endif
+
     /**
      * @brief Start the network I/O threads
      *
@@ -76,11 +93,34 @@ public:
 
     void send_beacon(int tid, size_t frame_id);
 
+    // Return the number of packets that socket threads discarded because
+    // their RX buffer was full, in overload shedding mode
+    size_t get_num_rx_overflow_pkts() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < socket_thread_num; i++)
+            total += num_rx_overflow_pkts_[i].load(std::memory_order_relaxed);
+        return total;
+    }
+
 private:
     void* loop_tx_rx(int tid); // The thread function for thread [tid]
     int dequeue_send(int tid);
     struct Packet* recv_enqueue(int tid, int radio_id, int rx_offset);
 
+    // Discard one packet from radio [radio_id]'s socket at thread [tid],
+    // whose RX buffer is full
+    void discard_packet(int tid, int radio_id);
+
+    // Receive up to socket_batch_size packets from radio [radio_id] with one
+    // recvmmsg into consecutive RX buffer slots starting at [rx_offset], and
+    // enqueue them to the master thread. Return the number of packets.
+    size_t recv_enqueue_batch(int tid, int radio_id, size_t rx_offset);
+
+    // Send up to socket_batch_size packets, with one sendmmsg per antenna
+    // socket. Return the number of packets sent.
+    size_t dequeue_send_batch(int tid);
+
     void* loop_tx_rx_argos(int tid);
     int dequeue_send_argos(int tid);
     struct Packet* recv_enqueue_argos(int tid, int radio_id, int rx_offset);
@@ -115,12 +155,44 @@ private:
     std::vector<struct sockaddr_in> bs_rru_sockaddr_;
     std::vector<int> socket_;
 
+    // num_rx_overflow_pkts_[i] is the number of packets that socket thread i
+    // discarded because its RX buffer was full
+    std::array<std::atomic<size_t>, kMaxThreads> num_rx_overflow_pkts_ = {};
+
+    // Message headers for batched socket I/O, indexed by socket thread ID
+    std::vector<std::vector<struct mmsghdr>> rx_msgs_;
+    std::vector<std::vector<struct iovec>> rx_iovecs_;
+    std::vector<std::vector<struct mmsghdr>> tx_msgs_;
+    std::vector<std::vector<struct iovec>> tx_iovecs_;
+
 #ifdef USE_DPDK
     uint32_t bs_rru_addr; // IPv4 address of the simulator sender
     uint32_t bs_server_addr; // IPv4 address of the Agora server
     struct rte_mempool* mbuf_pool;
 #endif
 
+#ifdef USE_XDP
+    // Set up socket thread [tid]'s AF_XDP socket, with the thread's RX
+    // buffer as its UMEM
+    void xdp_init(int tid);
+
+    // Post free RX buffer slots of socket thread [tid] to its fill ring
+    void xdp_refill(int tid);
+
+    // State of a socket thread's AF_XDP socket. The UMEM frames are the
+    // slots of the thread's RX buffer.
+    struct XdpSocket {
+        struct xsk_umem* umem = nullptr;
+        struct xsk_socket* xsk = nullptr;
+        struct xsk_ring_prod fill;
+        struct xsk_ring_cons comp;
+        struct xsk_ring_cons rx;
+        XdpSlotPool slots; // Ownership of the RX buffer slots
+    };
+    std::vector<XdpSocket> xsks_;
+    uint32_t bs_server_addr; // IPv4 address of the Agora server
+#endif
+
     RadioConfig* radioconfig_; // Used only in Argos mode
 };
 
@@ -14,7 +14,24 @@ PacketTXRX::PacketTXRX(Config* cfg, size_t core_offset)
     , socket_thread_num(cfg->socket_thread_num)
 {
     DpdkTransport::dpdk_init(core_offset - 1, socket_thread_num);
-    mbuf_pool = DpdkTransport::create_mempool();
+
+    size_t num_mbufs = NUM_MBUFS;
+    if (cfg->dpdk_zero_copy) {
+        // In zero-copy mode, every received packet of the kFrameWnd frames in
+        // flight holds its mbuf until FFT. The NIC rings and the per-core
+        // caches hold additional mbufs.
+        const size_t num_rx_pkts_per_frame = cfg->BS_ANT_NUM
+            * (cfg->symbol_num_perframe - cfg->dl_data_symbol_num_perframe);
+        const size_t num_mbufs_needed = kFrameWnd * num_rx_pkts_per_frame
+            + socket_thread_num
+                * (RX_RING_SIZE + TX_RING_SIZE + kRxBatchSize
+                    + MBUF_CACHE_SIZE);
+        // Mempools are most memory-efficient with 2^n - 1 elements
+        while (num_mbufs < num_mbufs_needed)
+            num_mbufs = 2 * num_mbufs + 1;
+        printf("DPDK zero-copy RX: using %zu mbufs\n", num_mbufs);
+    }
+    mbuf_pool = DpdkTransport::create_mempool(num_mbufs);
 
     const uint16_t port_id = 0; // The DPDK port ID
     if (DpdkTransport::nic_init(port_id, mbuf_pool, socket_thread_num) != 0)
@@ -113,8 +130,16 @@ uint16_t PacketTXRX::dpdk_recv(
 
     for (size_t i = 0; i < nb_rx; i++) {
         // If the RX buffer is full, it means that the base station processing
-        // hasn't kept up, so exit.
-        if ((*buffer_status_)[tid][rx_offset] == 1) {
+        // hasn't kept up, so exit, or drop the packet while the master sheds
+        // frames. In zero-copy mode, the RX buffer is unused and the NIC drops
+        // packets if the mempool runs out of mbufs.
+        if (!cfg->dpdk_zero_copy and (*buffer_status_)[tid][rx_offset] == 1) {
+            if (cfg->overload_shedding) {
+                rte_pktmbuf_free(rx_bufs[i]);
+                num_rx_overflow_pkts_[tid].fetch_add(
+                    1, std::memory_order_relaxed);
+                continue;
+            }
             printf(
                 "TXRX thread %d rx_buffer full, offset: %zu\n", tid, rx_offset);
             cfg->running = false;
@@ -154,13 +179,25 @@ uint16_t PacketTXRX::dpdk_recv(
             continue;
         }
 
-        auto* payload = reinterpret_cast<uint8_t*>(eth_hdr) + kPayloadOffset;
-        auto* pkt = reinterpret_cast<Packet*>(
-            &(*buffer_)[tid][rx_offset * cfg->packet_length]);
-        DpdkTransport::fastMemcpy(
-            reinterpret_cast<uint8_t*>(pkt), payload, cfg->packet_length);
+        Packet* pkt;
+        size_t rx_tag;
+        if (cfg->dpdk_zero_copy) {
+            // Pass the mbuf on to the master thread. DoFFT reads the packet
+            // from the mbuf and frees it.
+            pkt = reinterpret_cast<Packet*>(
+                DpdkTransport::udp_payload(dpdk_pkt));
+            rx_tag = rx_tag_t(tid, reinterpret_cast<size_t>(dpdk_pkt))._tag;
+        } else {
+            auto* payload = DpdkTransport::udp_payload(dpdk_pkt);
+            pkt = reinterpret_cast<Packet*>(
+                &(*buffer_)[tid][rx_offset * cfg->packet_length]);
+            DpdkTransport::fastMemcpy(
+                reinterpret_cast<uint8_t*>(pkt), payload, cfg->packet_length);
 
-        rte_pktmbuf_free(rx_bufs[i]);
+            rte_pktmbuf_free(rx_bufs[i]);
+            rx_tag = rx_tag_t(tid, rx_offset)._tag;
+            rx_offset = (rx_offset + 1) % packet_num_in_buffer_;
+        }
 
         if (kIsWorkerTimingEnabled) {
             if (prev_frame_id == SIZE_MAX or pkt->frame_id > prev_frame_id) {
@@ -169,14 +206,11 @@ uint16_t PacketTXRX::dpdk_recv(
             }
         }
 
-        if (!message_queue_->enqueue(*rx_ptoks_[tid],
-                Event_data(
-                    EventType::kPacketRX, rx_tag_t(tid, rx_offset)._tag))) {
+        if (!message_queue_->enqueue(
+                *rx_ptoks_[tid], Event_data(EventType::kPacketRX, rx_tag))) {
             printf("Failed to enqueue socket message\n");
             exit(-1);
         }
-
-        rx_offset = (rx_offset + 1) % packet_num_in_buffer_;
     }
     return nb_rx;
 }
@@ -211,7 +245,8 @@ int PacketTXRX::dequeue_send(int tid)
 
     char* cur_buffer_ptr = tx_buffer_ + offset * c->packet_length;
     auto* pkt = (Packet*)cur_buffer_ptr;
-    new (pkt) Packet(frame_id, symbol_id, 0 /* cell_id */, ant_id);
+    new (pkt) Packet(frame_id, symbol_id, 0 /* cell_id */, ant_id,
+        c->fronthaul_comp_hdr());
 
     struct rte_mbuf* tx_bufs[kTxBatchSize] __attribute__((aligned(64)));
     tx_bufs[0] = rte_pktmbuf_alloc(mbuf_pool);
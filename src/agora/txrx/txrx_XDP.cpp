@@ -0,0 +1,300 @@
+/**
+ * @file txrx_XDP.cpp
+ * @brief Implementation of PacketTXRX datapath functions for communicating
+ * with simulators over AF_XDP sockets
+ *
+ * Each socket thread receives packets from one queue of a network interface
+ * through an AF_XDP socket, without DPDK. The thread's RX buffer is the
+ * socket's UMEM, so the kernel (or the driver, in zero-copy mode) writes each
+ * packet directly into its slot in socket_buffer_. Downlink packets are sent
+ * with regular UDP sockets.
+ *
+ * AF_XDP works with any kernel driver, including veth pairs for testing.
+ */
+
+#include "logger.h"
+#include "txrx.hpp"
+#include <linux/if_ether.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+
+// Number of entries in the fill and RX rings of an AF_XDP socket
+static constexpr size_t kXdpRingSize = 4096;
+
+// Size of a received frame's Ethernet, IPv4, and UDP headers
+static constexpr size_t kXdpHeaderSize
+    = sizeof(struct ethhdr) + sizeof(struct iphdr) + sizeof(struct udphdr);
+static_assert(kXdpHeaderSize == 42, "");
+
+// Headroom that places packets at kXdpRxPktOffset in their UMEM frame
+static constexpr size_t kXdpFrameHeadroom
+    = kXdpRxPktOffset - XDP_PACKET_HEADROOM - kXdpHeaderSize;
+
+PacketTXRX::PacketTXRX(Config* cfg, size_t core_offset)
+    : cfg(cfg)
+    , core_offset(core_offset)
+    , ant_per_cell(cfg->BS_ANT_NUM / cfg->nCells)
+    , socket_thread_num(cfg->socket_thread_num)
+{
+    socket_.resize(cfg->nRadios);
+    bs_rru_sockaddr_.resize(cfg->nRadios);
+    xsks_.resize(socket_thread_num);
+
+    int ret = inet_pton(AF_INET, cfg->bs_server_addr.c_str(), &bs_server_addr);
+    rt_assert(ret == 1, "Invalid server IP address");
+}
+
+PacketTXRX::PacketTXRX(Config* cfg, size_t core_offset,
+    moodycamel::ConcurrentQueue<Event_data>* queue_message,
+    moodycamel::ConcurrentQueue<Event_data>* queue_task,
+    moodycamel::ProducerToken** rx_ptoks, moodycamel::ProducerToken** tx_ptoks)
+    : PacketTXRX(cfg, core_offset)
+{
+    message_queue_ = queue_message;
+    task_queue_ = queue_task;
+    rx_ptoks_ = rx_ptoks;
+    tx_ptoks_ = tx_ptoks;
+}
+
+PacketTXRX::~PacketTXRX()
+{
+    for (auto& s : xsks_) {
+        if (s.xsk != nullptr)
+            xsk_socket__delete(s.xsk);
+        if (s.umem != nullptr)
+            xsk_umem__delete(s.umem);
+    }
+}
+
+bool PacketTXRX::startTXRX(Table<char>& buffer, Table<int>& buffer_status,
+    size_t packet_num_in_buffer, Table<size_t>& frame_start, char* tx_buffer)
+{
+    buffer_ = &buffer;
+    buffer_status_ = &buffer_status;
+    frame_start_ = &frame_start;
+
+    packet_num_in_buffer_ = packet_num_in_buffer;
+    tx_buffer_ = tx_buffer;
+
+    for (size_t i = 0; i < socket_thread_num; i++) {
+        pthread_t txrx_thread;
+        auto context = new EventHandlerContext<PacketTXRX>;
+        context->obj_ptr = this;
+        context->id = i;
+        int ret = pthread_create(&txrx_thread, NULL,
+            pthread_fun_wrapper<PacketTXRX, &PacketTXRX::loop_tx_rx>, context);
+        rt_assert(ret == 0, "Failed to create threads");
+    }
+    return true;
+}
+
+void PacketTXRX::send_beacon(int tid, size_t frame_id)
+{
+    int radio_lo = tid * cfg->nRadios / socket_thread_num;
+    int radio_hi = (tid + 1) * cfg->nRadios / socket_thread_num;
+
+    // Send a beacon packet in the downlink to trigger user pilot
+    std::vector<uint8_t> udp_pkt_buf(cfg->packet_length, 0);
+    auto* pkt = reinterpret_cast<Packet*>(&udp_pkt_buf[0]);
+    for (int ant_id = radio_lo; ant_id < radio_hi; ant_id++) {
+        new (pkt) Packet(frame_id, 0, 0 /* cell_id */, ant_id);
+        ssize_t r = sendto(socket_[ant_id], (char*)udp_pkt_buf.data(),
+            cfg->packet_length, 0, (struct sockaddr*)&bs_rru_sockaddr_[ant_id],
+            sizeof(bs_rru_sockaddr_[ant_id]));
+        rt_assert(r > 0, "sendto() failed");
+    }
+}
+
+void PacketTXRX::xdp_init(int tid)
+{
+    XdpSocket& s = xsks_[tid];
+    s.slots.init(packet_num_in_buffer_, kXdpRingSize);
+
+    struct xsk_umem_config umem_cfg = {};
+    umem_cfg.fill_size = kXdpRingSize;
+    umem_cfg.comp_size = kXdpRingSize;
+    umem_cfg.frame_size = cfg->rx_slot_size;
+    umem_cfg.frame_headroom = kXdpFrameHeadroom;
+    int ret = xsk_umem__create(&s.umem, (*buffer_)[tid],
+        packet_num_in_buffer_ * cfg->rx_slot_size, &s.fill, &s.comp,
+        &umem_cfg);
+    if (ret != 0) {
+        fprintf(stderr, "TXRX thread %d: Failed to create UMEM: %s\n", tid,
+            strerror(-ret));
+        exit(-1);
+    }
+
+    // The socket has no TX ring since downlink packets use UDP sockets
+    struct xsk_socket_config xsk_cfg = {};
+    xsk_cfg.rx_size = kXdpRingSize;
+    xsk_cfg.bind_flags = XDP_USE_NEED_WAKEUP;
+    ret = xsk_socket__create(&s.xsk, cfg->xdp_ifname.c_str(), tid, s.umem,
+        &s.rx, nullptr, &xsk_cfg);
+    if (ret != 0) {
+        fprintf(stderr,
+            "TXRX thread %d: Failed to create AF_XDP socket on %s queue %d: "
+            "%s\n",
+            tid, cfg->xdp_ifname.c_str(), tid, strerror(-ret));
+        exit(-1);
+    }
+    MLPD_INFO("TXRX thread %d: AF_XDP socket on %s queue %d, %zu-byte "
+              "frames\n",
+        tid, cfg->xdp_ifname.c_str(), tid, cfg->rx_slot_size);
+
+    xdp_refill(tid);
+}
+
+void PacketTXRX::xdp_refill(int tid)
+{
+    XdpSocket& s = xsks_[tid];
+    s.slots.reclaim((*buffer_status_)[tid]);
+    const size_t n = s.slots.num_postable();
+    if (n == 0)
+        return;
+
+    uint32_t idx_fill = 0;
+    if (xsk_ring_prod__reserve(&s.fill, n, &idx_fill) != n)
+        return;
+    for (size_t i = 0; i < n; i++) {
+        *xsk_ring_prod__fill_addr(&s.fill, idx_fill + i)
+            = s.slots.post() * cfg->rx_slot_size;
+    }
+    xsk_ring_prod__submit(&s.fill, n);
+}
+
+size_t PacketTXRX::xdp_recv(int tid, size_t& prev_frame_id)
+{
+    XdpSocket& s = xsks_[tid];
+    uint32_t idx_rx = 0;
+    const size_t nb_rx
+        = xsk_ring_cons__peek(&s.rx, kMaxSocketBatchSize, &idx_rx);
+    if (nb_rx == 0) {
+        if (xsk_ring_prod__needs_wakeup(&s.fill)) {
+            recvfrom(xsk_socket__fd(s.xsk), nullptr, 0, MSG_DONTWAIT, nullptr,
+                nullptr);
+        }
+        return 0;
+    }
+
+    char* rx_buffer = (*buffer_)[tid];
+    int* rx_buffer_status = (*buffer_status_)[tid];
+    Event_data events[kMaxSocketBatchSize];
+    size_t num_events = 0;
+    size_t num_pkts = 0;
+    for (size_t i = 0; i < nb_rx; i++) {
+        const struct xdp_desc* desc = xsk_ring_cons__rx_desc(&s.rx, idx_rx + i);
+        const size_t slot = desc->addr / cfg->rx_slot_size;
+        auto* eth_hdr = reinterpret_cast<struct ethhdr*>(
+            xsk_umem__get_data(rx_buffer, desc->addr));
+        auto* ip_hdr = reinterpret_cast<struct iphdr*>(eth_hdr + 1);
+
+        // Skip frames that are not Agora packets for this server. Their slot
+        // is free and is posted to the fill ring again.
+        if (desc->len < kXdpHeaderSize + cfg->packet_length
+            or ntohs(eth_hdr->h_proto) != ETH_P_IP or ip_hdr->ihl != 5
+            or ip_hdr->protocol != IPPROTO_UDP
+            or ip_hdr->daddr != bs_server_addr) {
+            s.slots.receive(slot, false /* in_use */);
+            continue;
+        }
+
+        Packet* pkt = cfg->get_rx_packet(rx_buffer, slot);
+        rt_assert(reinterpret_cast<char*>(pkt)
+                == reinterpret_cast<char*>(eth_hdr) + kXdpHeaderSize,
+            "AF_XDP frame is not at the expected offset in its slot");
+        s.slots.receive(slot, true /* in_use */);
+        if (kDebugPrintInTask) {
+            printf("In TXRX thread %d: Received frame %d, symbol %d, ant %d\n",
+                tid, pkt->frame_id, pkt->symbol_id, pkt->ant_id);
+        }
+        pkt->ant_id += pkt->cell_id * ant_per_cell;
+        rx_buffer_status[slot] = 1;
+
+        if (kIsWorkerTimingEnabled) {
+            if (prev_frame_id == SIZE_MAX or pkt->frame_id > prev_frame_id) {
+                (*frame_start_)[tid][pkt->frame_id % kNumStatsFrames] = rdtsc();
+                prev_frame_id = pkt->frame_id;
+            }
+        }
+
+        if (num_pkts % Event_data::kMaxTags == 0) {
+            events[num_events] = Event_data(EventType::kPacketRX);
+            num_events++;
+        }
+        Event_data& event = events[num_events - 1];
+        event.tags[event.num_tags++] = rx_tag_t(tid, slot)._tag;
+        num_pkts++;
+    }
+    xsk_ring_cons__release(&s.rx, nb_rx);
+
+    if (num_events > 0
+        and !message_queue_->enqueue_bulk(
+            *rx_ptoks_[tid], events, num_events)) {
+        printf("socket message enqueue failed\n");
+        exit(0);
+    }
+    return num_pkts;
+}
+
+void* PacketTXRX::loop_tx_rx(int tid)
+{
+    pin_to_core_with_offset(
+        ThreadType::kWorkerTXRX, core_offset, tid, false /* quiet */);
+    int radio_lo = tid * cfg->nRadios / socket_thread_num;
+    int radio_hi = (tid + 1) * cfg->nRadios / socket_thread_num;
+
+    // UDP sockets for sending downlink packets
+    for (int radio_id = radio_lo; radio_id < radio_hi; ++radio_id) {
+        int local_port_id = cfg->bs_server_port + radio_id;
+        socket_[radio_id] = setup_socket_ipv4(local_port_id, true, 0);
+        setup_sockaddr_remote_ipv4(&bs_rru_sockaddr_[radio_id],
+            cfg->bs_rru_port + radio_id, cfg->bs_rru_addr.c_str());
+        fcntl(socket_[radio_id], F_SETFL, O_NONBLOCK);
+    }
+
+    xdp_init(tid);
+
+    size_t prev_frame_id = SIZE_MAX;
+    while (cfg->running) {
+        xdp_refill(tid);
+        xdp_recv(tid, prev_frame_id);
+        dequeue_send(tid);
+    }
+    return 0;
+}
+
+int PacketTXRX::dequeue_send(int tid)
+{
+    auto& c = cfg;
+    Event_data event;
+    if (!task_queue_->try_dequeue_from_producer(*tx_ptoks_[tid], event))
+        return -1;
+
+    assert(event.event_type == EventType::kPacketTX);
+
+    size_t ant_id = gen_tag_t(event.tags[0]).ant_id;
+    size_t frame_id = gen_tag_t(event.tags[0]).frame_id;
+    size_t symbol_id = gen_tag_t(event.tags[0]).symbol_id;
+
+    size_t data_symbol_idx_dl = cfg->get_dl_symbol_idx(frame_id, symbol_id);
+    size_t offset
+        = (c->get_total_data_symbol_idx_dl(frame_id, data_symbol_idx_dl)
+              * c->BS_ANT_NUM)
+        + ant_id;
+
+    char* cur_buffer_ptr = tx_buffer_ + offset * c->packet_length;
+    auto* pkt = (Packet*)cur_buffer_ptr;
+    new (pkt) Packet(frame_id, symbol_id, 0 /* cell_id */, ant_id,
+        c->fronthaul_comp_hdr());
+
+    // Send data (one OFDM symbol)
+    ssize_t ret = sendto(socket_[ant_id], cur_buffer_ptr, c->packet_length, 0,
+        (struct sockaddr*)&bs_rru_sockaddr_[ant_id],
+        sizeof(bs_rru_sockaddr_[ant_id]));
+    rt_assert(ret > 0, "sendto() failed");
+
+    rt_assert(message_queue_->enqueue(*rx_ptoks_[tid],
+                  Event_data(EventType::kPacketTX, event.tags[0])),
+        "Socket message enqueue failed\n");
+    return event.tags[0];
+}
@@ -0,0 +1,102 @@
+/**
+ * @file xdp_slot_pool.hpp
+ * @brief Ownership tracking of the RX buffer slots of an AF_XDP socket
+ *
+ * The UMEM frames of a socket thread's AF_XDP socket are the slots of the
+ * thread's RX buffer. A slot is free, posted to the kernel through the fill
+ * ring, or in use by Agora after a packet was received into it. The kernel
+ * may return posted slots in any order, e.g., in zero-copy mode, so the slot
+ * of a received packet is derived from its descriptor's address, and
+ * XdpSlotPool checks that the slot was posted.
+ *
+ * Agora releases a slot by clearing its RX buffer status. Slots in use are
+ * reclaimed in the order they were received, which is the order in which
+ * Agora mostly releases them.
+ *
+ * XdpSlotPool is not thread-safe; only the owning socket thread may use it.
+ */
+#ifndef XDP_SLOT_POOL
+#define XDP_SLOT_POOL
+
+#include "utils.h"
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+class XdpSlotPool {
+public:
+    /// Track [num_slots] slots, at most [max_posted] of which are owned by
+    /// the kernel at a time. All slots are initially free.
+    void init(size_t num_slots, size_t max_posted)
+    {
+        state_.assign(num_slots, SlotState::kFree);
+        free_slots_.clear();
+        for (size_t i = num_slots; i > 0; i--)
+            free_slots_.push_back(i - 1);
+        in_use_slots_ = std::queue<size_t>();
+        max_posted_ = max_posted;
+        num_posted_ = 0;
+    }
+
+    /// Return the number of free slots that can be posted to the kernel now
+    size_t num_postable() const
+    {
+        return std::min(free_slots_.size(), max_posted_ - num_posted_);
+    }
+
+    /// Take a free slot to post to the kernel. num_postable() must be
+    /// positive.
+    size_t post()
+    {
+        rt_assert(num_postable() > 0, "XdpSlotPool: No slot to post");
+        const size_t slot = free_slots_.back();
+        free_slots_.pop_back();
+        state_[slot] = SlotState::kPosted;
+        num_posted_++;
+        return slot;
+    }
+
+    /// Record that the kernel returned [slot] with a received frame. If
+    /// [in_use] is true, the frame is handed to Agora; else the slot is free
+    /// again.
+    void receive(size_t slot, bool in_use)
+    {
+        rt_assert(slot < state_.size() && state_[slot] == SlotState::kPosted,
+            "XdpSlotPool: Received a frame in a slot that was not posted");
+        num_posted_--;
+        if (in_use) {
+            state_[slot] = SlotState::kInUse;
+            in_use_slots_.push(slot);
+        } else {
+            state_[slot] = SlotState::kFree;
+            free_slots_.push_back(slot);
+        }
+    }
+
+    /// Free the slots in use that Agora has released, i.e., whose entry in
+    /// [buffer_status] is zero, up to the first slot still in use
+    void reclaim(const int* buffer_status)
+    {
+        while (!in_use_slots_.empty()
+            && buffer_status[in_use_slots_.front()] == 0) {
+            const size_t slot = in_use_slots_.front();
+            in_use_slots_.pop();
+            state_[slot] = SlotState::kFree;
+            free_slots_.push_back(slot);
+        }
+    }
+
+    size_t num_posted() const { return num_posted_; }
+    size_t num_in_use() const { return in_use_slots_.size(); }
+
+private:
+    enum class SlotState { kFree, kPosted, kInUse };
+
+    std::vector<SlotState> state_;
+    std::vector<size_t> free_slots_; // Free slots, used as a stack
+    std::queue<size_t> in_use_slots_; // Slots in use, in order of receipt
+    size_t max_posted_;
+    size_t num_posted_; // Number of slots owned by the kernel
+};
+
+#endif /* XDP_SLOT_POOL */
@@ -0,0 +1,160 @@
+/**
+ * @file work_stealing.hpp
+ * @brief Decentralized scheduling of uplink LDPC decoding tasks
+ *
+ * In work-stealing mode, the worker that completes the last demodulation task
+ * of an uplink symbol schedules that symbol's decode tasks itself, into its
+ * own task queue. Idle workers first drain their own queue and then steal
+ * decode tasks from other workers' queues. The master thread is only notified
+ * once per symbol, instead of once per demodulation or decode task.
+ */
+#ifndef WORK_STEALING
+#define WORK_STEALING
+
+#include "Symbols.hpp"
+#include "buffer.hpp"
+#include "concurrent_queue_wrapper.hpp"
+#include "concurrentqueue.h"
+#include "config.hpp"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+class WorkStealingScheduler {
+public:
+    // Initial capacity of each worker's task queue, in events
+    static constexpr size_t kWorkerQueueSize = 4096;
+
+    WorkStealingScheduler(Config* cfg)
+        : cfg_(cfg)
+        , num_workers_(cfg->worker_thread_num)
+        , num_demul_tasks_per_symbol_(cfg->demul_events_per_symbol)
+    {
+        rt_assert(num_workers_ > 0 && num_workers_ <= kMaxThreads,
+            "WorkStealingScheduler: Invalid number of workers");
+        for (size_t i = 0; i < num_workers_; i++) {
+            worker_queues_[i].queue
+                = moodycamel::ConcurrentQueue<Event_data>(kWorkerQueueSize);
+            worker_queues_[i].ptok
+                = new moodycamel::ProducerToken(worker_queues_[i].queue);
+            worker_queues_[i].num_steals = 0;
+        }
+        for (size_t i = 0; i < kFrameWnd; i++) {
+            for (size_t j = 0; j < kMaxSymbols; j++) {
+                demul_tasks_done_[i][j].count = 0;
+                decode_tasks_left_[i][j].count = 0;
+            }
+        }
+    }
+
+    ~WorkStealingScheduler()
+    {
+        for (size_t i = 0; i < num_workers_; i++)
+            delete worker_queues_[i].ptok;
+    }
+
+    /// Record the completion of one demodulation task of uplink symbol
+    /// [symbol_idx_ul] in frame [frame_id]. Return true iff this was the last
+    /// outstanding demodulation task of the symbol.
+    bool demul_task_done(size_t frame_id, size_t symbol_idx_ul)
+    {
+        auto& done = demul_tasks_done_[frame_id % kFrameWnd][symbol_idx_ul];
+        if (done.count.fetch_add(1, std::memory_order_acq_rel) + 1
+            == num_demul_tasks_per_symbol_) {
+            // All tasks of this symbol are done, so no other thread touches
+            // this counter until the slot is reused kFrameWnd frames later
+            done.count.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    /// Schedule decode tasks for all code blocks of uplink symbol
+    /// [symbol_idx_ul] in frame [frame_id] into worker [tid]'s queue
+    void schedule_codeblocks(size_t tid, size_t frame_id, size_t symbol_idx_ul)
+    {
+        const ModConfig& mod_cfg = cfg_->mod_cfg(frame_id);
+        const size_t num_tasks = mod_cfg.decode_events_per_symbol;
+        decode_tasks_left_[frame_id % kFrameWnd][symbol_idx_ul].count.store(
+            num_tasks, std::memory_order_release);
+
+        // Each task decodes a batch of consecutive code blocks
+        auto base_tag = gen_tag_t::frm_sym_cb(frame_id, symbol_idx_ul, 0);
+        for (size_t i = 0; i < num_tasks; i++) {
+            try_enqueue_fallback(&worker_queues_[tid].queue,
+                worker_queues_[tid].ptok,
+                Event_data(EventType::kDecode, base_tag._tag));
+            base_tag.cb_id += mod_cfg.decode_batch_size;
+        }
+    }
+
+    /// Record the completion of [num_tasks] decode tasks of uplink symbol
+    /// [symbol_idx_ul] in frame [frame_id]. Return true iff all decode tasks of
+    /// the symbol are now complete.
+    bool decode_tasks_done(
+        size_t frame_id, size_t symbol_idx_ul, size_t num_tasks)
+    {
+        auto& left = decode_tasks_left_[frame_id % kFrameWnd][symbol_idx_ul];
+        return left.count.fetch_sub(num_tasks, std::memory_order_acq_rel)
+            == num_tasks;
+    }
+
+    /// Get a decode task for worker [tid]. Tasks from the worker's own queue
+    /// are preferred since their inputs are likely still in the worker's
+    /// cache. Otherwise, steal a task from another worker. Return true iff a
+    /// task was dequeued into [event].
+    bool try_get_task(size_t tid, Event_data& event)
+    {
+        WorkerQueue& own = worker_queues_[tid];
+        if (own.queue.try_dequeue_from_producer(*own.ptok, event))
+            return true;
+
+        for (size_t i = 1; i < num_workers_; i++) {
+            WorkerQueue& victim = worker_queues_[(tid + i) % num_workers_];
+            if (victim.queue.size_approx() > 0
+                && victim.queue.try_dequeue(event)) {
+                own.num_steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Return the number of decode tasks that worker [tid] stole from others
+    size_t get_num_steals(size_t tid) const
+    {
+        return worker_queues_[tid].num_steals;
+    }
+
+private:
+    struct WorkerQueue {
+        moodycamel::ConcurrentQueue<Event_data> queue;
+        moodycamel::ProducerToken* ptok;
+        size_t num_steals; // Written only by the owner worker
+    };
+
+    // Counters are padded to a cache line to avoid false sharing between
+    // workers completing tasks of different symbols
+    struct alignas(64) PaddedCounter {
+        std::atomic<size_t> count;
+    };
+
+    Config* cfg_;
+    const size_t num_workers_;
+    const size_t num_demul_tasks_per_symbol_;
+
+    std::array<WorkerQueue, kMaxThreads> worker_queues_;
+
+    // demul_tasks_done_[i % kFrameWnd][j] is the number of completed
+    // demodulation tasks for frame i and uplink symbol j
+    std::array<std::array<PaddedCounter, kMaxSymbols>, kFrameWnd>
+        demul_tasks_done_;
+
+    // decode_tasks_left_[i % kFrameWnd][j] is the number of outstanding decode
+    // tasks for frame i and uplink symbol j
+    std::array<std::array<PaddedCounter, kMaxSymbols>, kFrameWnd>
+        decode_tasks_left_;
+};
+
+#endif /* WORK_STEALING */
@@ -0,0 +1,279 @@
+/**
+ * @file zf_batch.hpp
+ * @brief Batched zeroforcing for many small channel matrices
+ *
+ * BatchedZF computes W = inv(H' * H) * H' for up to kBatchSize channel
+ * matrices H (one per subcarrier) at once. The matrices are stored in a
+ * structure-of-arrays layout with the batch index as the innermost dimension,
+ * so every step (Gram matrix, Cholesky factorization, and the two triangular
+ * solves) is a fixed-length loop over batch lanes that the compiler maps to
+ * AVX2 or AVX-512 instructions. Unlike one Armadillo call per subcarrier, this
+ * performs no memory allocation or dispatch per matrix.
+ *
+ * This file does not depend on the rest of Agora so that microbenchmarks can
+ * use it directly.
+ */
+#ifndef ZF_BATCH
+#define ZF_BATCH
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+class BatchedZF {
+public:
+    // Number of matrices processed together. Sixteen single-precision lanes
+    // fill one AVX-512 register, or two AVX2 registers.
+    static constexpr size_t kBatchSize = 16;
+
+    /// Create an engine for channel matrices with [num_rows] rows (base
+    /// station antennas) and [num_cols] columns (users)
+    BatchedZF(size_t num_rows, size_t num_cols)
+        : num_rows_(num_rows)
+        , num_cols_(num_cols)
+    {
+        const size_t h_size = num_rows * num_cols * kBatchSize;
+        const size_t g_size = num_cols * num_cols * kBatchSize;
+        h_re_ = alloc(h_size);
+        h_im_ = alloc(h_size);
+        l_re_ = alloc(g_size);
+        l_im_ = alloc(g_size);
+        w_re_ = alloc(h_size);
+        w_im_ = alloc(h_size);
+        inv_diag_ = alloc(num_cols * kBatchSize);
+    }
+
+    ~BatchedZF()
+    {
+        std::free(h_re_);
+        std::free(h_im_);
+        std::free(l_re_);
+        std::free(l_im_);
+        std::free(w_re_);
+        std::free(w_im_);
+        std::free(inv_diag_);
+    }
+
+    BatchedZF(const BatchedZF&) = delete;
+    BatchedZF& operator=(const BatchedZF&) = delete;
+
+    /// Load the channel matrix of batch lane [lane]. [csi] is a column-major
+    /// num_rows x num_cols matrix of interleaved (real, imaginary) floats.
+    void load(size_t lane, const float* csi)
+    {
+        for (size_t i = 0; i < num_rows_ * num_cols_; i++) {
+            h_re_[i * kBatchSize + lane] = csi[2 * i];
+            h_im_[i * kBatchSize + lane] = csi[2 * i + 1];
+        }
+    }
+
+    /// Compute zeroforcing matrices for lanes [0, num_lanes). Lanes that were
+    /// not loaded are filled with a well-conditioned dummy matrix.
+    void compute(size_t num_lanes)
+    {
+        for (size_t lane = num_lanes; lane < kBatchSize; lane++)
+            load_dummy(lane);
+        for (size_t l = 0; l < kBatchSize; l++)
+            failed_[l] = false;
+
+        gram_and_cholesky();
+        solve();
+    }
+
+    /// Return true iff the Gram matrix of [lane] was not positive definite in
+    /// the last call to compute(). The output of such lanes is invalid.
+    bool failed(size_t lane) const { return failed_[lane]; }
+
+    /// Store the zeroforcing matrix of batch lane [lane] into [zf], a
+    /// column-major num_cols x num_rows matrix of interleaved floats
+    void store(size_t lane, float* zf) const
+    {
+        for (size_t i = 0; i < num_rows_ * num_cols_; i++) {
+            zf[2 * i] = w_re_[i * kBatchSize + lane];
+            zf[2 * i + 1] = w_im_[i * kBatchSize + lane];
+        }
+    }
+
+private:
+    static float* alloc(size_t num_floats)
+    {
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, 64, num_floats * sizeof(float)) != 0)
+            std::abort();
+        std::memset(ptr, 0, num_floats * sizeof(float));
+        return static_cast<float*>(ptr);
+    }
+
+    // Index of element (row, col) of a column-major matrix with [rows] rows,
+    // in units of batch vectors
+    static size_t idx(size_t row, size_t col, size_t rows)
+    {
+        return (col * rows + row) * kBatchSize;
+    }
+
+    void load_dummy(size_t lane)
+    {
+        for (size_t j = 0; j < num_cols_; j++) {
+            for (size_t i = 0; i < num_rows_; i++) {
+                h_re_[idx(i, j, num_rows_) + lane] = (i == j) ? 1.0f : 0.0f;
+                h_im_[idx(i, j, num_rows_) + lane] = 0.0f;
+            }
+        }
+    }
+
+    // Compute the lower triangle of G = H' * H, and factorize G = L * L' in
+    // place. L has a real diagonal; we keep its reciprocal in inv_diag_.
+    void gram_and_cholesky()
+    {
+        const size_t M = num_rows_;
+        const size_t K = num_cols_;
+        for (size_t j = 0; j < K; j++) {
+            for (size_t i = j; i < K; i++) {
+                float acc_re[kBatchSize] = {};
+                float acc_im[kBatchSize] = {};
+                for (size_t m = 0; m < M; m++) {
+                    const float* a_re = &h_re_[idx(m, i, M)];
+                    const float* a_im = &h_im_[idx(m, i, M)];
+                    const float* b_re = &h_re_[idx(m, j, M)];
+                    const float* b_im = &h_im_[idx(m, j, M)];
+                    // conj(H(m, i)) * H(m, j)
+                    for (size_t l = 0; l < kBatchSize; l++) {
+                        acc_re[l] += a_re[l] * b_re[l] + a_im[l] * b_im[l];
+                        acc_im[l] += a_re[l] * b_im[l] - a_im[l] * b_re[l];
+                    }
+                }
+                float* g_re = &l_re_[idx(i, j, K)];
+                float* g_im = &l_im_[idx(i, j, K)];
+                for (size_t l = 0; l < kBatchSize; l++) {
+                    g_re[l] = acc_re[l];
+                    g_im[l] = acc_im[l];
+                }
+            }
+        }
+
+        for (size_t j = 0; j < K; j++) {
+            // Diagonal: L(j, j) = sqrt(G(j, j) - sum_p |L(j, p)|^2)
+            float* d = &l_re_[idx(j, j, K)];
+            for (size_t p = 0; p < j; p++) {
+                const float* ljp_re = &l_re_[idx(j, p, K)];
+                const float* ljp_im = &l_im_[idx(j, p, K)];
+                for (size_t l = 0; l < kBatchSize; l++)
+                    d[l] -= ljp_re[l] * ljp_re[l] + ljp_im[l] * ljp_im[l];
+            }
+            float* inv_d = &inv_diag_[j * kBatchSize];
+            for (size_t l = 0; l < kBatchSize; l++) {
+                const bool bad = !(d[l] > 0.0f);
+                failed_[l] = failed_[l] || bad;
+                d[l] = bad ? 1.0f : std::sqrt(d[l]);
+                inv_d[l] = 1.0f / d[l];
+            }
+
+            // Column below the diagonal:
+            // L(i, j) = (G(i, j) - sum_p L(i, p) * conj(L(j, p))) / L(j, j)
+            for (size_t i = j + 1; i < K; i++) {
+                float* lij_re = &l_re_[idx(i, j, K)];
+                float* lij_im = &l_im_[idx(i, j, K)];
+                for (size_t p = 0; p < j; p++) {
+                    const float* lip_re = &l_re_[idx(i, p, K)];
+                    const float* lip_im = &l_im_[idx(i, p, K)];
+                    const float* ljp_re = &l_re_[idx(j, p, K)];
+                    const float* ljp_im = &l_im_[idx(j, p, K)];
+                    for (size_t l = 0; l < kBatchSize; l++) {
+                        lij_re[l] -= lip_re[l] * ljp_re[l]
+                            + lip_im[l] * ljp_im[l];
+                        lij_im[l] -= lip_im[l] * ljp_re[l]
+                            - lip_re[l] * ljp_im[l];
+                    }
+                }
+                for (size_t l = 0; l < kBatchSize; l++) {
+                    lij_re[l] *= inv_d[l];
+                    lij_im[l] *= inv_d[l];
+                }
+            }
+        }
+    }
+
+    // Compute W = inv(L * L') * H' with a forward solve L * Y = H' followed by
+    // a backward solve L' * W = Y, one column of H' (antenna) at a time
+    void solve()
+    {
+        const size_t M = num_rows_;
+        const size_t K = num_cols_;
+        for (size_t m = 0; m < M; m++) {
+            // Forward: Y(k, m) = (conj(H(m, k)) - sum_p L(k, p) Y(p, m)) / L(k, k)
+            for (size_t k = 0; k < K; k++) {
+                float y_re[kBatchSize];
+                float y_im[kBatchSize];
+                const float* hmk_re = &h_re_[idx(m, k, M)];
+                const float* hmk_im = &h_im_[idx(m, k, M)];
+                for (size_t l = 0; l < kBatchSize; l++) {
+                    y_re[l] = hmk_re[l];
+                    y_im[l] = -hmk_im[l];
+                }
+                for (size_t p = 0; p < k; p++) {
+                    const float* lkp_re = &l_re_[idx(k, p, K)];
+                    const float* lkp_im = &l_im_[idx(k, p, K)];
+                    const float* yp_re = &w_re_[idx(p, m, K)];
+                    const float* yp_im = &w_im_[idx(p, m, K)];
+                    for (size_t l = 0; l < kBatchSize; l++) {
+                        y_re[l] -= lkp_re[l] * yp_re[l] - lkp_im[l] * yp_im[l];
+                        y_im[l] -= lkp_re[l] * yp_im[l] + lkp_im[l] * yp_re[l];
+                    }
+                }
+                const float* inv_d = &inv_diag_[k * kBatchSize];
+                float* yk_re = &w_re_[idx(k, m, K)];
+                float* yk_im = &w_im_[idx(k, m, K)];
+                for (size_t l = 0; l < kBatchSize; l++) {
+                    yk_re[l] = y_re[l] * inv_d[l];
+                    yk_im[l] = y_im[l] * inv_d[l];
+                }
+            }
+
+            // Backward: W(k, m) = (Y(k, m) - sum_p conj(L(p, k)) W(p, m)) /
+            // L(k, k), for p > k
+            for (size_t k = K; k-- > 0;) {
+                float* wk_re = &w_re_[idx(k, m, K)];
+                float* wk_im = &w_im_[idx(k, m, K)];
+                for (size_t p = k + 1; p < K; p++) {
+                    const float* lpk_re = &l_re_[idx(p, k, K)];
+                    const float* lpk_im = &l_im_[idx(p, k, K)];
+                    const float* wp_re = &w_re_[idx(p, m, K)];
+                    const float* wp_im = &w_im_[idx(p, m, K)];
+                    for (size_t l = 0; l < kBatchSize; l++) {
+                        wk_re[l] -= lpk_re[l] * wp_re[l] + lpk_im[l] * wp_im[l];
+                        wk_im[l] -= lpk_re[l] * wp_im[l] - lpk_im[l] * wp_re[l];
+                    }
+                }
+                const float* inv_d = &inv_diag_[k * kBatchSize];
+                for (size_t l = 0; l < kBatchSize; l++) {
+                    wk_re[l] *= inv_d[l];
+                    wk_im[l] *= inv_d[l];
+                }
+            }
+        }
+    }
+
+    const size_t num_rows_; // Number of base station antennas
+    const size_t num_cols_; // Number of users
+
+    // Channel matrices H, num_rows_ x num_cols_, column-major
+    float* h_re_;
+    float* h_im_;
+
+    // Gram matrices, overwritten by their Cholesky factors (lower triangle),
+    // num_cols_ x num_cols_, column-major
+    float* l_re_;
+    float* l_im_;
+
+    // Reciprocals of the diagonal of the Cholesky factors
+    float* inv_diag_;
+
+    // Zeroforcing matrices W, num_cols_ x num_rows_, column-major
+    float* w_re_;
+    float* w_im_;
+
+    bool failed_[kBatchSize];
+};
+
+#endif /* ZF_BATCH */
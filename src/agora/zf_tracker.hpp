@@ -0,0 +1,83 @@
+/**
+ * @file zf_tracker.hpp
+ * @brief Reference state for zeroforcing tracking across frames
+ *
+ * In ZF tracking mode, each zeroforcing subcarrier keeps a reference CSI
+ * matrix and the uplink zeroforcing matrix computed from it. If a new frame's
+ * CSI is close to the reference, DoZF reuses or cheaply refines the reference
+ * zeroforcing matrix instead of computing a full inverse.
+ *
+ * ZF tasks of different frames for the same subcarrier may run concurrently
+ * on different workers. A worker must hold a subcarrier's lock to access its
+ * reference state; workers that fail to get the lock fall back to a full
+ * computation.
+ */
+#ifndef ZF_TRACKER
+#define ZF_TRACKER
+
+#include "Symbols.hpp"
+#include "memory_manage.h"
+#include <atomic>
+#include <vector>
+
+class ZFTracker {
+public:
+    /// Create reference state for [num_subcarriers] subcarriers, with
+    /// [bs_ant_num] x [ue_num] CSI matrices
+    ZFTracker(size_t num_subcarriers, size_t bs_ant_num, size_t ue_num)
+        : states_(num_subcarriers)
+    {
+        ref_csi_.calloc(num_subcarriers, bs_ant_num * ue_num, 64);
+        ref_ul_zf_.calloc(num_subcarriers, bs_ant_num * ue_num, 64);
+        for (auto& s : states_) {
+            s.locked = false;
+            s.valid = false;
+        }
+    }
+
+    ~ZFTracker()
+    {
+        ref_csi_.free();
+        ref_ul_zf_.free();
+    }
+
+    /// Try to get exclusive access to the reference state of subcarrier
+    /// [sc_id]. Return true on success.
+    bool try_lock(size_t sc_id)
+    {
+        return !states_[sc_id].locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock(size_t sc_id)
+    {
+        states_[sc_id].locked.store(false, std::memory_order_release);
+    }
+
+    /// Return true iff subcarrier [sc_id] has a reference. The caller must
+    /// hold the subcarrier's lock.
+    bool has_reference(size_t sc_id) const { return states_[sc_id].valid; }
+
+    /// Mark the reference of subcarrier [sc_id] as valid after the caller has
+    /// filled in ref_csi() and ref_ul_zf(). The caller must hold the lock.
+    void set_reference(size_t sc_id) { states_[sc_id].valid = true; }
+
+    /// The reference CSI matrix of subcarrier [sc_id], column-major
+    complex_float* ref_csi(size_t sc_id) { return ref_csi_[sc_id]; }
+
+    /// The uplink zeroforcing matrix for ref_csi(sc_id), column-major
+    complex_float* ref_ul_zf(size_t sc_id) { return ref_ul_zf_[sc_id]; }
+
+private:
+    // Per-subcarrier state is padded to a cache line to avoid false sharing
+    // between workers processing adjacent subcarriers
+    struct alignas(64) SubcarrierState {
+        std::atomic<bool> locked;
+        bool valid;
+    };
+
+    std::vector<SubcarrierState> states_;
+    Table<complex_float> ref_csi_;
+    Table<complex_float> ref_ul_zf_;
+};
+
+#endif /* ZF_TRACKER */
@@ -15,6 +15,8 @@ Phy_UE::Phy_UE(Config* config)
 
     this->config_ = config;
     initialize_vars_from_cfg();
+    mod_order_bits_ = config_->mod_order_bits;
+    mod_frame_ids_.fill(SIZE_MAX);
 
     std::vector<size_t> data_sc_ind_;
     for (size_t i = config_->OFDM_DATA_START;
@@ -250,6 +252,7 @@ void Phy_UE::start()
                     "Error: Received packet for future frame beyond frame "
                     "window. This can happen if PHY is running "
                     "slowly, e.g., in debug mode");
+                apply_ran_config(frame_id);
 
                 if (symbol_id
                     == 0) { // To send uplink pilots in simulation mode
@@ -418,6 +421,8 @@ void Phy_UE::start()
                         * config_->mac_bytes_num_perframe]);
                 rt_assert(pkt->frame_id == expected_frame_id_from_mac_,
                     "Incorrect frame ID from MAC");
+                if (config_->link_adaptation)
+                    update_ran_config(pkt->rb_indicator);
                 current_frame_user_num_
                     = (current_frame_user_num_ + 1) % config_->UE_ANT_NUM;
                 if (current_frame_user_num_ == 0)
@@ -785,16 +790,23 @@ void Phy_UE::doDemul(int tid, size_t tag)
     // demod_16qam_hard_loop(
     //    equal_ptr, (uint8_t*)demul_ptr, config_->UE_ANT_NUM);
 
-    switch (config_->mod_order_bits) {
+    const size_t mod_order_bits = config_->mod_cfg(frame_id).mod_order_bits;
+    switch (mod_order_bits) {
+    case (CommsLib::QPSK):
+        demod_qpsk_soft_avx2(equal_ptr, demul_ptr, config_->OFDM_DATA_NUM);
+        break;
     case (CommsLib::QAM16):
         demod_16qam_soft_avx2(equal_ptr, demul_ptr, config_->OFDM_DATA_NUM);
         break;
     case (CommsLib::QAM64):
         demod_64qam_soft_avx2(equal_ptr, demul_ptr, config_->OFDM_DATA_NUM);
         break;
+    case (CommsLib::QAM256):
+        demod_256qam_soft_avx2(equal_ptr, demul_ptr, config_->OFDM_DATA_NUM);
+        break;
     default:
-        printf("Demodulation: modulation type %s not supported!\n",
-            config_->modulation.c_str());
+        printf("Demodulation: modulation type %zu bits not supported!\n",
+            mod_order_bits);
     }
 
     size_t dem_duration_stat = rdtsc() - start_tsc;
@@ -857,10 +869,10 @@ void Phy_UE::doDecode(int tid, size_t tag)
     ldpc_decoder_5gnr_response.numMsgBits = numMsgBits;
     ldpc_decoder_5gnr_response.varNodes = resp_var_nodes;
 
-    for (size_t cb_id = 0; cb_id < config_->LDPC_config.nblocksInSymbol;
-         cb_id++) {
+    const ModConfig& mod_cfg = config_->mod_cfg(frame_id);
+    for (size_t cb_id = 0; cb_id < mod_cfg.nblocksInSymbol; cb_id++) {
         size_t demod_buffer_offset
-            = cb_id * LDPC_config.cbCodewLen * config_->mod_order_bits;
+            = cb_id * LDPC_config.cbCodewLen * mod_cfg.mod_order_bits;
         size_t decode_buffer_offset
             = cb_id * roundup<64>(config_->num_bytes_per_cb);
         auto* llr_buffer_ptr
@@ -943,13 +955,13 @@ void Phy_UE::doEncode(int tid, size_t tag)
         ? (LDPC_config.cbLen) >> 3
         : roundup<64>(bits_to_bytes(LDPC_config.cbLen));
     size_t encoded_bytes_per_block = (LDPC_config.cbCodewLen + 7) >> 3;
+    const ModConfig& mod_cfg = config_->mod_cfg(frame_id);
 
     for (size_t ul_symbol_id = 0; ul_symbol_id < ul_data_symbol_perframe;
          ul_symbol_id++) {
         size_t total_ul_symbol_id
             = frame_slot * ul_data_symbol_perframe + ul_symbol_id;
-        for (size_t cb_id = 0; cb_id < config_->LDPC_config.nblocksInSymbol;
-             cb_id++) {
+        for (size_t cb_id = 0; cb_id < mod_cfg.nblocksInSymbol; cb_id++) {
             int8_t* input_ptr;
             if (kEnableMac) {
                 uint8_t* ul_bits = ul_bits_buffer_[ue_id]
@@ -971,13 +983,13 @@ void Phy_UE::doEncode(int tid, size_t tag)
                 LDPC_config.nRows, encoded_buffer_temp, parity_buffer,
                 input_ptr);
 
-            int cbCodedBytes = LDPC_config.cbCodewLen / cfg->mod_order_bits;
+            int cbCodedBytes = LDPC_config.cbCodewLen / mod_cfg.mod_order_bits;
             int output_offset = total_ul_symbol_id * config_->OFDM_DATA_NUM
                 + cbCodedBytes * cb_id;
 
             adapt_bits_for_mod(reinterpret_cast<uint8_t*>(encoded_buffer_temp),
                 &ul_syms_buffer_[ue_id][output_offset], encoded_bytes_per_block,
-                cfg->mod_order_bits);
+                mod_cfg.mod_order_bits);
         }
     }
     // double duration = worker_rdtsc() - start_tsc;
@@ -996,6 +1008,7 @@ void Phy_UE::doModul(int tid, size_t tag)
     const size_t frame_id = gen_tag_t(tag).frame_id;
     const size_t ue_id = gen_tag_t(tag).ue_id;
     const size_t frame_slot = frame_id % kFrameWnd;
+    const complex_float* mod_table = config_->mod_cfg(frame_id).mod_table[0];
     for (size_t ch = 0; ch < config_->nChannels; ch++) {
         size_t ant_id = ue_id * config_->nChannels + ch;
         for (size_t ul_symbol_id = 0; ul_symbol_id < ul_data_symbol_perframe;
@@ -1007,10 +1020,8 @@ void Phy_UE::doModul(int tid, size_t tag)
             int8_t* ul_bits
                 = (int8_t*)&ul_syms_buffer_[ant_id][total_ul_symbol_id
                     * config_->OFDM_DATA_NUM];
-            for (size_t sc = 0; sc < config_->OFDM_DATA_NUM; sc++) {
-                modul_buf[sc] = mod_single_uint8(
-                    (uint8_t)ul_bits[sc], config_->mod_table);
-            }
+            for (size_t sc = 0; sc < config_->OFDM_DATA_NUM; sc++)
+                modul_buf[sc] = mod_table[(uint8_t)ul_bits[sc]];
         }
     }
     rt_assert(message_queue_.enqueue(
@@ -1069,6 +1080,32 @@ void Phy_UE::doIFFT(int tid, size_t tag)
         "Muliplexing message enqueue failed");
 }
 
+void Phy_UE::update_ran_config(const RBIndicator& ri)
+{
+    // Every MAC packet repeats the signalled order, so only changes are
+    // queued
+    const size_t last_mod_order_bits = ran_config_updates_.empty()
+        ? mod_order_bits_
+        : ran_config_updates_.back().mod_order_bits;
+    if (ri.mod_order_bits != last_mod_order_bits)
+        ran_config_updates_.push(ri);
+}
+
+void Phy_UE::apply_ran_config(size_t frame_id)
+{
+    const size_t frame_slot = frame_id % kFrameWnd;
+    if (mod_frame_ids_[frame_slot] == frame_id)
+        return;
+    mod_frame_ids_[frame_slot] = frame_id;
+
+    while (!ran_config_updates_.empty()
+        and ran_config_updates_.front().frame_id <= frame_id) {
+        mod_order_bits_ = ran_config_updates_.front().mod_order_bits;
+        ran_config_updates_.pop();
+    }
+    config_->set_frame_mod_order_bits(frame_id, mod_order_bits_);
+}
+
 void Phy_UE::initialize_vars_from_cfg(void)
 {
     dl_pilot_symbol_perframe = config_->DL_PILOT_SYMS;
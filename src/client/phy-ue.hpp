@@ -148,6 +148,13 @@ public:
 
     void initialize_vars_from_cfg(void);
 
+    /// Queue a modulation order signalled by the BS MAC, which applies to
+    /// frames starting from ri.frame_id
+    void update_ran_config(const RBIndicator& ri);
+
+    /// Set the modulation order of a frame when its first packet arrives
+    void apply_ran_config(size_t frame_id);
+
 private:
     Config* config_;
     size_t symbol_perframe;
@@ -190,6 +197,17 @@ private:
     size_t expected_frame_id_from_mac_ = 0;
     size_t current_frame_user_num_ = 0;
 
+    // With link adaptation, modulation orders signalled by the BS MAC that
+    // apply to frames that have not started yet, in frame order
+    std::queue<RBIndicator> ran_config_updates_;
+
+    // The modulation order bits of the most recently started frame
+    size_t mod_order_bits_;
+
+    // mod_frame_ids_[i] is the frame whose modulation order is set in frame
+    // slot i
+    std::array<size_t, kFrameWnd> mod_frame_ids_;
+
     // next_processed_frame_[i] is the next frame index on the uplink
     // to be processed and transmitted by the PHY for UE #i
     size_t next_frame_processed_[kMaxUEs] = {};
@@ -44,7 +44,6 @@ enum class EventType : int {
     kPacketTX,
     kPacketPilotTX,
     kDecode,
-    kDecodeLast,
     kEncode,
     kRC,
     kModul,
@@ -102,6 +101,17 @@ static constexpr bool kUseDPDK = true;
 static constexpr bool kUseDPDK = false;
 #endif
 
+#ifdef USE_XDP
+static constexpr bool kUseXDP = true;
+#else
+static constexpr bool kUseXDP = false;
+#endif
+
+// Offset of an Agora packet in an AF_XDP UMEM frame: the kernel's XDP
+// headroom (256 bytes), 22 bytes of frame headroom, and the 42-byte Ethernet,
+// IPv4, and UDP headers. This places packets on a cache line boundary.
+static constexpr size_t kXdpRxPktOffset = 320;
+
 #ifdef ENABLE_MAC
 static constexpr bool kEnableMac = true;
 #else
@@ -225,6 +235,15 @@ static constexpr size_t kTransposeBlockSize = 8;
 static_assert(is_power_of_two(kTransposeBlockSize), ""); // For cheap modulo
 static_assert(kTransposeBlockSize % kSCsPerCacheline == 0, "");
 
+// If true, equalization and precoding use kernels specialized for the
+// configured antenna and UE counts when such kernels exist
+static constexpr bool kUseFixedSizeKernels = true;
+
+// When the decode batch size is chosen automatically, a batch holds enough
+// code blocks for their total expansion factor to reach this value, so that
+// batches of small code blocks cost about as much as one maximum-size block
+static constexpr size_t kDecodeBatchTargetZc = 384;
+
 #ifdef USE_AVX2_ENCODER
 static constexpr bool kUseAVX2Encoder = true;
 #else
@@ -0,0 +1,252 @@
+/**
+ * @file bfp.h
+ * @brief SIMD functions for O-RAN block floating point (BFP) compression of
+ * fronthaul I/Q samples
+ *
+ * Samples are compressed in blocks of kBfpBlockSamples complex samples, like
+ * the resource blocks of O-RAN user-plane BFP compression. A compressed block
+ * is a one-byte exponent (udCompParam) followed by 2 * kBfpBlockSamples
+ * two's complement mantissas of iq_width bits each, packed MSB first. The
+ * 16-bit I/Q values of a block are mantissa << exponent.
+ *
+ * Mantissas are moved between their packed positions and 16-bit lanes eight
+ * at a time with byte shuffles. This needs every mantissa to lie within two
+ * bytes, which holds for the supported widths of 8, 9, and 12 bits.
+ */
+
+#ifndef BFP
+#define BFP
+
+#include <algorithm>
+#include <immintrin.h>
+#include <stdint.h>
+#include <string.h>
+
+// Number of complex samples per compressed block (one resource block)
+static constexpr size_t kBfpBlockSamples = 12;
+
+// udCompMeth values of the compression header
+static constexpr uint8_t kCompMethNone = 0;
+static constexpr uint8_t kCompMethBfp = 1;
+
+static inline bool bfp_width_supported(size_t iq_width)
+{
+    return iq_width == 8 || iq_width == 9 || iq_width == 12;
+}
+
+// Return the O-RAN udCompHdr for BFP compression with [iq_width]-bit
+// mantissas
+static inline uint8_t bfp_comp_hdr(size_t iq_width)
+{
+    return static_cast<uint8_t>(((iq_width & 0xf) << 4) | kCompMethBfp);
+}
+
+// Return the size in bytes of one compressed block
+static inline size_t bfp_block_bytes(size_t iq_width)
+{
+    return 1 + 2 * kBfpBlockSamples * iq_width / 8;
+}
+
+// Return the size in bytes of [num_samples] compressed complex samples
+static inline size_t bfp_compressed_bytes(size_t num_samples, size_t iq_width)
+{
+    return (num_samples + kBfpBlockSamples - 1) / kBfpBlockSamples
+        * bfp_block_bytes(iq_width);
+}
+
+// Shuffles and multipliers that move a group of eight packed mantissas (of
+// iq_width bytes) to and from 16-bit lanes. Mantissa k starts at bit
+// offset off_k = (k * iq_width) % 8 of byte byte_k = (k * iq_width) / 8.
+struct BfpLanes {
+    __m128i unpack_shuf; // Lane k = bytes byte_k and byte_k + 1, big-endian
+    __m128i unpack_mult; // 2^off_k, moves mantissa k to the top of lane k
+    __m128i pack_mult; // 2^(16 - iq_width - off_k), the inverse move
+    __m128i pack_hi_shuf; // High byte of lane k to byte_k
+    __m128i pack_lo_shuf; // Low byte of lane k to byte_k + 1
+    __m128i shift; // 16 - iq_width
+};
+
+static inline BfpLanes bfp_lanes(size_t iq_width)
+{
+    alignas(16) int8_t unpack_shuf[16], hi_shuf[16], lo_shuf[16];
+    alignas(16) int16_t unpack_mult[8], pack_mult[8];
+    memset(unpack_shuf, -1, sizeof(unpack_shuf)); // -1 zeroes the byte
+    memset(hi_shuf, -1, sizeof(hi_shuf));
+    memset(lo_shuf, -1, sizeof(lo_shuf));
+    for (size_t k = 0; k < 8; k++) {
+        const size_t byte = k * iq_width / 8;
+        const size_t off = k * iq_width % 8;
+        unpack_shuf[2 * k] = byte + 1;
+        unpack_shuf[2 * k + 1] = byte;
+        unpack_mult[k] = 1 << off;
+        pack_mult[k] = 1 << (16 - iq_width - off);
+        hi_shuf[byte] = 2 * k + 1;
+        lo_shuf[byte + 1] = 2 * k;
+    }
+
+    BfpLanes l;
+    l.unpack_shuf = _mm_load_si128(reinterpret_cast<__m128i*>(unpack_shuf));
+    l.unpack_mult = _mm_load_si128(reinterpret_cast<__m128i*>(unpack_mult));
+    l.pack_mult = _mm_load_si128(reinterpret_cast<__m128i*>(pack_mult));
+    l.pack_hi_shuf = _mm_load_si128(reinterpret_cast<__m128i*>(hi_shuf));
+    l.pack_lo_shuf = _mm_load_si128(reinterpret_cast<__m128i*>(lo_shuf));
+    l.shift = _mm_cvtsi32_si128(16 - iq_width);
+    return l;
+}
+
+// Decompress the block [blk] to 2 * kBfpBlockSamples floats in [out]. Reads
+// up to 16 - iq_width bytes past the end of the block.
+static inline void bfp_unpack_block(
+    const uint8_t* blk, const BfpLanes& l, size_t iq_width, float* out)
+{
+    // 2^exponent / 32768, like simd_convert_short_to_float()
+    const __m256 scale = _mm256_castsi256_ps(
+        _mm256_set1_epi32((127 + (blk[0] & 0xf) - 15) << 23));
+    for (size_t g = 0; g < 3; g++) {
+        __m128i x = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(blk + 1 + g * iq_width));
+        x = _mm_shuffle_epi8(x, l.unpack_shuf);
+        x = _mm_sra_epi16(_mm_mullo_epi16(x, l.unpack_mult), l.shift);
+        _mm256_storeu_ps(out + 8 * g,
+            _mm256_mul_ps(
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x)), scale));
+    }
+}
+
+// Decompress samples [first_sample, first_sample + num_samples) of a
+// compressed symbol [in] of [total_samples] complex samples to the float
+// array [out], scaled like simd_convert_short_to_float()
+static inline void bfp_decompress(const uint8_t* in, size_t iq_width,
+    size_t total_samples, size_t first_sample, size_t num_samples, float* out)
+{
+    const BfpLanes l = bfp_lanes(iq_width);
+    const size_t block_bytes = bfp_block_bytes(iq_width);
+    const size_t num_blocks
+        = (total_samples + kBfpBlockSamples - 1) / kBfpBlockSamples;
+    const size_t end = first_sample + num_samples;
+    alignas(32) float tile[2 * kBfpBlockSamples];
+    uint8_t last_blk[64];
+
+    size_t sample = first_sample;
+    while (sample < end) {
+        const size_t blk_id = sample / kBfpBlockSamples;
+        const size_t blk_start = blk_id * kBfpBlockSamples;
+        const uint8_t* blk = in + blk_id * block_bytes;
+        float* dst = out + 2 * (sample - first_sample);
+
+        // Whole blocks are decompressed in place. The symbol's last block is
+        // copied first so we don't read past the end of the packet.
+        if (sample == blk_start && end - sample >= kBfpBlockSamples
+            && blk_id + 1 < num_blocks) {
+            bfp_unpack_block(blk, l, iq_width, dst);
+            sample += kBfpBlockSamples;
+            continue;
+        }
+        if (blk_id + 1 == num_blocks) {
+            memcpy(last_blk, blk, block_bytes);
+            blk = last_blk;
+        }
+        bfp_unpack_block(blk, l, iq_width, tile);
+        const size_t n
+            = std::min(blk_start + kBfpBlockSamples, end) - sample;
+        memcpy(dst, &tile[2 * (sample - blk_start)], 2 * n * sizeof(float));
+        sample += n;
+    }
+}
+
+// Compress one block of 2 * kBfpBlockSamples short values [x] to [blk]. If
+// [last_blk] is true, nothing is written past the end of the block.
+static inline void bfp_pack_block(const __m128i* x, const BfpLanes& l,
+    size_t iq_width, bool last_blk, uint8_t* blk)
+{
+    // The exponent is the number of bits that the largest magnitude needs
+    // beyond iq_width, found from the OR of x ^ (x >> 15)
+    __m128i mag_or = _mm_setzero_si128();
+    for (size_t g = 0; g < 3; g++) {
+        mag_or = _mm_or_si128(
+            mag_or, _mm_xor_si128(x[g], _mm_srai_epi16(x[g], 15)));
+    }
+    mag_or = _mm_or_si128(mag_or, _mm_srli_si128(mag_or, 8));
+    mag_or = _mm_or_si128(mag_or, _mm_srli_si128(mag_or, 4));
+    mag_or = _mm_or_si128(mag_or, _mm_srli_si128(mag_or, 2));
+    const int mag = _mm_extract_epi16(mag_or, 0);
+    const int mag_bits = mag == 0 ? 0 : 32 - __builtin_clz(mag);
+    const int exponent = std::max(0, mag_bits + 1 - int(iq_width));
+    blk[0] = static_cast<uint8_t>(exponent);
+
+    const __m128i exp_shift = _mm_cvtsi32_si128(exponent);
+    const __m128i mask = _mm_set1_epi16((1 << iq_width) - 1);
+    for (size_t g = 0; g < 3; g++) {
+        __m128i m = _mm_and_si128(_mm_sra_epi16(x[g], exp_shift), mask);
+        m = _mm_mullo_epi16(m, l.pack_mult);
+        const __m128i packed = _mm_or_si128(_mm_shuffle_epi8(m, l.pack_hi_shuf),
+            _mm_shuffle_epi8(m, l.pack_lo_shuf));
+        // Bytes stored past the group are overwritten by the next group
+        uint8_t* dst = blk + 1 + g * iq_width;
+        if (last_blk && g == 2) {
+            alignas(16) uint8_t last_group[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(last_group), packed);
+            memcpy(dst, last_group, iq_width);
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), packed);
+        }
+    }
+}
+
+// Compress [num_samples] complex short samples [in] to [out] with
+// [iq_width]-bit mantissas. The last block is padded with zeros.
+static inline void bfp_compress(
+    const short* in, size_t num_samples, size_t iq_width, uint8_t* out)
+{
+    const BfpLanes l = bfp_lanes(iq_width);
+    const size_t block_bytes = bfp_block_bytes(iq_width);
+    alignas(16) short tile[2 * kBfpBlockSamples];
+
+    for (size_t s = 0; s < num_samples; s += kBfpBlockSamples) {
+        const short* src = in + 2 * s;
+        const bool last_blk = s + kBfpBlockSamples >= num_samples;
+        if (last_blk) {
+            memset(tile, 0, sizeof(tile));
+            memcpy(tile, src, 2 * (num_samples - s) * sizeof(short));
+            src = tile;
+        }
+        __m128i x[3];
+        for (size_t g = 0; g < 3; g++)
+            x[g] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + g);
+        bfp_pack_block(
+            x, l, iq_width, last_blk, out + s / kBfpBlockSamples * block_bytes);
+    }
+}
+
+// Compress [num_samples] complex float samples [in] to [out] with
+// [iq_width]-bit mantissas. Samples are multiplied by [scale] and saturated
+// to shorts first, like simd_convert_float_to_short().
+static inline void bfp_compress_float(const float* in, size_t num_samples,
+    float scale, size_t iq_width, uint8_t* out)
+{
+    const BfpLanes l = bfp_lanes(iq_width);
+    const size_t block_bytes = bfp_block_bytes(iq_width);
+    const __m256 scale_vec = _mm256_set1_ps(scale);
+    alignas(32) float tile[2 * kBfpBlockSamples];
+
+    for (size_t s = 0; s < num_samples; s += kBfpBlockSamples) {
+        const float* src = in + 2 * s;
+        const bool last_blk = s + kBfpBlockSamples >= num_samples;
+        if (last_blk) {
+            memset(tile, 0, sizeof(tile));
+            memcpy(tile, src, 2 * (num_samples - s) * sizeof(float));
+            src = tile;
+        }
+        __m128i x[3];
+        for (size_t g = 0; g < 3; g++) {
+            const __m256i v = _mm256_cvtps_epi32(
+                _mm256_mul_ps(_mm256_loadu_ps(src + 8 * g), scale_vec));
+            x[g] = _mm_packs_epi32(
+                _mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        }
+        bfp_pack_block(
+            x, l, iq_width, last_blk, out + s / kBfpBlockSamples * block_bytes);
+    }
+}
+
+#endif
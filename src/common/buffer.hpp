@@ -15,7 +15,11 @@
 union rx_tag_t {
     struct {
         size_t tid : 8; // ID of the socket thread that received the packet
-        size_t offset : 56; // Offset in the socket thread's RX buffer
+
+        // Offset in the socket thread's RX buffer. In DPDK zero-copy mode,
+        // this is the address of the rte_mbuf holding the packet, which fits
+        // since user-space addresses have at most 56 significant bits.
+        size_t offset : 56;
     };
     size_t _tag;
 
@@ -203,13 +207,17 @@ struct Packet {
     uint32_t symbol_id;
     uint32_t cell_id;
     uint32_t ant_id;
-    uint32_t fill[12]; // Padding for 64-byte alignment needed for SIMD
+    uint8_t comp_hdr; // O-RAN udCompHdr: (udIqWidth << 4) | udCompMeth
+    uint8_t reserved[3];
+    uint32_t fill[11]; // Padding for 64-byte alignment needed for SIMD
     short data[]; // Elements sent by antennae are two bytes (I/Q samples)
-    Packet(int f, int s, int c, int a) // TODO: Should be unsigned integers
+    Packet(int f, int s, int c, int a, // TODO: Should be unsigned integers
+        uint8_t comp = 0) // Uncompressed by default
         : frame_id(f)
         , symbol_id(s)
         , cell_id(c)
         , ant_id(a)
+        , comp_hdr(comp)
     {
     }
 
@@ -217,7 +225,8 @@ struct Packet {
     {
         std::ostringstream ret;
         ret << "[Frame seq num " << frame_id << ", symbol ID " << symbol_id
-            << ", cell ID " << cell_id << ", antenna ID " << ant_id << ", "
+            << ", cell ID " << cell_id << ", antenna ID " << ant_id
+            << ", compression header " << static_cast<size_t>(comp_hdr) << ", "
             << sizeof(fill) << " empty bytes]";
         return ret.str();
     }
@@ -276,11 +285,56 @@ public:
     // Number of reciprocity pilot packets we'll receive per frame
     size_t num_reciprocity_pkts_per_frame;
 
+    // ant_bitmaps[i % kFrameWnd][j] has bit k set if the packet from antenna
+    // k for symbol j of frame bitmap_frame_id[i % kFrameWnd] was received,
+    // or was replaced with zeros at the frame's RX deadline
+    std::array<std::array<uint64_t, kMaxSymbols>, kFrameWnd> ant_bitmaps;
+    std::array<size_t, kFrameWnd> bitmap_frame_id;
+
     RxCounters()
     {
         num_pkts.fill(0);
         num_pilot_pkts.fill(0);
         num_reciprocity_pkts.fill(0);
+        for (auto& bitmaps : ant_bitmaps)
+            bitmaps.fill(0);
+        bitmap_frame_id.fill(SIZE_MAX);
+    }
+
+    // Record the packet from antenna [ant_id] for symbol [symbol_id] of
+    // frame [frame_id]. Return false if it was already recorded.
+    bool mark_packet(size_t frame_id, size_t symbol_id, size_t ant_id)
+    {
+        const size_t frame_slot = frame_id % kFrameWnd;
+        if (bitmap_frame_id[frame_slot] != frame_id) {
+            ant_bitmaps[frame_slot].fill(0);
+            bitmap_frame_id[frame_slot] = frame_id;
+        }
+        const uint64_t ant_bit = 1ull << ant_id;
+        if (ant_bitmaps[frame_slot][symbol_id] & ant_bit)
+            return false;
+        ant_bitmaps[frame_slot][symbol_id] |= ant_bit;
+        return true;
+    }
+
+    // Forget the packets received for frame [frame_id]. Later packets of the
+    // frame are recorded as duplicates.
+    void reset_frame(size_t frame_id)
+    {
+        const size_t frame_slot = frame_id % kFrameWnd;
+        num_pkts[frame_slot] = 0;
+        num_pilot_pkts[frame_slot] = 0;
+        num_reciprocity_pkts[frame_slot] = 0;
+        for (auto& bitmap : ant_bitmaps[frame_slot])
+            bitmap = ~0ull;
+        bitmap_frame_id[frame_slot] = frame_id;
+    }
+
+    // Return true if all packets of frame [frame_id] have been recorded
+    bool received_all(size_t frame_id) const
+    {
+        return bitmap_frame_id[frame_id % kFrameWnd] == frame_id
+            and num_pkts[frame_id % kFrameWnd] == 0;
     }
 };
 
@@ -308,6 +362,12 @@ public:
         return symbol_count[frame_id % kFrameWnd];
     }
 
+    // Reset the counters of a frame that is dropped before completion
+    void reset_frame(size_t frame_id)
+    {
+        symbol_count[frame_id % kFrameWnd] = 0;
+    }
+
 private:
     std::array<size_t, kFrameWnd> symbol_count;
 };
@@ -329,14 +389,20 @@ public:
 
 class Data_stats : public Frame_stats {
 public:
-    size_t max_task_count;
-
     void init(int _max_task_count, int max_symbols, int max_data_symbol)
     {
         Frame_stats::init(max_symbols);
         for (size_t i = 0; i < kFrameWnd; i++)
             task_count[i] = new size_t[max_data_symbol]();
-        max_task_count = _max_task_count;
+        max_task_count.fill(_max_task_count);
+        num_data_symbols = max_data_symbol;
+    }
+
+    // Set the number of tasks per symbol of a frame, which can differ from
+    // frame to frame with link adaptation
+    void set_max_task_count(size_t frame_id, size_t _max_task_count)
+    {
+        max_task_count[frame_id % kFrameWnd] = _max_task_count;
     }
     void fini()
     {
@@ -346,7 +412,8 @@ public:
     bool last_task(size_t frame_id, size_t data_symbol_id)
     {
         const size_t frame_slot = frame_id % kFrameWnd;
-        if (++task_count[frame_slot][data_symbol_id] == max_task_count) {
+        if (++task_count[frame_slot][data_symbol_id]
+            == max_task_count[frame_slot]) {
             task_count[frame_slot][data_symbol_id] = 0;
             return true;
         }
@@ -358,8 +425,17 @@ public:
         return task_count[frame_id % kFrameWnd][symbol_id];
     }
 
+    void reset_frame(size_t frame_id)
+    {
+        Frame_stats::reset_frame(frame_id);
+        for (size_t i = 0; i < num_data_symbols; i++)
+            task_count[frame_id % kFrameWnd][i] = 0;
+    }
+
 private:
     size_t* task_count[kFrameWnd];
+    std::array<size_t, kFrameWnd> max_task_count;
+    size_t num_data_symbols = 0; // Zero if not initialized
 };
 
 class FFT_stats : public Data_stats {
@@ -368,16 +444,14 @@ public:
     std::array<size_t, kFrameWnd> symbol_rc_count;
     size_t max_symbol_rc_count;
 
-    // cur_frame_for_symbol[i] is the current frame for the symbol whose
-    // index in the frame's uplink symbols is i
-    std::vector<size_t> cur_frame_for_symbol;
+    void reset_frame(size_t frame_id)
+    {
+        Data_stats::reset_frame(frame_id);
+        symbol_rc_count[frame_id % kFrameWnd] = 0;
+    }
 };
 
 class Encode_stats : public Data_stats {
-public:
-    // cur_frame_for_symbol[i] is the current frame for the symbol whose
-    // index in the frame's uplink symbols is i
-    std::vector<size_t> cur_frame_for_symbol;
 };
 
 class RC_stats {
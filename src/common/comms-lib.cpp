@@ -467,7 +467,7 @@ std::vector<std::complex<float>> CommsLib::modulate(
     if (type == QPSK) {
         float qpsk_table[2][4]; // = init_qpsk();
         float scale = 1 / sqrt(2);
-        float mod_qpsk[2] = { -scale, scale };
+        float mod_qpsk[2] = { scale, -scale };
         for (int i = 0; i < 4; i++) {
             qpsk_table[0][i] = mod_qpsk[i / 2];
             qpsk_table[1][i] = mod_qpsk[i % 2];
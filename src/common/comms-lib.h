@@ -39,7 +39,7 @@ public:
         HADAMARD
     };
 
-    enum ModulationOrder { QPSK = 2, QAM16 = 4, QAM64 = 6 };
+    enum ModulationOrder { QPSK = 2, QAM16 = 4, QAM64 = 6, QAM256 = 8 };
 
     CommsLib(std::string);
     ~CommsLib();
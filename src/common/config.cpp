@@ -67,6 +67,7 @@ Config::Config(std::string jsonfile)
     ue_server_addr = tddConf.value("ue_server_addr", "127.0.0.1");
     mac_remote_addr = tddConf.value("mac_remote_addr", "127.0.0.1");
     bs_server_port = tddConf.value("bs_server_port", 8000);
+    xdp_ifname = tddConf.value("xdp_ifname", "veth0");
     bs_rru_port = tddConf.value("bs_rru_port", 9000);
     ue_rru_port = tddConf.value("ue_rru_port", 7000);
     ue_server_port = tddConf.value("ue_sever_port", 6000);
@@ -185,6 +186,9 @@ Config::Config(std::string jsonfile)
     core_offset = tddConf.value("core_offset", 0);
     worker_thread_num = tddConf.value("worker_thread_num", 25);
     socket_thread_num = tddConf.value("socket_thread_num", 4);
+    socket_batch_size = tddConf.value("socket_batch_size", 1);
+    dpdk_zero_copy = tddConf.value("dpdk_zero_copy", false);
+    rt_assert(!dpdk_zero_copy or kUseDPDK, "Zero-copy RX requires DPDK");
     fft_thread_num = tddConf.value("fft_thread_num", 5);
     demul_thread_num = tddConf.value("demul_thread_num", 5);
     decode_thread_num = tddConf.value("decode_thread_num", 10);
@@ -203,13 +207,86 @@ Config::Config(std::string jsonfile)
                                           : tddConf.value("zf_block_size", 1);
     zf_events_per_symbol = 1 + (OFDM_DATA_NUM - 1) / zf_block_size;
 
+    zf_tracking_mode = tddConf.value("zf_tracking_mode", false);
+    zf_reuse_threshold = tddConf.value("zf_reuse_threshold", 0.001);
+    zf_refine_threshold = tddConf.value("zf_refine_threshold", 0.05);
+    rt_assert(zf_reuse_threshold <= zf_refine_threshold,
+        "ZF reuse threshold must not exceed ZF refine threshold");
+
+    frame_deadline_us = tddConf.value("frame_deadline_us", 0);
+    rx_deadline_us = tddConf.value("rx_deadline_us", 0);
+    rt_assert(rx_deadline_us == 0 or BS_ANT_NUM <= kMaxAntennas,
+        "RX deadline mode supports up to kMaxAntennas antennas");
+    rt_assert(rx_deadline_us == 0 or !recipCalEn,
+        "RX deadline mode does not support reciprocity calibration");
+
     fft_block_size = tddConf.value("fft_block_size", 1);
+    rt_assert(fft_block_size >= 1 and fft_block_size <= Event_data::kMaxTags,
+        "FFT block size must be in [1, Event_data::kMaxTags]");
     encode_block_size = tddConf.value("encode_block_size", 1);
 
+    fused_precode_ifft = tddConf.value("fused_precode_ifft", false);
+    fused_precode_ant_block_size
+        = tddConf.value("fused_precode_ant_block_size", 8);
+    rt_assert(fused_precode_ant_block_size >= 1,
+        "Fused precode antenna block size must be at least 1");
+    fused_precode_events_per_symbol
+        = 1 + (BS_ANT_NUM - 1) / fused_precode_ant_block_size;
+    decode_block_size = tddConf.value("decode_block_size", 0);
+
+    work_stealing_mode = tddConf.value("work_stealing_mode", false);
+    if (work_stealing_mode and (downlink_mode or bigstation_mode)) {
+        printf("Config: Work-stealing mode supports only uplink frames in "
+               "non-BigStation mode. Disabling work-stealing mode.\n");
+        work_stealing_mode = false;
+    }
+
+    overload_shedding = tddConf.value("overload_shedding", false);
+    overload_frame_lag = tddConf.value("overload_frame_lag", kFrameWnd / 2);
+    overload_queue_depth = tddConf.value("overload_queue_depth", 0);
+    if (overload_shedding and work_stealing_mode) {
+        printf("Config: Overload shedding is not supported in work-stealing "
+               "mode. Disabling overload shedding.\n");
+        overload_shedding = false;
+    }
+    rt_assert(overload_frame_lag >= 1 and overload_frame_lag <= kFrameWnd,
+        "Overload frame lag must be in [1, kFrameWnd]");
+
+    buffer_page_backing = page_backing_from_string(
+        tddConf.value("buffer_page_size", "4K"));
+
+    numa_buffer_policy = tddConf.value("numa_buffer_policy", "default");
+    NumaUtils::policy_from_string(numa_buffer_policy); // Validate the name
+    json jnodes = tddConf.value("worker_numa_nodes", json::array());
+    for (size_t i = 0; i < jnodes.size(); i++) {
+        worker_numa_nodes.push_back(jnodes.at(i).get<size_t>());
+        rt_assert(worker_numa_nodes.back() < NumaUtils::num_nodes(),
+            "Invalid worker NUMA node");
+    }
+    if (!worker_numa_nodes.empty()) {
+        // The master thread and socket threads keep their cores
+        std::vector<size_t> reserved_cores;
+        for (size_t i = 0; i <= socket_thread_num; i++)
+            reserved_cores.push_back(core_offset + i);
+        worker_cores = NumaUtils::assign_worker_cores(
+            worker_numa_nodes, worker_thread_num, reserved_cores);
+    }
+
+    task_trace_events = tddConf.value("task_trace_events", 0);
+    metrics_port = tddConf.value("metrics_port", 0);
+
     /* LDPC Coding configurations */
     LDPC_config.Bg = tddConf.value("base_graph", 1);
     LDPC_config.earlyTermination = tddConf.value("earlyTermination", 1);
     LDPC_config.decoderIter = tddConf.value("decoderIter", 5);
+    LDPC_config.cbCrc = tddConf.value("cbCrc", false);
+    LDPC_config.adaptiveIter = tddConf.value("adaptiveDecoderIter", false);
+    LDPC_config.decoderIterMin = tddConf.value("decoderIterMin", 1);
+    rt_assert(!LDPC_config.adaptiveIter or frame_deadline_us > 0,
+        "Adaptive decoder iterations require a frame deadline");
+    rt_assert(LDPC_config.decoderIterMin >= 1
+            and LDPC_config.decoderIterMin <= LDPC_config.decoderIter,
+        "Minimum decoder iterations must be in [1, decoderIter]");
     LDPC_config.Zc = tddConf.value("Zc", 72);
     LDPC_config.nRows = tddConf.value("nRows", (LDPC_config.Bg == 1) ? 46 : 42);
     LDPC_config.cbLen = ldpc_num_input_bits(LDPC_config.Bg, LDPC_config.Zc);
@@ -217,15 +294,40 @@ Config::Config(std::string jsonfile)
         LDPC_config.Bg, LDPC_config.Zc, LDPC_config.nRows);
 
     /* Modulation configurations */
-    mod_order_bits = modulation == "64QAM"
-        ? CommsLib::QAM64
-        : (modulation == "16QAM" ? CommsLib::QAM16 : CommsLib::QPSK);
-    update_mod_cfgs(mod_order_bits);
+    if (modulation == "256QAM")
+        mod_order_bits = CommsLib::QAM256;
+    else if (modulation == "64QAM")
+        mod_order_bits = CommsLib::QAM64;
+    else if (modulation == "16QAM")
+        mod_order_bits = CommsLib::QAM16;
+    else
+        mod_order_bits = CommsLib::QPSK;
+    for (size_t bits = CommsLib::QPSK; bits <= mod_order_bits; bits += 2)
+        init_mod_cfg(bits);
+
+    const ModConfig& cfg_mod = mod_cfgs_[mod_order_bits];
+    mod_order = cfg_mod.mod_order;
+    init_modulation_table(mod_table, mod_order);
+    LDPC_config.nblocksInSymbol = cfg_mod.nblocksInSymbol;
+    decode_batch_size = cfg_mod.decode_batch_size;
+    decode_events_per_symbol = cfg_mod.decode_events_per_symbol;
+    frame_mod_order_bits_.fill(mod_order_bits);
 
     rt_assert(LDPC_config.nblocksInSymbol > 0,
         "LDPC expansion factor is too large for number of OFDM data "
         "subcarriers.");
 
+    link_adaptation = tddConf.value("link_adaptation", false);
+    if (link_adaptation) {
+        printf("Config: link adaptation between modulation orders:");
+        for (size_t bits = CommsLib::QPSK; bits <= mod_order_bits; bits += 2) {
+            if (mod_order_supported(bits))
+                printf(" %zu bits (%zu code blocks)", bits,
+                    mod_cfgs_[bits].nblocksInSymbol);
+        }
+        printf("\n");
+    }
+
     printf("Config: LDPC: Zc: %d, %zu code blocks per symbol, %d information "
            "bits per encoding, %d bits per encoded code word, decoder "
            "iterations: %d, code rate %.3f (nRows = %zu)\n",
@@ -234,15 +336,34 @@ Config::Config(std::string jsonfile)
         1.f * ldpc_num_input_cols(LDPC_config.Bg)
             / (ldpc_num_input_cols(LDPC_config.Bg) - 2 + LDPC_config.nRows),
         LDPC_config.nRows);
+    printf("Config: %zu code blocks per decode event, %zu decode events per "
+           "symbol\n",
+        decode_batch_size, decode_events_per_symbol);
 
     fft_in_rru = tddConf.value("fft_in_rru", false);
+    bfp_iq_width = tddConf.value("bfp_iq_width", 0);
+    rt_assert(bfp_iq_width == 0 or bfp_width_supported(bfp_iq_width),
+        "BFP compression supports 8, 9, and 12-bit mantissas");
+    rt_assert(bfp_iq_width == 0 or !fft_in_rru,
+        "BFP compression is not supported with FFT in the RRU");
 
     sampsPerSymbol
         = ofdm_tx_zero_prefix_ + OFDM_CA_NUM + CP_LEN + ofdm_tx_zero_postfix_;
-    packet_length
-        = Packet::kOffsetOfData + (2 * sizeof(short) * sampsPerSymbol);
+    packet_length = Packet::kOffsetOfData
+        + (bfp_iq_width == 0
+                  ? 2 * sizeof(short) * sampsPerSymbol
+                  : bfp_compressed_bytes(sampsPerSymbol, bfp_iq_width));
     rt_assert(
         packet_length < 9000, "Packet size must be smaller than jumbo frame");
+    rx_slot_size = packet_length;
+    rx_pkt_offset = 0;
+    if (kUseXDP) {
+        // UMEM frames must have a power-of-two size
+        rx_pkt_offset = kXdpRxPktOffset;
+        rx_slot_size = 2048;
+        while (rx_slot_size < rx_pkt_offset + packet_length)
+            rx_slot_size *= 2;
+    }
 
     num_bytes_per_cb = LDPC_config.cbLen / 8; // TODO: Use bits_to_bytes()?
     data_bytes_num_persymbol = num_bytes_per_cb * LDPC_config.nblocksInSymbol;
@@ -625,6 +746,8 @@ Config::~Config()
     free_buffer_1d(&pilots_);
     free_buffer_1d(&pilots_sgn_);
     mod_table.free();
+    for (auto& mod_cfg : mod_cfgs_)
+        mod_cfg.mod_table.free();
     dl_bits.free();
     ul_bits.free();
     dl_iq_f.free();
@@ -1,6 +1,8 @@
 #ifndef CONFIG_HEADER
 #define CONFIG_HEADER
 
+#include <algorithm>
+#include <array>
 #include <boost/range/algorithm/count.hpp>
 #include <complex.h>
 #include <emmintrin.h>
@@ -15,10 +17,12 @@
 #define JSON
 #ifdef JSON
 #include "Symbols.hpp"
+#include "bfp.h"
 #include "buffer.hpp"
 #include "comms-lib.h"
 #include "memory_manage.h"
 #include "modulation.hpp"
+#include "numa_utils.hpp"
 #include "utils.h"
 #include "utils_ldpc.hpp"
 #include <nlohmann/json.hpp>
@@ -39,6 +43,15 @@ public:
     /// if it decodes the codeblock eariler
     bool earlyTermination;
 
+    /// If true, the last kCbCrcBytes information bytes of each codeblock carry
+    /// a CRC24 of the preceding bytes, which the decoder checks
+    bool cbCrc;
+
+    /// If true, the decoder lowers the number of iterations for a codeblock
+    /// (down to decoderIterMin) as its frame approaches frame_deadline_us
+    bool adaptiveIter;
+    int16_t decoderIterMin; /// Minimum number of iterations in adaptive mode
+
     size_t nRows; /// Number of rows in the LDPC base graph to use
     uint32_t cbLen; /// Number of information bits input to LDPC encoding
     uint32_t cbCodewLen; /// Number of codeword bits output from LDPC encoding
@@ -58,6 +71,22 @@ public:
     }
 };
 
+// Parameters that depend on the modulation order. With link adaptation, each
+// frame is processed with the ModConfig of its own modulation order.
+class ModConfig {
+public:
+    size_t mod_order; // Modulation order (e.g., 4: QPSK, 16: 16QAM, 64: 64QAM)
+    size_t mod_order_bits; // Number of binary bits used for a modulation order
+
+    // Modulation lookup table for mapping binary bits to constellation points
+    Table<complex_float> mod_table;
+
+    // Number of LDPC code blocks per UE per symbol. Zero if not initialized.
+    size_t nblocksInSymbol = 0;
+    size_t decode_batch_size = 0; // Number of code blocks per decode event
+    size_t decode_events_per_symbol = 0; // Derived from decode_batch_size
+};
+
 class Config {
 public:
     std::string modulation; // Modulation order as a string, e.g., "16QAM"
@@ -67,6 +96,22 @@ public:
     // Modulation lookup table for mapping binary bits to constellation points
     Table<complex_float> mod_table;
 
+    // If true, the MAC picks the modulation order of each frame from the
+    // UEs' SNR reports, up to the configured modulation, and Agora and the
+    // UEs switch to it from the frame the MAC signals. Frames with a lower
+    // order carry fewer code blocks per symbol. The fields above keep the
+    // configured order, which sizes the buffers and the MAC payload; MAC
+    // packets are not resized per frame yet, so this is off by default.
+    bool link_adaptation;
+
+    // The ModConfig of each modulation order, indexed by mod_order_bits. Only
+    // orders up to the configured one whose code blocks fit in a symbol are
+    // initialized.
+    std::array<ModConfig, kMaxModType + 1> mod_cfgs_;
+
+    // The modulation order bits of the frame in each frame slot
+    std::array<size_t, kFrameWnd> frame_mod_order_bits_;
+
     std::vector<std::string> radio_ids;
     std::vector<std::string> hub_ids;
 
@@ -149,6 +194,10 @@ public:
     size_t core_offset;
     size_t worker_thread_num;
     size_t socket_thread_num;
+    // Number of packets received or sent with one socket system call. One
+    // means per-packet recv() and sendto(), larger values use recvmmsg() and
+    // sendmmsg().
+    size_t socket_batch_size;
     size_t fft_thread_num;
     size_t demul_thread_num;
     size_t decode_thread_num;
@@ -162,12 +211,99 @@ public:
     size_t zf_block_size;
     size_t zf_events_per_symbol; // Derived from zf_block_size
 
-    // Number of antennas handled in one FFT event
+    // If true, reuse or refine a subcarrier's zeroforcing matrices from an
+    // earlier frame if its CSI has changed little since then
+    bool zf_tracking_mode;
+
+    // In ZF tracking mode, the relative CSI change (squared Frobenius norm of
+    // the difference from the reference CSI, over that of the reference CSI)
+    // up to which the reference zeroforcing matrix is reused as is
+    double zf_reuse_threshold;
+
+    // In ZF tracking mode, the relative CSI change up to which the reference
+    // zeroforcing matrix is refined with one Newton-Schulz iteration. Larger
+    // changes require a full inverse.
+    double zf_refine_threshold;
+
+    // Deadline for processing an uplink frame, in microseconds after its
+    // first pilot packet is received. Zero means no deadline.
+    size_t frame_deadline_us;
+
+    // Deadline for receiving the pilot and uplink packets of a frame, in
+    // microseconds after its first packet is received. Packets still missing
+    // at the deadline are replaced with zeros, so the frame is processed with
+    // the remaining antennas. Zero means waiting for all packets.
+    //
+    // Calibration symbols cannot be zero-filled, since a zero calibration
+    // sample would corrupt the reciprocity calibration of the frame. This
+    // mode is therefore rejected when reciprocity calibration is enabled.
+    size_t rx_deadline_us;
+
+    // In overload shedding mode, Agora drops the oldest in-flight frames when
+    // it falls behind instead of stopping. Socket threads also discard
+    // packets when their RX buffer is full.
+    bool overload_shedding;
+
+    // In overload shedding mode, the oldest in-flight frame is shed when a
+    // packet arrives for a frame this many frames newer
+    size_t overload_frame_lag;
+
+    // In overload shedding mode, the oldest in-flight frame is also shed when
+    // a new frame starts while more than this many tasks are queued for
+    // workers. Zero means queue depth is not used.
+    size_t overload_queue_depth;
+
+    // Placement of the pages of Agora's shared uplink and downlink buffers on
+    // NUMA nodes: "default", "interleave", "first_touch", or
+    // "frame_slot_local". See NumaPolicy.
+    std::string numa_buffer_policy;
+
+    // NUMA nodes that run worker threads. Workers are split evenly across
+    // the nodes in order. Empty means workers run on consecutive cores after
+    // the socket threads.
+    std::vector<size_t> worker_numa_nodes;
+
+    // The core of each worker thread if worker_numa_nodes is not empty
+    std::vector<size_t> worker_cores;
+
+    // Pages that back the large RX, FFT, CSI, demodulation, and decoding
+    // buffers: "4K", "thp", "2M", or "1G". Hugetlb pages that are not
+    // reserved fall back to transparent hugepages.
+    PageBacking buffer_page_backing;
+
+    // Number of tasks to record per worker for the Chrome trace saved to
+    // data/task_trace.json at exit or on SIGUSR1. Zero disables tracing.
+    size_t task_trace_events;
+
+    // Port on the loopback interface where Agora serves its runtime metrics
+    // in Prometheus text format. Zero disables the metrics server.
+    size_t metrics_port;
+
+    // Number of packets handled in one FFT event, at most
+    // Event_data::kMaxTags. A worker transforms all packets of an event with
+    // one batched MKL DFTI call.
     size_t fft_block_size;
 
+    // If true, downlink precoding, IFFT, and conversion to TX packets are done
+    // by one task per block of antennas, without the dl_ifft_buffer pass
+    // between separate precode and IFFT tasks. Encode tasks then also
+    // modulate their code blocks, so that all antenna blocks of a symbol
+    // share one modulated copy.
+    bool fused_precode_ifft;
+
+    // Number of antennas handled in one fused precode and IFFT event
+    size_t fused_precode_ant_block_size;
+    size_t fused_precode_events_per_symbol; // Derived from the above
+
     // Number of code blocks handled in one encode event
     size_t encode_block_size;
 
+    // Number of consecutive code blocks of a symbol handled in one decode
+    // event. Zero means the size is chosen from Zc and the number of workers.
+    size_t decode_block_size;
+    size_t decode_batch_size; // Derived from decode_block_size
+    size_t decode_events_per_symbol; // Derived from decode_batch_size
+
     bool freq_orthogonal_pilot;
     size_t BS_ANT_NUM;
     size_t UE_NUM;
@@ -222,6 +358,12 @@ public:
     // Ethernet/IP/UDP headers.
     size_t packet_length;
 
+    // Size of a packet's slot in the RX socket buffers, and the offset of the
+    // packet in its slot. These differ from packet_length and zero only with
+    // AF_XDP, where each slot is a UMEM frame that also holds headers.
+    size_t rx_slot_size;
+    size_t rx_pkt_offset;
+
     size_t OFDM_PILOT_SPACING;
 
     size_t DL_PILOT_SYMS;
@@ -253,6 +395,10 @@ public:
     size_t dl_data_symbol_start, dl_data_symbol_end;
     bool downlink_mode; // If true, the frame contains downlink symbols
     bool bigstation_mode; // If true, use pipeline-parallel scheduling
+
+    // If true, workers schedule uplink decode tasks into per-worker queues
+    // and steal from each other, instead of going through the master thread
+    bool work_stealing_mode;
     bool correct_phase_shift; // If true, do phase shift correction
 
     // The total number of uncoded data bytes in each OFDM symbol
@@ -288,6 +434,9 @@ public:
 
     int bs_server_port; // Base UDP port used by BS to receive data
 
+    // Network interface that BS receives data on with AF_XDP
+    std::string xdp_ifname;
+
     // Base RRU/channel simulator UDP port used by BS to transmit downlink data
     int bs_rru_port;
 
@@ -314,6 +463,15 @@ public:
 
     bool fft_in_rru; // If true, the RRU does FFT instead of Agora
 
+    // If nonzero, time-domain fronthaul packets carry O-RAN block floating
+    // point compressed samples with mantissas of this many bits (8, 9, or
+    // 12), instead of 16-bit samples. Only the simulator RRU supports this.
+    size_t bfp_iq_width;
+
+    // If true, received DPDK packets are not copied into the socket buffers.
+    // RX events carry the packet's mbuf, which is freed after FFT.
+    bool dpdk_zero_copy;
+
     bool isUE;
     const size_t maxFrame = 1 << 30;
     const size_t data_offset = sizeof(int) * 16;
@@ -341,13 +499,54 @@ public:
     /// Return the symbol type of this symbol in this frame
     SymbolType get_symbol_type(size_t frame_id, size_t symbol_id);
 
-    inline void update_mod_cfgs(size_t new_mod_order_bits)
+    /// Initialize the ModConfig of modulation order [mod_order_bits]
+    inline void init_mod_cfg(size_t mod_order_bits)
     {
-        mod_order_bits = new_mod_order_bits;
-        mod_order = (size_t)pow(2, mod_order_bits);
-        init_modulation_table(mod_table, mod_order);
-        LDPC_config.nblocksInSymbol
+        ModConfig& mod_cfg = mod_cfgs_[mod_order_bits];
+        mod_cfg.mod_order_bits = mod_order_bits;
+        mod_cfg.mod_order = (size_t)pow(2, mod_order_bits);
+        init_modulation_table(mod_cfg.mod_table, mod_cfg.mod_order);
+        mod_cfg.nblocksInSymbol
             = OFDM_DATA_NUM * mod_order_bits / LDPC_config.cbCodewLen;
+
+        const size_t num_cbs = UE_NUM * mod_cfg.nblocksInSymbol;
+        size_t batch_size = decode_block_size;
+        if (batch_size == 0) {
+            // Batch small code blocks, but keep at least one batch per
+            // decoding worker
+            const size_t num_workers
+                = bigstation_mode ? decode_thread_num : worker_thread_num;
+            batch_size = std::min(
+                (kDecodeBatchTargetZc + LDPC_config.Zc - 1) / LDPC_config.Zc,
+                (num_cbs + num_workers - 1) / num_workers);
+        }
+        mod_cfg.decode_batch_size = std::max(batch_size, size_t(1));
+        mod_cfg.decode_events_per_symbol
+            = (num_cbs + mod_cfg.decode_batch_size - 1)
+            / mod_cfg.decode_batch_size;
+    }
+
+    /// Return true iff frames can use modulation order [mod_order_bits]
+    inline bool mod_order_supported(size_t mod_order_bits) const
+    {
+        return mod_order_bits <= this->mod_order_bits
+            and mod_cfgs_[mod_order_bits].nblocksInSymbol > 0;
+    }
+
+    /// Use modulation order [mod_order_bits] for frame [frame_id]. This must
+    /// be called before any task of the frame is scheduled.
+    inline void set_frame_mod_order_bits(
+        size_t frame_id, size_t mod_order_bits)
+    {
+        rt_assert(mod_order_supported(mod_order_bits),
+            "Unsupported modulation order for this frame");
+        frame_mod_order_bits_[frame_id % kFrameWnd] = mod_order_bits;
+    }
+
+    /// Return the modulation config of frame [frame_id]
+    inline const ModConfig& mod_cfg(size_t frame_id) const
+    {
+        return mod_cfgs_[frame_mod_order_bits_[frame_id % kFrameWnd]];
     }
 
     /// Return total number of data symbols of all frames in a buffer
@@ -382,6 +581,19 @@ public:
         return symbol_num_perframe * sampsPerSymbol / rate;
     }
 
+    /// Return the O-RAN compression header of time-domain fronthaul packets
+    inline uint8_t fronthaul_comp_hdr() const
+    {
+        return bfp_iq_width == 0 ? kCompMethNone : bfp_comp_hdr(bfp_iq_width);
+    }
+
+    /// Return the packet in slot [slot] of a socket thread's RX buffer
+    inline Packet* get_rx_packet(char* rx_buffer, size_t slot) const
+    {
+        return reinterpret_cast<Packet*>(
+            rx_buffer + slot * rx_slot_size + rx_pkt_offset);
+    }
+
     /// Fetch the data buffer for this frame and symbol ID. The symbol must
     /// be an uplink symbol.
     inline complex_float* get_data_buf(Table<complex_float>& data_buffers,
@@ -434,7 +646,7 @@ public:
         size_t total_data_symbol_id
             = get_total_data_symbol_idx_dl(frame_id, symbol_id);
         size_t num_encoded_bytes_per_cb
-            = LDPC_config.cbCodewLen / mod_order_bits;
+            = LDPC_config.cbCodewLen / mod_cfg(frame_id).mod_order_bits;
         return &encoded_buffer[total_data_symbol_id]
                               [roundup<64>(OFDM_DATA_NUM) * ue_id
                                   + num_encoded_bytes_per_cb * cb_id];
@@ -126,3 +126,21 @@ bool DoCRC::check_crc24(unsigned char* data, int len, uint32_t ref_crc)
 
     return rval;
 }
+
+DoCRC::~DoCRC() {}
+
+void DoCRC::add_cb_crc24(unsigned char* data, int len)
+{
+    uint32_t crc = calculate_crc24(data, len - kCbCrcBytes);
+    data[len - 3] = HI(crc);
+    data[len - 2] = MID(crc);
+    data[len - 1] = LO(crc);
+}
+
+bool DoCRC::check_cb_crc24(const unsigned char* data, int len)
+{
+    uint32_t crc
+        = calculate_crc24(const_cast<unsigned char*>(data), len - kCbCrcBytes);
+    return data[len - 3] == HI(crc) && data[len - 2] == MID(crc)
+        && data[len - 1] == LO(crc);
+}
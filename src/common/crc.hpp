@@ -29,6 +29,9 @@
 #define MID(x) (unsigned char)(((x) >> 8) & 0xff)
 #define HI(x) (unsigned char)(((x) >> 16) & 0xff)
 
+// Number of bytes of the CRC24 appended to a codeblock's information bytes
+static constexpr size_t kCbCrcBytes = 3;
+
 class DoCRC {
 private:
     const uint32_t crc24_table[256];
@@ -111,6 +114,17 @@ public:
      * Verify CRC
      */
     bool check_crc24(unsigned char* data, int len, uint32_t ref_crc);
+
+    /*
+     * Compute the CRC of the first (len - kCbCrcBytes) bytes of a codeblock
+     * and write it to the last kCbCrcBytes bytes
+     */
+    void add_cb_crc24(unsigned char* data, int len);
+
+    /*
+     * Verify the CRC in the last kCbCrcBytes bytes of a codeblock
+     */
+    bool check_cb_crc24(const unsigned char* data, int len);
 };
 
 #endif
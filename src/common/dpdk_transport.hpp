@@ -48,6 +48,12 @@ public:
         uint16_t dst_port);
 
     static void fastMemcpy(void* pvDest, void* pvSrc, size_t nBytes);
+
+    /// Return the UDP payload of a received packet
+    static inline uint8_t* udp_payload(rte_mbuf* pkt)
+    {
+        return rte_pktmbuf_mtod(pkt, uint8_t*) + kPayloadOffset;
+    }
     static void print_pkt(int src_ip, int dst_ip, uint16_t src_port,
         uint16_t dst_port, int len, int tid);
 
@@ -63,5 +69,7 @@ public:
 
     /// Init dpdk on core [core_offset:core_offset+thread_num]
     static void dpdk_init(uint16_t core_offset, size_t thread_num);
-    static rte_mempool* create_mempool();
+
+    /// Create a pool of [num_mbufs] mbufs per available port
+    static rte_mempool* create_mempool(size_t num_mbufs = NUM_MBUFS);
 };
\ No newline at end of file
@@ -6,28 +6,161 @@
 #include <cstring>
 #include <malloc.h>
 #include <random>
+#include <stdint.h>
 #include <stdio.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+// The pages that back a buffer
+enum class PageBacking {
+    kDefault, // The heap, usually 4 KB pages
+    kTHP, // A 2 MB-aligned mapping with transparent hugepages requested
+    kHuge2M, // 2 MB hugetlb pages, which must be reserved beforehand
+    kHuge1G // 1 GB hugetlb pages, which must be reserved beforehand
+};
+
+/// Parse a page size name: "4K", "thp", "2M", or "1G"
+static inline PageBacking page_backing_from_string(const std::string& name)
+{
+    if (name == "thp")
+        return PageBacking::kTHP;
+    if (name == "2M")
+        return PageBacking::kHuge2M;
+    if (name == "1G")
+        return PageBacking::kHuge1G;
+    if (name != "4K")
+        fprintf(stderr, "Unknown page size %s, using 4K\n", name.c_str());
+    return PageBacking::kDefault;
+}
+
+static inline const char* page_backing_str(PageBacking backing)
+{
+    switch (backing) {
+    case PageBacking::kDefault:
+        return "4K pages";
+    case PageBacking::kTHP:
+        return "transparent hugepages";
+    case PageBacking::kHuge2M:
+        return "2M hugepages";
+    case PageBacking::kHuge1G:
+        return "1G hugepages";
+    }
+    return "invalid";
+}
+
+/// Return the page size to use for placing a buffer with [backing]
+static inline size_t page_backing_size(PageBacking backing)
+{
+    switch (backing) {
+    case PageBacking::kDefault:
+        return sysconf(_SC_PAGESIZE);
+    case PageBacking::kTHP:
+    case PageBacking::kHuge2M:
+        return 1ul << 21;
+    case PageBacking::kHuge1G:
+        return 1ul << 30;
+    }
+    return sysconf(_SC_PAGESIZE);
+}
+
+/// Map [size] bytes of zeroed memory backed by hugepages. If no hugetlb pages
+/// of the requested size are available, fall back to a 2 MB-aligned mapping
+/// with transparent hugepages. [backing] must not be kDefault, and is updated
+/// to the backing that was used. [mapped_size] is set to the size to pass to
+/// page_backed_free().
+static inline void* page_backed_alloc(
+    size_t size, PageBacking& backing, size_t& mapped_size)
+{
+    if (backing == PageBacking::kHuge2M || backing == PageBacking::kHuge1G) {
+        const size_t page_size = page_backing_size(backing);
+        const int huge_flag = MAP_HUGETLB
+            | (backing == PageBacking::kHuge1G ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+        mapped_size = (size + page_size - 1) / page_size * page_size;
+        void* buf = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | huge_flag, -1, 0);
+        if (buf != MAP_FAILED)
+            return buf;
+        fprintf(stderr,
+            "Failed to map %zu bytes with %s. Reserve more hugepages in "
+            "/sys/kernel/mm/hugepages. Using transparent hugepages.\n",
+            mapped_size, page_backing_str(backing));
+        backing = PageBacking::kTHP;
+    }
+
+    // Over-allocate to find a 2 MB-aligned range, and unmap the rest
+    const size_t huge_size = page_backing_size(PageBacking::kTHP);
+    mapped_size = (size + huge_size - 1) / huge_size * huge_size;
+    const size_t reserve_size = mapped_size + huge_size;
+    auto* base = static_cast<uint8_t*>(mmap(nullptr, reserve_size,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED) {
+        perror("Failed to map buffer");
+        exit(-1);
+    }
+    const size_t head = (huge_size - reinterpret_cast<size_t>(base) % huge_size)
+        % huge_size;
+    if (head > 0)
+        munmap(base, head);
+    munmap(base + head + mapped_size, reserve_size - head - mapped_size);
+
+    if (madvise(base + head, mapped_size, MADV_HUGEPAGE) != 0)
+        fprintf(stderr, "Transparent hugepages are not available\n");
+    return base + head;
+}
+
+static inline void page_backed_free(void* buf, size_t mapped_size)
+{
+    munmap(buf, mapped_size);
+}
 
 template <typename T> class Table {
 private:
     size_t dimension;
+    size_t rows;
     void* data;
+    PageBacking backing; // The pages that back data
+    size_t mapped_size; // The size of data's mapping if not heap-allocated
 
 public:
     Table(void)
         : dimension(0)
+        , rows(0)
         , data(NULL)
+        , backing(PageBacking::kDefault)
+        , mapped_size(0)
     {
     }
-    void malloc(size_t dim1, size_t dim2, size_t aligned_bytes)
+
+    /// Allocate [dim1] rows of [dim2] entries, where each row is aligned to
+    /// [aligned_bytes], in memory backed by [page_backing]
+    void malloc(size_t dim1, size_t dim2, size_t aligned_bytes,
+        PageBacking page_backing = PageBacking::kDefault)
     {
         aligned_bytes = (aligned_bytes) / 32 * 32;
         dimension = (dim2 * sizeof(T) + aligned_bytes - 1) & -aligned_bytes;
-        data = aligned_alloc(aligned_bytes, dim1 * dimension);
+        rows = dim1;
+        backing = page_backing;
+        if (backing == PageBacking::kDefault) {
+            data = aligned_alloc(aligned_bytes, dim1 * dimension);
+        } else {
+            data = page_backed_alloc(dim1 * dimension, backing, mapped_size);
+        }
     }
-    void calloc(size_t dim1, size_t dim2, size_t aligned_bytes)
+    void calloc(size_t dim1, size_t dim2, size_t aligned_bytes,
+        PageBacking page_backing = PageBacking::kDefault)
     {
-        malloc(dim1, dim2, aligned_bytes);
+        malloc(dim1, dim2, aligned_bytes, page_backing);
         memset(data, 0, dim1 * dimension);
     }
 
@@ -61,14 +194,29 @@ public:
 
     bool is_allocated() { return dimension > 0; }
 
+    /// Return the size of the table in bytes, including row padding
+    size_t size_bytes() const { return rows * dimension; }
+
+    PageBacking page_backing() const { return backing; }
+
     void free(void)
     {
-        std::free(data);
+        if (backing == PageBacking::kDefault) {
+            std::free(data);
+        } else if (data != NULL) {
+            page_backed_free(data, mapped_size);
+        }
         dimension = 0;
+        rows = 0;
+        backing = PageBacking::kDefault;
         data = NULL;
     }
 
     T* operator[](int dim1) { return (T*)((char*)data + dim1 * dimension); }
+    const T* operator[](int dim1) const
+    {
+        return (const T*)((const char*)data + dim1 * dimension);
+    }
 };
 
 template <typename T, typename U>
@@ -96,23 +244,34 @@ public:
     /// only the grid with dimensions [n_rows, n_cols] has cells pointing to an
     /// array of [n_entries]. This can use less memory than a fully-allocated
     /// grid.
-    PtrGrid(size_t n_rows, size_t n_cols, size_t n_entries)
+    PtrGrid(size_t n_rows, size_t n_cols, size_t n_entries,
+        PageBacking page_backing = PageBacking::kDefault)
     {
         assert(n_rows <= ROWS && n_cols <= COLS);
-        alloc(n_rows, n_cols, n_entries);
+        alloc(n_rows, n_cols, n_entries, page_backing);
     }
 
     ~PtrGrid()
     {
-        if (is_allocated)
+        if (!is_allocated)
+            return;
+        if (backing == PageBacking::kDefault) {
             free(backing_buf);
+        } else {
+            page_backed_free(backing_buf, mapped_size);
+        }
     }
 
     /// Allocate [n_entries] entries per pointer cell
-    void alloc(size_t n_rows, size_t n_cols, size_t n_entries)
+    void alloc(size_t n_rows, size_t n_cols, size_t n_entries,
+        PageBacking page_backing = PageBacking::kDefault)
     {
         const size_t alloc_sz = n_rows * n_cols * n_entries * sizeof(T);
-        backing_buf = reinterpret_cast<T*>(memalign(64, alloc_sz));
+        backing = page_backing;
+        backing_buf = reinterpret_cast<T*>(backing == PageBacking::kDefault
+                ? memalign(64, alloc_sz)
+                : page_backed_alloc(alloc_sz, backing, mapped_size));
+        backing_buf_size = alloc_sz;
         memset(reinterpret_cast<uint8_t*>(backing_buf), 0, alloc_sz);
         is_allocated = true;
 
@@ -149,6 +308,12 @@ public:
 
     std::array<T*, COLS>& operator[](size_t row_idx) { return mat[row_idx]; }
 
+    /// Return the buffer that backs all cells. Cells of row i precede cells
+    /// of row i + 1.
+    T* backing_buffer() { return backing_buf; }
+    size_t backing_buffer_size() const { return backing_buf_size; }
+    PageBacking page_backing() const { return backing; }
+
     // Delete copy constructor and copy assignment
     PtrGrid(PtrGrid const&) = delete;
     PtrGrid& operator=(PtrGrid const&) = delete;
@@ -159,6 +324,12 @@ private:
     /// The backing buffer for the per-cell arrays. Having a common buffer
     /// reduces the number of memory allocations.
     T* backing_buf;
+    size_t backing_buf_size = 0; /// Size of backing_buf in bytes
+
+    /// The pages that back backing_buf, and the size of its mapping if it
+    /// is not heap-allocated
+    PageBacking backing = PageBacking::kDefault;
+    size_t mapped_size = 0;
 
     /// True iff we've allocated the backing buffer
     bool is_allocated = false;
@@ -178,23 +349,34 @@ public:
     /// only the cube with dimensions [dim_1, dim_2, dim_3] has cells
     /// pointing to an array of [n_entries]. This can use less memory than a
     /// fully-allocated cube.
-    PtrCube(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries)
+    PtrCube(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries,
+        PageBacking page_backing = PageBacking::kDefault)
     {
         assert(dim_1 <= DIM1 && dim_2 <= DIM2 && dim_3 <= DIM3);
-        alloc(dim_1, dim_2, dim_3, n_entries);
+        alloc(dim_1, dim_2, dim_3, n_entries, page_backing);
     }
 
     ~PtrCube()
     {
-        if (is_allocated)
+        if (!is_allocated)
+            return;
+        if (backing == PageBacking::kDefault) {
             free(backing_buf);
+        } else {
+            page_backed_free(backing_buf, mapped_size);
+        }
     }
 
     /// Allocate [n_entries] entries per pointer cell
-    void alloc(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries)
+    void alloc(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries,
+        PageBacking page_backing = PageBacking::kDefault)
     {
         const size_t alloc_sz = dim_1 * dim_2 * dim_3 * n_entries * sizeof(T);
-        backing_buf = reinterpret_cast<T*>(memalign(64, alloc_sz));
+        backing = page_backing;
+        backing_buf = reinterpret_cast<T*>(backing == PageBacking::kDefault
+                ? memalign(64, alloc_sz)
+                : page_backed_alloc(alloc_sz, backing, mapped_size));
+        backing_buf_size = alloc_sz;
         memset(reinterpret_cast<uint8_t*>(backing_buf), 0, alloc_sz);
         is_allocated = true;
 
@@ -223,6 +405,12 @@ public:
         return cube[row_idx];
     }
 
+    /// Return the buffer that backs all cells. Cells of cube[i] precede cells
+    /// of cube[i + 1].
+    T* backing_buffer() { return backing_buf; }
+    size_t backing_buffer_size() const { return backing_buf_size; }
+    PageBacking page_backing() const { return backing; }
+
     // Delete copy constructor and copy assignment
     PtrCube(PtrCube const&) = delete;
     PtrCube& operator=(PtrCube const&) = delete;
@@ -234,6 +422,12 @@ private:
     /// The backing buffer for the per-cell arrays. Having a common buffer
     /// reduces the number of memory allocations.
     T* backing_buf;
+    size_t backing_buf_size = 0; /// Size of backing_buf in bytes
+
+    /// The pages that back backing_buf, and the size of its mapping if it
+    /// is not heap-allocated
+    PageBacking backing = PageBacking::kDefault;
+    size_t mapped_size = 0;
 
     /// True iff we've allocated the backing buffer
     bool is_allocated = false;
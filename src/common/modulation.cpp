@@ -56,6 +56,9 @@ void init_modulation_table(Table<complex_float>& mod_table, size_t mod_order)
     case 64:
         init_qam64_table(mod_table);
         break;
+    case 256:
+        init_qam256_table(mod_table);
+        break;
     default: {
         printf("Modulation order not supported, use default value 4\n");
         init_qam16_table(mod_table);
@@ -66,14 +69,14 @@ void init_modulation_table(Table<complex_float>& mod_table, size_t mod_order)
 /**
  * QPSK modulation
  *              Q
- *  01  |  11
+ *  10  |  00
  *---------------> I
- *  00  |  10
+ *  11  |  01
  */
 void init_qpsk_table(Table<complex_float>& qpsk_table)
 {
     float scale = 1 / sqrt(2);
-    float mod_qpsk[2] = { -scale, scale };
+    float mod_qpsk[2] = { scale, -scale };
     for (int i = 0; i < 4; i++) {
         qpsk_table[0][i] = { mod_qpsk[i / 2], mod_qpsk[i % 2] };
     }
@@ -153,6 +156,33 @@ void init_qam64_table(Table<complex_float>& qam64_table)
     }
 }
 
+/**
+ * 256-QAM modulation
+ *
+ * Bits 7, 5, 3, 1 select the in-phase level and bits 6, 4, 2, 0 select the
+ * quadrature level. As for 16-QAM and 64-QAM, the most significant bit of
+ * each group selects the sign, and each following bit halves the distance
+ * to the center of the current group of levels, i.e., the in-phase level is
+ * (1 - 2b7)(8 - (1 - 2b5)(4 - (1 - 2b3)(2 - (1 - 2b1)))) / sqrt(170).
+ */
+void init_qam256_table(Table<complex_float>& qam256_table)
+{
+    float scale = 1 / sqrt(170);
+    float mod_256qam[16] = { 5 * scale, 7 * scale, 3 * scale, 1 * scale,
+        11 * scale, 9 * scale, 13 * scale, 15 * scale, (-5) * scale,
+        (-7) * scale, (-3) * scale, (-1) * scale, (-11) * scale, (-9) * scale,
+        (-13) * scale, (-15) * scale };
+    for (int i = 0; i < 256; i++) {
+        /* get bit 6, 4, 2, 0 */
+        int imag_i = (((i >> 6) & 0x1) << 3) + (((i >> 4) & 0x1) << 2)
+            + (((i >> 2) & 0x1) << 1) + (i & 0x1);
+        /* get bit 7, 5, 3, 1 */
+        int real_i = (((i >> 7) & 0x1) << 3) + (((i >> 5) & 0x1) << 2)
+            + (((i >> 3) & 0x1) << 1) + ((i >> 1) & 0x1);
+        qam256_table[0][i] = { mod_256qam[real_i], mod_256qam[imag_i] };
+    }
+}
+
 /**
  ***********************************************************************************
  * Modulation functions
@@ -210,6 +240,64 @@ void mod_simd(uint8_t* in, complex_float*& out, size_t len,
  ***********************************************************************************
  */
 
+/**
+ * QPSK demodulation
+ *              Q
+ *  10  |  00
+ *---------------> I
+ *  11  |  01
+ *
+ * The soft bits of QPSK are the scaled in-phase and quadrature components,
+ * so the LLRs are the input samples converted to bytes in place.
+ */
+void demod_qpsk_soft_loop(float* vec_in, int8_t* llr, int num)
+{
+    for (int i = 0; i < 2 * num; i++) {
+        float y = std::rint(SCALE_BYTE_CONV_QPSK * vec_in[i]);
+        llr[i] = (int8_t)std::max(-127.0f, std::min(127.0f, y));
+    }
+}
+
+void demod_qpsk_soft_avx2(float* vec_in, int8_t* llr, int num)
+{
+    float* symbolsPtr = vec_in;
+    __m256i* resultPtr = (__m256i*)llr;
+    __m256 symbol1, symbol2, symbol3, symbol4;
+    __m256i symbol_i1, symbol_i2, symbol_i3, symbol_i4, symbol_i, symbol_12,
+        symbol_34;
+    __m256 scale_v = _mm256_set1_ps(SCALE_BYTE_CONV_QPSK);
+    __m256i vec_min = _mm256_set1_epi8(-127);
+
+    for (int i = 0; i < num / 16; i++) {
+        symbol1 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol2 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol3 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol4 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol_i1 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol1, scale_v));
+        symbol_i2 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol2, scale_v));
+        symbol_i3 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol3, scale_v));
+        symbol_i4 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol4, scale_v));
+        symbol_12 = _mm256_packs_epi32(symbol_i1, symbol_i2);
+        symbol_12 = _mm256_permute4x64_epi64(symbol_12, 0xd8);
+        symbol_34 = _mm256_packs_epi32(symbol_i3, symbol_i4);
+        symbol_34 = _mm256_permute4x64_epi64(symbol_34, 0xd8);
+        symbol_i = _mm256_packs_epi16(symbol_12, symbol_34);
+        symbol_i = _mm256_permute4x64_epi64(symbol_i, 0xd8);
+        symbol_i = _mm256_max_epi8(symbol_i, vec_min);
+
+        _mm256_storeu_si256(resultPtr, symbol_i);
+        resultPtr++;
+    }
+    // Demodulate last symbols
+    int next_start = 16 * (num / 16);
+    demod_qpsk_soft_loop(
+        vec_in + 2 * next_start, llr + next_start * 2, num - next_start);
+}
+
 // /**
 //   * 16-QAM demodulation
 //   *              Q
@@ -1010,3 +1098,108 @@ void demod_64qam_soft_avx2(float* vec_in, int8_t* llr, int num)
     demod_64qam_soft_sse(
         vec_in + 2 * next_start, llr + next_start * 6, num - next_start);
 }
+
+/**
+ * 256-QAM soft demodulation with the max-log approximation
+ *
+ * For each of the in-phase and quadrature components y, the LLRs of the four
+ * bits are computed by folding y around the decision boundaries of the
+ * previous bit:
+ *   l0 = y, l1 = 8d - |l0|, l2 = 4d - |l1|, l3 = 2d - |l2|
+ * where 2d is the distance between adjacent levels. For a symbol with bits
+ * b7..b0, the output order is l0(re), l0(im), l1(re), l1(im), ..., matching
+ * the bit order b7..b0.
+ */
+void demod_256qam_soft_loop(float* vec_in, int8_t* llr, int num)
+{
+    const int offset1 = 8 * SCALE_BYTE_CONV_QAM256 / sqrt(170);
+    const int offset2 = 4 * SCALE_BYTE_CONV_QAM256 / sqrt(170);
+    const int offset3 = 2 * SCALE_BYTE_CONV_QAM256 / sqrt(170);
+    for (int i = 0; i < num; i++) {
+        for (int j = 0; j < 2; j++) {
+            float y = std::rint(SCALE_BYTE_CONV_QAM256 * vec_in[2 * i + j]);
+            int l0 = (int)std::max(-127.0f, std::min(127.0f, y));
+            int l1 = offset1 - std::abs(l0);
+            int l2 = offset2 - std::abs(l1);
+            int l3 = offset3 - std::abs(l2);
+            llr[8 * i + j] = l0;
+            llr[8 * i + 2 + j] = l1;
+            llr[8 * i + 4 + j] = l2;
+            llr[8 * i + 6 + j] = l3;
+        }
+    }
+}
+
+void demod_256qam_soft_avx2(float* vec_in, int8_t* llr, int num)
+{
+    float* symbolsPtr = vec_in;
+    __m256i* resultPtr = (__m256i*)llr;
+    __m256 symbol1, symbol2, symbol3, symbol4;
+    __m256i symbol_i1, symbol_i2, symbol_i3, symbol_i4, symbol_12, symbol_34;
+    __m256i llr0, llr1, llr2, llr3;
+    __m256i llr01_lo, llr23_lo, llr01_hi, llr23_hi;
+    __m256i result0, result1, result2, result3;
+    __m256i offset1 = _mm256_set1_epi8(8 * SCALE_BYTE_CONV_QAM256 / sqrt(170));
+    __m256i offset2 = _mm256_set1_epi8(4 * SCALE_BYTE_CONV_QAM256 / sqrt(170));
+    __m256i offset3 = _mm256_set1_epi8(2 * SCALE_BYTE_CONV_QAM256 / sqrt(170));
+    __m256 scale_v = _mm256_set1_ps(SCALE_BYTE_CONV_QAM256);
+    __m256i vec_min = _mm256_set1_epi8(-127);
+
+    for (int i = 0; i < num / 16; i++) {
+        symbol1 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol2 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol3 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol4 = _mm256_load_ps(symbolsPtr);
+        symbolsPtr += 8;
+        symbol_i1 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol1, scale_v));
+        symbol_i2 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol2, scale_v));
+        symbol_i3 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol3, scale_v));
+        symbol_i4 = _mm256_cvtps_epi32(_mm256_mul_ps(symbol4, scale_v));
+        symbol_12 = _mm256_packs_epi32(symbol_i1, symbol_i2);
+        symbol_12 = _mm256_permute4x64_epi64(symbol_12, 0xd8);
+        symbol_34 = _mm256_packs_epi32(symbol_i3, symbol_i4);
+        symbol_34 = _mm256_permute4x64_epi64(symbol_34, 0xd8);
+        llr0 = _mm256_packs_epi16(symbol_12, symbol_34);
+        llr0 = _mm256_permute4x64_epi64(llr0, 0xd8);
+        // Avoid overflow in abs(-128)
+        llr0 = _mm256_max_epi8(llr0, vec_min);
+
+        llr1 = _mm256_sub_epi8(offset1, _mm256_abs_epi8(llr0));
+        llr2 = _mm256_sub_epi8(offset2, _mm256_abs_epi8(llr1));
+        llr3 = _mm256_sub_epi8(offset3, _mm256_abs_epi8(llr2));
+
+        // Each 16-bit element is the (re, im) pair of one symbol. Interleave
+        // the four LLR vectors so that each 64-bit element holds the eight
+        // LLRs of one symbol. Within each 128-bit lane, result0 holds symbols
+        // 0-1, result1 symbols 2-3, result2 symbols 4-5, and result3
+        // symbols 6-7 of the lane.
+        llr01_lo = _mm256_unpacklo_epi16(llr0, llr1);
+        llr23_lo = _mm256_unpacklo_epi16(llr2, llr3);
+        llr01_hi = _mm256_unpackhi_epi16(llr0, llr1);
+        llr23_hi = _mm256_unpackhi_epi16(llr2, llr3);
+        result0 = _mm256_unpacklo_epi32(llr01_lo, llr23_lo);
+        result1 = _mm256_unpackhi_epi32(llr01_lo, llr23_lo);
+        result2 = _mm256_unpacklo_epi32(llr01_hi, llr23_hi);
+        result3 = _mm256_unpackhi_epi32(llr01_hi, llr23_hi);
+
+        _mm256_storeu_si256(
+            resultPtr, _mm256_permute2x128_si256(result0, result1, 0x20));
+        resultPtr++;
+        _mm256_storeu_si256(
+            resultPtr, _mm256_permute2x128_si256(result2, result3, 0x20));
+        resultPtr++;
+        _mm256_storeu_si256(
+            resultPtr, _mm256_permute2x128_si256(result0, result1, 0x31));
+        resultPtr++;
+        _mm256_storeu_si256(
+            resultPtr, _mm256_permute2x128_si256(result2, result3, 0x31));
+        resultPtr++;
+    }
+    // Demodulate last symbols
+    int next_start = 16 * (num / 16);
+    demod_256qam_soft_loop(
+        vec_in + 2 * next_start, llr + next_start * 8, num - next_start);
+}
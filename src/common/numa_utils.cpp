@@ -0,0 +1,193 @@
+/**
+ * @file numa_utils.cpp
+ * @brief NUMA node discovery and page placement, using sysfs and the mbind
+ * system call directly so that Agora does not depend on libnuma
+ */
+
+#include "numa_utils.hpp"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Largest number of NUMA nodes supported in node masks
+static constexpr size_t kMaxNumaNodes = 64;
+
+// Parse a sysfs CPU or node list such as "0-3,8-11"
+static std::vector<size_t> parse_sysfs_list(const std::string& path)
+{
+    std::vector<size_t> ret;
+    std::ifstream file(path);
+    std::string list;
+    if (!file.is_open() || !std::getline(file, list))
+        return ret;
+
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty())
+            continue;
+        const size_t dash = range.find('-');
+        const size_t lo = std::stoul(range.substr(0, dash));
+        const size_t hi = dash == std::string::npos
+            ? lo
+            : std::stoul(range.substr(dash + 1));
+        for (size_t i = lo; i <= hi; i++)
+            ret.push_back(i);
+    }
+    return ret;
+}
+
+static long sys_mbind(void* addr, size_t len, int mode,
+    const std::vector<size_t>& nodes, unsigned int flags)
+{
+    unsigned long nodemask = 0;
+    for (size_t node : nodes) {
+        rt_assert(node < kMaxNumaNodes, "NUMA node ID too large");
+        nodemask |= 1ul << node;
+    }
+    // The kernel expects the number of bits in the mask plus one
+    return syscall(SYS_mbind, addr, len, mode, &nodemask, kMaxNumaNodes + 1,
+        flags);
+}
+
+NumaPolicy NumaUtils::policy_from_string(const std::string& name)
+{
+    if (name == "default")
+        return NumaPolicy::kDefault;
+    if (name == "interleave")
+        return NumaPolicy::kInterleave;
+    if (name == "first_touch")
+        return NumaPolicy::kFirstTouch;
+    if (name == "frame_slot_local")
+        return NumaPolicy::kFrameSlotLocal;
+    rt_assert(false, "Unknown NUMA buffer policy " + name);
+    return NumaPolicy::kDefault;
+}
+
+std::string NumaUtils::policy_to_string(NumaPolicy policy)
+{
+    switch (policy) {
+    case NumaPolicy::kDefault:
+        return "default";
+    case NumaPolicy::kInterleave:
+        return "interleave";
+    case NumaPolicy::kFirstTouch:
+        return "first_touch";
+    case NumaPolicy::kFrameSlotLocal:
+        return "frame_slot_local";
+    }
+    return "invalid";
+}
+
+size_t NumaUtils::num_nodes()
+{
+    std::vector<size_t> nodes
+        = parse_sysfs_list("/sys/devices/system/node/possible");
+    return nodes.empty() ? 1 : nodes.back() + 1;
+}
+
+std::vector<size_t> NumaUtils::node_cpus(size_t node)
+{
+    std::vector<size_t> cpus = parse_sysfs_list(
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (cpus.empty() && node == 0) {
+        // No NUMA support in sysfs: all CPUs belong to node 0
+        const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < num_cpus; i++)
+            cpus.push_back(i);
+    }
+    return cpus;
+}
+
+std::vector<size_t> NumaUtils::assign_worker_cores(
+    const std::vector<size_t>& nodes, size_t num_workers,
+    const std::vector<size_t>& reserved_cores)
+{
+    std::vector<std::vector<size_t>> cpus_of_nodes;
+    for (size_t node : nodes)
+        cpus_of_nodes.push_back(node_cpus(node));
+    return assign_worker_cores(
+        nodes, cpus_of_nodes, num_workers, reserved_cores);
+}
+
+std::vector<size_t> NumaUtils::assign_worker_cores(
+    const std::vector<size_t>& nodes,
+    const std::vector<std::vector<size_t>>& cpus_of_nodes, size_t num_workers,
+    const std::vector<size_t>& reserved_cores)
+{
+    std::vector<size_t> cores;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        // Workers [i * num_workers / n, (i + 1) * num_workers / n) run on
+        // nodes[i]
+        const size_t num_node_workers = (i + 1) * num_workers / nodes.size()
+            - i * num_workers / nodes.size();
+        size_t num_assigned = 0;
+        for (size_t cpu : cpus_of_nodes[i]) {
+            if (num_assigned == num_node_workers)
+                break;
+            if (std::find(reserved_cores.begin(), reserved_cores.end(), cpu)
+                != reserved_cores.end())
+                continue;
+            cores.push_back(cpu);
+            num_assigned++;
+        }
+        rt_assert(num_assigned == num_node_workers,
+            "Not enough free cores on NUMA node "
+                + std::to_string(nodes[i]) + " for worker threads");
+    }
+    return cores;
+}
+
+void NumaUtils::place(void* buf, size_t size, NumaPolicy policy,
+    const std::vector<size_t>& nodes, size_t num_slots, size_t page_size)
+{
+    if (policy == NumaPolicy::kDefault || size == 0)
+        return;
+
+    const auto base = reinterpret_cast<size_t>(buf);
+    // Return the first page boundary at or after address [addr]
+    auto page_up = [page_size](size_t addr) {
+        return (addr + page_size - 1) / page_size * page_size;
+    };
+
+    long ret = 0;
+    if (policy == NumaPolicy::kFirstTouch) {
+        const size_t start = page_up(base);
+        const size_t end = (base + size) / page_size * page_size;
+        if (end > start) {
+            ret = madvise(
+                reinterpret_cast<void*>(start), end - start, MADV_DONTNEED);
+        }
+    } else if (policy == NumaPolicy::kInterleave) {
+        const size_t start = page_up(base);
+        const size_t end = (base + size) / page_size * page_size;
+        if (end > start) {
+            ret = sys_mbind(reinterpret_cast<void*>(start), end - start,
+                MPOL_INTERLEAVE, nodes, MPOL_MF_MOVE);
+        }
+    } else if (policy == NumaPolicy::kFrameSlotLocal) {
+        // Pages that straddle two slots go to the node of the earlier slot
+        for (size_t i = 0; i < num_slots && ret == 0; i++) {
+            const size_t start = page_up(base + i * size / num_slots);
+            const size_t end = std::min(
+                page_up(base + (i + 1) * size / num_slots),
+                (base + size) / page_size * page_size);
+            if (end <= start)
+                continue;
+            ret = sys_mbind(reinterpret_cast<void*>(start), end - start,
+                MPOL_PREFERRED, { nodes[i % nodes.size()] }, MPOL_MF_MOVE);
+        }
+    }
+
+    if (ret != 0) {
+        fprintf(stderr,
+            "NumaUtils: Failed to apply NUMA policy %s to a %zu-byte buffer: "
+            "%s. Continuing with the default placement.\n",
+            policy_to_string(policy).c_str(), size, strerror(errno));
+    }
+}
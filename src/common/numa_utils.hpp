@@ -0,0 +1,66 @@
+/**
+ * @file numa_utils.hpp
+ * @brief NUMA node discovery, worker thread placement, and page placement
+ * policies for the buffers that Agora's worker threads share
+ */
+
+#ifndef NUMA_UTILS
+#define NUMA_UTILS
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Placement of the pages of a shared buffer on NUMA nodes
+enum class NumaPolicy {
+    // Pages stay on the node of the thread that allocated and zeroed them,
+    // i.e., the master thread
+    kDefault,
+
+    // Pages are interleaved across the worker nodes
+    kInterleave,
+
+    // Pages are released after allocation, so that each page is placed on
+    // the node of the worker thread that first writes it
+    kFirstTouch,
+
+    // The pages of frame slot i are placed on worker node i % (number of
+    // worker nodes)
+    kFrameSlotLocal
+};
+
+class NumaUtils {
+public:
+    /// Parse a policy name: "default", "interleave", "first_touch", or
+    /// "frame_slot_local"
+    static NumaPolicy policy_from_string(const std::string& name);
+    static std::string policy_to_string(NumaPolicy policy);
+
+    /// Return the number of NUMA nodes. This is one on non-NUMA machines.
+    static size_t num_nodes();
+
+    /// Return the online CPUs of NUMA node [node]
+    static std::vector<size_t> node_cpus(size_t node);
+
+    /// Return cores for [num_workers] worker threads, split evenly across
+    /// [nodes] in order. Cores in [reserved_cores] are not used.
+    static std::vector<size_t> assign_worker_cores(
+        const std::vector<size_t>& nodes, size_t num_workers,
+        const std::vector<size_t>& reserved_cores);
+
+    /// Like above, with the online CPUs of each of [nodes] given in
+    /// [cpus_of_nodes] instead of read from sysfs
+    static std::vector<size_t> assign_worker_cores(
+        const std::vector<size_t>& nodes,
+        const std::vector<std::vector<size_t>>& cpus_of_nodes,
+        size_t num_workers, const std::vector<size_t>& reserved_cores);
+
+    /// Apply [policy] to the [size]-byte buffer [buf], which holds
+    /// [num_slots] equal-sized frame slots, for worker threads on [nodes].
+    /// Only pages of [page_size] bytes that lie entirely inside the buffer
+    /// are affected. With kFirstTouch, the buffer reads as zeros afterwards.
+    static void place(void* buf, size_t size, NumaPolicy policy,
+        const std::vector<size_t>& nodes, size_t num_slots, size_t page_size);
+};
+
+#endif
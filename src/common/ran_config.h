@@ -28,4 +28,5 @@ class RBIndicator {
 public:
     size_t ue_id; /// UE ID
     size_t mod_order_bits; /// modulation type (number of bits)
+    size_t frame_id; /// first frame that uses mod_order_bits
 };
@@ -4,83 +4,148 @@
 #include "config.hpp"
 #include "logger.h"
 #include "utils.h"
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <sstream>
 #include <vector>
 
 // We use one RxStatus object to track packet reception status.
 // This object is shared between socket threads and subcarrier workers.
+//
+// For every frame in the frame window, each symbol has a bitmap of the
+// antennas whose packets have arrived. Recording a packet is a single
+// fetch_or, which also detects duplicate packets. The thread that sets the
+// last bit of a symbol's bitmap is the only one that bumps the frame's count
+// of completed pilot or data symbols, so "symbol complete" and "all pilots
+// received" are O(1) loads. Each symbol's bitmap and each frame's counters
+// live on their own cache line, so socket threads receiving different
+// symbols or frames do not share lines.
 class RxStatus {
 public:
+    static_assert(kMaxAntennas <= 64, "Antenna bitmaps must fit in a word");
+
     RxStatus(Config* cfg)
-        : num_pilot_pkts_per_frame_(
-              cfg->pilot_symbol_num_perframe * cfg->BS_ANT_NUM)
-        , num_pilot_symbols_per_frame_(cfg->pilot_symbol_num_perframe)
-        , num_data_symbol_per_frame_(cfg->data_symbol_num_perframe)
-        , num_pkts_per_symbol_(cfg->BS_ANT_NUM)
-        , num_decode_tasks_per_frame_(cfg->get_num_ues_to_process())
+        : RxStatus(cfg->pilot_symbol_num_perframe,
+              cfg->data_symbol_num_perframe, cfg->BS_ANT_NUM,
+              cfg->get_num_ues_to_process())
+    {
+    }
+
+    RxStatus(size_t num_pilot_symbols_per_frame,
+        size_t num_data_symbols_per_frame, size_t num_pkts_per_symbol,
+        size_t num_decode_tasks_per_frame)
+        : num_pilot_symbols_per_frame_(num_pilot_symbols_per_frame)
+        , num_data_symbol_per_frame_(num_data_symbols_per_frame)
+        , num_pkts_per_symbol_(num_pkts_per_symbol)
+        , num_decode_tasks_per_frame_(num_decode_tasks_per_frame)
+        , full_symbol_mask_(num_pkts_per_symbol == 64
+                  ? ~0ull
+                  : (1ull << num_pkts_per_symbol) - 1)
     {
+        rt_assert(num_pkts_per_symbol_ <= kMaxAntennas,
+            "RxStatus: too many antennas");
+        rt_assert(num_pilot_symbols_per_frame_ + num_data_symbol_per_frame_
+                <= kMaxSymbols,
+            "RxStatus: too many symbols");
     }
 
-    // When receive a new packet, record it here
+    // When receive a new packet, record it here. Return false if the packet
+    // is outside the frame window or is a duplicate.
     bool add_new_packet(const Packet* pkt)
     {
-        if (pkt->frame_id >= cur_frame_ + kFrameWnd) {
+        const size_t cur_frame = cur_frame_.load(std::memory_order_acquire);
+        if (pkt->frame_id >= cur_frame + kFrameWnd) {
             MLPD_ERROR(
                 "SharedCounters RxStatus error: Received packet for future "
                 "frame %u beyond frame window (%zu + %zu). This can "
                 "happen if Agora is running slowly, e.g., in debug mode. "
                 "Full packet = %s.\n",
-                pkt->frame_id, cur_frame_, kFrameWnd, pkt->to_string().c_str());
+                pkt->frame_id, cur_frame, kFrameWnd, pkt->to_string().c_str());
+            return false;
+        }
+        if (pkt->frame_id < cur_frame) {
+            MLPD_WARN("SharedCounters RxStatus: Dropping packet for retired "
+                      "frame %u (current frame %zu)\n",
+                pkt->frame_id, cur_frame);
             return false;
         }
 
-        const size_t frame_slot = pkt->frame_id % kFrameWnd;
-        num_pkts_[frame_slot]++;
-        if (num_pkts_[frame_slot]
-            == num_pkts_per_symbol_
-                * (num_pilot_symbols_per_frame_ + num_data_symbol_per_frame_)) {
-            printf("SharedCounters: received all packets in frame: %u. "
-                   "Pilot pkts = %zu of %zu\n",
-                pkt->frame_id, num_pilot_pkts_[frame_slot].load(),
-                num_pilot_pkts_per_frame_);
+        FrameSlot& slot = frames_[pkt->frame_id % kFrameWnd];
+        const uint64_t ant_bit = 1ull << pkt->ant_id;
+        // Release so that readers of a complete bitmap see the packet data
+        const uint64_t prev
+            = slot.symbols[pkt->symbol_id].ant_bitmap.fetch_or(
+                ant_bit, std::memory_order_acq_rel);
+        if (prev & ant_bit) {
+            MLPD_WARN("SharedCounters RxStatus: Duplicate packet %s\n",
+                pkt->to_string().c_str());
+            return false;
         }
 
-        if (pkt->symbol_id < num_pilot_symbols_per_frame_) {
-            num_pilot_pkts_[frame_slot]++;
-            if (num_pilot_pkts_[frame_slot] == num_pilot_pkts_per_frame_) {
-                printf("SharedCounters: received all pilots in frame: %u\n",
+        if ((prev | ant_bit) == full_symbol_mask_) {
+            if (pkt->symbol_id < num_pilot_symbols_per_frame_) {
+                if (slot.num_pilot_symbols_done.fetch_add(
+                        1, std::memory_order_acq_rel)
+                        + 1
+                    == num_pilot_symbols_per_frame_) {
+                    printf("SharedCounters: received all pilots in frame: "
+                           "%u\n",
+                        pkt->frame_id);
+                }
+            } else {
+                slot.num_data_symbols_done.fetch_add(
+                    1, std::memory_order_acq_rel);
+            }
+            if (received_all_packets(pkt->frame_id)) {
+                printf("SharedCounters: received all packets in frame: %u\n",
                     pkt->frame_id);
             }
-        } else {
-            num_data_pkts_[frame_slot][pkt->symbol_id]++;
         }
-        if (pkt->frame_id > latest_frame_) {
-            // TODO: race condition could happen here but the impact is small
-            latest_frame_ = pkt->frame_id;
+
+        // Racing socket threads can only raise latest_frame_
+        size_t latest = latest_frame_.load(std::memory_order_relaxed);
+        while (pkt->frame_id > latest
+            and !latest_frame_.compare_exchange_weak(
+                latest, pkt->frame_id, std::memory_order_relaxed)) {
         }
         return true;
     }
 
     // Check whether all pilot packets are received for a frame
     // used by CSI
-    bool received_all_pilots(size_t frame_id)
+    bool received_all_pilots(size_t frame_id) const
     {
-        if (frame_id < cur_frame_ || frame_id >= cur_frame_ + kFrameWnd) {
+        if (!in_window(frame_id)) {
             return false;
         }
-        return num_pilot_pkts_[frame_id % kFrameWnd]
-            == num_pilot_pkts_per_frame_;
+        return frames_[frame_id % kFrameWnd].num_pilot_symbols_done.load(
+                   std::memory_order_acquire)
+            == num_pilot_symbols_per_frame_;
     }
 
     // Check whether demodulation can proceed for a symbol in a frame
-    bool is_demod_ready(size_t frame_id, size_t symbol_id)
+    bool is_demod_ready(size_t frame_id, size_t symbol_id) const
     {
-        if (frame_id < cur_frame_ || frame_id >= cur_frame_ + kFrameWnd) {
+        if (!in_window(frame_id)) {
             return false;
         }
-        return num_data_pkts_[frame_id % kFrameWnd][symbol_id]
-            == num_pkts_per_symbol_;
+        return frames_[frame_id % kFrameWnd].symbols[symbol_id].ant_bitmap.load(
+                   std::memory_order_acquire)
+            == full_symbol_mask_;
+    }
+
+    // Check whether all pilot and data packets are received for a frame
+    bool received_all_packets(size_t frame_id) const
+    {
+        if (!in_window(frame_id)) {
+            return false;
+        }
+        const FrameSlot& slot = frames_[frame_id % kFrameWnd];
+        return slot.num_pilot_symbols_done.load(std::memory_order_acquire)
+            == num_pilot_symbols_per_frame_
+            and slot.num_data_symbols_done.load(std::memory_order_acquire)
+            == num_data_symbol_per_frame_;
     }
 
     // When decoding is done for a frame from one decoder, call this function
@@ -89,56 +154,79 @@ public:
     // this frame
     void decode_done(size_t frame_id)
     {
-        rt_assert(frame_id == cur_frame_, "Wrong completed decode task!");
-        decode_mutex_.lock();
-        num_decode_tasks_completed_++;
-        if (num_decode_tasks_completed_ == num_decode_tasks_per_frame_) {
-            cur_frame_++;
-            num_decode_tasks_completed_ = 0;
-            size_t frame_slot = frame_id % kFrameWnd;
-            num_pkts_[frame_slot] = 0;
-            num_pilot_pkts_[frame_slot] = 0;
-            for (size_t j = 0; j < kMaxSymbols; j++) {
-                num_data_pkts_[frame_slot][j] = 0;
-            }
-            printf("Main thread: Decode done frame: %lu\n", cur_frame_ - 1);
+        rt_assert(frame_id == cur_frame_.load(std::memory_order_acquire),
+            "Wrong completed decode task!");
+        if (num_decode_tasks_completed_.fetch_add(1, std::memory_order_acq_rel)
+                + 1
+            != num_decode_tasks_per_frame_) {
+            return;
+        }
+
+        // Only the last decoder gets here. Packets that map to this frame's
+        // slot are rejected until cur_frame_ moves past it, so the slot can
+        // be cleared before the new window is published.
+        FrameSlot& slot = frames_[frame_id % kFrameWnd];
+        for (size_t j = 0; j < kMaxSymbols; j++) {
+            slot.symbols[j].ant_bitmap.store(0, std::memory_order_relaxed);
         }
-        decode_mutex_.unlock();
+        slot.num_pilot_symbols_done.store(0, std::memory_order_relaxed);
+        slot.num_data_symbols_done.store(0, std::memory_order_relaxed);
+        num_decode_tasks_completed_.store(0, std::memory_order_relaxed);
+        cur_frame_.store(frame_id + 1, std::memory_order_release);
+        printf("Main thread: Decode done frame: %lu\n", frame_id);
     }
 
-    // TODO: Instead of having all-atomic counter arrays, can we just make
-    // the entire class atomic?
+    size_t cur_frame() const
+    {
+        return cur_frame_.load(std::memory_order_acquire);
+    }
 
-    // num_pkts[i % kFrameWnd] is the total number of packets
-    // received for frame i (may be removed if not used)
-    std::array<std::atomic<size_t>, kFrameWnd> num_pkts_ = {};
+    size_t latest_frame() const
+    {
+        return latest_frame_.load(std::memory_order_relaxed);
+    }
 
-    // num_pilot_pkts[i % kFrameWnd] is the total number of pilot
-    // packets received for frame i
-    std::array<std::atomic<size_t>, kFrameWnd> num_pilot_pkts_ = {};
+private:
+    bool in_window(size_t frame_id) const
+    {
+        const size_t cur_frame = cur_frame_.load(std::memory_order_acquire);
+        return frame_id >= cur_frame && frame_id < cur_frame + kFrameWnd;
+    }
 
-    // num_data_pkts[i % kFrameWnd][j] is the total number of data
-    // packets received for frame i and symbol j
-    std::array<std::array<std::atomic<size_t>, kMaxSymbols>, kFrameWnd>
-        num_data_pkts_ = {};
+    // Bitmap of antennas whose packets have arrived for one symbol
+    struct alignas(64) SymbolBitmap {
+        std::atomic<uint64_t> ant_bitmap = { 0 };
+    };
+
+    struct alignas(64) FrameSlot {
+        std::array<SymbolBitmap, kMaxSymbols> symbols;
 
-    // cur_frame is the first frame for which decoding is incomplete
-    size_t cur_frame_ = 0;
+        // Number of pilot and data symbols whose bitmaps are full
+        alignas(64) std::atomic<size_t> num_pilot_symbols_done = { 0 };
+        std::atomic<size_t> num_data_symbols_done = { 0 };
+    };
 
-    // The max frame number for which socket I/O threads have received any packet
-    size_t latest_frame_ = 0;
+    std::array<FrameSlot, kFrameWnd> frames_;
 
-    // Atomic counter for # completed decode tasks
-    // cur_frame will be incremented in all tasks are completed
-    size_t num_decode_tasks_completed_;
-    std::mutex decode_mutex_;
+    // cur_frame is the first frame for which decoding is incomplete. Written
+    // only by the last decoder of a frame.
+    alignas(64) std::atomic<size_t> cur_frame_ = { 0 };
+
+    // The max frame number for which socket I/O threads have received any
+    // packet
+    alignas(64) std::atomic<size_t> latest_frame_ = { 0 };
+
+    // Number of completed decode tasks for cur_frame_
+    alignas(64) std::atomic<size_t> num_decode_tasks_completed_ = { 0 };
 
     // Copies of Config variables
-    const size_t num_pilot_pkts_per_frame_;
     const size_t num_pilot_symbols_per_frame_;
     const size_t num_data_symbol_per_frame_;
     const size_t num_pkts_per_symbol_;
     const size_t num_decode_tasks_per_frame_;
+
+    // Bitmap of a symbol for which packets from all antennas have arrived
+    const uint64_t full_symbol_mask_;
 };
 
 // We use DemulStatus to track # completed demul tasks for each symbol
@@ -53,6 +53,25 @@ void pin_to_core_with_offset(
     }
 }
 
+void pin_to_core_in_list(ThreadType thread_type,
+    const std::vector<size_t>& cores, int thread_id, bool verbose)
+{
+    if (!kEnableThreadPinning)
+        return;
+
+    rt_assert(static_cast<size_t>(thread_id) < cores.size(),
+        "No core assigned to thread");
+    const int core_id = cores[thread_id];
+    if (pin_to_core(core_id) != 0) {
+        fprintf(stderr, "%s thread %d: failed to pin to core %d. Exiting.\n",
+            thread_type_str(thread_type).c_str(), thread_id, core_id);
+        exit(0);
+    } else if (verbose) {
+        printf("%s thread %d: pinned to core %d\n",
+            thread_type_str(thread_type).c_str(), thread_id, core_id);
+    }
+}
+
 std::vector<size_t> Utils::strToChannels(const std::string& channel)
 {
     std::vector<size_t> channels;
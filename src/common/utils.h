@@ -44,6 +44,10 @@ int pin_to_core(int core_id);
 void pin_to_core_with_offset(ThreadType thread, int base_core_offset,
     int thread_id, bool verbose = true);
 
+/* Pin this thread to core cores[thread_id] */
+void pin_to_core_in_list(ThreadType thread, const std::vector<size_t>& cores,
+    int thread_id, bool verbose = true);
+
 template <class T> struct EventHandlerContext {
     T* obj_ptr;
     int id;
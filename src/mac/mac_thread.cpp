@@ -34,6 +34,8 @@ MacThread::MacThread(Mode mode, Config* cfg, size_t core_offset,
     client_.ul_bits_buffer_status_ = ul_bits_buffer_status;
 
     server_.n_filled_in_frame_.fill(0);
+    server_.snr_sum_.fill(0);
+    mod_order_bits_ = cfg_->mod_order_bits;
     for (auto& v : server_.frame_data_)
         v.resize(cfg_->mac_data_bytes_num_perframe);
 
@@ -65,6 +67,8 @@ void MacThread::process_rx_from_master()
     if (!rx_queue_->try_dequeue(event))
         return;
 
+    last_phy_frame_id_ = std::max(
+        last_phy_frame_id_, size_t(gen_tag_t(event.tags[0]).frame_id));
     if (event.event_type == EventType::kPacketToMac)
         process_codeblocks_from_master(event);
     else if (event.event_type == EventType::kSNRReport)
@@ -75,19 +79,66 @@ void MacThread::process_snr_report_from_master(Event_data event)
 {
     const size_t ue_id = gen_tag_t(event.tags[0]).ue_id;
     if (server_.snr_[ue_id].size() == kSNRWindowSize) {
+        server_.snr_sum_[ue_id] -= server_.snr_[ue_id].front();
         server_.snr_[ue_id].pop();
     }
 
     float snr;
     memcpy(&snr, &event.tags[1], sizeof(float));
     server_.snr_[ue_id].push(snr);
+    server_.snr_sum_[ue_id] += snr;
+}
+
+size_t MacThread::select_mod_order_bits()
+{
+    // All UEs share one modulation order, so it is limited by the worst UE
+    float min_snr = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < cfg_->UE_NUM; i++) {
+        if (server_.snr_[i].empty())
+            continue;
+        min_snr = std::min(min_snr,
+            static_cast<float>(server_.snr_sum_[i] / server_.snr_[i].size()));
+    }
+    if (min_snr == std::numeric_limits<float>::max()) {
+        // No SNR reports yet
+        return mod_order_bits_;
+    }
+
+    static constexpr size_t kNumOrders = 4;
+    static constexpr size_t kOrders[kNumOrders] = { CommsLib::QPSK,
+        CommsLib::QAM16, CommsLib::QAM64, CommsLib::QAM256 };
+    static constexpr float kMinSNR[kNumOrders]
+        = { -std::numeric_limits<float>::max(), kMinSNRQAM16, kMinSNRQAM64,
+              kMinSNRQAM256 };
+
+    // Use the lowest order that the PHY supports even if the SNR is below
+    // its threshold
+    size_t new_mod_order_bits = 0;
+    for (size_t i = 0; i < kNumOrders; i++) {
+        if (!cfg_->mod_order_supported(kOrders[i]))
+            continue;
+        // Moving up to a higher order than the current one requires the
+        // hysteresis margin
+        float threshold = kMinSNR[i];
+        if (kOrders[i] > mod_order_bits_)
+            threshold += kSNRHysteresis;
+        if (new_mod_order_bits == 0 or min_snr >= threshold)
+            new_mod_order_bits = kOrders[i];
+    }
+
+    if (new_mod_order_bits != mod_order_bits_) {
+        MLPD_INFO("MAC thread: average SNR %.2f dB, switching modulation from "
+                  "%zu to %zu bits per symbol\n",
+            min_snr, mod_order_bits_, new_mod_order_bits);
+    }
+    return new_mod_order_bits;
 }
 
 void MacThread::send_ran_config_update(Event_data event)
 {
     RanConfig rc;
     rc.n_antennas = 0; // TODO [arjun]: What's the correct value here?
-    rc.mod_order_bits = CommsLib::QAM16;
+    rc.mod_order_bits = mod_order_bits_;
     rc.frame_id = scheduler_next_frame_id_;
     // TODO: change n_antennas to a desired value
     // cfg_->BS_ANT_NUM is added to fix compiler warning
@@ -100,8 +151,6 @@ void MacThread::send_ran_config_update(Event_data event)
     msg.tags[2] = rc.frame_id;
     rt_assert(tx_queue_->enqueue(msg),
         "MAC thread: failed to send RAN update to Agora");
-
-    scheduler_next_frame_id_++;
 }
 
 void MacThread::process_codeblocks_from_master(Event_data event)
@@ -184,11 +233,22 @@ void MacThread::process_codeblocks_from_master(Event_data event)
 void MacThread::send_control_information()
 {
     // send RAN control information UE
+    if (cfg_->link_adaptation)
+        mod_order_bits_ = select_mod_order_bits();
+
+    // The UEs and Agora all switch to the new order from the same PHY
+    // frame, which is far enough ahead that none of them has started it
+    scheduler_next_frame_id_ = std::max(
+        scheduler_next_frame_id_, last_phy_frame_id_ + kRanConfigLead);
+
     RBIndicator ri;
-    ri.ue_id = next_radio_id_;
-    ri.mod_order_bits = CommsLib::QAM16;
-    udp_client->send(cfg_->ue_server_addr, kBaseClientPort + ri.ue_id,
-        (uint8_t*)&ri, sizeof(RBIndicator));
+    ri.mod_order_bits = mod_order_bits_;
+    ri.frame_id = scheduler_next_frame_id_;
+    for (size_t ue_id = 0; ue_id < cfg_->UE_NUM; ue_id++) {
+        ri.ue_id = ue_id;
+        udp_client->send(cfg_->ue_server_addr, kBaseClientPort + ue_id,
+            (uint8_t*)&ri, sizeof(RBIndicator));
+    }
 
     // update RAN config within Agora
     send_ran_config_update(Event_data(EventType::kRANUpdate));
@@ -55,6 +55,23 @@ public:
     // TODO: map this to time?
     static constexpr size_t kSNRWindowSize = 100;
 
+    // Minimum average uplink SNR (in dB) at which link adaptation selects
+    // 16-QAM, 64-QAM, and 256-QAM. Below kMinSNRQAM16, QPSK is used.
+    static constexpr float kMinSNRQAM16 = 10.0;
+    static constexpr float kMinSNRQAM64 = 16.0;
+    static constexpr float kMinSNRQAM256 = 22.0;
+
+    // Link adaptation switches to a higher modulation order only if the SNR
+    // exceeds the order's threshold by this margin (in dB), to avoid
+    // oscillating between two orders
+    static constexpr float kSNRHysteresis = 1.0;
+
+    // A RAN config update takes effect this many frames after the newest
+    // frame that the PHY reported to the MAC. The frame window bounds the
+    // frames the PHY has started beyond the reported one, and the rest of
+    // the lead covers frames that start while the update is in transit.
+    static constexpr size_t kRanConfigLead = 2 * kFrameWnd;
+
     MacThread(Mode mode, Config* cfg, size_t core_offset,
         PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, uint8_t>& decoded_buffer,
         Table<uint8_t>* ul_bits_buffer, Table<uint8_t>* ul_bits_buffer_status,
@@ -85,6 +102,10 @@ private:
     // Push RAN config update to PHY master thread.
     void send_ran_config_update(Event_data event);
 
+    // Select the modulation order for the next frame based on the average
+    // SNR of the worst UE. Returns the number of bits per symbol.
+    size_t select_mod_order_bits();
+
     // Send control information over (out-of-band) control channel
     // from server to client
     void send_control_information();
@@ -149,9 +170,16 @@ private:
     // The timestamp at which we last scheduled a TTI (frame)
     size_t last_frame_tx_tsc_ = 0;
 
-    // The frame ID of the next TTI that the scheduler plans for
+    // The newest frame ID in the events received from the PHY
+    size_t last_phy_frame_id_ = 0;
+
+    // The frame ID of the next TTI that the scheduler plans for. RAN config
+    // updates sent to the PHY and to the UEs take effect from this frame.
     size_t scheduler_next_frame_id_ = 0;
 
+    // The modulation order (in bits) currently scheduled by link adaptation
+    size_t mod_order_bits_;
+
     FastRand fast_rand_;
 
     // Server-only members
@@ -165,6 +193,9 @@ private:
 
         // snr_[i] contains a moving window of SNR measurement for UE #i
         std::array<std::queue<float>, kMaxUEs> snr_;
+
+        // snr_sum_[i] is the sum of the SNR measurements in snr_[i]
+        std::array<double, kMaxUEs> snr_sum_;
     } server_;
 
     // Client-only members
@@ -238,6 +238,79 @@ static double bench_mod_64qam(unsigned iterations, unsigned mode)
     return end_time - start_time;
 }
 
+// Benchmark soft demodulation for modulation orders that have only soft
+// demodulation kernels (QPSK and 256-QAM). Check that the SIMD kernel matches
+// the loop kernel, and that the signs of the LLRs recover the input bits.
+static double bench_mod_soft_only(
+    unsigned mod_order, unsigned iterations, unsigned mode)
+{
+    if (mode == 0) {
+        printf("Error: hard demodulation not supported for this order!\n");
+        return 0;
+    }
+
+    unsigned mod_order_bits = log2(mod_order);
+    void (*demod_soft_loop)(float*, int8_t*, int);
+    void (*demod_soft_avx2)(float*, int8_t*, int);
+    if (mod_order == 4) {
+        demod_soft_loop = demod_qpsk_soft_loop;
+        demod_soft_avx2 = demod_qpsk_soft_avx2;
+    } else {
+        demod_soft_loop = demod_256qam_soft_loop;
+        demod_soft_avx2 = demod_256qam_soft_avx2;
+    }
+
+    int* input;
+    complex_float* output_mod;
+    Table<complex_float> mod_table;
+    init_modulation_table(mod_table, mod_order);
+    unsigned int num = 300;
+    int8_t* output_demod_loop;
+    int8_t* output_demod_avx2;
+
+    alloc_buffer_1d(&input, num, 32, 1);
+    alloc_buffer_1d(&output_mod, num, 32, 1);
+    alloc_buffer_1d(&output_demod_loop, num * mod_order_bits, 32, 1);
+    alloc_buffer_1d(&output_demod_avx2, num * mod_order_bits, 32, 1);
+
+    for (unsigned i = 0; i < num; i++)
+        input[i] = i % mod_order;
+
+    double start_time = get_time();
+    for (unsigned i = 0; i < iterations; i++) {
+        for (unsigned j = 0; j < num; j++)
+            output_mod[j] = mod_single(input[j], mod_table);
+        demod_soft_loop((float*)output_mod, output_demod_loop, num);
+        demod_soft_avx2((float*)output_mod, output_demod_avx2, num);
+    }
+    double end_time = get_time();
+
+    int num_error = 0;
+    int num_bit_error = 0;
+    for (unsigned i = 0; i < num; i++) {
+        for (unsigned j = 0; j < mod_order_bits; j++) {
+            size_t k = i * mod_order_bits + j;
+            if (output_demod_loop[k] != output_demod_avx2[k])
+                num_error++;
+            // A positive LLR means bit 0; LLRs are ordered from the MSB
+            int bit = (input[i] >> (mod_order_bits - 1 - j)) & 1;
+            if ((output_demod_avx2[k] > 0 ? 0 : 1) != bit)
+                num_bit_error++;
+        }
+    }
+    printf("error rate %d/%d, bit errors %d/%d\n", num_error,
+        num * mod_order_bits, num_bit_error, num * mod_order_bits);
+
+    return end_time - start_time;
+}
+
+static void run_benchmark_soft_only(
+    unsigned mod_order, unsigned iterations, unsigned mode)
+{
+    double time = bench_mod_soft_only(mod_order, iterations, mode);
+    printf("time: %.2f us per iteration\n", time / iterations);
+}
+
 static void run_benchmark_16qam(unsigned iterations, unsigned mode)
 {
     double time = bench_mod_16qam(iterations, mode);
@@ -254,8 +327,8 @@ int main(int argc, char* argv[])
 {
     if (argc != 4) {
         fprintf(stderr,
-            "Usage: %s [modulation order 4/16/64] [mode hard(0)/soft(1)] "
-            "[iterations]\n",
+            "Usage: %s [modulation order 4/16/64/256] "
+            "[mode hard(0)/soft(1)] [iterations]\n",
             argv[0]);
         return 1;
     }
@@ -274,9 +347,9 @@ int main(int argc, char* argv[])
         unsigned mod_order = strtoul(argv[1], NULL, 0);
         unsigned mode = strtoul(argv[2], NULL, 0);
         unsigned iterations = strtoul(argv[3], NULL, 0);
-        // if (mod_order == 4)
-        //     run_benchmark_qpsk(mod_order, iterations);
-        if (mod_order == 16)
+        if (mod_order == 4 || mod_order == 256)
+            run_benchmark_soft_only(mod_order, iterations, mode);
+        else if (mod_order == 16)
             run_benchmark_16qam(iterations, mode);
         else if (mod_order == 64)
             run_benchmark_64qam(iterations, mode);
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "bfp.h"
+#include <random>
+#include <vector>
+
+// Not a multiple of kBfpBlockSamples, so the last block is padded
+static constexpr size_t kNumSamples = 2048 + 150;
+
+// Compress random samples, with a different dynamic range per block, and
+// check that decompressing them loses at most the bits below each block's
+// exponent
+static void check_roundtrip(size_t iq_width)
+{
+    std::mt19937 gen(iq_width);
+    std::vector<short> in(2 * kNumSamples);
+    for (size_t i = 0; i < in.size(); i += 2 * kBfpBlockSamples) {
+        const int range = 1 << (gen() % 16);
+        std::uniform_int_distribution<int> dist(-range, range - 1);
+        for (size_t j = i; j < std::min(in.size(), i + 2 * kBfpBlockSamples);
+             j++) {
+            in[j] = dist(gen);
+        }
+    }
+
+    const size_t num_bytes = bfp_compressed_bytes(kNumSamples, iq_width);
+    ASSERT_EQ(num_bytes,
+        (kNumSamples / kBfpBlockSamples + 1) * (1 + 3 * iq_width));
+    std::vector<uint8_t> compressed(num_bytes);
+    bfp_compress(in.data(), kNumSamples, iq_width, compressed.data());
+
+    std::vector<float> out(2 * kNumSamples);
+    bfp_decompress(compressed.data(), iq_width, kNumSamples, 0, kNumSamples,
+        out.data());
+    for (size_t i = 0; i < in.size(); i++) {
+        const size_t exponent = compressed[i / (2 * kBfpBlockSamples)
+            * bfp_block_bytes(iq_width)];
+        ASSERT_LE(exponent, 16 - iq_width);
+        const float err = in[i] - out[i] * 32768.f;
+        ASSERT_GE(err, 0) << "width " << iq_width << ", value " << i;
+        ASSERT_LT(err, 1 << exponent) << "width " << iq_width << ", value "
+                                      << i;
+    }
+
+    // Compressing the samples as scaled floats gives the same bytes
+    std::vector<float> in_float(in.size());
+    for (size_t i = 0; i < in.size(); i++)
+        in_float[i] = in[i] / 4.f;
+    std::vector<uint8_t> compressed_float(num_bytes);
+    bfp_compress_float(in_float.data(), kNumSamples, 4.f, iq_width,
+        compressed_float.data());
+    ASSERT_TRUE(compressed == compressed_float);
+
+    // Decompressing a part of the symbol, which need not start or end at a
+    // block boundary, gives the same values
+    const size_t first = 5, num = kNumSamples - 12;
+    std::vector<float> part(2 * num);
+    bfp_decompress(
+        compressed.data(), iq_width, kNumSamples, first, num, part.data());
+    for (size_t i = 0; i < part.size(); i++)
+        ASSERT_EQ(part[i], out[2 * first + i]);
+}
+
+TEST(TestBfp, Width8) { check_roundtrip(8); }
+
+TEST(TestBfp, Width9) { check_roundtrip(9); }
+
+TEST(TestBfp, Width12) { check_roundtrip(12); }
+
+TEST(TestBfp, CompHdr)
+{
+    ASSERT_EQ(bfp_comp_hdr(9), 0x91);
+    ASSERT_TRUE(bfp_width_supported(12));
+    ASSERT_FALSE(bfp_width_supported(16));
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "crc.hpp"
+#include "docoding.hpp"
+#include <random>
+#include <vector>
+
+static constexpr size_t kNumCbBytes = 1056; // Includes the CRC
+
+// A codeblock with its CRC passes the check, and flipping any single bit of
+// the information bytes or the CRC makes it fail
+TEST(TestDecodeCrc, CodeblockCrc)
+{
+    DoCRC crc;
+    std::mt19937 gen(1);
+    std::vector<unsigned char> cb(kNumCbBytes);
+    for (auto& v : cb)
+        v = gen();
+    crc.add_cb_crc24(cb.data(), kNumCbBytes);
+    ASSERT_TRUE(crc.check_cb_crc24(cb.data(), kNumCbBytes));
+
+    for (size_t bit = 0; bit < kNumCbBytes * 8; bit += 7) {
+        cb[bit / 8] ^= 1 << (bit % 8);
+        ASSERT_FALSE(crc.check_cb_crc24(cb.data(), kNumCbBytes))
+            << "bit " << bit;
+        cb[bit / 8] ^= 1 << (bit % 8);
+    }
+    ASSERT_TRUE(crc.check_cb_crc24(cb.data(), kNumCbBytes));
+}
+
+// The adaptive iteration budget stays within [iter_min, iter_max], from a
+// frame with all of its time left to one past its deadline
+TEST(TestDecodeCrc, IterationBudget)
+{
+    const int16_t iter_max = 5, iter_min = 1;
+    const size_t deadline_cycles = 1000000;
+
+    ASSERT_EQ(DoDecode::iteration_budget(
+                  iter_max, iter_min, deadline_cycles, deadline_cycles),
+        iter_max);
+    ASSERT_EQ(DoDecode::iteration_budget(
+                  iter_max, iter_min, deadline_cycles / 2, deadline_cycles),
+        iter_max);
+    ASSERT_EQ(
+        DoDecode::iteration_budget(iter_max, iter_min, 0, deadline_cycles),
+        iter_min);
+    ASSERT_EQ(DoDecode::iteration_budget(iter_max, iter_min, 0, 0), iter_min);
+
+    int16_t prev = iter_max;
+    for (size_t remaining = deadline_cycles; remaining > 0;
+         remaining -= deadline_cycles / 100) {
+        const int16_t budget = DoDecode::iteration_budget(
+            iter_max, iter_min, remaining, deadline_cycles);
+        ASSERT_GE(budget, iter_min);
+        ASSERT_LE(budget, iter_max);
+        ASSERT_LE(budget, prev) << "remaining " << remaining;
+        prev = budget;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -28,12 +28,12 @@ void MasterToWorkerDynamic_master(Config* cfg,
     }
 
     for (size_t bs_ant_idx = 0; bs_ant_idx < kModTestNum; bs_ant_idx++) {
-        cfg->update_mod_cfgs(mod_bits_nums[bs_ant_idx]);
         for (size_t i = 0; i < kMaxTestNum; i++) {
             uint32_t frame_id = i
                     / (cfg->demul_events_per_symbol
                           * cfg->ul_data_symbol_num_perframe)
                 + frame_offsets[bs_ant_idx];
+            cfg->set_frame_mod_order_bits(frame_id, mod_bits_nums[bs_ant_idx]);
             uint32_t symbol_id = (i / cfg->demul_events_per_symbol)
                 % cfg->ul_data_symbol_num_perframe;
             size_t base_sc_id
@@ -93,7 +93,8 @@ void MasterToWorkerDynamic_worker(Config* cfg, size_t worker_id,
                 and cur_frame_id - frame_offsets[2] <= max_frame_id_wo_offset) {
                 frame_offset_id = 2;
             }
-            ASSERT_EQ(cfg->mod_order_bits, mod_bits_nums[frame_offset_id]);
+            ASSERT_EQ(cfg->mod_cfg(cur_frame_id).mod_order_bits,
+                mod_bits_nums[frame_offset_id]);
             Event_data resp_event = computeDemul->launch(req_event.tags[0]);
             try_enqueue_fallback(&complete_task_queue, ptok, resp_event);
         }
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "equalize.hpp"
+#include <complex>
+#include <random>
+#include <vector>
+
+typedef std::complex<float> cx;
+
+static constexpr size_t kNumSCs = 2 * kEqualizeTileSCs;
+
+// Compare an equalization kernel against a scalar reference for
+// [bs_ant_num] antennas and [ue_num] UEs, with and without phase correction
+static void check_kernel_dims(
+    EqualizeTileFn fn, size_t bs_ant_num, size_t ue_num)
+{
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+
+    std::vector<complex_float> data(kNumSCs * bs_ant_num);
+    for (auto& v : data)
+        v = { dist(gen), dist(gen) };
+    std::vector<std::vector<complex_float>> ul_zf(kNumSCs,
+        std::vector<complex_float>(bs_ant_num * ue_num));
+    for (auto& zf : ul_zf) {
+        for (auto& v : zf)
+            v = { dist(gen), dist(gen) };
+    }
+    std::vector<complex_float> phase(ue_num);
+    for (auto& v : phase)
+        v = { dist(gen), dist(gen) };
+
+    for (bool use_phase : { false, true }) {
+        for (size_t base = 0; base < kNumSCs; base += kEqualizeTileSCs) {
+            complex_float* ul_zf_ptrs[kEqualizeTileSCs];
+            for (size_t j = 0; j < kEqualizeTileSCs; j++)
+                ul_zf_ptrs[j] = ul_zf[base + j].data();
+            alignas(64) complex_float tile[kMaxUEs * kEqualizeTileSCs];
+            fn(data.data(), ul_zf_ptrs, use_phase ? phase.data() : nullptr,
+                bs_ant_num, ue_num, base, kEqualizeTileSCs, tile);
+
+            for (size_t j = 0; j < kEqualizeTileSCs; j++) {
+                const size_t offset
+                    = equalize_data_offset(base + j, bs_ant_num);
+                for (size_t u = 0; u < ue_num; u++) {
+                    cx y = 0;
+                    for (size_t a = 0; a < bs_ant_num; a++) {
+                        complex_float w = ul_zf[base + j][a * ue_num + u];
+                        complex_float x
+                            = data[offset + a * kTransposeBlockSize];
+                        y += cx(w.re, w.im) * cx(x.re, x.im);
+                    }
+                    if (use_phase)
+                        y *= cx(phase[u].re, phase[u].im);
+                    complex_float t = tile[u * kEqualizeTileSCs + j];
+                    ASSERT_LT(std::abs(y - cx(t.re, t.im)), 1e-4)
+                        << "bs_ant_num " << bs_ant_num << ", ue_num " << ue_num
+                        << ", sc " << base + j << ", ue " << u;
+                }
+            }
+        }
+    }
+}
+
+// Compare an equalization kernel against a scalar reference for a range of
+// antenna and UE counts
+static void check_kernel(EqualizeTileFn fn)
+{
+    for (size_t bs_ant_num : { 8, 12, 16, 64 }) {
+        for (size_t ue_num : { 1, 4, 7, 8, 16 })
+            check_kernel_dims(fn, bs_ant_num, ue_num);
+    }
+}
+
+// Check the specialized kernels for all their antenna and UE counts
+static void check_fixed_kernels(bool use_avx512)
+{
+    const size_t dims[][2] = { { 8, 4 }, { 16, 8 }, { 32, 8 }, { 64, 16 },
+        { 64, 32 } };
+    for (const auto& d : dims) {
+        EqualizeTileFn fn
+            = select_fixed_equalize_tile_fn(d[0], d[1], use_avx512);
+        ASSERT_TRUE(fn != nullptr);
+        check_kernel_dims(fn, d[0], d[1]);
+    }
+    ASSERT_TRUE(select_fixed_equalize_tile_fn(12, 7, use_avx512) == nullptr);
+}
+
+TEST(TestEqualize, AVX2) { check_kernel(equalize_tile_avx2); }
+
+TEST(TestEqualize, AVX512)
+{
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx512f")) {
+        printf("AVX-512 not supported, skipping\n");
+        return;
+    }
+    check_kernel(equalize_tile_avx512);
+}
+
+TEST(TestEqualize, FixedAVX2) { check_fixed_kernels(false); }
+
+TEST(TestEqualize, FixedAVX512)
+{
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx512f")) {
+        printf("AVX-512 not supported, skipping\n");
+        return;
+    }
+    check_fixed_kernels(true);
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "fft_transpose.hpp"
+#include <complex>
+#include <malloc.h>
+#include <random>
+#include <vector>
+
+typedef std::complex<float> cx;
+
+static constexpr size_t kNumBlocks = 16;
+static constexpr size_t kNumSCs = kNumBlocks * kTransposeBlockSize;
+static constexpr size_t kDataStart = 4; // Not a multiple of kSCsPerCacheline
+
+// Check that [out_buf] holds the partial transpose of [in] for every antenna,
+// multiplied with the conjugate of [pilots_sgn] if it is not nullptr
+static void check_output(const std::vector<complex_float>& in,
+    const complex_float* out_buf, size_t bs_ant_num,
+    const complex_float* pilots_sgn)
+{
+    for (size_t ant_id = 0; ant_id < bs_ant_num; ant_id++) {
+        for (size_t sc = 0; sc < kNumSCs; sc++) {
+            const complex_float x = in[ant_id * kNumSCs + sc];
+            cx expected(x.re, x.im);
+            if (pilots_sgn != nullptr)
+                expected *= std::conj(cx(pilots_sgn[sc].re, pilots_sgn[sc].im));
+            const complex_float y = out_buf[(sc / kTransposeBlockSize)
+                    * (kTransposeBlockSize * bs_ant_num)
+                + ant_id * kTransposeBlockSize + sc % kTransposeBlockSize];
+            ASSERT_LT(std::abs(expected - cx(y.re, y.im)), 1e-5)
+                << "ant " << ant_id << ", sc " << sc;
+        }
+    }
+}
+
+// Transpose random symbols of [bs_ant_num] antennas with [fn] and
+// [fp16_fn], as data and as pilot symbols, and compare with a scalar
+// reference
+static void check_kernels(FFTTransposeFn fn, FP16TransposeFn fp16_fn)
+{
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    complex_float* pilots_sgn = reinterpret_cast<complex_float*>(
+        memalign(64, kNumSCs * sizeof(complex_float)));
+    for (size_t i = 0; i < kNumSCs; i++)
+        pilots_sgn[i] = { dist(gen), dist(gen) };
+
+    for (size_t bs_ant_num : { 8, 12, 64 }) {
+        const size_t out_size = kNumSCs * bs_ant_num;
+        complex_float* out_buf = reinterpret_cast<complex_float*>(
+            memalign(64, out_size * sizeof(complex_float)));
+
+        // Each antenna's FFT output has kDataStart guard subcarriers
+        std::vector<complex_float> in(out_size);
+        std::vector<complex_float> fft_out(kDataStart + kNumSCs);
+        std::vector<uint16_t> fp16_in(2 * (kDataStart + kNumSCs));
+        for (const complex_float* pilots : { pilots_sgn,
+                 static_cast<complex_float*>(nullptr) }) {
+            for (auto& v : in)
+                v = { dist(gen), dist(gen) };
+            for (size_t ant_id = 0; ant_id < bs_ant_num; ant_id++) {
+                memcpy(&fft_out[kDataStart], &in[ant_id * kNumSCs],
+                    kNumSCs * sizeof(complex_float));
+                fn(&fft_out[kDataStart], out_buf, ant_id, bs_ant_num,
+                    kNumBlocks, pilots);
+            }
+            check_output(in, out_buf, bs_ant_num, pilots);
+
+            // Round the input to fp16 for the fp16 kernel
+            for (size_t ant_id = 0; ant_id < bs_ant_num; ant_id++) {
+                for (size_t sc = 0; sc < kNumSCs; sc++) {
+                    complex_float& v = in[ant_id * kNumSCs + sc];
+                    fp16_in[2 * (kDataStart + sc)] = _cvtss_sh(v.re, 0);
+                    fp16_in[2 * (kDataStart + sc) + 1] = _cvtss_sh(v.im, 0);
+                    v = { _cvtsh_ss(fp16_in[2 * (kDataStart + sc)]),
+                        _cvtsh_ss(fp16_in[2 * (kDataStart + sc) + 1]) };
+                }
+                fp16_fn(&fp16_in[2 * kDataStart], out_buf, ant_id,
+                    bs_ant_num, kNumBlocks, pilots);
+            }
+            check_output(in, out_buf, bs_ant_num, pilots);
+        }
+        free(out_buf);
+    }
+    free(pilots_sgn);
+}
+
+TEST(TestFFTTranspose, AVX2)
+{
+    check_kernels(fft_transpose_avx2, fp16_transpose_avx2);
+}
+
+TEST(TestFFTTranspose, AVX512)
+{
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx512f")) {
+        printf("AVX-512 not supported, skipping\n");
+        return;
+    }
+    check_kernels(fft_transpose_avx512, fp16_transpose_avx512);
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
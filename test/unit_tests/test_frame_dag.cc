@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "frame_dag.hpp"
+
+static constexpr size_t kNumULSymbols = 13;
+static constexpr size_t kNumDLSymbols = 5;
+
+// A data symbol is ready only after both its FFT and the frame's ZF are done,
+// in either order
+TEST(TestFrameDag, SymbolDependencies)
+{
+    FrameDag dag;
+    dag.init(kNumULSymbols, kNumDLSymbols);
+
+    // Frame 0: FFT of all symbols completes before ZF
+    for (size_t i = 0; i < kNumULSymbols; i++)
+        ASSERT_FALSE(dag.resolve_ul(0, i));
+    for (size_t i = 0; i < kNumULSymbols; i++)
+        ASSERT_TRUE(dag.resolve_ul(0, i));
+
+    // Frame 1 overlaps with frame 0: ZF completes first
+    for (size_t i = 0; i < kNumDLSymbols; i++)
+        ASSERT_FALSE(dag.resolve_dl(1, i));
+    for (size_t i = 0; i < kNumDLSymbols; i++)
+        ASSERT_TRUE(dag.resolve_dl(1, i));
+
+    // Counters are re-armed when the slot is reused
+    ASSERT_FALSE(dag.resolve_ul(kFrameWnd, 0));
+    ASSERT_TRUE(dag.resolve_ul(kFrameWnd, 0));
+}
+
+// Frames that complete out of order are retired in order
+TEST(TestFrameDag, InOrderRetirement)
+{
+    FrameDag dag;
+    dag.init(kNumULSymbols, kNumDLSymbols);
+    size_t frame_id;
+
+    dag.set_frame_done(2);
+    dag.set_frame_done(1);
+    ASSERT_FALSE(dag.try_retire_oldest(frame_id));
+    ASSERT_EQ(dag.oldest_frame(), 0u);
+
+    dag.set_frame_done(0);
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(dag.try_retire_oldest(frame_id));
+        ASSERT_EQ(frame_id, i);
+    }
+    ASSERT_FALSE(dag.try_retire_oldest(frame_id));
+    ASSERT_EQ(dag.oldest_frame(), 3u);
+
+    // The frame window slides with the oldest frame
+    dag.set_frame_done(3 + kFrameWnd - 1);
+    ASSERT_FALSE(dag.try_retire_oldest(frame_id));
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
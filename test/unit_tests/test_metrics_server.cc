@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "metrics_server.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t kMetricsPort = 19090;
+
+// Return the response to an HTTP request for the metrics at [port]
+static std::string scrape(size_t port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))
+        != 0) {
+        close(fd);
+        return "";
+    }
+
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    send(fd, request.data(), request.size(), 0);
+    std::string response;
+    char buf[4096];
+    ssize_t ret;
+    while ((ret = recv(fd, buf, sizeof(buf), 0)) > 0)
+        response.append(buf, ret);
+    close(fd);
+    return response;
+}
+
+static MetricsSnapshot make_snapshot()
+{
+    MetricsSnapshot snapshot = MetricsSnapshot();
+    snapshot.num_frames_done = 42;
+    snapshot.frame_lag = 3;
+    snapshot.task_count[static_cast<size_t>(DoerType::kFFT)] = 100;
+    snapshot.queue_depth[static_cast<size_t>(EventType::kDemul)] = 7;
+    snapshot.num_latencies = 100;
+    for (size_t i = 0; i < snapshot.num_latencies; i++)
+        snapshot.frame_latency_us[i] = 100 - i; // 1 to 100 us
+    snapshot.num_ues = 2;
+    snapshot.decoded_blocks[1] = 50;
+    snapshot.block_errors[1] = 5;
+    snapshot.rx_drop_stat.num_late = 9;
+    return snapshot;
+}
+
+TEST(TestMetricsServer, Format)
+{
+    const std::string text = MetricsServer::format(make_snapshot());
+    const char* expected_lines[] = { "agora_frames_done_total 42\n",
+        "agora_frame_lag 3\n", "agora_tasks_total{stage=\"fft\"} 100\n",
+        "agora_queue_depth{queue=\"demul\"} 7\n",
+        "agora_frame_latency_us{quantile=\"0.5\"} 51\n",
+        "agora_frame_latency_us{quantile=\"1\"} 100\n",
+        "agora_frame_latency_us_count 100\n",
+        "agora_ue_decoded_blocks_total{ue=\"1\"} 50\n",
+        "agora_ue_block_errors_total{ue=\"1\"} 5\n",
+        "agora_rx_dropped_packets_total{reason=\"late\"} 9\n",
+        "# TYPE agora_frame_latency_us summary\n" };
+    for (const char* line : expected_lines)
+        ASSERT_NE(text.find(line), std::string::npos) << line;
+    ASSERT_EQ(text.find("ue=\"2\""), std::string::npos);
+}
+
+// A scraper gets the last published snapshot over HTTP
+TEST(TestMetricsServer, Scrape)
+{
+    MetricsServer server(kMetricsPort);
+    ASSERT_NE(scrape(kMetricsPort).find("agora_frames_done_total 0\n"),
+        std::string::npos);
+
+    server.publish(make_snapshot());
+    const std::string response = scrape(kMetricsPort);
+    ASSERT_EQ(response.find("HTTP/1.0 200 OK\r\n"), 0u);
+    ASSERT_NE(response.find("agora_frames_done_total 42\n"), std::string::npos);
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "numa_utils.hpp"
+#include <stdexcept>
+
+// Two nodes with eight CPUs each, numbered like a typical two-socket server
+static const std::vector<size_t> kNodes = { 0, 1 };
+static const std::vector<std::vector<size_t>> kCpusOfNodes
+    = { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } };
+
+// Workers are split evenly across nodes, with the first node taking the
+// smaller share for an odd number of workers
+TEST(TestNumaUtils, EvenSplit)
+{
+    ASSERT_EQ(NumaUtils::assign_worker_cores(kNodes, kCpusOfNodes, 6, {}),
+        std::vector<size_t>({ 0, 1, 2, 8, 9, 10 }));
+    ASSERT_EQ(NumaUtils::assign_worker_cores(kNodes, kCpusOfNodes, 5, {}),
+        std::vector<size_t>({ 0, 1, 8, 9, 10 }));
+    ASSERT_EQ(NumaUtils::assign_worker_cores({ 1 }, { kCpusOfNodes[1] }, 3, {}),
+        std::vector<size_t>({ 8, 9, 10 }));
+}
+
+// Reserved cores, e.g., of the master and socket threads, are skipped
+TEST(TestNumaUtils, ReservedCores)
+{
+    ASSERT_EQ(
+        NumaUtils::assign_worker_cores(kNodes, kCpusOfNodes, 4, { 0, 2, 9 }),
+        std::vector<size_t>({ 1, 3, 8, 10 }));
+
+    // Node 0 has only two free cores left for its four workers
+    ASSERT_THROW(NumaUtils::assign_worker_cores(
+                     kNodes, kCpusOfNodes, 8, { 0, 1, 2, 3, 4, 5 }),
+        std::runtime_error);
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "precode.hpp"
+#include <complex>
+#include <random>
+#include <vector>
+
+typedef std::complex<float> cx;
+
+// Compare the specialized precoding kernels against a scalar reference for
+// all their antenna and UE counts
+TEST(TestPrecode, Fixed)
+{
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    const size_t dims[][2] = { { 8, 4 }, { 16, 8 }, { 32, 8 }, { 64, 16 },
+        { 64, 32 } };
+
+    for (const auto& d : dims) {
+        const size_t bs_ant_num = d[0], ue_num = d[1];
+        PrecodeScFn fn = select_precode_sc_fn(bs_ant_num, ue_num);
+        ASSERT_TRUE(fn != nullptr);
+
+        std::vector<complex_float> precoder(bs_ant_num * ue_num);
+        for (auto& v : precoder)
+            v = { dist(gen), dist(gen) };
+        std::vector<complex_float> data(ue_num);
+        for (auto& v : data)
+            v = { dist(gen), dist(gen) };
+        std::vector<complex_float> precoded(bs_ant_num);
+        fn(precoder.data(), data.data(), precoded.data());
+
+        for (size_t a = 0; a < bs_ant_num; a++) {
+            cx y = 0;
+            for (size_t u = 0; u < ue_num; u++) {
+                complex_float w = precoder[u * bs_ant_num + a];
+                y += cx(w.re, w.im) * cx(data[u].re, data[u].im);
+            }
+            ASSERT_LT(std::abs(y - cx(precoded[a].re, precoded[a].im)), 1e-4)
+                << "bs_ant_num " << bs_ant_num << ", ue_num " << ue_num
+                << ", antenna " << a;
+        }
+    }
+    ASSERT_TRUE(select_precode_sc_fn(12, 7) == nullptr);
+}
+
+// Precode blocks of antennas, including a partial last block, with
+// precode_sc_ants_avx2() and compare against a scalar reference
+TEST(TestPrecode, AntennaBlocks)
+{
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    const size_t bs_ant_num = 22, ue_num = 7;
+
+    std::vector<complex_float> precoder(bs_ant_num * ue_num);
+    for (auto& v : precoder)
+        v = { dist(gen), dist(gen) };
+    std::vector<complex_float> data(ue_num);
+    for (auto& v : data)
+        v = { dist(gen), dist(gen) };
+
+    for (size_t block_size : { 1, 3, 8, 22 }) {
+        for (size_t ant_start = 0; ant_start < bs_ant_num;
+             ant_start += block_size) {
+            const size_t num_ants
+                = std::min(block_size, bs_ant_num - ant_start);
+            // One extra element checks that nothing is written past the end
+            std::vector<complex_float> precoded(num_ants + 1, { 7, 7 });
+            precode_sc_ants_avx2(precoder.data(), data.data(), bs_ant_num,
+                ue_num, ant_start, num_ants, precoded.data());
+
+            for (size_t i = 0; i < num_ants; i++) {
+                cx y = 0;
+                for (size_t u = 0; u < ue_num; u++) {
+                    complex_float w = precoder[u * bs_ant_num + ant_start + i];
+                    y += cx(w.re, w.im) * cx(data[u].re, data[u].im);
+                }
+                ASSERT_LT(
+                    std::abs(y - cx(precoded[i].re, precoded[i].im)), 1e-4)
+                    << "block size " << block_size << ", antenna "
+                    << ant_start + i;
+            }
+            ASSERT_EQ(precoded[num_ants].re, 7);
+        }
+    }
+}
+
+// Modulate a block of subcarriers, and the block without its last three
+// subcarriers, with modulate_block_avx2(), and compare against scalar
+// modulation and pilot insertion
+static void check_modulate_block(const std::vector<int8_t>& raw,
+    size_t raw_stride, const std::vector<const complex_float*>& pilots,
+    size_t base_sc_id, const std::vector<size_t>& pilot_sc_flags,
+    const std::vector<complex_float>& mod_table, size_t ue_num)
+{
+    const size_t num_scs = pilot_sc_flags.size();
+    for (size_t n : { num_scs, num_scs - 3 }) {
+        std::vector<complex_float> out(n * ue_num);
+        modulate_block_avx2(raw.data(), raw_stride, pilots.data(), base_sc_id,
+            pilot_sc_flags.data(), mod_table.data(), ue_num, n, out.data());
+
+        for (size_t sc = 0; sc < n; sc++) {
+            for (size_t u = 0; u < ue_num; u++) {
+                const size_t sc_id = base_sc_id + sc;
+                const complex_float expected = pilot_sc_flags[sc] == 1
+                    ? pilots[u][sc_id]
+                    : mod_table[raw[u * raw_stride + sc_id]];
+                ASSERT_EQ(out[sc * ue_num + u].re, expected.re)
+                    << "ue_num " << ue_num << ", sc " << sc << ", ue " << u;
+                ASSERT_EQ(out[sc * ue_num + u].im, expected.im);
+            }
+        }
+    }
+}
+
+// Check modulate_block_avx2() for UE counts with and without a partial group
+// of four UEs, in data and pilot symbols
+TEST(TestPrecode, ModulateBlock)
+{
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    const size_t num_scs = 64, raw_stride = 128, base_sc_id = 9;
+    const size_t table_size = 64;
+
+    std::vector<complex_float> mod_table(table_size);
+    for (auto& v : mod_table)
+        v = { dist(gen), dist(gen) };
+    std::vector<size_t> pilot_sc_flags(num_scs);
+
+    for (size_t ue_num : { 1, 4, 7, 16 }) {
+        std::vector<int8_t> raw(ue_num * raw_stride);
+        for (auto& v : raw)
+            v = gen() % table_size;
+        std::vector<std::vector<complex_float>> pilot_rows(ue_num);
+        std::vector<const complex_float*> pilots(ue_num);
+        for (size_t u = 0; u < ue_num; u++) {
+            pilot_rows[u].resize(raw_stride);
+            for (auto& v : pilot_rows[u])
+                v = { dist(gen), dist(gen) };
+            pilots[u] = pilot_rows[u].data();
+        }
+
+        // A data symbol with some pilot subcarriers, and a pilot symbol
+        for (size_t pilot_symbol : { 0, 1 }) {
+            for (size_t i = 0; i < num_scs; i++)
+                pilot_sc_flags[i] = pilot_symbol == 1 or i % 5 == 0 ? 1 : 0;
+            check_modulate_block(raw, raw_stride, pilots, base_sc_id,
+                pilot_sc_flags, mod_table, ue_num);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "buffer.hpp"
+#include "gettime.h"
+#include "task_tracer.hpp"
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static constexpr double kFreqGhz = 2.0;
+static const std::string kTraceFile = "/tmp/test_task_tracer.json";
+
+// Return the task events of worker [tid] in the trace at [filename]
+static std::vector<json> load_tasks(const std::string& filename, size_t tid)
+{
+    std::ifstream file(filename);
+    json trace;
+    file >> trace;
+
+    std::vector<json> ret;
+    for (auto& event : trace["traceEvents"]) {
+        if (event["ph"] == "X" && event["tid"] == tid)
+            ret.push_back(event);
+    }
+    return ret;
+}
+
+// Tasks are saved with their event type, tag, and duration
+TEST(TestTaskTracer, SaveTasks)
+{
+    TaskTracer tracer(2, 4, kFreqGhz);
+    const size_t start_tsc = rdtsc();
+    tracer.ring(1)->record(EventType::kDemul,
+        gen_tag_t::frm_sym_sc(7, 3, 48)._tag, start_tsc, start_tsc + 2000);
+    tracer.save(kTraceFile);
+
+    ASSERT_TRUE(load_tasks(kTraceFile, 0).empty());
+    std::vector<json> tasks = load_tasks(kTraceFile, 1);
+    ASSERT_EQ(tasks.size(), 1u);
+    ASSERT_EQ(tasks[0]["name"], "Demul");
+    ASSERT_EQ(tasks[0]["args"]["frame"], 7);
+    ASSERT_EQ(tasks[0]["args"]["symbol"], 3);
+    ASSERT_EQ(tasks[0]["args"]["id"], 48);
+    ASSERT_NEAR(tasks[0]["dur"].get<double>(), 1.0, 0.001);
+    ASSERT_GE(tasks[0]["ts"].get<double>(), 0.0);
+}
+
+// A full ring keeps only the newest tasks, in order
+TEST(TestTaskTracer, RingWrap)
+{
+    TaskTracer tracer(1, 3, kFreqGhz); // Rounded up to four records
+    for (size_t i = 0; i < 10; i++) {
+        const size_t tsc = rdtsc();
+        tracer.ring(0)->record(
+            EventType::kFFT, gen_tag_t::frm_sym(i, 0)._tag, tsc, tsc + 100);
+    }
+    tracer.save(kTraceFile);
+
+    std::vector<json> tasks = load_tasks(kTraceFile, 0);
+    ASSERT_EQ(tasks.size(), 4u);
+    for (size_t i = 0; i < tasks.size(); i++) {
+        ASSERT_EQ(tasks[i]["name"], "FFT");
+        ASSERT_EQ(tasks[i]["args"]["frame"], 6 + i);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "config.hpp"
+#include "utils.h"
+#include "work_stealing.hpp"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static constexpr size_t kNumWorkers = 8;
+static constexpr size_t kNumTestFrames = 3 * kFrameWnd;
+
+// The first code block of each decode event, per (frame, symbol)
+struct DecodeEventLog {
+    std::mutex mutex;
+    std::vector<std::vector<size_t>> cb_ids;
+};
+
+// One worker schedules decode tasks for all symbols of each frame. All
+// workers (including the producer) drain the queues, so most tasks must be
+// stolen. Each symbol must be reported complete exactly once.
+void StealDecodeTasks_worker(WorkStealingScheduler* sched, Config* cfg,
+    size_t tid, std::atomic<size_t>* num_symbols_done,
+    std::atomic<size_t>* num_tasks_done, DecodeEventLog* log)
+{
+    const size_t num_symbols = cfg->ul_data_symbol_num_perframe;
+    const size_t total_symbols = kNumTestFrames * num_symbols;
+    Event_data event;
+    while (num_symbols_done->load() < total_symbols) {
+        if (!sched->try_get_task(tid, event))
+            continue;
+        ASSERT_EQ(event.event_type, EventType::kDecode);
+        num_tasks_done->fetch_add(event.num_tags);
+        const size_t frame_id = gen_tag_t(event.tags[0]).frame_id;
+        const size_t symbol_idx_ul = gen_tag_t(event.tags[0]).symbol_id;
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            log->cb_ids[frame_id * num_symbols + symbol_idx_ul].push_back(
+                gen_tag_t(event.tags[0]).cb_id);
+        }
+        if (sched->decode_tasks_done(frame_id, symbol_idx_ul, event.num_tags))
+            num_symbols_done->fetch_add(1);
+    }
+}
+
+TEST(TestWorkStealing, StealDecodeTasks)
+{
+    auto* cfg = new Config("data/tddconfig-sim-ul.json");
+    cfg->worker_thread_num = kNumWorkers;
+    auto* sched = new WorkStealingScheduler(cfg);
+
+    const size_t num_symbols = cfg->ul_data_symbol_num_perframe;
+    std::atomic<size_t> num_symbols_done(0);
+    std::atomic<size_t> num_tasks_done(0);
+    DecodeEventLog log;
+    log.cb_ids.resize(kNumTestFrames * num_symbols);
+
+    std::thread workers[kNumWorkers];
+    for (size_t i = 0; i < kNumWorkers; i++) {
+        workers[i] = std::thread(StealDecodeTasks_worker, sched, cfg, i,
+            &num_symbols_done, &num_tasks_done, &log);
+    }
+
+    // Keep at most kFrameWnd frames in flight, like Agora does
+    for (size_t frame_id = 0; frame_id < kNumTestFrames; frame_id++) {
+        if (frame_id % kFrameWnd == 0) {
+            while (num_symbols_done.load() < frame_id * num_symbols) {
+                // Wait for the previous window of frames to be decoded
+            }
+        }
+        for (size_t i = 0; i < num_symbols; i++)
+            sched->schedule_codeblocks(0 /* tid */, frame_id, i);
+    }
+
+    for (auto& w : workers)
+        w.join();
+
+    // Each decode event covers decode_batch_size consecutive code blocks, and
+    // the events of a symbol together cover all of its code blocks
+    size_t num_events = 0;
+    for (size_t frame_id = 0; frame_id < kNumTestFrames; frame_id++) {
+        const ModConfig& mod_cfg = cfg->mod_cfg(frame_id);
+        const size_t num_cbs = cfg->UE_NUM * mod_cfg.nblocksInSymbol;
+        for (size_t i = 0; i < num_symbols; i++) {
+            std::vector<size_t>& cb_ids
+                = log.cb_ids[frame_id * num_symbols + i];
+            std::sort(cb_ids.begin(), cb_ids.end());
+            ASSERT_EQ(cb_ids.size(), mod_cfg.decode_events_per_symbol);
+            for (size_t j = 0; j < cb_ids.size(); j++)
+                ASSERT_EQ(cb_ids[j], j * mod_cfg.decode_batch_size);
+            ASSERT_LT(cb_ids.back(), num_cbs);
+            ASSERT_GE(cb_ids.back() + mod_cfg.decode_batch_size, num_cbs);
+            num_events += cb_ids.size();
+        }
+    }
+
+    ASSERT_EQ(num_symbols_done.load(), kNumTestFrames * num_symbols);
+    ASSERT_EQ(num_tasks_done.load(), num_events);
+
+    size_t num_steals = 0;
+    for (size_t i = 0; i < kNumWorkers; i++)
+        num_steals += sched->get_num_steals(i);
+    printf("%zu of %zu decode events were stolen\n", num_steals,
+        num_tasks_done.load());
+
+    delete sched;
+    delete cfg;
+}
+
+// Exactly one of the demodulation tasks of a symbol must be reported as the
+// last one, even if the tasks complete concurrently
+TEST(TestWorkStealing, LastDemulTask)
+{
+    auto* cfg = new Config("data/tddconfig-sim-ul.json");
+    cfg->worker_thread_num = kNumWorkers;
+    auto* sched = new WorkStealingScheduler(cfg);
+
+    const size_t num_symbols = cfg->ul_data_symbol_num_perframe;
+    std::atomic<size_t> num_last_tasks(0);
+    std::thread workers[kNumWorkers];
+    for (size_t i = 0; i < kNumWorkers; i++) {
+        workers[i] = std::thread([&, i]() {
+            for (size_t frame_id = 0; frame_id < kFrameWnd; frame_id++) {
+                for (size_t s = 0; s < num_symbols; s++) {
+                    for (size_t t = i; t < cfg->demul_events_per_symbol;
+                         t += kNumWorkers) {
+                        if (sched->demul_task_done(frame_id, s))
+                            num_last_tasks++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+
+    ASSERT_EQ(num_last_tasks.load(), kFrameWnd * num_symbols);
+
+    delete sched;
+    delete cfg;
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+#include "xdp_slot_pool.hpp"
+#include <vector>
+
+static constexpr size_t kNumSlots = 8;
+static constexpr size_t kMaxPosted = 4;
+
+// At most kMaxPosted slots are owned by the kernel at a time
+TEST(TestXdpSlotPool, PostLimit)
+{
+    XdpSlotPool pool;
+    pool.init(kNumSlots, kMaxPosted);
+    ASSERT_EQ(pool.num_postable(), kMaxPosted);
+
+    std::vector<size_t> posted;
+    while (pool.num_postable() > 0)
+        posted.push_back(pool.post());
+    ASSERT_EQ(posted.size(), kMaxPosted);
+    ASSERT_EQ(pool.num_posted(), kMaxPosted);
+
+    pool.receive(posted[0], false /* in_use */);
+    ASSERT_EQ(pool.num_postable(), 1u);
+}
+
+// The kernel may return posted slots in any order. Slots that are not in use
+// by Agora are immediately free again.
+TEST(TestXdpSlotPool, OutOfOrderReceive)
+{
+    XdpSlotPool pool;
+    pool.init(kNumSlots, kMaxPosted);
+    std::vector<size_t> posted;
+    while (pool.num_postable() > 0)
+        posted.push_back(pool.post());
+
+    std::vector<int> buffer_status(kNumSlots, 0);
+    pool.receive(posted[2], true /* in_use */);
+    buffer_status[posted[2]] = 1;
+    pool.receive(posted[0], false /* in_use */);
+    pool.receive(posted[3], true /* in_use */);
+    buffer_status[posted[3]] = 1;
+    ASSERT_EQ(pool.num_posted(), 1u);
+    ASSERT_EQ(pool.num_in_use(), 2u);
+
+    // Re-posting never hands out a slot that is posted or in use
+    std::vector<size_t> reposted;
+    while (pool.num_postable() > 0)
+        reposted.push_back(pool.post());
+    ASSERT_EQ(reposted.size(), kMaxPosted - 1);
+    for (size_t slot : reposted) {
+        ASSERT_LT(slot, kNumSlots);
+        ASSERT_NE(slot, posted[1]);
+        ASSERT_NE(slot, posted[2]);
+        ASSERT_NE(slot, posted[3]);
+    }
+}
+
+// Slots are reclaimed once Agora clears their buffer status, in the order
+// they were received
+TEST(TestXdpSlotPool, Reclaim)
+{
+    XdpSlotPool pool;
+    pool.init(kNumSlots, kNumSlots);
+    std::vector<int> buffer_status(kNumSlots, 0);
+    std::vector<size_t> posted;
+    while (pool.num_postable() > 0)
+        posted.push_back(pool.post());
+    for (size_t slot : posted) {
+        pool.receive(slot, true /* in_use */);
+        buffer_status[slot] = 1;
+    }
+    ASSERT_EQ(pool.num_postable(), 0u);
+
+    // A slot released out of order waits for the slots received before it
+    buffer_status[posted[1]] = 0;
+    pool.reclaim(&buffer_status[0]);
+    ASSERT_EQ(pool.num_postable(), 0u);
+
+    buffer_status[posted[0]] = 0;
+    pool.reclaim(&buffer_status[0]);
+    ASSERT_EQ(pool.num_postable(), 2u);
+    ASSERT_EQ(pool.num_in_use(), kNumSlots - 2);
+}
+
+// Receiving a frame in a slot that was not posted is an error
+TEST(TestXdpSlotPool, ReceiveUnpostedSlot)
+{
+    XdpSlotPool pool;
+    pool.init(kNumSlots, kMaxPosted);
+    const size_t slot = pool.post();
+    pool.receive(slot, false /* in_use */);
+    ASSERT_ANY_THROW(pool.receive(slot, false /* in_use */));
+    ASSERT_ANY_THROW(pool.receive(kNumSlots, false /* in_use */));
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
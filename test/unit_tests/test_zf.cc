@@ -5,6 +5,59 @@
 #include "dozf.hpp"
 #include "gettime.h"
 #include "utils.h"
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Allocation-counting hook: count heap allocations made by any thread while
+// count_allocs is set, by interposing the glibc allocation functions
+static std::atomic<bool> count_allocs(false);
+static std::atomic<size_t> num_allocs(0);
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size)
+{
+    if (count_allocs)
+        num_allocs++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size)
+{
+    if (count_allocs)
+        num_allocs++;
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if (count_allocs)
+        num_allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    if (count_allocs)
+        num_allocs++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    if (count_allocs)
+        num_allocs++;
+    *memptr = __libc_memalign(alignment, size);
+    return *memptr == nullptr ? ENOMEM : 0;
+}
+}
 
 /// Measure performance of zeroforcing
 TEST(TestZF, Perf)
@@ -51,6 +104,231 @@ TEST(TestZF, Perf)
     printf("Time per zeroforcing iteration = %.4f ms\n", ms / kNumIters);
 }
 
+/// Steady-state zeroforcing must not allocate memory, for both the uplink
+/// detector and the downlink precoder
+void NoAllocation_run(const char* conf_file)
+{
+    static constexpr size_t kNumWarmupIters = 10;
+    static constexpr size_t kNumIters = 1000;
+    auto* cfg = new Config(conf_file);
+    cfg->genData();
+    double freq_ghz = measure_rdtsc_freq();
+
+    auto event_queue = moodycamel::ConcurrentQueue<Event_data>(2 * kNumIters);
+    auto comp_queue = moodycamel::ConcurrentQueue<Event_data>(2 * kNumIters);
+    auto ptok = new moodycamel::ProducerToken(comp_queue);
+
+    PtrGrid<kFrameWnd, kMaxUEs, complex_float> csi_buffers;
+    csi_buffers.rand_alloc_cx_float(cfg->BS_ANT_NUM * cfg->OFDM_DATA_NUM);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ul_zf_matrices(
+        cfg->BS_ANT_NUM * cfg->UE_NUM);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> dl_zf_matrices(
+        cfg->UE_NUM * cfg->BS_ANT_NUM);
+    Table<complex_float> calib_buffer;
+    calib_buffer.rand_alloc_cx_float(
+        kFrameWnd, cfg->OFDM_DATA_NUM * cfg->BS_ANT_NUM, 64);
+
+    auto stats = new Stats(cfg, kMaxStatBreakdown, freq_ghz);
+    auto computeZF = new DoZF(cfg, 0 /* tid */, freq_ghz, event_queue,
+        comp_queue, ptok, csi_buffers, calib_buffer, ul_zf_matrices,
+        dl_zf_matrices, stats);
+
+    const size_t num_blocks = cfg->OFDM_DATA_NUM / cfg->zf_block_size;
+    for (size_t i = 0; i < kNumWarmupIters + kNumIters; i++) {
+        // Let MKL initialize its internal buffers during warmup
+        if (i == kNumWarmupIters)
+            count_allocs = true;
+        computeZF->launch(gen_tag_t::frm_sc(i % kFrameWnd,
+            (i % num_blocks) * cfg->zf_block_size)._tag);
+    }
+    count_allocs = false;
+
+    ASSERT_EQ(num_allocs.load(), 0u) << "Zeroforcing allocated memory";
+
+    delete computeZF;
+    delete stats;
+    delete ptok;
+    delete cfg;
+}
+
+TEST(TestZF, NoAllocationUplink)
+{
+    NoAllocation_run("data/tddconfig-sim-ul.json");
+}
+
+TEST(TestZF, NoAllocationDownlink)
+{
+    NoAllocation_run("data/tddconfig-sim-dl.json");
+}
+
+// Sum of squared magnitudes of the differences between two matrices
+static double diff_norm(complex_float* a, complex_float* b, size_t n)
+{
+    double ret = 0;
+    for (size_t i = 0; i < n; i++) {
+        ret += std::pow(a[i].re - b[i].re, 2) + std::pow(a[i].im - b[i].im, 2);
+    }
+    return ret;
+}
+
+/// In ZF tracking mode, identical CSI reuses the reference zeroforcing
+/// matrices, slightly changed CSI refines them, and new CSI is fully inverted
+TEST(TestZF, Tracking)
+{
+    auto* cfg = new Config("data/tddconfig-sim-ul.json");
+    cfg->genData();
+    cfg->zf_tracking_mode = true;
+    cfg->zf_reuse_threshold = 1e-6;
+    cfg->zf_refine_threshold = 0.05;
+    double freq_ghz = measure_rdtsc_freq();
+    const size_t csi_size = cfg->BS_ANT_NUM * cfg->UE_NUM;
+
+    auto event_queue = moodycamel::ConcurrentQueue<Event_data>(64);
+    auto comp_queue = moodycamel::ConcurrentQueue<Event_data>(64);
+    auto ptok = new moodycamel::ProducerToken(comp_queue);
+
+    PtrGrid<kFrameWnd, kMaxUEs, complex_float> csi_buffers;
+    csi_buffers.rand_alloc_cx_float(cfg->BS_ANT_NUM * cfg->OFDM_DATA_NUM);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ul_zf_matrices(csi_size);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> dl_zf_matrices(csi_size);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ref_ul_zf_matrices(
+        csi_size);
+    Table<complex_float> calib_buffer;
+    calib_buffer.rand_alloc_cx_float(
+        kFrameWnd, cfg->OFDM_DATA_NUM * cfg->BS_ANT_NUM, 64);
+
+    // Frame 1 has the same CSI as frame 0, and frame 2 has slightly different
+    // CSI. Frame 3 has unrelated random CSI.
+    std::default_random_engine generator;
+    std::uniform_real_distribution<float> distribution(-0.05, 0.05);
+    for (size_t i = 0; i < cfg->UE_NUM; i++) {
+        const size_t n = cfg->BS_ANT_NUM * cfg->OFDM_DATA_NUM;
+        memcpy(csi_buffers[1][i], csi_buffers[0][i], n * sizeof(complex_float));
+        for (size_t j = 0; j < n; j++) {
+            const complex_float& h = csi_buffers[0][i][j];
+            const float scale = 1 + distribution(generator);
+            csi_buffers[2][i][j] = { h.re * scale, h.im * scale };
+        }
+    }
+
+    auto stats = new Stats(cfg, kMaxStatBreakdown, freq_ghz);
+    auto tracker
+        = new ZFTracker(cfg->OFDM_DATA_NUM, cfg->BS_ANT_NUM, cfg->UE_NUM);
+    auto computeZF = new DoZF(cfg, 0 /* tid */, freq_ghz, event_queue,
+        comp_queue, ptok, csi_buffers, calib_buffer, ul_zf_matrices,
+        dl_zf_matrices, stats, tracker);
+    auto computeZFRef = new DoZF(cfg, 1 /* tid */, freq_ghz, event_queue,
+        comp_queue, ptok, csi_buffers, calib_buffer, ref_ul_zf_matrices,
+        dl_zf_matrices, stats);
+    ZFTrackingStat* zf_tracking_stat = stats->get_zf_tracking_stat(0);
+
+    const size_t num_tasks = cfg->OFDM_DATA_NUM / cfg->zf_block_size;
+    for (size_t frame_id = 0; frame_id < 4; frame_id++) {
+        for (size_t i = 0; i < num_tasks; i++) {
+            const size_t tag
+                = gen_tag_t::frm_sc(frame_id, i * cfg->zf_block_size)._tag;
+            computeZF->launch(tag);
+            computeZFRef->launch(tag);
+        }
+    }
+
+    ASSERT_EQ(zf_tracking_stat->num_reused, num_tasks);
+    ASSERT_EQ(zf_tracking_stat->num_refined, num_tasks);
+    ASSERT_EQ(zf_tracking_stat->num_full, 2 * num_tasks);
+
+    for (size_t i = 0; i < num_tasks; i++) {
+        const size_t sc_id = cfg->get_zf_sc_id(i * cfg->zf_block_size);
+
+        // Reused and fully computed matrices are exact
+        ASSERT_LT(diff_norm(ul_zf_matrices[1][sc_id],
+                      ref_ul_zf_matrices[1][sc_id], csi_size),
+            1e-6);
+        ASSERT_LT(diff_norm(ul_zf_matrices[3][sc_id],
+                      ref_ul_zf_matrices[3][sc_id], csi_size),
+            1e-6);
+
+        // The refined matrix must be closer to the exact one than the stale
+        // matrix from frame 0
+        ASSERT_LT(diff_norm(ul_zf_matrices[2][sc_id],
+                      ref_ul_zf_matrices[2][sc_id], csi_size),
+            0.5
+                * diff_norm(ul_zf_matrices[0][sc_id],
+                    ref_ul_zf_matrices[2][sc_id], csi_size));
+    }
+
+    delete computeZF;
+    delete computeZFRef;
+    delete tracker;
+    delete stats;
+    delete ptok;
+    delete cfg;
+}
+
+/// Batched zeroforcing must match per-subcarrier zeroforcing, including for
+/// partial batches and for the partial last ZF block of a symbol
+TEST(TestZF, Batched)
+{
+    // With 8 antennas and 2 users, H' * H is well-conditioned enough for
+    // single-precision results to agree closely
+    auto* cfg = new Config("data/bs-ul-sim.json");
+    double freq_ghz = measure_rdtsc_freq();
+    const size_t csi_size = cfg->BS_ANT_NUM * cfg->UE_NUM;
+
+    auto event_queue = moodycamel::ConcurrentQueue<Event_data>(64);
+    auto comp_queue = moodycamel::ConcurrentQueue<Event_data>(64);
+    auto ptok = new moodycamel::ProducerToken(comp_queue);
+
+    PtrGrid<kFrameWnd, kMaxUEs, complex_float> csi_buffers;
+    csi_buffers.rand_alloc_cx_float(cfg->BS_ANT_NUM * cfg->OFDM_DATA_NUM);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ul_zf_matrices(csi_size);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> dl_zf_matrices(csi_size);
+    PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ref_ul_zf_matrices(
+        csi_size);
+    Table<complex_float> calib_buffer;
+    calib_buffer.rand_alloc_cx_float(
+        kFrameWnd, cfg->OFDM_DATA_NUM * cfg->BS_ANT_NUM, 64);
+
+    // DoZF batches subcarriers only if the ZF block size exceeds one
+    auto stats = new Stats(cfg, kMaxStatBreakdown, freq_ghz);
+    cfg->zf_block_size = 1;
+    auto computeZFRef = new DoZF(cfg, 1 /* tid */, freq_ghz, event_queue,
+        comp_queue, ptok, csi_buffers, calib_buffer, ref_ul_zf_matrices,
+        dl_zf_matrices, stats);
+
+    // Each block has one full and one partial batch, and the last block of
+    // the symbol is shorter than the others
+    cfg->zf_block_size = BatchedZF::kBatchSize + 5;
+    ASSERT_NE(cfg->OFDM_DATA_NUM % cfg->zf_block_size, 0u);
+    auto computeZF = new DoZF(cfg, 0 /* tid */, freq_ghz, event_queue,
+        comp_queue, ptok, csi_buffers, calib_buffer, ul_zf_matrices,
+        dl_zf_matrices, stats);
+
+    const size_t frame_id = 0;
+    for (size_t base_sc_id = 0; base_sc_id < cfg->OFDM_DATA_NUM;
+         base_sc_id += cfg->zf_block_size) {
+        const size_t tag = gen_tag_t::frm_sc(frame_id, base_sc_id)._tag;
+        computeZF->launch(tag);
+        computeZFRef->launch(tag);
+    }
+
+    std::vector<complex_float> zero(csi_size, { 0, 0 });
+    for (size_t sc_id = 0; sc_id < cfg->OFDM_DATA_NUM; sc_id++) {
+        const double ref_norm = diff_norm(
+            ref_ul_zf_matrices[frame_id][sc_id], &zero[0], csi_size);
+        ASSERT_GT(ref_norm, 0) << "Subcarrier " << sc_id;
+        ASSERT_LT(diff_norm(ul_zf_matrices[frame_id][sc_id],
+                      ref_ul_zf_matrices[frame_id][sc_id], csi_size),
+            1e-6 * ref_norm)
+            << "Subcarrier " << sc_id;
+    }
+
+    delete computeZF;
+    delete computeZFRef;
+    delete stats;
+    delete ptok;
+    delete cfg;
+}
+
 int main(int argc, char** argv)
 {
     testing::InitGoogleTest(&argc, argv);